@@ -1,6 +1,8 @@
 #include "astepcooler_test.h"
 #include "rk4solver.h"
+#include "telemetry.h"
 #include "thermal_model.h"
+#include "thermal_model_accuracy.h"
 #include "thermal_model_overload_predictor.h"
 #include "thermal_model_state_space.h"
 
@@ -14,9 +16,15 @@
 
 #define RUN_THERMAL_MANAGER true
 #define PRINT_TEMPERATURES false
+#define LOG_TELEMETRY false
+#define PRINT_ACCURACY_REPORT false
 
 RK4SOLVER_INPUT rk4input;
 RK4SOLVER_OUTPUT rk4output;
+float rk4state[ ASC_THERMAL_MODEL_NUM_STATES ];
+float rk4outputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+float rk4workspace[ RK4SOLVER_WORKSPACE_LENGTH( ASC_THERMAL_MODEL_NUM_STATES,
+                                                ASC_THERMAL_MODEL_NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
 
 ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR overloadPredictor = 
 {
@@ -31,6 +39,7 @@ ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR overloadPredictor =
   { 5.4168f, 16.0000f, 4.4368f },
   (void*)0,
   (void*)0,
+  (void*)0,
   (void*)0
 };
 
@@ -39,13 +48,26 @@ static void _cleanupRK4Solver( RK4SOLVER_INPUT * input, RK4SOLVER_OUTPUT * outpu
 
 int main( int argc, char *argv[] )
 {
+  int exitCode = 0;
+  
   if ( RUN_THERMAL_MANAGER )
   {
+    static ASC_TELEMETRY_RECORD records[ 256U ];
+    static ASC_TELEMETRY_RING ring;
+    ASC_TELEMETRY_RING * rings[ 1U ] = { &ring };
+    ASC_TELEMETRY_WRITER writer = { 0 };
     uint32_t itr = 0U;
     float ins[ ASC_THERMAL_MODEL_NUM_INPUTS ];
     float temp[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
     ASC_THERMAL_MODEL_Setup();
     
+    if ( LOG_TELEMETRY &&
+         ASC_TELEMETRY_Init( &ring, records, 256U ) &&
+         ASC_TELEMETRY_StartWriter( &writer, rings, 1U, "astepcooler_telemetry.bin" ) )
+    {
+      ASC_THERMAL_MODEL_SetTelemetry( &ring, 0U );
+    }
+    
     ASC_THERMAL_MODEL_CalculateSourceInputs( (float*)ins, 4.0f, 0.0 );
     
     printf( "inputs: [ %6.4f, %6.4f, %6.4f ]\n", ins[ 0U ], ins[ 1U ], ins[ 2U ] );
@@ -57,6 +79,12 @@ int main( int argc, char *argv[] )
       ASC_THERMAL_MODEL_PeriodicTask();
       //ASC_THERMAL_MODEL_BackgroundTask();
       
+      if ( LOG_TELEMETRY )
+      {
+        // records are written by the telemetry consumer thread
+        continue;
+      }
+      
       //printf( "%4u ", itr );
       
       ASC_THERMAL_MODEL_GetCurrentTemp( (float*)temp );
@@ -77,6 +105,13 @@ int main( int argc, char *argv[] )
       printf( "\n" );
     }
     
+    if ( LOG_TELEMETRY )
+    {
+      ASC_THERMAL_MODEL_SetTelemetry( (ASC_TELEMETRY_RING*)0, 0U );
+      ASC_TELEMETRY_StopWriter( &writer );
+      printf( "telemetry: %u records dropped\n", ring.dropped );
+    }
+    
     ASC_THERMAL_MODEL_Cleanup();
   }
   
@@ -168,27 +203,51 @@ int main( int argc, char *argv[] )
     overloadPredictor.solverOutputs = (void*) 0;
   }
   
+  if ( PRINT_ACCURACY_REPORT )
+  {
+    ASC_THERMAL_MODEL_ACCURACY_RESULT results[ ASC_THERMAL_MODEL_ACCURACY_MAX_RESULTS ];
+    uint32_t numResults = ASC_THERMAL_MODEL_ACCURACY_Run( results, ASC_THERMAL_MODEL_ACCURACY_MAX_RESULTS );
+    uint32_t itr = 0U;
+    
+    printf( "# %-10s %-22s %10s %10s %10s\n", "scenario", "mode", "max err", "rms err", "ns/step" );
+    
+    for ( itr = 0U; itr < numResults; itr++ )
+    {
+      printf( "  %-10s %-22s %10.3e %10.3e %10.1f %s\n",
+              results[ itr ].scenario,
+              results[ itr ].mode,
+              results[ itr ].maxAbsError,
+              results[ itr ].rmsError,
+              results[ itr ].nsPerStep,
+              results[ itr ].passed ? "ok" : "FAIL" );
+      
+      if ( !results[ itr ].passed )
+      {
+        exitCode = 1;
+      }
+    }
+  }
   
-  
-  return 0;
+  return exitCode;
 }
 
 void _setupRK4Solver( RK4SOLVER_INPUT * input, RK4SOLVER_OUTPUT * output )
 {
   input->h = overloadPredictor.h;
   
-  input->currentState = calloc( ASC_THERMAL_MODEL_NUM_STATES, sizeof( float ) );
+  input->currentState = rk4state;
   memcpy( (char*)input->currentState, (char*)overloadPredictor.initialState, ASC_THERMAL_MODEL_NUM_STATES * sizeof( float ) );
+  input->workspace = rk4workspace;
     
   output->nextState = input->currentState;
-  output->nextOutput = calloc( ASC_THERMAL_MODEL_NUM_OUTPUTS, sizeof( float ) );
+  output->nextOutput = rk4outputs;
 }
 
 void _cleanupRK4Solver( RK4SOLVER_INPUT * input, RK4SOLVER_OUTPUT * output )
 {
-  free( input->currentState );
   input->currentState = 0;
+  input->workspace = 0;
   
-  free( output->nextOutput );
+  output->nextState = 0;
   output->nextOutput = 0;
 }
@@ -0,0 +1,303 @@
+/**
+ * @file
+ * @brief Definition and implementation of the live state export
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "live_state.h"
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined( ASC_LIVE_STATE_HAS_SHM )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Seqlock ordering: the writer makes the sequence odd before touching the
+ * snapshot and even again after it, the reader checks the sequence on both
+ * sides of its copy. Hosted compilers get the fences from the builtins; on
+ * single core targets without them the volatile accesses are sufficient.
+ */
+#if defined( __GNUC__ )
+#define LOAD_ACQUIRE( p ) __atomic_load_n( (p), __ATOMIC_ACQUIRE )
+#define LOAD_RELAXED( p ) __atomic_load_n( (p), __ATOMIC_RELAXED )
+#define STORE_RELAXED( p, v ) __atomic_store_n( (p), (v), __ATOMIC_RELAXED )
+#define STORE_RELEASE( p, v ) __atomic_store_n( (p), (v), __ATOMIC_RELEASE )
+#define FENCE_RELEASE() __atomic_thread_fence( __ATOMIC_RELEASE )
+#define FENCE_ACQUIRE() __atomic_thread_fence( __ATOMIC_ACQUIRE )
+#else
+#define LOAD_ACQUIRE( p ) ( *(p) )
+#define LOAD_RELAXED( p ) ( *(p) )
+#define STORE_RELAXED( p, v ) ( *(p) = (v) )
+#define STORE_RELEASE( p, v ) ( *(p) = (v) )
+#define FENCE_RELEASE()
+#define FENCE_ACQUIRE()
+#endif
+
+/*!
+ * \brief Lays out a table on caller provided memory, e.g. a RAM region read
+ * by a debug probe, or the mapping made by ASC_LIVE_STATE_Create
+ * \param table The table to be initialized
+ * \param memory At least ASC_LIVE_STATE_SIZE( numSlots ) bytes, aligned to
+ * ASC_LIVE_STATE_CACHE_LINE for the best results
+ * \param size Bytes available at memory
+ * \param numSlots Number of model instances the table holds
+ * \return success
+ */
+bool ASC_LIVE_STATE_Init( ASC_LIVE_STATE_TABLE * table, void * memory, size_t size, uint32_t numSlots )
+{
+  bool status = false;
+
+  if ( table && memory && ( numSlots > 0U ) && ( size >= ASC_LIVE_STATE_SIZE( numSlots ) ) )
+  {
+    ASC_LIVE_STATE_HEADER * header = (ASC_LIVE_STATE_HEADER*)memory;
+
+    memset( (char*)table, 0, sizeof( *table ) );
+    memset( (char*)memory, 0, ASC_LIVE_STATE_SIZE( numSlots ) );
+
+    header->version = ASC_LIVE_STATE_VERSION;
+    header->slotSize = (uint16_t)sizeof( ASC_LIVE_STATE_SLOT );
+    header->numOutputs = ASC_THERMAL_MODEL_NUM_OUTPUTS;
+    header->numInputs = ASC_THERMAL_MODEL_NUM_INPUTS;
+    header->numSlots = numSlots;
+    // a reader that sees the magic sees a complete header
+    STORE_RELEASE( &header->magic, (uint32_t)ASC_LIVE_STATE_MAGIC );
+
+    table->header = header;
+    table->slots = (ASC_LIVE_STATE_SLOT*)( header + 1 );
+    table->numSlots = numSlots;
+    table->size = ASC_LIVE_STATE_SIZE( numSlots );
+    table->fd = -1;
+    status = true;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Writer side, replaces the snapshot of one slot. Bounded time, no
+ * system call and no lock, so it can run from the control loop. Each slot
+ * must have a single writer.
+ * \param table The table being written
+ * \param slot Index of the model instance
+ * \param snapshot The new state, publishCount is filled in here
+ */
+void ASC_LIVE_STATE_Publish( ASC_LIVE_STATE_TABLE * table,
+                             uint32_t slot,
+                             const ASC_LIVE_STATE_SNAPSHOT * snapshot )
+{
+  if ( table && table->slots && snapshot && ( slot < table->numSlots ) )
+  {
+    ASC_LIVE_STATE_SLOT * entry = &table->slots[ slot ];
+    uint32_t sequence = entry->sequence;
+    uint32_t publishCount = entry->snapshot.publishCount;
+
+    STORE_RELAXED( &entry->sequence, sequence + 1U );
+    FENCE_RELEASE();
+
+    memcpy( (char*)&entry->snapshot, (const char*)snapshot, sizeof( entry->snapshot ) );
+    entry->snapshot.publishCount = publishCount + 1U;
+
+    STORE_RELEASE( &entry->sequence, sequence + 2U );
+  }
+}
+
+/*!
+ * \brief Reader side, copies a consistent snapshot of one slot without
+ * blocking the writer
+ * \param table A created or attached table
+ * \param slot Index of the model instance
+ * \param snapshot [out] The copy
+ * \return success
+ * \retval false The slot is out of range, or the writer rewrote it on every
+ * one of ASC_LIVE_STATE_READ_RETRIES attempts
+ */
+bool ASC_LIVE_STATE_Read( const ASC_LIVE_STATE_TABLE * table,
+                          uint32_t slot,
+                          ASC_LIVE_STATE_SNAPSHOT * snapshot )
+{
+  bool status = false;
+
+  if ( table && table->slots && snapshot && ( slot < table->numSlots ) )
+  {
+    const ASC_LIVE_STATE_SLOT * entry = &table->slots[ slot ];
+    uint32_t attempt = 0U;
+
+    for ( attempt = 0U; ( attempt < ASC_LIVE_STATE_READ_RETRIES ) && !status; attempt++ )
+    {
+      uint32_t before = LOAD_ACQUIRE( &entry->sequence );
+
+      if ( ( before & 1U ) == 0U )
+      {
+        memcpy( (char*)snapshot, (const char*)&entry->snapshot, sizeof( *snapshot ) );
+        FENCE_ACQUIRE();
+        status = ( LOAD_RELAXED( &entry->sequence ) == before );
+      }
+    }
+  }
+
+  return status;
+}
+
+#if defined( ASC_LIVE_STATE_HAS_SHM )
+
+/*!
+ * \brief Creates, or recreates, a named POSIX shared memory table and maps it
+ * read-write for the controller process
+ * \param table [out] The mapped table
+ * \param name Shared memory object name, e.g. "/asc_live"
+ * \param numSlots Number of model instances the table holds
+ * \return success
+ * \note The only system calls are made here and in ASC_LIVE_STATE_Close
+ */
+bool ASC_LIVE_STATE_Create( ASC_LIVE_STATE_TABLE * table, const char * name, uint32_t numSlots )
+{
+  bool status = false;
+
+  if ( table && name && ( strlen( name ) < ASC_LIVE_STATE_NAME_LENGTH ) && ( numSlots > 0U ) )
+  {
+    size_t size = ASC_LIVE_STATE_SIZE( numSlots );
+    int fd = shm_open( name, O_CREAT | O_RDWR, 0644 );
+    void * memory = MAP_FAILED;
+
+    if ( ( fd >= 0 ) && ( ftruncate( fd, (off_t)size ) == 0 ) )
+    {
+      memory = mmap( (void*)0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    }
+
+    if ( ( memory != MAP_FAILED ) && ASC_LIVE_STATE_Init( table, memory, size, numSlots ) )
+    {
+      table->fd = fd;
+      table->owner = true;
+      strcpy( table->name, name );
+      status = true;
+    }
+    else
+    {
+      if ( memory != MAP_FAILED )
+      {
+        munmap( memory, size );
+      }
+
+      if ( fd >= 0 )
+      {
+        close( fd );
+        shm_unlink( name );
+      }
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Maps an existing table read only for a monitoring process
+ * \param table [out] The mapped table
+ * \param name Shared memory object name given to ASC_LIVE_STATE_Create
+ * \return success
+ * \retval false The object does not exist or was written by a build with a
+ * different model layout
+ */
+bool ASC_LIVE_STATE_Attach( ASC_LIVE_STATE_TABLE * table, const char * name )
+{
+  bool status = false;
+
+  if ( table && name && ( strlen( name ) < ASC_LIVE_STATE_NAME_LENGTH ) )
+  {
+    int fd = shm_open( name, O_RDONLY, 0 );
+    struct stat info;
+    void * memory = MAP_FAILED;
+    size_t size = 0U;
+
+    if ( ( fd >= 0 ) && ( fstat( fd, &info ) == 0 ) && ( (size_t)info.st_size >= sizeof( ASC_LIVE_STATE_HEADER ) ) )
+    {
+      size = (size_t)info.st_size;
+      memory = mmap( (void*)0, size, PROT_READ, MAP_SHARED, fd, 0 );
+    }
+
+    if ( memory != MAP_FAILED )
+    {
+      ASC_LIVE_STATE_HEADER * header = (ASC_LIVE_STATE_HEADER*)memory;
+
+      status = ( LOAD_ACQUIRE( &header->magic ) == (uint32_t)ASC_LIVE_STATE_MAGIC ) &&
+               ( header->version == ASC_LIVE_STATE_VERSION ) &&
+               ( header->slotSize == (uint16_t)sizeof( ASC_LIVE_STATE_SLOT ) ) &&
+               ( header->numOutputs == ASC_THERMAL_MODEL_NUM_OUTPUTS ) &&
+               ( header->numInputs == ASC_THERMAL_MODEL_NUM_INPUTS ) &&
+               ( size >= ASC_LIVE_STATE_SIZE( header->numSlots ) );
+
+      if ( status )
+      {
+        memset( (char*)table, 0, sizeof( *table ) );
+        table->header = header;
+        table->slots = (ASC_LIVE_STATE_SLOT*)( header + 1 );
+        table->numSlots = header->numSlots;
+        table->size = size;
+        table->fd = fd;
+        table->owner = false;
+        strcpy( table->name, name );
+      }
+      else
+      {
+        munmap( memory, size );
+      }
+    }
+
+    if ( !status && ( fd >= 0 ) )
+    {
+      close( fd );
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Unmaps a table. The creator also removes the shared memory object,
+ * attached readers keep their mapping until they close it.
+ * \param table A created or attached table
+ * \return success
+ */
+bool ASC_LIVE_STATE_Close( ASC_LIVE_STATE_TABLE * table )
+{
+  bool status = false;
+
+  if ( table && table->header && ( table->fd >= 0 ) )
+  {
+    status = ( munmap( (void*)table->header, table->size ) == 0 );
+    status = ( close( table->fd ) == 0 ) && status;
+
+    if ( table->owner )
+    {
+      status = ( shm_unlink( table->name ) == 0 ) && status;
+    }
+
+    memset( (char*)table, 0, sizeof( *table ) );
+    table->fd = -1;
+  }
+
+  return status;
+}
+
+#endif
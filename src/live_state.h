@@ -0,0 +1,128 @@
+/**
+ * @file
+ * @brief Defines the interface to the live state export, a seqlock protected
+ * table of the latest thermal model results that monitoring processes read
+ * from shared memory
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_LIVE_STATE_H_
+#define _ASC_LIVE_STATE_H_
+
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define ASC_LIVE_STATE_HAS_SHM 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASC_LIVE_STATE_MAGIC (0x4C435341UL) //!< "ASCL"
+#define ASC_LIVE_STATE_VERSION (1U)
+
+/* Every slot starts on its own cache line so writers of different axes never
+ * invalidate each other's lines */
+#define ASC_LIVE_STATE_CACHE_LINE (64U)
+
+/* Reader attempts before giving up on a slot that is being rewritten */
+#define ASC_LIVE_STATE_READ_RETRIES (64U)
+
+#define ASC_LIVE_STATE_NAME_LENGTH (64U)
+
+    /*!
+     * \brief The published state of one thermal model instance
+     */
+    typedef struct
+    {
+        uint64_t modelTime; //!< Model time in ms of the estimate
+        uint64_t predictionTime; //!< Model time in ms of the period the verdict was predicted from
+        uint32_t publishCount; //!< Number of publications, 0 if never written
+        uint16_t axis; //!< Axis identifier of the writer
+        uint8_t verdict; //!< 1U if overload is available
+        uint8_t reserved;
+        float outputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< Estimated temperatures
+        float maxTemps[ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< Predicted peaks of the overload profile
+        float inputs[ ASC_THERMAL_MODEL_NUM_INPUTS ]; //!< Heat source inputs of the period
+    } ASC_LIVE_STATE_SNAPSHOT;
+
+    /*!
+     * \brief One slot of the table. sequence is odd while the writer is
+     * updating the snapshot, a reader retries until it sees the same even
+     * value before and after its copy.
+     */
+    typedef struct
+    {
+        volatile uint32_t sequence;
+        uint32_t reserved;
+        ASC_LIVE_STATE_SNAPSHOT snapshot;
+        uint8_t pad[ ASC_LIVE_STATE_CACHE_LINE -
+                     ( ( sizeof( ASC_LIVE_STATE_SNAPSHOT ) + 8U ) % ASC_LIVE_STATE_CACHE_LINE ) ];
+    } ASC_LIVE_STATE_SLOT;
+
+    /*!
+     * \brief Header at the start of the table, a reader checks it against its
+     * own build before trusting the layout
+     */
+    typedef struct
+    {
+        uint32_t magic; //!< ASC_LIVE_STATE_MAGIC, stored last by the creator
+        uint16_t version; //!< ASC_LIVE_STATE_VERSION
+        uint16_t slotSize; //!< sizeof( ASC_LIVE_STATE_SLOT )
+        uint16_t numOutputs; //!< outputs per snapshot
+        uint16_t numInputs; //!< inputs per snapshot
+        uint32_t numSlots; //!< slots following the header
+        uint8_t pad[ ASC_LIVE_STATE_CACHE_LINE - 16U ];
+    } ASC_LIVE_STATE_HEADER;
+
+    /*!
+     * \brief A mapped table, either created by the controller process or
+     * attached read only by a monitor
+     */
+    typedef struct
+    {
+        ASC_LIVE_STATE_HEADER * header;
+        ASC_LIVE_STATE_SLOT * slots;
+        uint32_t numSlots;
+        size_t size; //!< Bytes mapped
+        int fd; //!< Shared memory descriptor, -1 for caller memory
+        bool owner; //!< Created the shared memory object, unlinks it on close
+        char name[ ASC_LIVE_STATE_NAME_LENGTH ];
+    } ASC_LIVE_STATE_TABLE;
+
+    #define ASC_LIVE_STATE_SIZE( numSlots ) ( sizeof( ASC_LIVE_STATE_HEADER ) + (size_t)( numSlots ) * sizeof( ASC_LIVE_STATE_SLOT ) )
+
+    extern bool ASC_LIVE_STATE_Init( ASC_LIVE_STATE_TABLE * table, void * memory, size_t size, uint32_t numSlots );
+    extern void ASC_LIVE_STATE_Publish( ASC_LIVE_STATE_TABLE * table,
+                                        uint32_t slot,
+                                        const ASC_LIVE_STATE_SNAPSHOT * snapshot );
+    extern bool ASC_LIVE_STATE_Read( const ASC_LIVE_STATE_TABLE * table,
+                                     uint32_t slot,
+                                     ASC_LIVE_STATE_SNAPSHOT * snapshot );
+#if defined( ASC_LIVE_STATE_HAS_SHM )
+    extern bool ASC_LIVE_STATE_Create( ASC_LIVE_STATE_TABLE * table, const char * name, uint32_t numSlots );
+    extern bool ASC_LIVE_STATE_Attach( ASC_LIVE_STATE_TABLE * table, const char * name );
+    extern bool ASC_LIVE_STATE_Close( ASC_LIVE_STATE_TABLE * table );
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
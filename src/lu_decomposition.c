@@ -0,0 +1,170 @@
+/**
+ * @file
+ * @brief Definition and implementation of the LU decomposition with partial
+ * pivoting of a dense square matrix
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lu_decomposition.h"
+#include <stdint.h>
+
+/*!
+ * \brief Factors a row major n x n matrix in place into [P]*[A] = [L]*[U],
+ * Doolittle form with partial pivoting. [L] has a unit diagonal that is not
+ * stored; both factors share the storage of the matrix.
+ * \param matrix [in,out] Pointer to the n x n matrix, replaced by [L] and [U]
+ * \param n Dimension of the matrix
+ * \param pivots [out] n row indices, row i of [P]*[A] is row pivots[i] of [A]
+ * \return success of failure
+ * \retval 0U Failure, the matrix is singular
+ * \retval 1U Success
+ */
+uint8_t LU_Factor( float * matrix,
+                   uint32_t n,
+                   uint32_t * pivots )
+{
+  uint8_t status = 0U; // failure
+  
+  if ( matrix && pivots && ( n > 0U ) )
+  {
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+    uint32_t k = 0U;
+    
+    status = 1U; // success
+    
+    for ( i = 0U; i < n; i++ )
+    {
+      pivots[ i ] = i;
+    }
+    
+    for ( k = 0U; ( k < n ) && ( status == 1U ); k++ )
+    {
+      uint32_t pivot = k;
+      float largest = 0.0f;
+      
+      for ( i = k; i < n; i++ )
+      {
+        float magnitude = matrix[ ( i * n ) + k ];
+        
+        magnitude = ( magnitude < 0.0f ) ? -magnitude : magnitude;
+        
+        if ( magnitude > largest )
+        {
+          largest = magnitude;
+          pivot = i;
+        }
+      }
+      
+      if ( largest == 0.0f )
+      {
+        status = 0U; // failure
+      }
+      else
+      {
+        if ( pivot != k )
+        {
+          uint32_t index = pivots[ k ];
+          
+          pivots[ k ] = pivots[ pivot ];
+          pivots[ pivot ] = index;
+          
+          for ( j = 0U; j < n; j++ )
+          {
+            float swap = matrix[ ( k * n ) + j ];
+            
+            matrix[ ( k * n ) + j ] = matrix[ ( pivot * n ) + j ];
+            matrix[ ( pivot * n ) + j ] = swap;
+          }
+        }
+        
+        for ( i = k + 1U; i < n; i++ )
+        {
+          float factor = matrix[ ( i * n ) + k ] / matrix[ ( k * n ) + k ];
+          
+          matrix[ ( i * n ) + k ] = factor;
+          
+          if ( factor != 0.0f )
+          {
+            for ( j = k + 1U; j < n; j++ )
+            {
+              matrix[ ( i * n ) + j ] -= factor * matrix[ ( k * n ) + j ];
+            }
+          }
+        }
+      }
+    }
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Solves [A]*x = b with the factors from LU_Factor by forward and back
+ * substitution
+ * \param lu Pointer to the n x n factors
+ * \param n Dimension of the matrix
+ * \param pivots The row permutation from LU_Factor
+ * \param b Pointer to the n long right hand side
+ * \param x [out] Pointer to the n long solution, must not alias b
+ * \return success of failure
+ * \retval 0U Failure
+ * \retval 1U Success
+ */
+uint8_t LU_Solve( const float * lu,
+                  uint32_t n,
+                  const uint32_t * pivots,
+                  const float * b,
+                  float * x )
+{
+  uint8_t status = 0U; // failure
+  
+  if ( lu && pivots && b && x && ( n > 0U ) )
+  {
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+    
+    // [L]*y = [P]*b, y is kept in x
+    for ( i = 0U; i < n; i++ )
+    {
+      float sum = b[ pivots[ i ] ];
+      
+      for ( j = 0U; j < i; j++ )
+      {
+        sum -= lu[ ( i * n ) + j ] * x[ j ];
+      }
+      
+      x[ i ] = sum;
+    }
+    
+    // [U]*x = y
+    for ( i = n; i > 0U; i-- )
+    {
+      uint32_t row = i - 1U;
+      float sum = x[ row ];
+      
+      for ( j = i; j < n; j++ )
+      {
+        sum -= lu[ ( row * n ) + j ] * x[ j ];
+      }
+      
+      x[ row ] = sum / lu[ ( row * n ) + row ];
+    }
+    
+    status = 1U; // success
+  }
+  
+  return status;
+}
@@ -0,0 +1,42 @@
+/** 
+ * @file
+ * @brief Defines the interface to the LU decomposition with partial pivoting
+ * of a dense square matrix
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_LU_DECOMPOSITION_H_
+#define _ASC_LU_DECOMPOSITION_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern uint8_t LU_Factor( float * matrix,
+                              uint32_t n,
+                              uint32_t * pivots );
+    extern uint8_t LU_Solve( const float * lu,
+                             uint32_t n,
+                             const uint32_t * pivots,
+                             const float * b,
+                             float * x );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,250 @@
+/**
+ * @file
+ * @brief Definition and implementation of the matrix exponential and exact
+ * zero order hold discretization of a state space representation
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "matrix_exponential.h"
+#include "rk4solver.h"
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/* The scaled matrix norm is kept below this bound so that the truncated
+ * Taylor series converges to double precision within MAX_TAYLOR_TERMS.
+ */
+static const double SCALED_NORM_LIMIT = 0.5;
+static const uint32_t MAX_TAYLOR_TERMS = 20U;
+static const uint32_t MAX_SQUARINGS = 64U;
+
+/*!
+ * \brief Infinity norm (maximum absolute row sum) of a square matrix
+ * \param matrix Pointer to n x n row major matrix
+ * \param n Dimension of the matrix
+ * \return The infinity norm
+ * \note As this is a static function, there is no input validation
+ */
+static double _NormInf( const double * matrix, uint32_t n )
+{
+  double norm = 0.0;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < n; i++ )
+  {
+    double rowSum = 0.0;
+
+    for ( j = 0U; j < n; j++ )
+    {
+      rowSum += fabs( matrix[ ( i * n ) + j ] );
+    }
+
+    if ( rowSum > norm )
+    {
+      norm = rowSum;
+    }
+  }
+
+  return norm;
+}
+
+/*!
+ * \brief Square matrix multiply result = lhs * rhs
+ * \param lhs First operand, n x n row major
+ * \param rhs Second operand, n x n row major
+ * \param result [out] Product, must not alias lhs or rhs
+ * \param n Dimension of the matrices
+ * \note As this is a static function, there is no input validation
+ */
+static void _MatMul( const double * lhs,
+                     const double * rhs,
+                     double * result,
+                     uint32_t n )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+  uint32_t k = 0U;
+
+  for ( i = 0U; i < n; i++ )
+  {
+    for ( j = 0U; j < n; j++ )
+    {
+      double sum = 0.0;
+
+      for ( k = 0U; k < n; k++ )
+      {
+        sum += lhs[ ( i * n ) + k ] * rhs[ ( k * n ) + j ];
+      }
+
+      result[ ( i * n ) + j ] = sum;
+    }
+  }
+}
+
+/*!
+ * \brief Calculates the matrix exponential result = e^[matrix] by scaling and
+ * squaring a truncated Taylor series.
+ * \param matrix Pointer to n x n row major matrix
+ * \param n Dimension of the matrix
+ * \param result [out] Pointer to n x n row major result
+ * \param workspace Scratch of MATEXP_WORKSPACE_LENGTH( n ) doubles
+ * \return success of failure and fill in result if successful
+ * \retval 0U Failure
+ * \retval 1U Success
+ */
+uint8_t MATEXP_Expm( const double * matrix,
+                     uint32_t n,
+                     double * result,
+                     double * workspace )
+{
+  uint8_t status = 0U; // failure
+
+  if ( matrix && result && workspace && ( n > 0U ) )
+  {
+    double * scaled = workspace;
+    double * term = scaled + ( n * n );
+    double * product = term + ( n * n );
+    double norm = _NormInf( matrix, n );
+    uint32_t squarings = 0U;
+    uint32_t k = 0U;
+    uint32_t i = 0U;
+    double scale = 1.0;
+
+    while ( ( norm * scale > SCALED_NORM_LIMIT ) && ( squarings < MAX_SQUARINGS ) )
+    {
+      scale *= 0.5;
+      squarings++;
+    }
+
+    for ( i = 0U; i < n * n; i++ )
+    {
+      scaled[ i ] = matrix[ i ] * scale;
+      term[ i ] = 0.0;
+      result[ i ] = 0.0;
+    }
+
+    for ( i = 0U; i < n; i++ )
+    {
+      term[ ( i * n ) + i ] = 1.0;
+      result[ ( i * n ) + i ] = 1.0;
+    }
+
+    // result = sum( X^k / k! )
+    for ( k = 1U; k <= MAX_TAYLOR_TERMS; k++ )
+    {
+      _MatMul( term, scaled, product, n );
+
+      for ( i = 0U; i < n * n; i++ )
+      {
+        term[ i ] = product[ i ] / (double)k;
+        result[ i ] += term[ i ];
+      }
+
+      if ( _NormInf( term, n ) <= DBL_EPSILON * _NormInf( result, n ) )
+      {
+        break;
+      }
+    }
+
+    // e^A = ( e^(A/2^s) )^(2^s)
+    for ( k = 0U; k < squarings; k++ )
+    {
+      _MatMul( result, result, product, n );
+      memcpy( (char*)result, (char*)product, n * n * sizeof( double ) );
+    }
+
+    status = 1U; // success
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Calculates the exact zero order hold discretization of the state
+ * space representation over an interval t:
+ *  [Phi] = e^([A]*t)
+ *  [Gamma] = integral( e^([A]*s) ds, 0, t ) * [B]
+ * such that x(t) = [Phi]*x(0) + [Gamma]*u for an input u held over t.
+ * Both are taken from the exponential of the augmented matrix
+ *  [ A*t  B*t ]
+ *  [  0    0  ]
+ * \param config The state space representation
+ * \param t The interval in seconds, t >= 0
+ * \param Phi [out] numStates x numStates row major state transition
+ * \param Gamma [out] numStates x numInputs row major input matrix, may be null
+ * \param workspace Scratch of MATEXP_DISCRETIZE_WORKSPACE_LENGTH doubles
+ * \return success of failure and fill in Phi and Gamma if successful
+ * \retval 0U Failure
+ * \retval 1U Success
+ */
+uint8_t MATEXP_Discretize( const RK4SOLVER_CONFIGURATION * config,
+                           double t,
+                           double * Phi,
+                           double * Gamma,
+                           double * workspace )
+{
+  uint8_t status = 0U; // failure
+
+  if ( config && Phi && workspace && ( t >= 0.0 ) )
+  {
+    uint32_t numStates = config->numStates;
+    uint32_t numInputs = config->numInputs;
+    uint32_t n = numStates + numInputs;
+    double * augmented = workspace;
+    double * exponential = augmented + ( n * n );
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+
+    for ( i = 0U; i < n * n; i++ )
+    {
+      augmented[ i ] = 0.0;
+    }
+
+    for ( i = 0U; i < numStates; i++ )
+    {
+      for ( j = 0U; j < numStates; j++ )
+      {
+        augmented[ ( i * n ) + j ] = (double)RK4SOLVER_GetCoefficient( config, RK4SOLVER_MATRIX_A, ( i * numStates ) + j ) * t;
+      }
+
+      for ( j = 0U; j < numInputs; j++ )
+      {
+        augmented[ ( i * n ) + numStates + j ] = (double)RK4SOLVER_GetCoefficient( config, RK4SOLVER_MATRIX_B, ( i * numInputs ) + j ) * t;
+      }
+    }
+
+    status = MATEXP_Expm( augmented, n, exponential, exponential + ( n * n ) );
+
+    if ( status == 1U )
+    {
+      for ( i = 0U; i < numStates; i++ )
+      {
+        for ( j = 0U; j < numStates; j++ )
+        {
+          Phi[ ( i * numStates ) + j ] = exponential[ ( i * n ) + j ];
+        }
+
+        for ( j = 0U; ( j < numInputs ) && Gamma; j++ )
+        {
+          Gamma[ ( i * numInputs ) + j ] = exponential[ ( i * n ) + numStates + j ];
+        }
+      }
+    }
+  }
+
+  return status;
+}
@@ -0,0 +1,52 @@
+/** 
+ * @file
+ * @brief Defines the interface to the matrix exponential and exact zero order
+ * hold discretization of a state space representation
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_MATRIX_EXPONENTIAL_H_
+#define _ASC_MATRIX_EXPONENTIAL_H_
+
+#include "rk4solver.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Number of doubles of scratch required by MATEXP_Expm for an n x n matrix */
+#define MATEXP_WORKSPACE_LENGTH( n ) ( 3U * (uint32_t)(n) * (uint32_t)(n) )
+
+/*! Number of doubles of scratch required by MATEXP_Discretize */
+#define MATEXP_DISCRETIZE_WORKSPACE_LENGTH( numStates, numInputs ) \
+    ( 2U * ( (uint32_t)(numStates) + (uint32_t)(numInputs) ) * ( (uint32_t)(numStates) + (uint32_t)(numInputs) ) + \
+      MATEXP_WORKSPACE_LENGTH( (uint32_t)(numStates) + (uint32_t)(numInputs) ) )
+
+    extern uint8_t MATEXP_Expm( const double * matrix,
+                                uint32_t n,
+                                double * result,
+                                double * workspace );
+    extern uint8_t MATEXP_Discretize( const RK4SOLVER_CONFIGURATION * config,
+                                      double t,
+                                      double * Phi,
+                                      double * Gamma,
+                                      double * workspace );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
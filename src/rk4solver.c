@@ -17,28 +17,104 @@
  */
 
 #include "rk4solver.h"
+#include "rk4solver_kernels.h"
 #include <float.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 static const float ONEBYSIX = (1.0f/6.0f);
 
 /*!
- * \brief Matrix get accessor
- * \param matrix Pointer to RAM containing 2D array
- * \param numColumns number of columns to parse 2D array
+ * \brief Selects one of the matrices of a configuration with its dimensions
+ * \param config The configuration
+ * \param matrix RK4SOLVER_MATRIX_A to RK4SOLVER_MATRIX_D
+ * \param values [out] The float matrix, null for a packed configuration
+ * \param packed [out] The packed matrix, null for a float configuration
+ * \param rows [out] Rows of the matrix
+ * \param columns [out] Columns of the matrix
+ * \note As this is a static function, there is no input validation
+ */
+static void _Select( const RK4SOLVER_CONFIGURATION * config,
+                     uint8_t matrix,
+                     const float ** values,
+                     const RK4SOLVER_PACKED_MATRIX ** packed,
+                     uint32_t * rows,
+                     uint32_t * columns )
+{
+  const float * floats[ 4 ] = { config->A, config->B, config->C, config->D };
+  uint32_t matrixRows[ 4 ] = { config->numStates, config->numStates, config->numOutputs, config->numOutputs };
+  uint32_t matrixColumns[ 4 ] = { config->numStates, config->numInputs, config->numStates, config->numInputs };
+  
+  *values = config->packed ? (const float*)0 : floats[ matrix ];
+  *packed = (const RK4SOLVER_PACKED_MATRIX*)0;
+  *rows = matrixRows[ matrix ];
+  *columns = matrixColumns[ matrix ];
+  
+  if ( config->packed )
+  {
+    const RK4SOLVER_PACKED_MATRIX * packedMatrices[ 4 ] = { &config->packed->A,
+                                                             &config->packed->B,
+                                                             &config->packed->C,
+                                                             &config->packed->D };
+    
+    *packed = packedMatrices[ matrix ];
+  }
+}
+
+/*!
+ * \brief Matrix get accessor, expanding packed coefficients
+ * \param config The configuration
+ * \param matrix RK4SOLVER_MATRIX_A to RK4SOLVER_MATRIX_D
  * \param row The row to access
  * \param column The column to access
- * \return pointer to specified element
+ * \return The coefficient
  * \note As this is a static funtion, there is no input validation
  */
-static float * _Get( float * matrix,
-                     uint32_t numColumns,
-                     uint32_t row, 
-                     uint32_t column )
+static float _Get( const RK4SOLVER_CONFIGURATION * config,
+                   uint8_t matrix,
+                   uint32_t row, 
+                   uint32_t column )
 {
-  float * element = matrix + ( row * numColumns ) + column;
+  const float * values = (const float*)0;
+  const RK4SOLVER_PACKED_MATRIX * packed = (const RK4SOLVER_PACKED_MATRIX*)0;
+  uint32_t rows = 0U;
+  uint32_t columns = 0U;
   
-  return element;
+  _Select( config, matrix, &values, &packed, &rows, &columns );
+  
+  return packed ? RK4SOLVER_KERNELS_Expand( config->packed->format, packed, ( row * columns ) + column ) :
+                  values[ ( row * columns ) + column ];
+}
+
+/*!
+ * \brief [y] += [M]*x for one of the matrices of a configuration, float or
+ * packed
+ * \param config The configuration
+ * \param matrix RK4SOLVER_MATRIX_A to RK4SOLVER_MATRIX_D
+ * \param x Pointer to the columns long operand
+ * \param y [in,out] Pointer to the rows long result
+ * \note As this is a static function, there is no input validation
+ */
+static void _MatVec( const RK4SOLVER_CONFIGURATION * config,
+                     uint8_t matrix,
+                     const float * x,
+                     float * y )
+{
+  const float * values = (const float*)0;
+  const RK4SOLVER_PACKED_MATRIX * packed = (const RK4SOLVER_PACKED_MATRIX*)0;
+  uint32_t rows = 0U;
+  uint32_t columns = 0U;
+  
+  _Select( config, matrix, &values, &packed, &rows, &columns );
+  
+  if ( packed )
+  {
+    RK4SOLVER_KERNELS_MatVecPacked( config->packed->format, packed, rows, columns, x, y );
+  }
+  else
+  {
+    RK4SOLVER_KERNELS_Get()->MatVec( values, rows, columns, x, y );
+  }
 }
 
 /*!
@@ -123,7 +199,7 @@ static void _CopyArray( float * dst,
   
   for ( i = 0U; i < numElements; i++ )
   {
-    *dst = *src;
+    dst[ i ] = src[ i ];
   }
 }
 
@@ -136,37 +212,20 @@ static void _CopyArray( float * dst,
  * \param result [out] Pointer to xdot result array
  * \note As this is a static function, there is no input validation
  */
-static void _fx( RK4SOLVER_CONFIGURATION * config,
+static void _fx( const RK4SOLVER_CONFIGURATION * config,
                  float * x,
                  float * u,
                  float * result )
 {
   uint32_t i = 0U;
-  uint32_t j = 0U;
   
   for ( i = 0U; i < config->numStates; i++ )
   {
-    result[ i ] = 0.0;
-    for ( j = 0U; j < config->numStates; j++ )
-    {
-      float A = *_Get( config->A, config->numStates, i, j );
-      
-      if ( A != 0.0 )
-      {
-        result[ i ] += A * x[ j ];
-      }
-    }
-    
-    for( j = 0U; j < config->numInputs; j++ )
-    {
-      float B = *_Get( config->B, config->numInputs, i, j );
-      
-      if ( B != 0.0 )
-      {
-        result[ i ] += B * u[ j ];
-      }
-    }
+    result[ i ] = 0.0f;
   }
+  
+  _MatVec( config, RK4SOLVER_MATRIX_A, x, result );
+  _MatVec( config, RK4SOLVER_MATRIX_B, u, result );
 }
 
 /*!
@@ -177,44 +236,73 @@ static void _fx( RK4SOLVER_CONFIGURATION * config,
  * \param output [out] The output structure containing yn+1
  * \note As this is a static function, there is no input validation
  */
-static void _GenerateOutput( RK4SOLVER_CONFIGURATION * config,
+static void _GenerateOutput( const RK4SOLVER_CONFIGURATION * config,
                              RK4SOLVER_INPUT * input,
                              RK4SOLVER_OUTPUT * output )
 {
   uint32_t i = 0U;
-  uint32_t j = 0U;
   
   for ( i = 0U; i < config->numOutputs; i++ )
   {
-    output->nextOutput[ i ] = 0.0;
-    for ( j = 0U; j < config->numStates; j++ )
-    {
-      float C = *_Get( config->C, config->numStates, i, j );
-      
-      if ( C == 1.0f )
-      {
-        output->nextOutput[ i ] += output->nextState[ j ];
-      }
-      else if ( C != 0.0f )
-      {
-        output->nextOutput[ i ] += C * output->nextState[ j ];
-      }
-    }
-    
-    for ( j = 0U; j < config->numInputs; j++ )
-    {
-      float D = *_Get( config->D, config->numInputs, i, j );
-      
-      if ( D == 1.0f )
-      {
-        output->nextOutput[ i ] += input->currentInput[ j ];
-      }
-      else if ( D != 0.0f )
-      {
-        output->nextOutput[ i ] += D * input->currentInput[ j ];
-      }
-    }
+    output->nextOutput[ i ] = 0.0f;
   }
+  
+  _MatVec( config, RK4SOLVER_MATRIX_C, output->nextState, output->nextOutput );
+  _MatVec( config, RK4SOLVER_MATRIX_D, input->currentInput, output->nextOutput );
+}
+
+/* Optional static-storage mode: when RK4SOLVER_STATIC_MAX_STATES is defined
+ * at build time, a solve without a caller workspace falls back to a single
+ * file-scope workspace sized for the largest expected model. This shared
+ * buffer is not reentrant, so it must only be used from one execution context.
+ */
+#if defined( RK4SOLVER_STATIC_MAX_STATES ) && defined( RK4SOLVER_STATIC_MAX_INPUTS )
+static float _staticWorkspace[ RK4SOLVER_WORKSPACE_LENGTH( RK4SOLVER_STATIC_MAX_STATES,
+                                                           RK4SOLVER_STATIC_MAX_INPUTS ) ] RK4SOLVER_ALIGNED;
+#endif
+
+/*!
+ * \brief Selects the scratch workspace for a solve
+ * \param config The configuration structure containing numStates and numInputs
+ * \param input The input structure possibly holding a caller workspace
+ * \return pointer to the workspace or null if none is available
+ * \note As this is a static function, there is no input validation
+ */
+static float * _GetWorkspace( const RK4SOLVER_CONFIGURATION * config,
+                              RK4SOLVER_INPUT * input )
+{
+  float * workspace = input->workspace;
+  
+#if defined( RK4SOLVER_STATIC_MAX_STATES ) && defined( RK4SOLVER_STATIC_MAX_INPUTS )
+  if ( !workspace &&
+       ( config->numStates <= RK4SOLVER_STATIC_MAX_STATES ) &&
+       ( config->numInputs <= RK4SOLVER_STATIC_MAX_INPUTS ) )
+  {
+    workspace = _staticWorkspace;
+  }
+#else
+  (void)config;
+#endif
+  
+  return workspace;
+}
+
+/*!
+ * \brief Reports the size of the scratch workspace required by RK4SOLVER_Solve
+ * \param config The configuration structure containing numStates and numInputs
+ * \return Workspace size in bytes, 0 if config is null
+ * \note The workspace should be aligned to 16 bytes, see RK4SOLVER_ALIGNED
+ */
+uint32_t RK4SOLVER_GetWorkspaceSize( const RK4SOLVER_CONFIGURATION * config )
+{
+  uint32_t size = 0U;
+  
+  if ( config )
+  {
+    size = RK4SOLVER_WORKSPACE_LENGTH( config->numStates, config->numInputs ) * sizeof( float );
+  }
+  
+  return size;
 }
 
 /*!
@@ -232,60 +320,70 @@ static void _GenerateOutput( RK4SOLVER_CONFIGURATION * config,
  * \retval 0U Failure
  * \retval 1U Success
  * \note All vectors must be of stated length and pointers are non-null
+ * \note The scratch space comes from input->workspace (or the static
+ * workspace when built in static-storage mode), no stack arrays or heap
+ * allocations are used.
  */ 
-uint8_t RK4SOLVER_Solve( RK4SOLVER_CONFIGURATION * config,
+uint8_t RK4SOLVER_Solve( const RK4SOLVER_CONFIGURATION * config,
                          RK4SOLVER_INPUT * input,
                          RK4SOLVER_OUTPUT * output )
 {
   uint8_t status = 0U; // failure
+  float * workspace = ( config && input ) ? _GetWorkspace( config, input ) : (float*)0;
   
-  if ( config && input && output )
+  if ( workspace && output )
   {
-    float x[ config->numStates ];
-    float u[ config->numInputs ];
-    float K[ 4U ][ config->numStates ];
+    uint32_t stride = RK4SOLVER_PAD_LENGTH( config->numStates );
+    float * K[ 4U ];
+    float * x = workspace + ( 4U * stride );
+    float * u = x + stride;
+    
+    K[ 0 ] = workspace;
+    K[ 1 ] = K[ 0 ] + stride;
+    K[ 2 ] = K[ 1 ] + stride;
+    K[ 3 ] = K[ 2 ] + stride;
     
-    _fx( config, input->currentState , input->currentInput, (float*)&K[ 0 ] );
+    _fx( config, input->currentState , input->currentInput, K[ 0 ] );
     
     // x = h/2 .* K[0] + currentState
     // u = 1/2 .* (currentInput + nextInput)
-    _DotMultiplyArray( (float*)&K[ 0 ], input->h * 0.5, x, config->numStates );
+    _DotMultiplyArray( K[ 0 ], input->h * 0.5, x, config->numStates );
     _AddArray( input->currentState, x, x, config->numStates );
-    _AddArray( input->currentInput, input->nextInput, u, config->numStates );
+    _AddArray( input->currentInput, input->nextInput, u, config->numInputs );
     _DotMultiplyArray( u, 0.5, u, config->numInputs );
-    _fx( config, x, u, (float*)&K[ 1 ] );
+    _fx( config, x, u, K[ 1 ] );
     
     // x = h/2 .* K[1] + currentState
     // u = 1/2 .* (currentInput + nextInput)
-    _DotMultiplyArray( (float*)&K[ 1 ], input->h * 0.5, x, config->numStates );
+    _DotMultiplyArray( K[ 1 ], input->h * 0.5, x, config->numStates );
     _AddArray( input->currentState, x, x, config->numStates );
     // already done : 
-    // _AddArray( input->currentInput, input->nextInput, u, config->numStates );
+    // _AddArray( input->currentInput, input->nextInput, u, config->numInputs );
     // _DotMultiplyArray( u, 0.5, u, config->numInputs );
-    _fx( config, x, u, (float*)&K[ 2 ] );
+    _fx( config, x, u, K[ 2 ] );
     
     
     // x = h .* K[2] + currentState
     // u = nextInput
-    _DotMultiplyArray( (float*)&K[ 2 ], input->h, x, config->numInputs );
+    _DotMultiplyArray( K[ 2 ], input->h, x, config->numStates );
     _AddArray( input->currentState, x, x, config->numStates );
     _CopyArray( u, input->nextInput, config->numInputs );
-    _fx( config, x, u, (float*)&K[ 3 ] );
+    _fx( config, x, u, K[ 3 ] );
     
-    _DotMultiplyArray( (float*)&K[ 1 ], 2.0, (float*)&K[ 1 ], config->numStates );
-    _DotMultiplyArray( (float*)&K[ 2 ], 2.0, (float*)&K[ 2 ], config->numStates );
+    _DotMultiplyArray( K[ 1 ], 2.0, K[ 1 ], config->numStates );
+    _DotMultiplyArray( K[ 2 ], 2.0, K[ 2 ], config->numStates );
     
     // K[0] = K[total] = h/6 ( K[0] + 2.*K[1] + 2.*K[2] + K[3] )
-    _AddArray4( (float*)&K[ 0 ],
-                (float*)&K[ 1 ], 
-                (float*)&K[ 2 ],
-                (float*)&K[ 3 ],
-                (float*)&K[ 0 ],
+    _AddArray4( K[ 0 ],
+                K[ 1 ], 
+                K[ 2 ],
+                K[ 3 ],
+                K[ 0 ],
                 config->numStates );
-    _DotMultiplyArray( (float*)&K[ 0 ], input->h * ONEBYSIX, (float*)&K[ 0 ], config->numInputs );
+    _DotMultiplyArray( K[ 0 ], input->h * ONEBYSIX, K[ 0 ], config->numStates );
     
     // nextState = currentState + K[total]
-    _AddArray( input->currentState, (float*)&K[ 0 ], output->nextState, config->numStates );
+    _AddArray( input->currentState, K[ 0 ], output->nextState, config->numStates );
     
     _GenerateOutput( config, input, output );
     
@@ -294,3 +392,390 @@ uint8_t RK4SOLVER_Solve( RK4SOLVER_CONFIGURATION * config,
   
   return status;
 }
+
+/*!
+ * \brief Calculates the output of the state space representation for a state
+ * that was obtained outside of RK4SOLVER_Solve (restored, fast-forwarded...)
+ *  [y] = [C]*x + [D]*u
+ * \param config The configuration structure containing C, D and dimensions
+ * \param state Pointer to the numStates long state x
+ * \param input Pointer to the numInputs long input u
+ * \param output [out] Pointer to the numOutputs long output y
+ * \return success of failure and fill in output if successful
+ * \retval 0U Failure
+ * \retval 1U Success
+ */
+uint8_t RK4SOLVER_Output( const RK4SOLVER_CONFIGURATION * config,
+                          float * state,
+                          float * input,
+                          float * output )
+{
+  uint8_t status = 0U; // failure
+  
+  if ( config && state && input && output )
+  {
+    RK4SOLVER_INPUT solverInput = { 0.0f, state, input, input, (float*)0 };
+    RK4SOLVER_OUTPUT solverOutput = { state, output };
+    
+    _GenerateOutput( config, &solverInput, &solverOutput );
+    
+    status = 1U; // success
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Calculates xdot for every instance of a batch such that
+ * [result][b] = [A]*x[b] + [B]*u[b]
+ * Each coefficient is loaded once and applied across the contiguous instance
+ * dimension.
+ * \param config The configuation structure containing A, B and numStates and numInputs
+ * \param x Pointer to numStates x xStride states
+ * \param xStride Row length of x
+ * \param u Pointer to numInputs x count inputs
+ * \param result [out] Pointer to numStates x stride xdot
+ * \param count Number of instances
+ * \param stride Row length of result
+ * \note As this is a static function, there is no input validation
+ */
+static void _fxBatch( const RK4SOLVER_CONFIGURATION * config,
+                      float * x,
+                      uint32_t xStride,
+                      float * u,
+                      float * result,
+                      uint32_t count,
+                      uint32_t stride )
+{
+  const RK4SOLVER_KERNELS * kernels = RK4SOLVER_KERNELS_Get();
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+  uint32_t b = 0U;
+  
+  for ( i = 0U; i < config->numStates; i++ )
+  {
+    float * row = result + ( i * stride );
+    
+    for ( b = 0U; b < count; b++ )
+    {
+      row[ b ] = 0.0f;
+    }
+    
+    for ( j = 0U; j < config->numStates; j++ )
+    {
+      float A = _Get( config, RK4SOLVER_MATRIX_A, i, j );
+      float * xj = x + ( j * xStride );
+      
+      if ( A != 0.0f )
+      {
+        kernels->Axpy( A, xj, row, count );
+      }
+    }
+    
+    for ( j = 0U; j < config->numInputs; j++ )
+    {
+      float B = _Get( config, RK4SOLVER_MATRIX_B, i, j );
+      float * uj = u + ( j * count );
+      
+      if ( B != 0.0f )
+      {
+        kernels->Axpy( B, uj, row, count );
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Calculates the outputs of every instance of a batch such that
+ * [y][b] = [C]*x[b] + [D]*u[b]
+ * \note As this is a static function, there is no input validation
+ */
+static void _GenerateOutputBatch( const RK4SOLVER_CONFIGURATION * config,
+                                  RK4SOLVER_BATCH * batch )
+{
+  const RK4SOLVER_KERNELS * kernels = RK4SOLVER_KERNELS_Get();
+  uint32_t count = batch->count;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+  uint32_t b = 0U;
+  
+  for ( i = 0U; i < config->numOutputs; i++ )
+  {
+    float * row = batch->outputs + ( i * count );
+    
+    for ( b = 0U; b < count; b++ )
+    {
+      row[ b ] = 0.0f;
+    }
+    
+    for ( j = 0U; j < config->numStates; j++ )
+    {
+      float C = _Get( config, RK4SOLVER_MATRIX_C, i, j );
+      float * xj = batch->states + ( j * count );
+      
+      if ( C != 0.0f )
+      {
+        kernels->Axpy( C, xj, row, count );
+      }
+    }
+    
+    for ( j = 0U; j < config->numInputs; j++ )
+    {
+      float D = _Get( config, RK4SOLVER_MATRIX_D, i, j );
+      float * uj = batch->inputs + ( j * count );
+      
+      if ( D != 0.0f )
+      {
+        kernels->Axpy( D, uj, row, count );
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Advances every instance of a batch by one Runge-Kutta 4 step with
+ * the input held, the same method as RK4SOLVER_Solve with un = un+1.
+ * Instances are stored structure-of-arrays so the inner loops run over
+ * contiguous memory and share each coefficient load.
+ * \param config The state space representation shared by the batch
+ * \param batch The batch of states, inputs, outputs and workspace
+ * \return success of failure and fill in states and outputs if successful
+ * \retval 0U Failure
+ * \retval 1U Success
+ */
+uint8_t RK4SOLVER_SolveBatch( const RK4SOLVER_CONFIGURATION * config,
+                              RK4SOLVER_BATCH * batch )
+{
+  uint8_t status = 0U; // failure
+  
+  if ( config && batch && batch->states && batch->inputs && batch->workspace )
+  {
+    uint32_t n = config->numStates;
+    uint32_t count = batch->count;
+    uint32_t stride = RK4SOLVER_PAD_LENGTH( count );
+    float * K[ 4U ];
+    float * x = batch->workspace + ( 4U * n * stride );
+    float halfStep = batch->h * 0.5f;
+    float sixthStep = batch->h * ONEBYSIX;
+    uint32_t i = 0U;
+    uint32_t b = 0U;
+    
+    K[ 0 ] = batch->workspace;
+    K[ 1 ] = K[ 0 ] + ( n * stride );
+    K[ 2 ] = K[ 1 ] + ( n * stride );
+    K[ 3 ] = K[ 2 ] + ( n * stride );
+    
+    _fxBatch( config, batch->states, count, batch->inputs, K[ 0 ], count, stride );
+    
+    for ( i = 0U; i < n; i++ )
+    {
+      for ( b = 0U; b < count; b++ )
+      {
+        x[ ( i * stride ) + b ] = batch->states[ ( i * count ) + b ] + halfStep * K[ 0 ][ ( i * stride ) + b ];
+      }
+    }
+    _fxBatch( config, x, stride, batch->inputs, K[ 1 ], count, stride );
+    
+    for ( i = 0U; i < n; i++ )
+    {
+      for ( b = 0U; b < count; b++ )
+      {
+        x[ ( i * stride ) + b ] = batch->states[ ( i * count ) + b ] + halfStep * K[ 1 ][ ( i * stride ) + b ];
+      }
+    }
+    _fxBatch( config, x, stride, batch->inputs, K[ 2 ], count, stride );
+    
+    for ( i = 0U; i < n; i++ )
+    {
+      for ( b = 0U; b < count; b++ )
+      {
+        x[ ( i * stride ) + b ] = batch->states[ ( i * count ) + b ] + batch->h * K[ 2 ][ ( i * stride ) + b ];
+      }
+    }
+    _fxBatch( config, x, stride, batch->inputs, K[ 3 ], count, stride );
+    
+    for ( i = 0U; i < n; i++ )
+    {
+      for ( b = 0U; b < count; b++ )
+      {
+        uint32_t k = ( i * stride ) + b;
+        
+        batch->states[ ( i * count ) + b ] += sixthStep * ( K[ 0 ][ k ] +
+                                                            2.0f * K[ 1 ][ k ] +
+                                                            2.0f * K[ 2 ][ k ] +
+                                                            K[ 3 ][ k ] );
+      }
+    }
+    
+    if ( batch->outputs )
+    {
+      _GenerateOutputBatch( config, batch );
+    }
+    
+    status = 1U; // success
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Advances the state by one Runge-Kutta 4 step like RK4SOLVER_Solve and
+ * carries the forward sensitivities along. For a linear model the
+ * variational equations d/dt( dx/dp ) = [A]*dx/dp + [B]*du/dp are the model
+ * itself, so each sensitivity is stepped by the same Runge-Kutta 4 map. The
+ * result is the exact derivative of the discrete step, not an approximation
+ * of the continuous one.
+ * \param config The state space representation
+ * \param input The step and its workspace, as for RK4SOLVER_Solve
+ * \param output The next state and output, as for RK4SOLVER_Solve
+ * \param sensitivity The sensitivities, states advanced in place and outputs
+ * filled in
+ * \return success of failure
+ * \retval 0U Failure
+ * \retval 1U Success
+ */
+uint8_t RK4SOLVER_SolveSensitivity( const RK4SOLVER_CONFIGURATION * config,
+                                    RK4SOLVER_INPUT * input,
+                                    RK4SOLVER_OUTPUT * output,
+                                    RK4SOLVER_SENSITIVITY * sensitivity )
+{
+  uint8_t status = 0U; // failure
+  
+  if ( sensitivity && sensitivity->states && sensitivity->currentInputs &&
+       sensitivity->nextInputs && sensitivity->outputs )
+  {
+    uint32_t p = 0U;
+    
+    status = RK4SOLVER_Solve( config, input, output );
+    
+    for ( p = 0U; ( p < sensitivity->numParams ) && ( status == 1U ); p++ )
+    {
+      float * state = sensitivity->states + ( p * config->numStates );
+      RK4SOLVER_INPUT sensitivityInput;
+      RK4SOLVER_OUTPUT sensitivityOutput;
+      
+      sensitivityInput.h = input->h;
+      sensitivityInput.currentState = state;
+      sensitivityInput.currentInput = sensitivity->currentInputs + ( p * config->numInputs );
+      sensitivityInput.nextInput = sensitivity->nextInputs + ( p * config->numInputs );
+      sensitivityInput.workspace = input->workspace;
+      sensitivityOutput.nextState = state;
+      sensitivityOutput.nextOutput = sensitivity->outputs + ( p * config->numOutputs );
+      
+      status = RK4SOLVER_Solve( config, &sensitivityInput, &sensitivityOutput );
+    }
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Packs the float matrices of a configuration into 16 bit codes with
+ * one power of two scale per matrix, see RK4SOLVER_KERNELS_Encode. The packed
+ * configuration { numStates, numInputs, numOutputs, null, null, null, null,
+ * packed } then runs every solver of this module at half the coefficient
+ * storage.
+ * \param config The float configuration
+ * \param format RK4SOLVER_PACKED_FLOAT16 or RK4SOLVER_PACKED_INT16
+ * \param packed [out] The packed matrices, pointing into storage
+ * \param storage [out] RK4SOLVER_PACKED_LENGTH( numStates, numInputs,
+ * numOutputs ) codes, A then B, C and D
+ * \return success of failure and fill in packed and storage if successful
+ * \retval 0U Failure, e.g. config is already packed
+ * \retval 1U Success
+ */
+uint8_t RK4SOLVER_Pack( const RK4SOLVER_CONFIGURATION * config,
+                        uint8_t format,
+                        RK4SOLVER_PACKED * packed,
+                        uint16_t * storage )
+{
+  uint8_t status = 0U; // failure
+  
+  if ( config && packed && storage && !config->packed &&
+       config->A && config->B && config->C && config->D )
+  {
+    RK4SOLVER_PACKED_MATRIX * matrices[ 4 ] = { &packed->A, &packed->B, &packed->C, &packed->D };
+    uint16_t * codes = storage;
+    bool encoded = true;
+    uint8_t matrix = 0U;
+    
+    packed->format = format;
+    
+    for ( matrix = RK4SOLVER_MATRIX_A; encoded && ( matrix <= RK4SOLVER_MATRIX_D ); matrix++ )
+    {
+      const float * values = (const float*)0;
+      const RK4SOLVER_PACKED_MATRIX * unused = (const RK4SOLVER_PACKED_MATRIX*)0;
+      uint32_t rows = 0U;
+      uint32_t columns = 0U;
+      
+      _Select( config, matrix, &values, &unused, &rows, &columns );
+      
+      encoded = RK4SOLVER_KERNELS_Encode( format, values, rows * columns, codes, &matrices[ matrix ]->exponent );
+      matrices[ matrix ]->data = codes;
+      codes += rows * columns;
+    }
+    
+    status = encoded ? 1U : 0U;
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief One coefficient of a float or packed configuration, for code
+ * outside the solver kernels that reads the model elementwise
+ * \param config The configuration
+ * \param matrix RK4SOLVER_MATRIX_A to RK4SOLVER_MATRIX_D
+ * \param index Row major index of the coefficient
+ * \return The coefficient, 0 if config is null or matrix is unknown
+ */
+float RK4SOLVER_GetCoefficient( const RK4SOLVER_CONFIGURATION * config,
+                                uint8_t matrix,
+                                uint32_t index )
+{
+  float value = 0.0f;
+  
+  if ( config && ( matrix <= RK4SOLVER_MATRIX_D ) )
+  {
+    value = _Get( config, matrix, 0U, index );
+  }
+  
+  return value;
+}
+
+/*!
+ * \brief Copies one matrix of a float or packed configuration, expanded to
+ * float
+ * \param config The configuration
+ * \param matrix RK4SOLVER_MATRIX_A to RK4SOLVER_MATRIX_D
+ * \param values [out] rows x columns floats, row major
+ * \return success of failure and fill in values if successful
+ * \retval 0U Failure
+ * \retval 1U Success
+ */
+uint8_t RK4SOLVER_GetMatrix( const RK4SOLVER_CONFIGURATION * config,
+                             uint8_t matrix,
+                             float * values )
+{
+  uint8_t status = 0U; // failure
+  
+  if ( config && values && ( matrix <= RK4SOLVER_MATRIX_D ) )
+  {
+    const float * floats = (const float*)0;
+    const RK4SOLVER_PACKED_MATRIX * packed = (const RK4SOLVER_PACKED_MATRIX*)0;
+    uint32_t rows = 0U;
+    uint32_t columns = 0U;
+    uint32_t i = 0U;
+    
+    _Select( config, matrix, &floats, &packed, &rows, &columns );
+    
+    for ( i = 0U; i < ( rows * columns ); i++ )
+    {
+      values[ i ] = packed ? RK4SOLVER_KERNELS_Expand( config->packed->format, packed, i ) : floats[ i ];
+    }
+    
+    status = 1U; // success
+  }
+  
+  return status;
+}
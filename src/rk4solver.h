@@ -25,6 +25,76 @@
 extern "C" {
 #endif
 
+/* Each workspace segment is padded to a multiple of four floats so that, given
+ * an aligned base address, every segment starts on a 16 byte boundary.
+ */
+#define RK4SOLVER_PAD_LENGTH( n ) ( ( (uint32_t)(n) + 3U ) & ~3U )
+
+/*!
+ * Number of floats required by the solver scratch workspace. Usable in constant
+ * expressions so the workspace can be placed in static storage.
+ */
+#define RK4SOLVER_WORKSPACE_LENGTH( numStates, numInputs ) \
+    ( 5U * RK4SOLVER_PAD_LENGTH( numStates ) + RK4SOLVER_PAD_LENGTH( numInputs ) )
+
+/*!
+ * Number of floats required by the batched solver workspace for count
+ * instances of a model with numStates states.
+ */
+#define RK4SOLVER_BATCH_WORKSPACE_LENGTH( numStates, count ) \
+    ( 5U * (uint32_t)(numStates) * RK4SOLVER_PAD_LENGTH( count ) )
+
+/* Alignment hint for statically allocated workspaces. Compilers without the
+ * attribute still get float alignment, which the solver accepts.
+ */
+#if defined( __GNUC__ )
+#define RK4SOLVER_ALIGNED __attribute__(( aligned( 16 ) ))
+#else
+#define RK4SOLVER_ALIGNED
+#endif
+
+    /*!
+     * Coefficient encodings of RK4SOLVER_PACKED
+     */
+#define RK4SOLVER_PACKED_FLOAT16 (1U) //!< IEEE 754 binary16
+#define RK4SOLVER_PACKED_INT16 (2U) //!< two's complement integer
+
+    /*!
+     * Matrix identifiers of RK4SOLVER_GetCoefficient and RK4SOLVER_GetMatrix
+     */
+#define RK4SOLVER_MATRIX_A (0U)
+#define RK4SOLVER_MATRIX_B (1U)
+#define RK4SOLVER_MATRIX_C (2U)
+#define RK4SOLVER_MATRIX_D (3U)
+
+    /*!
+     * Number of 16 bit codes RK4SOLVER_Pack stores for a model
+     */
+#define RK4SOLVER_PACKED_LENGTH( numStates, numInputs, numOutputs ) \
+    ( ( ( numStates ) + ( numOutputs ) ) * ( ( numStates ) + ( numInputs ) ) )
+
+    /*!
+     * One matrix in 16 bit codes with a shared power of two scale,
+     * coefficient = decode( code ) * 2^exponent, row major like the float
+     * matrices
+     */
+    typedef struct {
+        const uint16_t *data;
+        int8_t exponent;
+    } RK4SOLVER_PACKED_MATRIX;
+
+    /*!
+     * Half size coefficient storage, expanded to float on the fly by the
+     * solver kernels so that only the codes occupy flash
+     */
+    typedef struct {
+        uint8_t format; //!< RK4SOLVER_PACKED_FLOAT16 or RK4SOLVER_PACKED_INT16
+        RK4SOLVER_PACKED_MATRIX A;
+        RK4SOLVER_PACKED_MATRIX B;
+        RK4SOLVER_PACKED_MATRIX C;
+        RK4SOLVER_PACKED_MATRIX D;
+    } RK4SOLVER_PACKED;
+
     /*! 
      * Defines State Space Representation
      * [dx/dt] = [A]*x + [B]*u
@@ -34,10 +104,11 @@ extern "C" {
         uint32_t numStates; //!< Row and Columns for A, Rows for B
         uint32_t numInputs; //!< Columns for B and D
         uint32_t numOutputs; //!< Rows and Columns for C, Rows for D
-        float *A;
-        float *B;
-        float *C;
-        float *D;
+        const float *A;
+        const float *B;
+        const float *C;
+        const float *D;
+        const RK4SOLVER_PACKED *packed; //!< When set, used instead of A to D, which may be null
     } RK4SOLVER_CONFIGURATION;
 
     /*! 
@@ -52,6 +123,7 @@ extern "C" {
         float * currentState; //!< xn input must be numStates long
         float * currentInput; //!< un input must be numInputs long
         float * nextInput; //!< un+1 input must be numInputs long
+        float * workspace; //!< scratch, must be RK4SOLVER_GetWorkspaceSize bytes
     } RK4SOLVER_INPUT;
     
     /*! 
@@ -62,9 +134,58 @@ extern "C" {
         float * nextOutput; //!< yn+1 output mus be numOutputs long
     } RK4SOLVER_OUTPUT;
     
-    extern uint8_t RK4SOLVER_Solve( RK4SOLVER_CONFIGURATION * config,
+    /*!
+     * Defines a batch of instances sharing one configuration, stored
+     * structure-of-arrays: element [i][b] of a numRows x count array is row i
+     * of instance b. The input is held over the step.
+     */
+    typedef struct {
+        float h; //!< time step
+        uint32_t count; //!< number of instances in the batch
+        float * states; //!< numStates x count, advanced in place
+        float * inputs; //!< numInputs x count
+        float * outputs; //!< numOutputs x count, may be null
+        float * workspace; //!< scratch, RK4SOLVER_BATCH_WORKSPACE_LENGTH floats
+    } RK4SOLVER_BATCH;
+    
+    /*!
+     * Defines the forward sensitivities of the state and output to numParams
+     * parameters, stored one parameter after another: element [p][i] is
+     * d(row i)/d(parameter p). The system is linear, so they obey the same
+     * state space equations driven by du/dp.
+     */
+    typedef struct {
+        uint32_t numParams; //!< number of parameters
+        float * states; //!< numParams x numStates, dx/dp, advanced in place
+        float * currentInputs; //!< numParams x numInputs, dun/dp
+        float * nextInputs; //!< numParams x numInputs, dun+1/dp
+        float * outputs; //!< numParams x numOutputs, dyn+1/dp
+    } RK4SOLVER_SENSITIVITY;
+    
+    extern uint32_t RK4SOLVER_GetWorkspaceSize( const RK4SOLVER_CONFIGURATION * config );
+    extern uint8_t RK4SOLVER_Solve( const RK4SOLVER_CONFIGURATION * config,
                                     RK4SOLVER_INPUT * input,
                                     RK4SOLVER_OUTPUT * output );
+    extern uint8_t RK4SOLVER_SolveBatch( const RK4SOLVER_CONFIGURATION * config,
+                                         RK4SOLVER_BATCH * batch );
+    extern uint8_t RK4SOLVER_SolveSensitivity( const RK4SOLVER_CONFIGURATION * config,
+                                               RK4SOLVER_INPUT * input,
+                                               RK4SOLVER_OUTPUT * output,
+                                               RK4SOLVER_SENSITIVITY * sensitivity );
+    extern uint8_t RK4SOLVER_Output( const RK4SOLVER_CONFIGURATION * config,
+                                     float * state,
+                                     float * input,
+                                     float * output );
+    extern uint8_t RK4SOLVER_Pack( const RK4SOLVER_CONFIGURATION * config,
+                                   uint8_t format,
+                                   RK4SOLVER_PACKED * packed,
+                                   uint16_t * storage );
+    extern float RK4SOLVER_GetCoefficient( const RK4SOLVER_CONFIGURATION * config,
+                                           uint8_t matrix,
+                                           uint32_t index );
+    extern uint8_t RK4SOLVER_GetMatrix( const RK4SOLVER_CONFIGURATION * config,
+                                        uint8_t matrix,
+                                        float * values );
 
 #ifdef __cplusplus
 }
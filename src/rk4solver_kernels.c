@@ -0,0 +1,689 @@
+/**
+ * @file
+ * @brief Definition and implementation of the instruction set variants of the
+ * solver kernels and their runtime selection
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rk4solver_kernels.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* The vector variants are built with per-function target attributes, so the
+ * rest of the library keeps the baseline instruction set and one binary runs
+ * on every x86 host. Define RK4SOLVER_KERNELS_SCALAR_ONLY to leave them out.
+ */
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) ) && \
+    !defined( RK4SOLVER_KERNELS_SCALAR_ONLY )
+#define RK4SOLVER_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+/* Gathers index rows with 32 bit offsets */
+#define INDEX_LIMIT (0x7FFFFFFFUL)
+
+/* The scalar kernels finish the rows and elements left over by the vector
+ * ones. Kept out of line, they stay baseline code that no vector target can
+ * turn into fused multiply-adds.
+ */
+#if defined( RK4SOLVER_KERNELS_X86 )
+#define SCALAR_KERNEL __attribute__(( noinline ))
+#else
+#define SCALAR_KERNEL
+#endif
+
+/*!
+ * \brief [y] += [M]*x one row at a time
+ * \note As this is a static function, there is no input validation
+ */
+SCALAR_KERNEL static void _MatVecScalar( const float * M, uint32_t rows, uint32_t columns, const float * x, float * y )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < rows; i++ )
+  {
+    float sum = y[ i ];
+
+    for ( j = 0U; j < columns; j++ )
+    {
+      float a = M[ ( i * columns ) + j ];
+
+      if ( a != 0.0f )
+      {
+        sum += a * x[ j ];
+      }
+    }
+
+    y[ i ] = sum;
+  }
+}
+
+/*!
+ * \brief [y] += a*[x]
+ * \note As this is a static function, there is no input validation
+ */
+SCALAR_KERNEL static void _AxpyScalar( float a, const float * x, float * y, uint32_t count )
+{
+  uint32_t b = 0U;
+
+  for ( b = 0U; b < count; b++ )
+  {
+    y[ b ] += a * x[ b ];
+  }
+}
+
+#if defined( RK4SOLVER_KERNELS_X86 )
+
+/* avx512f implies fma, which would fuse the product into the sum; the
+ * explicitly rounded forms are never contracted.
+ */
+#define ROUNDING ( _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC )
+
+/* The 256 and 512 bit variants only touch the vector registers when there is
+ * at least one whole vector of work, and clear the upper halves with
+ * vzeroupper before the scalar remainder and the legacy SSE code of the
+ * caller run. A dirty upper state makes every SSE instruction after it pay a
+ * transition penalty, which for a three state model costs far more than the
+ * vectors save.
+ */
+
+/*!
+ * \brief [y] += [M]*x four rows at a time, each lane summing its row in the
+ * scalar order
+ * \note As this is a static function, there is no input validation
+ */
+__attribute__(( target( "sse4.2" ) ))
+static void _MatVecSse42( const float * M, uint32_t rows, uint32_t columns, const float * x, float * y )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; ( i + 4U ) <= rows; i += 4U )
+  {
+    const float * r0 = &M[ i * columns ];
+    const float * r1 = r0 + columns;
+    const float * r2 = r1 + columns;
+    const float * r3 = r2 + columns;
+    __m128 sum = _mm_loadu_ps( &y[ i ] );
+
+    for ( j = 0U; j < columns; j++ )
+    {
+      __m128 a = _mm_setr_ps( r0[ j ], r1[ j ], r2[ j ], r3[ j ] );
+
+      sum = _mm_add_ps( sum, _mm_mul_ps( a, _mm_set1_ps( x[ j ] ) ) );
+    }
+
+    _mm_storeu_ps( &y[ i ], sum );
+  }
+
+  _MatVecScalar( &M[ i * columns ], rows - i, columns, x, &y[ i ] );
+}
+
+__attribute__(( target( "sse4.2" ) ))
+static void _AxpySse42( float a, const float * x, float * y, uint32_t count )
+{
+  __m128 scale = _mm_set1_ps( a );
+  uint32_t b = 0U;
+
+  for ( b = 0U; ( b + 4U ) <= count; b += 4U )
+  {
+    _mm_storeu_ps( &y[ b ], _mm_add_ps( _mm_loadu_ps( &y[ b ] ), _mm_mul_ps( scale, _mm_loadu_ps( &x[ b ] ) ) ) );
+  }
+
+  _AxpyScalar( a, &x[ b ], &y[ b ], count - b );
+}
+
+/*!
+ * \brief [y] += [M]*x eight rows at a time, the column gathered
+ * \note As this is a static function, there is no input validation
+ */
+__attribute__(( target( "avx2" ) ))
+static void _MatVecAvx2( const float * M, uint32_t rows, uint32_t columns, const float * x, float * y )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  if ( ( rows >= 8U ) && ( ( (uint64_t)rows * (uint64_t)columns ) <= INDEX_LIMIT ) )
+  {
+    __m256i lanes = _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 );
+    __m256i stride = _mm256_set1_epi32( (int32_t)columns );
+
+    for ( i = 0U; ( i + 8U ) <= rows; i += 8U )
+    {
+      __m256i index = _mm256_mullo_epi32( _mm256_add_epi32( _mm256_set1_epi32( (int32_t)i ), lanes ), stride );
+      __m256 sum = _mm256_loadu_ps( &y[ i ] );
+
+      for ( j = 0U; j < columns; j++ )
+      {
+        __m256 a = _mm256_i32gather_ps( &M[ j ], index, 4 );
+
+        sum = _mm256_add_ps( sum, _mm256_mul_ps( a, _mm256_set1_ps( x[ j ] ) ) );
+      }
+
+      _mm256_storeu_ps( &y[ i ], sum );
+    }
+
+    _mm256_zeroupper();
+  }
+
+  _MatVecScalar( &M[ i * columns ], rows - i, columns, x, &y[ i ] );
+}
+
+__attribute__(( target( "avx2" ) ))
+static void _AxpyAvx2( float a, const float * x, float * y, uint32_t count )
+{
+  uint32_t b = 0U;
+
+  if ( count >= 8U )
+  {
+    __m256 scale = _mm256_set1_ps( a );
+
+    for ( b = 0U; ( b + 8U ) <= count; b += 8U )
+    {
+      _mm256_storeu_ps( &y[ b ], _mm256_add_ps( _mm256_loadu_ps( &y[ b ] ),
+                                                _mm256_mul_ps( scale, _mm256_loadu_ps( &x[ b ] ) ) ) );
+    }
+
+    _mm256_zeroupper();
+  }
+
+  _AxpyScalar( a, &x[ b ], &y[ b ], count - b );
+}
+
+/*!
+ * \brief [y] += [M]*x sixteen rows at a time, the column gathered
+ * \note As this is a static function, there is no input validation
+ */
+__attribute__(( target( "avx512f" ) ))
+static void _MatVecAvx512( const float * M, uint32_t rows, uint32_t columns, const float * x, float * y )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  if ( ( rows >= 16U ) && ( ( (uint64_t)rows * (uint64_t)columns ) <= INDEX_LIMIT ) )
+  {
+    __m512i lanes = _mm512_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 );
+    __m512i stride = _mm512_set1_epi32( (int32_t)columns );
+
+    for ( i = 0U; ( i + 16U ) <= rows; i += 16U )
+    {
+      __m512i index = _mm512_mullo_epi32( _mm512_add_epi32( _mm512_set1_epi32( (int32_t)i ), lanes ), stride );
+      __m512 sum = _mm512_loadu_ps( &y[ i ] );
+
+      for ( j = 0U; j < columns; j++ )
+      {
+        __m512 a = _mm512_i32gather_ps( index, &M[ j ], 4 );
+
+        sum = _mm512_add_round_ps( sum, _mm512_mul_round_ps( a, _mm512_set1_ps( x[ j ] ), ROUNDING ), ROUNDING );
+      }
+
+      _mm512_storeu_ps( &y[ i ], sum );
+    }
+
+    _mm256_zeroupper();
+  }
+
+  _MatVecScalar( &M[ i * columns ], rows - i, columns, x, &y[ i ] );
+}
+
+__attribute__(( target( "avx512f" ) ))
+static void _AxpyAvx512( float a, const float * x, float * y, uint32_t count )
+{
+  uint32_t b = 0U;
+
+  if ( count >= 16U )
+  {
+    __m512 scale = _mm512_set1_ps( a );
+
+    for ( b = 0U; ( b + 16U ) <= count; b += 16U )
+    {
+      _mm512_storeu_ps( &y[ b ], _mm512_add_round_ps( _mm512_loadu_ps( &y[ b ] ),
+                                                      _mm512_mul_round_ps( scale, _mm512_loadu_ps( &x[ b ] ), ROUNDING ),
+                                                      ROUNDING ) );
+    }
+
+    _mm256_zeroupper();
+  }
+
+  _AxpyScalar( a, &x[ b ], &y[ b ], count - b );
+}
+
+#endif
+
+static const RK4SOLVER_KERNELS _variants[ RK4SOLVER_KERNELS_NUM_VARIANTS ] =
+{
+  { "scalar", _MatVecScalar, _AxpyScalar },
+#if defined( RK4SOLVER_KERNELS_X86 )
+  { "sse4.2", _MatVecSse42, _AxpySse42 },
+  { "avx2", _MatVecAvx2, _AxpyAvx2 },
+  { "avx512f", _MatVecAvx512, _AxpyAvx512 }
+#else
+  { "sse4.2", 0, 0 },
+  { "avx2", 0, 0 },
+  { "avx512f", 0, 0 }
+#endif
+};
+
+static RK4SOLVER_KERNELS_VARIANT _active = RK4SOLVER_KERNELS_SCALAR;
+
+#if defined( RK4SOLVER_KERNELS_X86 )
+/*!
+ * \brief Picks the best variant when the library is loaded, before any solve
+ */
+__attribute__(( constructor ))
+static void _SelectAtLoad( void )
+{
+  __builtin_cpu_init();
+  (void)RK4SOLVER_KERNELS_Select( RK4SOLVER_KERNELS_Best() );
+}
+#endif
+
+/*!
+ * \brief The kernels in use
+ * \return The active variant's table, never null
+ */
+const RK4SOLVER_KERNELS * RK4SOLVER_KERNELS_Get( void )
+{
+  return &_variants[ _active ];
+}
+
+/*!
+ * \brief The variant in use
+ */
+RK4SOLVER_KERNELS_VARIANT RK4SOLVER_KERNELS_Active( void )
+{
+  return _active;
+}
+
+/*!
+ * \brief Reports whether a variant is compiled in and the processor and
+ * operating system can run it
+ * \param variant The variant
+ * \return true when it can be selected
+ */
+bool RK4SOLVER_KERNELS_Supported( RK4SOLVER_KERNELS_VARIANT variant )
+{
+  bool supported = false;
+
+  if ( ( variant < RK4SOLVER_KERNELS_NUM_VARIANTS ) && _variants[ variant ].MatVec )
+  {
+    switch ( variant )
+    {
+#if defined( RK4SOLVER_KERNELS_X86 )
+      case RK4SOLVER_KERNELS_SSE42:
+        supported = ( __builtin_cpu_supports( "sse4.2" ) != 0 );
+        break;
+      case RK4SOLVER_KERNELS_AVX2:
+        supported = ( __builtin_cpu_supports( "avx2" ) != 0 );
+        break;
+      case RK4SOLVER_KERNELS_AVX512:
+        supported = ( __builtin_cpu_supports( "avx512f" ) != 0 );
+        break;
+#endif
+      default:
+        supported = ( variant == RK4SOLVER_KERNELS_SCALAR );
+        break;
+    }
+  }
+
+  return supported;
+}
+
+/*!
+ * \brief Forces a variant, e.g. to compare against another or to rule the
+ * vector units out in the field. Not synchronized with running solves, so it
+ * is meant for start up and tests.
+ * \param variant The variant
+ * \return success
+ * \retval false The variant is not supported, the selection is unchanged
+ */
+bool RK4SOLVER_KERNELS_Select( RK4SOLVER_KERNELS_VARIANT variant )
+{
+  bool status = RK4SOLVER_KERNELS_Supported( variant );
+
+  if ( status )
+  {
+    _active = variant;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief The most capable variant this host supports, the one selected at
+ * load time
+ */
+RK4SOLVER_KERNELS_VARIANT RK4SOLVER_KERNELS_Best( void )
+{
+  RK4SOLVER_KERNELS_VARIANT best = RK4SOLVER_KERNELS_SCALAR;
+  uint32_t variant = 0U;
+
+  for ( variant = 0U; variant < (uint32_t)RK4SOLVER_KERNELS_NUM_VARIANTS; variant++ )
+  {
+    if ( RK4SOLVER_KERNELS_Supported( (RK4SOLVER_KERNELS_VARIANT)variant ) )
+    {
+      best = (RK4SOLVER_KERNELS_VARIANT)variant;
+    }
+  }
+
+  return best;
+}
+
+/*!
+ * \brief Name of a variant for logs
+ * \return The name, "unknown" when out of range
+ */
+const char * RK4SOLVER_KERNELS_Name( RK4SOLVER_KERNELS_VARIANT variant )
+{
+  return ( variant < RK4SOLVER_KERNELS_NUM_VARIANTS ) ? _variants[ variant ].name : "unknown";
+}
+
+/*!
+ * \brief Runs every supported variant on the same data, sized to leave a
+ * remainder for each vector width, and compares the results with the scalar
+ * kernels bit for bit
+ * \param failedVariants [out] Bit per variant that disagreed, may be null
+ * \return true when every supported variant agrees
+ */
+bool RK4SOLVER_KERNELS_SelfCheck( uint32_t * failedVariants )
+{
+  enum { ROWS = 37, COLUMNS = 29, COUNT = 53 };
+  float M[ ROWS * COLUMNS ];
+  float x[ COUNT ];
+  float reference[ ROWS + COUNT ];
+  float result[ ROWS + COUNT ];
+  uint32_t seed = 12345U;
+  uint32_t failed = 0U;
+  uint32_t variant = 0U;
+  uint32_t i = 0U;
+
+  for ( i = 0U; i < ( ROWS * COLUMNS ); i++ )
+  {
+    seed = ( seed * 1664525U ) + 1013904223U;
+    // every fifth coefficient zero, as in sparse thermal models
+    M[ i ] = ( ( seed >> 8 ) % 5U == 0U ) ? 0.0f : ( (float)( seed >> 8 ) / 16777216.0f ) - 0.5f;
+  }
+
+  for ( i = 0U; i < COUNT; i++ )
+  {
+    seed = ( seed * 1664525U ) + 1013904223U;
+    x[ i ] = ( (float)( seed >> 8 ) / 1677721.6f ) - 5.0f;
+  }
+
+  for ( variant = 0U; variant < (uint32_t)RK4SOLVER_KERNELS_NUM_VARIANTS; variant++ )
+  {
+    const RK4SOLVER_KERNELS * kernels = &_variants[ variant ];
+    float * out = ( variant == 0U ) ? reference : result;
+
+    if ( RK4SOLVER_KERNELS_Supported( (RK4SOLVER_KERNELS_VARIANT)variant ) )
+    {
+      for ( i = 0U; i < ( ROWS + COUNT ); i++ )
+      {
+        out[ i ] = 0.25f * (float)i;
+      }
+
+      kernels->MatVec( M, ROWS, COLUMNS, x, out );
+      kernels->MatVec( M, ROWS, COLUMNS, &x[ COUNT - COLUMNS ], out ); // accumulates
+      kernels->Axpy( -0.75f, x, &out[ ROWS ], COUNT );
+
+      if ( ( variant != 0U ) && ( memcmp( (char*)reference, (char*)result, sizeof( result ) ) != 0 ) )
+      {
+        failed |= ( 1UL << variant );
+      }
+    }
+  }
+
+  if ( failedVariants )
+  {
+    *failedVariants = failed;
+  }
+
+  return ( failed == 0U );
+}
+
+/*!
+ * \brief IEEE 754 binary32 to binary16, rounded to nearest even, out of range
+ * values saturate to infinity
+ * \note As this is a static function, there is no input validation
+ */
+static uint16_t _FloatToHalf( float value )
+{
+  uint32_t bits = 0U;
+  uint32_t mantissa = 0U;
+  uint32_t half = 0U;
+  uint32_t rest = 0U;
+  uint32_t tie = 0U;
+  int32_t exponent = 0;
+  uint16_t sign = 0U;
+
+  memcpy( (char*)&bits, (char*)&value, sizeof( bits ) );
+  sign = (uint16_t)( ( bits >> 16 ) & 0x8000U );
+  mantissa = bits & 0x007FFFFFUL;
+  exponent = (int32_t)( ( bits >> 23 ) & 0xFFU ) - 127 + 15;
+
+  if ( ( ( bits >> 23 ) & 0xFFU ) == 0xFFU )
+  {
+    half = ( mantissa != 0U ) ? 0x7E00U : 0x7C00U;
+  }
+  else if ( exponent >= 31 )
+  {
+    half = 0x7C00U;
+  }
+  else if ( exponent <= 0 )
+  {
+    // subnormal half, the implicit bit joins the shifted mantissa
+    if ( exponent >= -10 )
+    {
+      uint32_t shift = (uint32_t)( 14 - exponent );
+
+      mantissa |= 0x00800000UL;
+      half = mantissa >> shift;
+      rest = mantissa & ( ( 1UL << shift ) - 1U );
+      tie = 1UL << ( shift - 1U );
+    }
+  }
+  else
+  {
+    half = ( (uint32_t)exponent << 10 ) | ( mantissa >> 13 );
+    rest = mantissa & 0x1FFFU;
+    tie = 0x1000U;
+  }
+
+  // a carry out of the mantissa correctly steps the exponent
+  if ( ( tie != 0U ) && ( ( rest > tie ) || ( ( rest == tie ) && ( ( half & 1U ) != 0U ) ) ) )
+  {
+    half++;
+  }
+
+  return (uint16_t)( sign | (uint16_t)half );
+}
+
+/*!
+ * \brief IEEE 754 binary16 to binary32, exact
+ * \note As this is a static function, there is no input validation
+ */
+static float _HalfToFloat( uint16_t code )
+{
+  uint32_t sign = ( (uint32_t)code & 0x8000U ) << 16;
+  uint32_t exponent = ( (uint32_t)code >> 10 ) & 0x1FU;
+  uint32_t mantissa = (uint32_t)code & 0x03FFU;
+  uint32_t bits = sign;
+  float value = 0.0f;
+
+  if ( exponent == 0U )
+  {
+    // zero or subnormal, mantissa * 2^-24 is exact in binary32
+    value = ldexpf( (float)mantissa, -24 );
+    return ( sign != 0U ) ? -value : value;
+  }
+  else if ( exponent == 0x1FU )
+  {
+    bits |= 0x7F800000UL | ( mantissa << 13 );
+  }
+  else
+  {
+    bits |= ( ( exponent + 127U - 15U ) << 23 ) | ( mantissa << 13 );
+  }
+
+  memcpy( (char*)&value, (char*)&bits, sizeof( value ) );
+
+  return value;
+}
+
+/*!
+ * \brief One code without its matrix scale
+ * \note As this is a static function, there is no input validation
+ */
+static float _Decode( uint8_t format, uint16_t code )
+{
+  return ( format == RK4SOLVER_PACKED_FLOAT16 ) ? _HalfToFloat( code ) : (float)(int16_t)code;
+}
+
+/*!
+ * \brief Encodes one matrix for RK4SOLVER_PACKED with a shared power of two
+ * scale. For int16 the largest magnitude lands just under 32767, for float16
+ * just under 1, which keeps the small coefficients out of the subnormal range.
+ * Codes round to nearest, so each coefficient is off by at most half a unit
+ * of the last place of the format.
+ * \param format RK4SOLVER_PACKED_FLOAT16 or RK4SOLVER_PACKED_INT16
+ * \param values count float coefficients
+ * \param count Number of coefficients
+ * \param codes [out] count codes
+ * \param exponent [out] The scale, coefficient = decode( code ) * 2^exponent
+ * \return success
+ * \retval false Null pointer, unknown format, a value that is not finite or a
+ * scale beyond int8_t
+ */
+bool RK4SOLVER_KERNELS_Encode( uint8_t format,
+                               const float * values,
+                               uint32_t count,
+                               uint16_t * codes,
+                               int8_t * exponent )
+{
+  bool status = values && codes && exponent &&
+                ( ( format == RK4SOLVER_PACKED_FLOAT16 ) || ( format == RK4SOLVER_PACKED_INT16 ) );
+  float largest = 0.0f;
+  int scale = 0;
+  uint32_t i = 0U;
+
+  for ( i = 0U; status && ( i < count ); i++ )
+  {
+    status = isfinite( values[ i ] );
+    largest = ( fabsf( values[ i ] ) > largest ) ? fabsf( values[ i ] ) : largest;
+  }
+
+  if ( status && ( largest > 0.0f ) )
+  {
+    // largest = f * 2^scale with f in [0.5, 1)
+    (void)frexpf( largest, &scale );
+
+    if ( format == RK4SOLVER_PACKED_INT16 )
+    {
+      scale -= 15;
+
+      if ( lrintf( ldexpf( largest, -scale ) ) > 32767L )
+      {
+        scale++;
+      }
+    }
+
+    status = ( scale >= -128 ) && ( scale <= 127 );
+  }
+
+  for ( i = 0U; status && ( i < count ); i++ )
+  {
+    float scaled = ldexpf( values[ i ], -scale );
+
+    codes[ i ] = ( format == RK4SOLVER_PACKED_FLOAT16 ) ? _FloatToHalf( scaled ) :
+                                                          (uint16_t)(int16_t)lrintf( scaled );
+  }
+
+  if ( status )
+  {
+    *exponent = (int8_t)scale;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief One coefficient of a packed matrix
+ * \param format RK4SOLVER_PACKED_FLOAT16 or RK4SOLVER_PACKED_INT16
+ * \param matrix The packed matrix
+ * \param index Row major index of the coefficient
+ * \return The coefficient, 0 for a null matrix
+ */
+float RK4SOLVER_KERNELS_Expand( uint8_t format,
+                                const RK4SOLVER_PACKED_MATRIX * matrix,
+                                uint32_t index )
+{
+  float value = 0.0f;
+
+  if ( matrix && matrix->data )
+  {
+    value = ldexpf( _Decode( format, matrix->data[ index ] ), matrix->exponent );
+  }
+
+  return value;
+}
+
+/*!
+ * \brief [y] += [M]*x for a packed [M], expanding each coefficient as it is
+ * used. Zero codes are skipped like zero coefficients in the float kernels,
+ * and the power of two scale is exact, so the only difference to the float
+ * kernels is the rounding of the coefficients themselves.
+ * \param format RK4SOLVER_PACKED_FLOAT16 or RK4SOLVER_PACKED_INT16
+ * \param matrix The packed matrix, rows x columns row major
+ * \param rows Rows of [M] and y
+ * \param columns Columns of [M] and x
+ * \param x columns elements
+ * \param y [in,out] rows elements
+ */
+void RK4SOLVER_KERNELS_MatVecPacked( uint8_t format,
+                                     const RK4SOLVER_PACKED_MATRIX * matrix,
+                                     uint32_t rows,
+                                     uint32_t columns,
+                                     const float * x,
+                                     float * y )
+{
+  if ( matrix && matrix->data && x && y )
+  {
+    const uint16_t * codes = matrix->data;
+    float scale = ldexpf( 1.0f, matrix->exponent );
+    uint16_t magnitude = ( format == RK4SOLVER_PACKED_FLOAT16 ) ? 0x7FFFU : 0xFFFFU; // float16 has -0
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+
+    for ( i = 0U; i < rows; i++ )
+    {
+      float sum = y[ i ];
+
+      for ( j = 0U; j < columns; j++ )
+      {
+        uint16_t code = codes[ ( i * columns ) + j ];
+
+        if ( ( code & magnitude ) != 0U )
+        {
+          sum += ( _Decode( format, code ) * scale ) * x[ j ];
+        }
+      }
+
+      y[ i ] = sum;
+    }
+  }
+}
@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @brief Defines the interface to the instruction set variants of the solver
+ * kernels and their runtime selection
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_RK4SOLVER_KERNELS_H_
+#define _ASC_RK4SOLVER_KERNELS_H_
+
+#include "rk4solver.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /*!
+     * Compiled variants, in order of preference. Variants the compiler or
+     * target cannot build report as unsupported.
+     */
+    typedef enum {
+        RK4SOLVER_KERNELS_SCALAR = 0,
+        RK4SOLVER_KERNELS_SSE42,
+        RK4SOLVER_KERNELS_AVX2,
+        RK4SOLVER_KERNELS_AVX512,
+        RK4SOLVER_KERNELS_NUM_VARIANTS
+    } RK4SOLVER_KERNELS_VARIANT;
+
+    /*!
+     * The kernels of one variant. Vector lanes run across rows or instances,
+     * never across a sum, and products are not fused, so every variant returns
+     * bit for bit what the scalar one does.
+     */
+    typedef struct {
+        const char * name;
+        /*! [y] += [M]*x, M rows x columns row major, zero coefficients skipped */
+        void (*MatVec)( const float * M, uint32_t rows, uint32_t columns, const float * x, float * y );
+        /*! [y] += a*[x] over count elements */
+        void (*Axpy)( float a, const float * x, float * y, uint32_t count );
+    } RK4SOLVER_KERNELS;
+
+    extern const RK4SOLVER_KERNELS * RK4SOLVER_KERNELS_Get( void );
+    extern RK4SOLVER_KERNELS_VARIANT RK4SOLVER_KERNELS_Active( void );
+    extern bool RK4SOLVER_KERNELS_Supported( RK4SOLVER_KERNELS_VARIANT variant );
+    extern bool RK4SOLVER_KERNELS_Select( RK4SOLVER_KERNELS_VARIANT variant );
+    extern RK4SOLVER_KERNELS_VARIANT RK4SOLVER_KERNELS_Best( void );
+    extern const char * RK4SOLVER_KERNELS_Name( RK4SOLVER_KERNELS_VARIANT variant );
+    extern bool RK4SOLVER_KERNELS_SelfCheck( uint32_t * failedVariants );
+    extern bool RK4SOLVER_KERNELS_Encode( uint8_t format,
+                                          const float * values,
+                                          uint32_t count,
+                                          uint16_t * codes,
+                                          int8_t * exponent );
+    extern float RK4SOLVER_KERNELS_Expand( uint8_t format,
+                                           const RK4SOLVER_PACKED_MATRIX * matrix,
+                                           uint32_t index );
+    extern void RK4SOLVER_KERNELS_MatVecPacked( uint8_t format,
+                                                const RK4SOLVER_PACKED_MATRIX * matrix,
+                                                uint32_t rows,
+                                                uint32_t columns,
+                                                const float * x,
+                                                float * y );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
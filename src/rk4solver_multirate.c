@@ -0,0 +1,495 @@
+/**
+ * @file
+ * @brief Definition and implementation of a multirate State Space Runge-Kutta
+ * 4 ODE solver
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rk4solver.h"
+#include "rk4solver_multirate.h"
+#include <math.h>
+#include <stdint.h>
+
+static const float ONEBYSIX = (1.0f/6.0f);
+
+/*!
+ * \brief Matrix get accessor, float or packed
+ * \param config The configuration
+ * \param matrix RK4SOLVER_MATRIX_A to RK4SOLVER_MATRIX_D
+ * \param numColumns number of columns to parse 2D array
+ * \param row The row to access
+ * \param column The column to access
+ * \return The coefficient
+ * \note As this is a static funtion, there is no input validation
+ */
+static float _Get( const RK4SOLVER_CONFIGURATION * config,
+                   uint8_t matrix,
+                   uint32_t numColumns,
+                   uint32_t row,
+                   uint32_t column )
+{
+  return RK4SOLVER_GetCoefficient( config, matrix, ( row * numColumns ) + column );
+}
+
+/*!
+ * \brief Linear interpolation of two arrays: result = lhs + t * ( rhs - lhs )
+ * \param lhs Value at t = 0, pointer to Array
+ * \param rhs Value at t = 1, pointer to Array
+ * \param t Interpolation fraction
+ * \param result [out] Interpolated array
+ * \param numElements Length of the arrays
+ * \note As this is a static function, there is no input validation
+ */
+static void _LerpArray( float * lhs,
+                        float * rhs,
+                        float t,
+                        float * result,
+                        uint32_t numElements )
+{
+  uint32_t i = 0U;
+
+  for ( i = 0U; i < numElements; i++ )
+  {
+    result[ i ] = lhs[ i ] + t * ( rhs[ i ] - lhs[ i ] );
+  }
+}
+
+/*!
+ * \brief Copy of src array to dst array dst = src
+ * \param dst [out] Pointer to destination array
+ * \param src Pointer to source array
+ * \param numElements Length of array to be copied
+ * \note As this is a static function, there is no input validation
+ */
+static void _CopyArray( float * dst,
+                        float * src,
+                        uint32_t numElements )
+{
+  uint32_t i = 0U;
+
+  for ( i = 0U; i < numElements; i++ )
+  {
+    dst[ i ] = src[ i ];
+  }
+}
+
+/*!
+ * \brief Calculates xdot for the rows of one partition such that
+ * [result] = [A]*x + [B]*u for rows where isSlow[ i ] == slow
+ * \param config The configuation structure containing A, B and numStates and numInputs
+ * \param isSlow The partition mask
+ * \param slow The partition being evaluated
+ * \param x Pointer to the states array used in calculation
+ * \param u Pointer to the inputs array used in calculation
+ * \param result [out] Pointer to xdot result array, other rows untouched
+ * \note As this is a static function, there is no input validation
+ */
+static void _fxRows( const RK4SOLVER_CONFIGURATION * config,
+                     uint8_t * isSlow,
+                     uint8_t slow,
+                     float * x,
+                     float * u,
+                     float * result )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < config->numStates; i++ )
+  {
+    if ( isSlow[ i ] == slow )
+    {
+      result[ i ] = 0.0f;
+      for ( j = 0U; j < config->numStates; j++ )
+      {
+        float A = _Get( config, RK4SOLVER_MATRIX_A, config->numStates, i, j );
+
+        if ( A != 0.0f )
+        {
+          result[ i ] += A * x[ j ];
+        }
+      }
+
+      for ( j = 0U; j < config->numInputs; j++ )
+      {
+        float B = _Get( config, RK4SOLVER_MATRIX_B, config->numInputs, i, j );
+
+        if ( B != 0.0f )
+        {
+          result[ i ] += B * u[ j ];
+        }
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Sets the rows of one partition: result = base + scale * K
+ * \param isSlow The partition mask
+ * \param slow The partition being updated
+ * \param base Pointer to the base array
+ * \param K Pointer to the slope array
+ * \param scale Step applied to the slope
+ * \param result [out] Pointer to the result array, other rows untouched
+ * \param numElements Length of the arrays
+ * \note As this is a static function, there is no input validation
+ */
+static void _StepRows( uint8_t * isSlow,
+                       uint8_t slow,
+                       float * base,
+                       float * K,
+                       float scale,
+                       float * result,
+                       uint32_t numElements )
+{
+  uint32_t i = 0U;
+
+  for ( i = 0U; i < numElements; i++ )
+  {
+    if ( isSlow[ i ] == slow )
+    {
+      result[ i ] = base[ i ] + scale * K[ i ];
+    }
+  }
+}
+
+/*!
+ * \brief Sets the rows of one partition to the RK4 weighted update
+ * result = base + scale * ( K0 + 2*K1 + 2*K2 + K3 )
+ * \note As this is a static function, there is no input validation
+ */
+static void _CombineRows( uint8_t * isSlow,
+                          uint8_t slow,
+                          float * base,
+                          float ** K,
+                          float scale,
+                          float * result,
+                          uint32_t numElements )
+{
+  uint32_t i = 0U;
+
+  for ( i = 0U; i < numElements; i++ )
+  {
+    if ( isSlow[ i ] == slow )
+    {
+      result[ i ] = base[ i ] + scale * ( K[ 0 ][ i ] +
+                                          2.0f * K[ 1 ][ i ] +
+                                          2.0f * K[ 2 ][ i ] +
+                                          K[ 3 ][ i ] );
+    }
+  }
+}
+
+/*!
+ * \brief Interpolates the slow rows between the start and end of the macro step
+ * \note As this is a static function, there is no input validation
+ */
+static void _InterpolateSlowRows( uint8_t * isSlow,
+                                  float * slowStart,
+                                  float * slowEnd,
+                                  float t,
+                                  float * result,
+                                  uint32_t numElements )
+{
+  uint32_t i = 0U;
+
+  for ( i = 0U; i < numElements; i++ )
+  {
+    if ( isSlow[ i ] )
+    {
+      result[ i ] = slowStart[ i ] + t * ( slowEnd[ i ] - slowStart[ i ] );
+    }
+  }
+}
+
+/*!
+ * \brief Calculates the output y for the given state and input such that
+ * [y] = [C]*x + [D]*u
+ * \note As this is a static function, there is no input validation
+ */
+static void _GenerateOutput( const RK4SOLVER_CONFIGURATION * config,
+                             float * x,
+                             float * u,
+                             float * y )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < config->numOutputs; i++ )
+  {
+    y[ i ] = 0.0f;
+    for ( j = 0U; j < config->numStates; j++ )
+    {
+      y[ i ] += _Get( config, RK4SOLVER_MATRIX_C, config->numStates, i, j ) * x[ j ];
+    }
+
+    for ( j = 0U; j < config->numInputs; j++ )
+    {
+      y[ i ] += _Get( config, RK4SOLVER_MATRIX_D, config->numInputs, i, j ) * u[ j ];
+    }
+  }
+}
+
+/*!
+ * \brief Partitions the states by the time constant of their diagonal term
+ * of A, tau = -1 / A[i][i].
+ * \param config The configuration structure containing A and numStates
+ * \param tauSplit States with tau >= tauSplit are marked slow
+ * \param isSlow [out] The partition mask, must be numStates long
+ * \return Number of slow states
+ */
+uint32_t RK4SOLVER_MULTIRATE_Partition( const RK4SOLVER_CONFIGURATION * config,
+                                        float tauSplit,
+                                        uint8_t * isSlow )
+{
+  uint32_t numSlow = 0U;
+
+  if ( config && isSlow )
+  {
+    uint32_t i = 0U;
+
+    for ( i = 0U; i < config->numStates; i++ )
+    {
+      float diagonal = _Get( config, RK4SOLVER_MATRIX_A, config->numStates, i, i );
+
+      isSlow[ i ] = 0U;
+
+      // a state with no self decay is treated as slow, it only moves through coupling
+      if ( ( diagonal >= 0.0f ) || ( ( -1.0f / diagonal ) >= tauSplit ) )
+      {
+        isSlow[ i ] = 1U;
+        numSlow++;
+      }
+    }
+  }
+
+  return numSlow;
+}
+
+/*!
+ * \brief Reports the size of the scratch workspace required by
+ * RK4SOLVER_MULTIRATE_Solve and RK4SOLVER_MULTIRATE_ErrorReport
+ * \param config The configuration structure containing the model dimensions
+ * \return Workspace size in bytes, 0 if config is null
+ */
+uint32_t RK4SOLVER_MULTIRATE_GetWorkspaceSize( const RK4SOLVER_CONFIGURATION * config )
+{
+  uint32_t size = 0U;
+
+  if ( config )
+  {
+    size = RK4SOLVER_MULTIRATE_WORKSPACE_LENGTH( config->numStates,
+                                                 config->numInputs,
+                                                 config->numOutputs ) * sizeof( float );
+  }
+
+  return size;
+}
+
+/*!
+ * \brief Advances the state space representation by one macro step of
+ * ratio * h using a slowest-first multirate Runge-Kutta 4 scheme:
+ *  1. The slow states take one RK4 step of ratio * h, holding the fast
+ *     states at their value from the start of the macro step.
+ *  2. The fast states take ratio RK4 steps of h, with the slow states
+ *     linearly interpolated between the start and end of the macro step.
+ * The input is linearly interpolated from currentInput to nextInput across
+ * the macro step.
+ * \param config The state space representation
+ * \param multirate The partition and step ratio
+ * \param input The input structure, h is the fast step and workspace must be
+ * RK4SOLVER_MULTIRATE_GetWorkspaceSize bytes
+ * \param output [out] The output structure containing xn+1 and yn+1
+ * \return success of failure and fill in output if successful
+ * \retval 0U Failure
+ * \retval 1U Success
+ * \note nextState may alias currentState
+ */
+uint8_t RK4SOLVER_MULTIRATE_Solve( const RK4SOLVER_CONFIGURATION * config,
+                                   RK4SOLVER_MULTIRATE_CONFIGURATION * multirate,
+                                   RK4SOLVER_INPUT * input,
+                                   RK4SOLVER_OUTPUT * output )
+{
+  uint8_t status = 0U; // failure
+
+  if ( config && multirate && input && output &&
+       input->workspace && multirate->isSlow && ( multirate->ratio > 0U ) )
+  {
+    uint32_t n = config->numStates;
+    uint32_t stride = RK4SOLVER_PAD_LENGTH( n );
+    uint8_t * isSlow = multirate->isSlow;
+    float ratio = (float)multirate->ratio;
+    float h = input->h;
+    float H = h * ratio;
+    float * K[ 4U ];
+    float * x = input->workspace + ( 4U * stride );
+    float * u = x + stride;
+    float * slowStart = input->workspace + RK4SOLVER_WORKSPACE_LENGTH( n, config->numInputs );
+    float * slowEnd = slowStart + stride;
+    float * state = slowEnd + stride;
+    uint32_t step = 0U;
+
+    K[ 0 ] = input->workspace;
+    K[ 1 ] = K[ 0 ] + stride;
+    K[ 2 ] = K[ 1 ] + stride;
+    K[ 3 ] = K[ 2 ] + stride;
+
+    _CopyArray( state, input->currentState, n );
+    _CopyArray( slowStart, state, n );
+    _CopyArray( x, state, n );
+
+    // slow partition, one step of H with the fast states held
+    _fxRows( config, isSlow, 1U, x, input->currentInput, K[ 0 ] );
+    _LerpArray( input->currentInput, input->nextInput, 0.5f, u, config->numInputs );
+    _StepRows( isSlow, 1U, state, K[ 0 ], H * 0.5f, x, n );
+    _fxRows( config, isSlow, 1U, x, u, K[ 1 ] );
+    _StepRows( isSlow, 1U, state, K[ 1 ], H * 0.5f, x, n );
+    _fxRows( config, isSlow, 1U, x, u, K[ 2 ] );
+    _StepRows( isSlow, 1U, state, K[ 2 ], H, x, n );
+    _fxRows( config, isSlow, 1U, x, input->nextInput, K[ 3 ] );
+    _CombineRows( isSlow, 1U, state, K, H * ONEBYSIX, slowEnd, n );
+
+    // fast partition, ratio steps of h with interpolated slow coupling
+    for ( step = 0U; step < multirate->ratio; step++ )
+    {
+      float t0 = (float)step / ratio;
+      float tm = ( (float)step + 0.5f ) / ratio;
+      float t1 = (float)( step + 1U ) / ratio;
+
+      _CopyArray( x, state, n );
+      _InterpolateSlowRows( isSlow, slowStart, slowEnd, t0, x, n );
+      _LerpArray( input->currentInput, input->nextInput, t0, u, config->numInputs );
+      _fxRows( config, isSlow, 0U, x, u, K[ 0 ] );
+
+      _StepRows( isSlow, 0U, state, K[ 0 ], h * 0.5f, x, n );
+      _InterpolateSlowRows( isSlow, slowStart, slowEnd, tm, x, n );
+      _LerpArray( input->currentInput, input->nextInput, tm, u, config->numInputs );
+      _fxRows( config, isSlow, 0U, x, u, K[ 1 ] );
+
+      _StepRows( isSlow, 0U, state, K[ 1 ], h * 0.5f, x, n );
+      _fxRows( config, isSlow, 0U, x, u, K[ 2 ] );
+
+      _StepRows( isSlow, 0U, state, K[ 2 ], h, x, n );
+      _InterpolateSlowRows( isSlow, slowStart, slowEnd, t1, x, n );
+      _LerpArray( input->currentInput, input->nextInput, t1, u, config->numInputs );
+      _fxRows( config, isSlow, 0U, x, u, K[ 3 ] );
+
+      _CombineRows( isSlow, 0U, state, K, h * ONEBYSIX, state, n );
+    }
+
+    _InterpolateSlowRows( isSlow, slowStart, slowEnd, 1.0f, state, n );
+    _CopyArray( output->nextState, state, n );
+
+    _GenerateOutput( config, output->nextState, input->currentInput, output->nextOutput );
+
+    status = 1U; // success
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Runs the multirate solver and the single-rate RK4 reference side by
+ * side from the same state and reports the state error and relative cost.
+ * \param config The state space representation
+ * \param multirate The partition and step ratio
+ * \param input The starting state, the input ramp applied on every macro
+ * step, the fast step h and a RK4SOLVER_MULTIRATE_GetWorkspaceSize workspace.
+ * currentState is not modified.
+ * \param numMacroSteps Number of macro steps of ratio * h to compare
+ * \param report [out] The error and cost report
+ * \return success of failure and fill in report if successful
+ * \retval 0U Failure
+ * \retval 1U Success
+ */
+uint8_t RK4SOLVER_MULTIRATE_ErrorReport( const RK4SOLVER_CONFIGURATION * config,
+                                         RK4SOLVER_MULTIRATE_CONFIGURATION * multirate,
+                                         RK4SOLVER_INPUT * input,
+                                         uint32_t numMacroSteps,
+                                         RK4SOLVER_MULTIRATE_REPORT * report )
+{
+  uint8_t status = 0U; // failure
+
+  if ( config && multirate && input && report &&
+       input->workspace && multirate->isSlow && ( multirate->ratio > 0U ) )
+  {
+    uint32_t n = config->numStates;
+    uint32_t stride = RK4SOLVER_PAD_LENGTH( n );
+    uint32_t inputStride = RK4SOLVER_PAD_LENGTH( config->numInputs );
+    float * refState = input->workspace + RK4SOLVER_WORKSPACE_LENGTH( n, config->numInputs ) + ( 3U * stride );
+    float * mrState = refState + stride;
+    float * refInputA = mrState + stride;
+    float * refInputB = refInputA + inputStride;
+    float * y = refInputB + inputStride;
+    RK4SOLVER_INPUT refInput = { input->h, refState, refInputA, refInputB, input->workspace };
+    RK4SOLVER_OUTPUT refOutput = { refState, y };
+    RK4SOLVER_INPUT mrInput = { input->h, mrState, input->currentInput, input->nextInput, input->workspace };
+    RK4SOLVER_OUTPUT mrOutput = { mrState, y };
+    uint32_t numSlow = 0U;
+    uint32_t macro = 0U;
+    uint32_t i = 0U;
+
+    for ( i = 0U; i < n; i++ )
+    {
+      numSlow += ( multirate->isSlow[ i ] != 0U ) ? 1U : 0U;
+    }
+
+    _CopyArray( refState, input->currentState, n );
+    _CopyArray( mrState, input->currentState, n );
+
+    report->maxAbsError = 0.0f;
+    report->finalAbsError = 0.0f;
+    report->singleRateRowEvaluations = 4U * n * multirate->ratio * numMacroSteps;
+    report->multirateRowEvaluations = 4U * ( numSlow + ( n - numSlow ) * multirate->ratio ) * numMacroSteps;
+
+    status = 1U; // success
+
+    for ( macro = 0U; ( macro < numMacroSteps ) && ( status == 1U ); macro++ )
+    {
+      uint32_t step = 0U;
+
+      for ( step = 0U; ( step < multirate->ratio ) && ( status == 1U ); step++ )
+      {
+        _LerpArray( input->currentInput, input->nextInput,
+                    (float)step / (float)multirate->ratio, refInputA, config->numInputs );
+        _LerpArray( input->currentInput, input->nextInput,
+                    (float)( step + 1U ) / (float)multirate->ratio, refInputB, config->numInputs );
+        status = RK4SOLVER_Solve( config, &refInput, &refOutput );
+      }
+
+      if ( status == 1U )
+      {
+        status = RK4SOLVER_MULTIRATE_Solve( config, multirate, &mrInput, &mrOutput );
+      }
+
+      report->finalAbsError = 0.0f;
+      for ( i = 0U; i < n; i++ )
+      {
+        float error = fabsf( refState[ i ] - mrState[ i ] );
+
+        if ( error > report->finalAbsError )
+        {
+          report->finalAbsError = error;
+        }
+      }
+
+      if ( report->finalAbsError > report->maxAbsError )
+      {
+        report->maxAbsError = report->finalAbsError;
+      }
+    }
+  }
+
+  return status;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief Defines the interface to a multirate State Space Runge-Kutta 4 ODE
+ * solver that advances slow states at a larger step than fast states
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_RK4SOLVER_MULTIRATE_H_
+#define _ASC_RK4SOLVER_MULTIRATE_H_
+
+#include "rk4solver.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Number of floats required by the multirate workspace. The leading part has
+ * the same layout as the RK4SOLVER workspace so the single-rate reference in
+ * the error report can share it.
+ */
+#define RK4SOLVER_MULTIRATE_WORKSPACE_LENGTH( numStates, numInputs, numOutputs ) \
+    ( RK4SOLVER_WORKSPACE_LENGTH( numStates, numInputs ) + \
+      5U * RK4SOLVER_PAD_LENGTH( numStates ) + \
+      2U * RK4SOLVER_PAD_LENGTH( numInputs ) + \
+      RK4SOLVER_PAD_LENGTH( numOutputs ) )
+
+    /*!
+     * Defines the partition of the states into fast and slow groups.
+     * Slow states take one RK4 step of ratio * h per macro step while fast
+     * states take ratio steps of h.
+     */
+    typedef struct {
+        uint32_t ratio; //!< fast steps per slow step, must be >= 1
+        uint8_t * isSlow; //!< numStates long, 1U marks a slow state
+    } RK4SOLVER_MULTIRATE_CONFIGURATION;
+
+    /*!
+     * Compares the multirate solution against the single-rate RK4 reference
+     */
+    typedef struct {
+        float maxAbsError; //!< largest absolute state error over the run
+        float finalAbsError; //!< largest absolute state error at the end of the run
+        uint32_t singleRateRowEvaluations; //!< rows of fx evaluated by the reference
+        uint32_t multirateRowEvaluations; //!< rows of fx evaluated by the multirate solver
+    } RK4SOLVER_MULTIRATE_REPORT;
+
+    extern uint32_t RK4SOLVER_MULTIRATE_Partition( const RK4SOLVER_CONFIGURATION * config,
+                                                   float tauSplit,
+                                                   uint8_t * isSlow );
+    extern uint32_t RK4SOLVER_MULTIRATE_GetWorkspaceSize( const RK4SOLVER_CONFIGURATION * config );
+    extern uint8_t RK4SOLVER_MULTIRATE_Solve( const RK4SOLVER_CONFIGURATION * config,
+                                              RK4SOLVER_MULTIRATE_CONFIGURATION * multirate,
+                                              RK4SOLVER_INPUT * input,
+                                              RK4SOLVER_OUTPUT * output );
+    extern uint8_t RK4SOLVER_MULTIRATE_ErrorReport( const RK4SOLVER_CONFIGURATION * config,
+                                                    RK4SOLVER_MULTIRATE_CONFIGURATION * multirate,
+                                                    RK4SOLVER_INPUT * input,
+                                                    uint32_t numMacroSteps,
+                                                    RK4SOLVER_MULTIRATE_REPORT * report );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,561 @@
+/**
+ * @file
+ * @brief Definition and implementation of the deadline aware scheduler of
+ * many thermal model and torque manager instances
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "task_scheduler.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/*!
+ * \brief Monotonic time stamp
+ * \return Nanoseconds
+ */
+static uint64_t _Now( void )
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  return ( (uint64_t)now.tv_sec * 1000000000ULL ) + (uint64_t)now.tv_nsec;
+}
+
+/*!
+ * \brief Heap order, earliest deadline first, ties to the task added first so
+ * equal deadlines run in a repeatable order
+ * \note As this is a static function, there is no input validation
+ */
+static bool _Before( const ASC_TASK_SCHEDULER * scheduler, uint32_t lhs, uint32_t rhs )
+{
+  const ASC_TASK_SCHEDULER_TASK * a = &scheduler->tasks[ lhs ];
+  const ASC_TASK_SCHEDULER_TASK * b = &scheduler->tasks[ rhs ];
+
+  return ( a->absoluteDeadline < b->absoluteDeadline ) ||
+         ( ( a->absoluteDeadline == b->absoluteDeadline ) && ( lhs < rhs ) );
+}
+
+/*!
+ * \brief Queues a released background task, call with the lock held
+ * \note As this is a static function, there is no input validation
+ */
+static void _Push( ASC_TASK_SCHEDULER * scheduler, uint32_t task )
+{
+  uint32_t child = scheduler->numReady++;
+
+  while ( child > 0U )
+  {
+    uint32_t parent = ( child - 1U ) / 2U;
+
+    if ( !_Before( scheduler, task, scheduler->ready[ parent ] ) )
+    {
+      break;
+    }
+
+    scheduler->ready[ child ] = scheduler->ready[ parent ];
+    child = parent;
+  }
+
+  scheduler->ready[ child ] = task;
+}
+
+/*!
+ * \brief Takes the queued task with the earliest deadline, call with the lock
+ * held and the heap not empty
+ * \note As this is a static function, there is no input validation
+ */
+static uint32_t _Pop( ASC_TASK_SCHEDULER * scheduler )
+{
+  uint32_t first = scheduler->ready[ 0 ];
+  uint32_t last = scheduler->ready[ --scheduler->numReady ];
+  uint32_t parent = 0U;
+
+  while ( ( ( 2U * parent ) + 1U ) < scheduler->numReady )
+  {
+    uint32_t child = ( 2U * parent ) + 1U;
+
+    if ( ( ( child + 1U ) < scheduler->numReady ) &&
+         _Before( scheduler, scheduler->ready[ child + 1U ], scheduler->ready[ child ] ) )
+    {
+      child++;
+    }
+
+    if ( !_Before( scheduler, scheduler->ready[ child ], last ) )
+    {
+      break;
+    }
+
+    scheduler->ready[ parent ] = scheduler->ready[ child ];
+    parent = child;
+  }
+
+  scheduler->ready[ parent ] = last;
+
+  return first;
+}
+
+/*!
+ * \brief Runs the earliest deadline job, call with the lock held and the heap
+ * not empty. The lock is released while the job runs.
+ * \note As this is a static function, there is no input validation
+ */
+static void _RunNext( ASC_TASK_SCHEDULER * scheduler )
+{
+  uint32_t index = _Pop( scheduler );
+  ASC_TASK_SCHEDULER_TASK * task = &scheduler->tasks[ index ];
+  uint64_t start = 0U;
+  uint64_t elapsed = 0U;
+
+  pthread_mutex_unlock( &scheduler->lock );
+
+  start = _Now();
+  task->run( task->instance );
+  elapsed = _Now() - start;
+
+  pthread_mutex_lock( &scheduler->lock );
+  task->worstNanoseconds = ( elapsed > task->worstNanoseconds ) ? elapsed : task->worstNanoseconds;
+  task->runs++;
+  task->queued = false;
+  scheduler->stats.jobs++;
+}
+
+/*!
+ * \brief Worker thread, runs queued background jobs by earliest deadline
+ */
+static void * _WorkerThread( void * context )
+{
+  ASC_TASK_SCHEDULER_WORKER * args = (ASC_TASK_SCHEDULER_WORKER*)context;
+  ASC_TASK_SCHEDULER * scheduler = (ASC_TASK_SCHEDULER*)args->scheduler;
+
+  pthread_mutex_lock( &scheduler->lock );
+
+  while ( !scheduler->shutdown )
+  {
+    if ( scheduler->numReady == 0U )
+    {
+      pthread_cond_wait( &scheduler->wake, &scheduler->lock );
+    }
+    else
+    {
+      _RunNext( scheduler );
+    }
+  }
+
+  pthread_mutex_unlock( &scheduler->lock );
+
+  return (void*)0;
+}
+
+/*!
+ * \brief Chooses the phase that keeps the busiest tick the task lands on as
+ * light as possible, then adds the task's cost to the ticks it lands on
+ * \param load Planned cost per tick of the frame
+ * \return The phase, 0 .. period - 1
+ * \note As this is a static function, there is no input validation
+ */
+static uint32_t _PlanPhase( uint32_t * load, uint32_t frame, uint32_t period, uint32_t cost )
+{
+  uint32_t best = 0U;
+  uint32_t bestPeak = 0U;
+  uint64_t bestTotal = 0U;
+  uint32_t phase = 0U;
+  uint32_t slot = 0U;
+
+  for ( phase = 0U; phase < period; phase++ )
+  {
+    uint32_t peak = 0U;
+    uint64_t total = 0U;
+
+    for ( slot = phase; slot < frame; slot += period )
+    {
+      peak = ( load[ slot ] > peak ) ? load[ slot ] : peak;
+      total += load[ slot ];
+    }
+
+    if ( ( phase == 0U ) || ( peak < bestPeak ) || ( ( peak == bestPeak ) && ( total < bestTotal ) ) )
+    {
+      best = phase;
+      bestPeak = peak;
+      bestTotal = total;
+    }
+  }
+
+  for ( slot = best; slot < frame; slot += period )
+  {
+    load[ slot ] += cost;
+  }
+
+  return best;
+}
+
+/*!
+ * \brief Registers a task, see the Add functions
+ * \note As this is a static function, there is no input validation
+ */
+static bool _Add( ASC_TASK_SCHEDULER * scheduler,
+                  ASC_TASK_SCHEDULER_JOB run,
+                  ASC_TASK_SCHEDULER_JOB release,
+                  void * instance,
+                  uint32_t period,
+                  uint32_t deadline,
+                  uint32_t cost,
+                  bool background,
+                  uint32_t * phase )
+{
+  bool status = ( scheduler->numTasks < ASC_TASK_SCHEDULER_MAX_TASKS ) &&
+                ( period > 0U ) && ( ( scheduler->frame % period ) == 0U );
+
+  if ( status )
+  {
+    ASC_TASK_SCHEDULER_TASK * task = &scheduler->tasks[ scheduler->numTasks ];
+    uint32_t * load = background ? scheduler->backgroundLoad : scheduler->load;
+
+    memset( (char*)task, 0, sizeof( *task ) );
+    task->run = run;
+    task->release = release;
+    task->instance = instance;
+    task->period = period;
+    task->deadline = deadline;
+    task->cost = ( cost > 0U ) ? cost : 1U;
+    task->background = background;
+    task->phase = _PlanPhase( load, scheduler->frame, period, task->cost );
+
+    if ( phase )
+    {
+      *phase = task->phase;
+    }
+
+    // published last, a running tick only looks at complete tasks
+    pthread_mutex_lock( &scheduler->lock );
+    scheduler->numTasks++;
+    pthread_mutex_unlock( &scheduler->lock );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Sets up a scheduler and starts its workers. The application calls
+ * ASC_TASK_SCHEDULER_Tick once per tick instead of calling every instance
+ * itself, and the scheduler spreads the instances over the ticks.
+ * \param scheduler The scheduler to be created
+ * \param frame Ticks over which phases are planned, every period must divide
+ * it, e.g. 100 for periods of 1, 10 and 100 ticks
+ * \param tickNanoseconds Length of a tick, ticks taking longer count as
+ * tickOverruns, 0 disables the count
+ * \param numWorkers Threads running background jobs, 0 to run them from the
+ * application's idle loop with ASC_TASK_SCHEDULER_Background
+ * \return success
+ */
+bool ASC_TASK_SCHEDULER_Create( ASC_TASK_SCHEDULER * scheduler,
+                                uint32_t frame,
+                                uint64_t tickNanoseconds,
+                                uint32_t numWorkers )
+{
+  bool status = false;
+
+  if ( scheduler && ( frame > 0U ) && ( frame <= ASC_TASK_SCHEDULER_MAX_FRAME ) &&
+       ( numWorkers <= ASC_TASK_SCHEDULER_MAX_WORKERS ) )
+  {
+    uint32_t worker = 0U;
+
+    memset( (char*)scheduler, 0, sizeof( *scheduler ) );
+    scheduler->frame = frame;
+    scheduler->tickNanoseconds = tickNanoseconds;
+    pthread_mutex_init( &scheduler->lock, (pthread_mutexattr_t*)0 );
+    pthread_cond_init( &scheduler->wake, (pthread_condattr_t*)0 );
+    status = true;
+
+    for ( worker = 0U; ( worker < numWorkers ) && status; worker++ )
+    {
+      scheduler->workers[ worker ].scheduler = (void*)scheduler;
+      scheduler->workers[ worker ].index = worker;
+      status = ( pthread_create( &scheduler->threads[ worker ], (pthread_attr_t*)0,
+                                 _WorkerThread, (void*)&scheduler->workers[ worker ] ) == 0 );
+      scheduler->numWorkers = status ? ( worker + 1U ) : worker;
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Registers a task run inside the tick, e.g. a torque manager
+ * foreground task or an estimator periodic task
+ * \param scheduler The scheduler
+ * \param run The job
+ * \param instance Passed to run
+ * \param period Ticks between runs, must divide the frame
+ * \param cost Relative run time, 0 counts as 1
+ * \param phase [out] Tick of the frame the task runs first, may be null
+ * \return success
+ * \note Call from the context that calls ASC_TASK_SCHEDULER_Tick
+ */
+bool ASC_TASK_SCHEDULER_AddForeground( ASC_TASK_SCHEDULER * scheduler,
+                                       ASC_TASK_SCHEDULER_JOB run,
+                                       void * instance,
+                                       uint32_t period,
+                                       uint32_t cost,
+                                       uint32_t * phase )
+{
+  return scheduler && run &&
+         _Add( scheduler, run, (ASC_TASK_SCHEDULER_JOB)0, instance, period, 0U, cost, false, phase );
+}
+
+/*!
+ * \brief Registers a task whose jobs run on the workers, earliest deadline
+ * first, e.g. an overload prediction
+ * \param scheduler The scheduler
+ * \param run The job
+ * \param release Runs in the tick when a job is released, before it is queued,
+ * e.g. to hand the job the estimator's latest state. It never overlaps a job
+ * of the same task. May be null.
+ * \param instance Passed to run and release
+ * \param period Ticks between releases, must divide the frame
+ * \param deadline Ticks after the release the job must be done by, 0 selects
+ * the period
+ * \param cost Relative run time, 0 counts as 1
+ * \param phase [out] Tick of the frame of the first release, may be null
+ * \return success
+ * \note A release while the previous job is still queued or running is
+ * dropped and counted as skipped, so a task never has two jobs in flight
+ * \note Call from the context that calls ASC_TASK_SCHEDULER_Tick
+ */
+bool ASC_TASK_SCHEDULER_AddBackground( ASC_TASK_SCHEDULER * scheduler,
+                                       ASC_TASK_SCHEDULER_JOB run,
+                                       ASC_TASK_SCHEDULER_JOB release,
+                                       void * instance,
+                                       uint32_t period,
+                                       uint32_t deadline,
+                                       uint32_t cost,
+                                       uint32_t * phase )
+{
+  return scheduler && run &&
+         _Add( scheduler, run, release, instance, period, ( deadline > 0U ) ? deadline : period, cost, true, phase );
+}
+
+/*!
+ * \brief Advances one tick: flags background jobs past their deadline, runs
+ * the foreground tasks due and releases the background tasks due
+ * \param scheduler The scheduler
+ */
+void ASC_TASK_SCHEDULER_Tick( ASC_TASK_SCHEDULER * scheduler )
+{
+  if ( scheduler )
+  {
+    uint64_t start = _Now();
+    uint64_t elapsed = 0U;
+    uint32_t slot = (uint32_t)( scheduler->tick % scheduler->frame );
+    uint32_t numTasks = 0U;
+    uint32_t ran = 0U;
+    uint32_t i = 0U;
+    bool released = false;
+
+    pthread_mutex_lock( &scheduler->lock );
+    numTasks = scheduler->numTasks;
+
+    for ( i = 0U; i < numTasks; i++ )
+    {
+      ASC_TASK_SCHEDULER_TASK * task = &scheduler->tasks[ i ];
+
+      // counted once, when the tick that is its deadline begins
+      if ( task->queued && !task->missed && ( task->absoluteDeadline <= scheduler->tick ) )
+      {
+        task->missed = true;
+        task->misses++;
+        scheduler->stats.misses++;
+      }
+    }
+
+    pthread_mutex_unlock( &scheduler->lock );
+
+    for ( i = 0U; i < numTasks; i++ )
+    {
+      ASC_TASK_SCHEDULER_TASK * task = &scheduler->tasks[ i ];
+
+      if ( !task->background && ( ( slot % task->period ) == task->phase ) )
+      {
+        uint64_t jobStart = _Now();
+        uint64_t jobElapsed = 0U;
+
+        task->run( task->instance );
+        jobElapsed = _Now() - jobStart;
+        task->worstNanoseconds = ( jobElapsed > task->worstNanoseconds ) ? jobElapsed : task->worstNanoseconds;
+        task->runs++;
+        ran++;
+      }
+    }
+
+    pthread_mutex_lock( &scheduler->lock );
+
+    for ( i = 0U; i < numTasks; i++ )
+    {
+      ASC_TASK_SCHEDULER_TASK * task = &scheduler->tasks[ i ];
+
+      if ( task->background && ( ( slot % task->period ) == task->phase ) )
+      {
+        if ( task->queued )
+        {
+          task->skipped++;
+          scheduler->stats.skipped++;
+        }
+        else
+        {
+          if ( task->release )
+          {
+            task->release( task->instance );
+          }
+
+          task->queued = true;
+          task->missed = false;
+          task->absoluteDeadline = scheduler->tick + task->deadline;
+          _Push( scheduler, i );
+          released = true;
+        }
+      }
+    }
+
+    if ( released )
+    {
+      pthread_cond_broadcast( &scheduler->wake );
+    }
+
+    scheduler->tick++;
+    scheduler->stats.jobs += ran;
+    elapsed = _Now() - start;
+    scheduler->stats.ticks = scheduler->tick;
+    scheduler->totalTickNanoseconds += elapsed;
+    scheduler->stats.worstTickNanoseconds = ( elapsed > scheduler->stats.worstTickNanoseconds ) ?
+                                            elapsed : scheduler->stats.worstTickNanoseconds;
+
+    if ( ( scheduler->tickNanoseconds > 0U ) && ( elapsed > scheduler->tickNanoseconds ) )
+    {
+      scheduler->stats.tickOverruns++;
+    }
+
+    pthread_mutex_unlock( &scheduler->lock );
+  }
+}
+
+/*!
+ * \brief Runs the queued background jobs on the calling thread, earliest
+ * deadline first, until none is left. Meant for a scheduler without workers,
+ * called from the application's idle loop.
+ * \param scheduler The scheduler
+ * \return true if a job ran
+ */
+bool ASC_TASK_SCHEDULER_Background( ASC_TASK_SCHEDULER * scheduler )
+{
+  bool ran = false;
+
+  if ( scheduler )
+  {
+    pthread_mutex_lock( &scheduler->lock );
+
+    while ( scheduler->numReady > 0U )
+    {
+      _RunNext( scheduler );
+      ran = true;
+    }
+
+    pthread_mutex_unlock( &scheduler->lock );
+  }
+
+  return ran;
+}
+
+/*!
+ * \brief Whether no background job is queued or running
+ * \param scheduler The scheduler
+ * \return true when idle
+ */
+bool ASC_TASK_SCHEDULER_Idle( ASC_TASK_SCHEDULER * scheduler )
+{
+  bool idle = true;
+
+  if ( scheduler )
+  {
+    uint32_t i = 0U;
+
+    pthread_mutex_lock( &scheduler->lock );
+
+    for ( i = 0U; ( i < scheduler->numTasks ) && idle; i++ )
+    {
+      idle = !scheduler->tasks[ i ].queued;
+    }
+
+    pthread_mutex_unlock( &scheduler->lock );
+  }
+
+  return idle;
+}
+
+/*!
+ * \brief Copies the totals and the planned load spread
+ * \param scheduler The scheduler
+ * \param stats [out] The totals
+ */
+void ASC_TASK_SCHEDULER_GetStats( ASC_TASK_SCHEDULER * scheduler, ASC_TASK_SCHEDULER_STATS * stats )
+{
+  if ( scheduler && stats )
+  {
+    uint32_t slot = 0U;
+
+    pthread_mutex_lock( &scheduler->lock );
+    *stats = scheduler->stats;
+    stats->meanTickNanoseconds = ( scheduler->tick > 0U ) ? ( scheduler->totalTickNanoseconds / scheduler->tick ) : 0U;
+    stats->minFrameLoad = scheduler->load[ 0 ];
+    stats->maxFrameLoad = scheduler->load[ 0 ];
+
+    for ( slot = 1U; slot < scheduler->frame; slot++ )
+    {
+      stats->minFrameLoad = ( scheduler->load[ slot ] < stats->minFrameLoad ) ? scheduler->load[ slot ] : stats->minFrameLoad;
+      stats->maxFrameLoad = ( scheduler->load[ slot ] > stats->maxFrameLoad ) ? scheduler->load[ slot ] : stats->maxFrameLoad;
+    }
+
+    pthread_mutex_unlock( &scheduler->lock );
+  }
+}
+
+/*!
+ * \brief Stops and joins the workers. Jobs still queued are not run.
+ * \param scheduler The scheduler to be destroyed
+ */
+void ASC_TASK_SCHEDULER_Destroy( ASC_TASK_SCHEDULER * scheduler )
+{
+  if ( scheduler )
+  {
+    uint32_t worker = 0U;
+
+    pthread_mutex_lock( &scheduler->lock );
+    scheduler->shutdown = true;
+    pthread_cond_broadcast( &scheduler->wake );
+    pthread_mutex_unlock( &scheduler->lock );
+
+    for ( worker = 0U; worker < scheduler->numWorkers; worker++ )
+    {
+      pthread_join( scheduler->threads[ worker ], (void**)0 );
+    }
+
+    pthread_cond_destroy( &scheduler->wake );
+    pthread_mutex_destroy( &scheduler->lock );
+  }
+}
@@ -0,0 +1,143 @@
+/**
+ * @file
+ * @brief Defines the interface to the deadline aware scheduler of many thermal
+ * model and torque manager instances
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_TASK_SCHEDULER_H_
+#define _ASC_TASK_SCHEDULER_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bounds of the scheduler storage, define at build time to size it for a
+ * smaller target */
+#ifndef ASC_TASK_SCHEDULER_MAX_TASKS
+#define ASC_TASK_SCHEDULER_MAX_TASKS (4096U)
+#endif
+#define ASC_TASK_SCHEDULER_MAX_FRAME (1000U) //!< Ticks
+#define ASC_TASK_SCHEDULER_MAX_WORKERS (32U)
+
+    /*!
+     * \brief One job of a task, e.g. a wrapper calling
+     * ASC_THERMAL_MODEL_ESTIMATOR_PeriodicTask, ASC_TORQUE_MANAGER_ForegroundTask
+     * or ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_BackgroundTask on one axis
+     * \param instance The instance the task was added with
+     */
+    typedef void (*ASC_TASK_SCHEDULER_JOB)( void * instance );
+
+    /*!
+     * \brief A registered task and the state of its current job
+     */
+    typedef struct
+    {
+        ASC_TASK_SCHEDULER_JOB run;
+        ASC_TASK_SCHEDULER_JOB release; //!< Background only, runs in the tick before the job is queued, may be null
+        void * instance;
+        uint32_t period; //!< Ticks between releases
+        uint32_t phase; //!< Tick of the frame of the first release, chosen by the scheduler
+        uint32_t deadline; //!< Background only, ticks after the release the job must be done by
+        uint32_t cost; //!< Relative run time, weighs the phase choice
+        bool background; //!< Runs on the workers instead of in the tick
+        bool queued; //!< Released and not finished
+        bool missed; //!< The current job is past its deadline
+        uint64_t absoluteDeadline; //!< Tick the current job must be done by
+        uint32_t runs; //!< Finished jobs
+        uint32_t misses; //!< Jobs finished after their deadline
+        uint32_t skipped; //!< Releases dropped while the previous job was still queued
+        uint64_t worstNanoseconds; //!< Longest job
+    } ASC_TASK_SCHEDULER_TASK;
+
+    /*!
+     * \brief Totals over every task since the scheduler was created
+     */
+    typedef struct
+    {
+        uint64_t ticks;
+        uint64_t jobs; //!< Finished jobs, foreground and background
+        uint32_t misses; //!< Background jobs finished after their deadline
+        uint32_t skipped; //!< Background releases dropped, see ASC_TASK_SCHEDULER_TASK
+        uint32_t tickOverruns; //!< Ticks whose foreground jobs took longer than the tick
+        uint64_t worstTickNanoseconds; //!< Longest tick, foreground jobs and releases
+        uint64_t meanTickNanoseconds;
+        uint32_t minFrameLoad; //!< Least planned foreground cost of a tick of the frame
+        uint32_t maxFrameLoad; //!< Most planned foreground cost of a tick of the frame
+    } ASC_TASK_SCHEDULER_STATS;
+
+    /*!
+     * \brief Start argument of a worker thread
+     */
+    typedef struct
+    {
+        void * scheduler; //!< The owning ASC_TASK_SCHEDULER
+        uint32_t index; //!< Worker index
+    } ASC_TASK_SCHEDULER_WORKER;
+
+    typedef struct
+    {
+        uint32_t frame; //!< Ticks every period divides, phases are planned over one frame
+        uint64_t tickNanoseconds; //!< Length of a tick, for tickOverruns
+        uint32_t numTasks;
+        ASC_TASK_SCHEDULER_TASK tasks[ ASC_TASK_SCHEDULER_MAX_TASKS ];
+        uint32_t load[ ASC_TASK_SCHEDULER_MAX_FRAME ]; //!< Planned foreground cost per tick of the frame
+        uint32_t backgroundLoad[ ASC_TASK_SCHEDULER_MAX_FRAME ]; //!< Planned background cost released per tick
+        uint64_t tick; //!< Ticks so far
+        uint32_t ready[ ASC_TASK_SCHEDULER_MAX_TASKS ]; //!< Queued background tasks, a heap by absoluteDeadline
+        uint32_t numReady;
+        uint32_t numWorkers; //!< Worker threads, 0 runs background jobs in ASC_TASK_SCHEDULER_Background
+        pthread_t threads[ ASC_TASK_SCHEDULER_MAX_WORKERS ];
+        ASC_TASK_SCHEDULER_WORKER workers[ ASC_TASK_SCHEDULER_MAX_WORKERS ];
+        pthread_mutex_t lock; //!< Guards the heap and the background task state
+        pthread_cond_t wake; //!< Signals queued jobs or shutdown
+        bool shutdown;
+        ASC_TASK_SCHEDULER_STATS stats;
+        uint64_t totalTickNanoseconds;
+    } ASC_TASK_SCHEDULER;
+
+    extern bool ASC_TASK_SCHEDULER_Create( ASC_TASK_SCHEDULER * scheduler,
+                                           uint32_t frame,
+                                           uint64_t tickNanoseconds,
+                                           uint32_t numWorkers );
+    extern bool ASC_TASK_SCHEDULER_AddForeground( ASC_TASK_SCHEDULER * scheduler,
+                                                  ASC_TASK_SCHEDULER_JOB run,
+                                                  void * instance,
+                                                  uint32_t period,
+                                                  uint32_t cost,
+                                                  uint32_t * phase );
+    extern bool ASC_TASK_SCHEDULER_AddBackground( ASC_TASK_SCHEDULER * scheduler,
+                                                  ASC_TASK_SCHEDULER_JOB run,
+                                                  ASC_TASK_SCHEDULER_JOB release,
+                                                  void * instance,
+                                                  uint32_t period,
+                                                  uint32_t deadline,
+                                                  uint32_t cost,
+                                                  uint32_t * phase );
+    extern void ASC_TASK_SCHEDULER_Tick( ASC_TASK_SCHEDULER * scheduler );
+    extern bool ASC_TASK_SCHEDULER_Background( ASC_TASK_SCHEDULER * scheduler );
+    extern bool ASC_TASK_SCHEDULER_Idle( ASC_TASK_SCHEDULER * scheduler );
+    extern void ASC_TASK_SCHEDULER_GetStats( ASC_TASK_SCHEDULER * scheduler, ASC_TASK_SCHEDULER_STATS * stats );
+    extern void ASC_TASK_SCHEDULER_Destroy( ASC_TASK_SCHEDULER * scheduler );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
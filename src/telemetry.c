@@ -0,0 +1,390 @@
+/**
+ * @file
+ * @brief Definition and implementation of the binary telemetry ring buffer
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "telemetry.h"
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined( ASC_TELEMETRY_HAS_WRITER )
+#include <pthread.h>
+#include <time.h>
+#endif
+
+/* The producer publishes a record by storing head after the record, and the
+ * consumer releases a slot by storing tail after reading it. Hosted compilers
+ * get acquire/release ordering from the builtins; on single core targets
+ * without them the volatile accesses are sufficient.
+ */
+#if defined( __GNUC__ )
+#define LOAD_ACQUIRE( p ) __atomic_load_n( (p), __ATOMIC_ACQUIRE )
+#define STORE_RELEASE( p, v ) __atomic_store_n( (p), (v), __ATOMIC_RELEASE )
+#else
+#define LOAD_ACQUIRE( p ) ( *(p) )
+#define STORE_RELEASE( p, v ) ( *(p) = (v) )
+#endif
+
+/*!
+ * \brief Initializes a ring on caller provided record storage
+ * \param ring The ring to be initialized
+ * \param records Storage for capacity records
+ * \param capacity Number of records, must be a power of two
+ * \return success
+ */
+bool ASC_TELEMETRY_Init( ASC_TELEMETRY_RING * ring,
+                         ASC_TELEMETRY_RECORD * records,
+                         uint32_t capacity )
+{
+  bool status = false;
+
+  if ( ring && records && ( capacity > 0U ) && ( ( capacity & ( capacity - 1U ) ) == 0U ) )
+  {
+    memset( (char*)ring, 0, sizeof( *ring ) );
+    ring->records = records;
+    ring->capacity = capacity;
+    status = true;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Reserves the next record slot for the producer to fill in place
+ * \param ring The ring being written
+ * \return Pointer to the zeroed slot, null if the ring is full (the record
+ * is counted as dropped)
+ * \note Must be followed by ASC_TELEMETRY_Commit before the next Reserve
+ */
+ASC_TELEMETRY_RECORD * ASC_TELEMETRY_Reserve( ASC_TELEMETRY_RING * ring )
+{
+  ASC_TELEMETRY_RECORD * record = (ASC_TELEMETRY_RECORD*)0;
+
+  if ( ring )
+  {
+    uint32_t head = ring->head;
+
+    if ( ( head - LOAD_ACQUIRE( &ring->tail ) ) < ring->capacity )
+    {
+      record = &ring->records[ head & ( ring->capacity - 1U ) ];
+
+      // records are written raw, so the compiler's trailing padding must not
+      // carry whatever the slot held before
+      memset( (char*)record, 0, sizeof( *record ) );
+      record->sequence = ring->sequence;
+    }
+    else
+    {
+      ring->dropped++;
+    }
+
+    ring->sequence++;
+  }
+
+  return record;
+}
+
+/*!
+ * \brief Publishes the record filled after ASC_TELEMETRY_Reserve
+ * \param ring The ring being written
+ */
+void ASC_TELEMETRY_Commit( ASC_TELEMETRY_RING * ring )
+{
+  if ( ring )
+  {
+    STORE_RELEASE( &ring->head, ring->head + 1U );
+  }
+}
+
+/*!
+ * \brief Writes one thermal model record into the ring
+ * \param ring The ring being written
+ * \param timestamp Model time in ms
+ * \param axis Axis identifier of the producer
+ * \param outputs ASC_THERMAL_MODEL_NUM_OUTPUTS estimated temperatures
+ * \param inputs ASC_THERMAL_MODEL_NUM_INPUTS heat source inputs
+ * \param verdict Overload availability
+ * \return false if the record was dropped
+ */
+bool ASC_TELEMETRY_Push( ASC_TELEMETRY_RING * ring,
+                         uint64_t timestamp,
+                         uint16_t axis,
+                         const float * outputs,
+                         const float * inputs,
+                         bool verdict )
+{
+  bool status = false;
+  ASC_TELEMETRY_RECORD * record = ( outputs && inputs ) ? ASC_TELEMETRY_Reserve( ring ) : (ASC_TELEMETRY_RECORD*)0;
+
+  if ( record )
+  {
+    uint32_t itr = 0U;
+
+    record->timestamp = timestamp;
+    record->axis = axis;
+    record->verdict = verdict ? 1U : 0U;
+    record->reserved = 0U;
+
+    for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_OUTPUTS; itr++ )
+    {
+      record->outputs[ itr ] = outputs[ itr ];
+    }
+
+    for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_INPUTS; itr++ )
+    {
+      record->inputs[ itr ] = inputs[ itr ];
+    }
+
+    ASC_TELEMETRY_Commit( ring );
+    status = true;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Consumer side, writes pending records straight from the ring storage
+ * to a file in at most two contiguous blocks
+ * \param ring The ring being drained
+ * \param file The output file
+ * \param maxRecords Upper bound on records written in this call
+ * \return Number of records written
+ */
+uint32_t ASC_TELEMETRY_Drain( ASC_TELEMETRY_RING * ring,
+                              FILE * file,
+                              uint32_t maxRecords )
+{
+  uint32_t written = 0U;
+
+  if ( ring && file )
+  {
+    uint32_t tail = ring->tail;
+    uint32_t pending = LOAD_ACQUIRE( &ring->head ) - tail;
+
+    if ( pending > maxRecords )
+    {
+      pending = maxRecords;
+    }
+
+    while ( written < pending )
+    {
+      uint32_t index = ( tail + written ) & ( ring->capacity - 1U );
+      uint32_t span = ring->capacity - index;
+      size_t count = 0U;
+
+      if ( span > ( pending - written ) )
+      {
+        span = pending - written;
+      }
+
+      count = fwrite( (const void*)&ring->records[ index ], sizeof( ASC_TELEMETRY_RECORD ), span, file );
+      written += (uint32_t)count;
+
+      if ( count != span )
+      {
+        break;
+      }
+    }
+
+    STORE_RELEASE( &ring->tail, tail + written );
+  }
+
+  return written;
+}
+
+/*!
+ * \brief Writes the telemetry file header
+ * \param file The output file
+ * \return success
+ */
+bool ASC_TELEMETRY_WriteHeader( FILE * file )
+{
+  bool status = false;
+
+  if ( file )
+  {
+    ASC_TELEMETRY_FILE_HEADER header;
+
+    header.magic = ASC_TELEMETRY_MAGIC;
+    header.version = ASC_TELEMETRY_VERSION;
+    header.recordSize = (uint16_t)sizeof( ASC_TELEMETRY_RECORD );
+    header.numOutputs = ASC_THERMAL_MODEL_NUM_OUTPUTS;
+    header.numInputs = ASC_THERMAL_MODEL_NUM_INPUTS;
+
+    status = ( fwrite( (const void*)&header, sizeof( header ), 1U, file ) == 1U );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Reads and validates the telemetry file header
+ * \param file The input file positioned at its start
+ * \param header [out] The header read
+ * \return true if the header matches this build's record layout
+ */
+bool ASC_TELEMETRY_ReadHeader( FILE * file, ASC_TELEMETRY_FILE_HEADER * header )
+{
+  bool status = false;
+
+  if ( file && header &&
+       ( fread( (void*)header, sizeof( *header ), 1U, file ) == 1U ) )
+  {
+    status = ( header->magic == ASC_TELEMETRY_MAGIC ) &&
+             ( header->version == ASC_TELEMETRY_VERSION ) &&
+             ( header->recordSize == sizeof( ASC_TELEMETRY_RECORD ) ) &&
+             ( header->numOutputs == ASC_THERMAL_MODEL_NUM_OUTPUTS ) &&
+             ( header->numInputs == ASC_THERMAL_MODEL_NUM_INPUTS );
+  }
+
+  return status;
+}
+
+#if defined( ASC_TELEMETRY_HAS_WRITER )
+
+/*!
+ * \brief Drains every ring once
+ * \return Number of records written
+ * \note As this is a static function, there is no input validation
+ */
+static uint32_t _DrainAll( ASC_TELEMETRY_WRITER * writer )
+{
+  uint32_t written = 0U;
+  uint32_t itr = 0U;
+
+  for ( itr = 0U; itr < writer->numRings; itr++ )
+  {
+    written += ASC_TELEMETRY_Drain( writer->rings[ itr ], writer->file, writer->rings[ itr ]->capacity );
+  }
+
+  return written;
+}
+
+/*!
+ * \brief Consumer thread, drains until stopped then flushes what is left
+ */
+static void * _WriterThread( void * context )
+{
+  ASC_TELEMETRY_WRITER * writer = (ASC_TELEMETRY_WRITER*)context;
+  struct timespec poll;
+
+  poll.tv_sec = (time_t)( writer->pollMicroseconds / 1000000U );
+  poll.tv_nsec = (long)( writer->pollMicroseconds % 1000000U ) * 1000L;
+
+  while ( LOAD_ACQUIRE( &writer->running ) )
+  {
+    if ( _DrainAll( writer ) == 0U )
+    {
+      nanosleep( &poll, (struct timespec*)0 );
+    }
+  }
+
+  while ( _DrainAll( writer ) > 0U )
+  {
+  }
+
+  return (void*)0;
+}
+
+/*!
+ * \brief Opens the output file and starts the consumer thread
+ * \param writer The writer to be started
+ * \param rings Rings to drain, each with exactly one producer
+ * \param numRings Length of rings
+ * \param path Output file path
+ * \return success
+ */
+bool ASC_TELEMETRY_StartWriter( ASC_TELEMETRY_WRITER * writer,
+                                ASC_TELEMETRY_RING ** rings,
+                                uint32_t numRings,
+                                const char * path )
+{
+  bool status = false;
+
+  if ( writer && rings && path )
+  {
+    writer->rings = rings;
+    writer->numRings = numRings;
+    writer->pollMicroseconds = ( writer->pollMicroseconds > 0U ) ? writer->pollMicroseconds : 1000U;
+    writer->file = fopen( path, "wb" );
+    writer->running = true;
+
+    if ( writer->file && ASC_TELEMETRY_WriteHeader( writer->file ) )
+    {
+      status = ( pthread_create( &writer->thread, (pthread_attr_t*)0, _WriterThread, (void*)writer ) == 0 );
+    }
+
+    if ( !status && writer->file )
+    {
+      fclose( writer->file );
+      writer->file = (FILE*)0;
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Stops the consumer thread after it drained every ring and closes the
+ * output file
+ * \param writer The writer to be stopped
+ * \return success
+ */
+bool ASC_TELEMETRY_StopWriter( ASC_TELEMETRY_WRITER * writer )
+{
+  bool status = false;
+
+  if ( writer && writer->file )
+  {
+    STORE_RELEASE( &writer->running, false );
+    status = ( pthread_join( writer->thread, (void**)0 ) == 0 );
+    status &= ( fclose( writer->file ) == 0 );
+    writer->file = (FILE*)0;
+  }
+
+  return status;
+}
+
+#else
+
+bool ASC_TELEMETRY_StartWriter( ASC_TELEMETRY_WRITER * writer,
+                                ASC_TELEMETRY_RING ** rings,
+                                uint32_t numRings,
+                                const char * path )
+{
+  (void)writer;
+  (void)rings;
+  (void)numRings;
+  (void)path;
+
+  return false;
+}
+
+bool ASC_TELEMETRY_StopWriter( ASC_TELEMETRY_WRITER * writer )
+{
+  (void)writer;
+
+  return false;
+}
+
+#endif
@@ -0,0 +1,127 @@
+/** 
+ * @file
+ * @brief Defines the interface to the binary telemetry ring buffer used to
+ * log thermal model records from the control loop
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_TELEMETRY_H_
+#define _ASC_TELEMETRY_H_
+
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#include <pthread.h>
+#define ASC_TELEMETRY_HAS_WRITER 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASC_TELEMETRY_MAGIC (0x54435341UL) //!< "ASCT"
+#define ASC_TELEMETRY_VERSION (1U)
+
+/* Keeps the producer and consumer indices on separate cache lines */
+#define ASC_TELEMETRY_CACHE_LINE (64U)
+
+    /*!
+     * \brief One fixed-size binary telemetry record
+     */
+    typedef struct
+    {
+        uint64_t timestamp; //!< Model time in ms
+        uint32_t sequence; //!< Per-ring record counter, gaps mean dropped records
+        uint16_t axis; //!< Axis identifier of the producer
+        uint8_t verdict; //!< 1U if overload is available
+        uint8_t reserved;
+        float outputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< Estimated temperatures
+        float inputs[ ASC_THERMAL_MODEL_NUM_INPUTS ]; //!< Heat source inputs of the period
+    } ASC_TELEMETRY_RECORD;
+
+    /*!
+     * \brief Header at the start of every telemetry file
+     */
+    typedef struct
+    {
+        uint32_t magic; //!< ASC_TELEMETRY_MAGIC
+        uint16_t version; //!< ASC_TELEMETRY_VERSION
+        uint16_t recordSize; //!< sizeof( ASC_TELEMETRY_RECORD )
+        uint16_t numOutputs; //!< outputs per record
+        uint16_t numInputs; //!< inputs per record
+    } ASC_TELEMETRY_FILE_HEADER;
+
+    /*!
+     * \brief Single producer, single consumer ring of records. The producer
+     * only writes head and the consumer only writes tail, so neither side
+     * takes a lock. Records are dropped, and counted, when the ring is full.
+     */
+    typedef struct
+    {
+        ASC_TELEMETRY_RECORD * records; //!< Caller storage, capacity records long
+        uint32_t capacity; //!< Must be a power of two
+        uint32_t sequence; //!< Producer record counter
+        uint32_t dropped; //!< Records lost to a full ring, written by the producer
+        uint8_t padHead[ ASC_TELEMETRY_CACHE_LINE ];
+        volatile uint32_t head; //!< Next slot to write, producer owned
+        uint8_t padTail[ ASC_TELEMETRY_CACHE_LINE ];
+        volatile uint32_t tail; //!< Next slot to read, consumer owned
+    } ASC_TELEMETRY_RING;
+
+    /*!
+     * \brief Consumer that drains a set of rings to a file on its own thread
+     */
+    typedef struct
+    {
+        ASC_TELEMETRY_RING ** rings; //!< Rings to drain
+        uint32_t numRings; //!< Length of rings
+        uint32_t pollMicroseconds; //!< Sleep when all rings are empty
+        FILE * file; //!< Output file
+        volatile bool running; //!< Cleared to stop the thread
+#if defined( ASC_TELEMETRY_HAS_WRITER )
+        pthread_t thread; //!< Consumer thread
+#endif
+    } ASC_TELEMETRY_WRITER;
+
+    extern bool ASC_TELEMETRY_Init( ASC_TELEMETRY_RING * ring,
+                                    ASC_TELEMETRY_RECORD * records,
+                                    uint32_t capacity );
+    extern ASC_TELEMETRY_RECORD * ASC_TELEMETRY_Reserve( ASC_TELEMETRY_RING * ring );
+    extern void ASC_TELEMETRY_Commit( ASC_TELEMETRY_RING * ring );
+    extern bool ASC_TELEMETRY_Push( ASC_TELEMETRY_RING * ring,
+                                    uint64_t timestamp,
+                                    uint16_t axis,
+                                    const float * outputs,
+                                    const float * inputs,
+                                    bool verdict );
+    extern uint32_t ASC_TELEMETRY_Drain( ASC_TELEMETRY_RING * ring,
+                                         FILE * file,
+                                         uint32_t maxRecords );
+    extern bool ASC_TELEMETRY_WriteHeader( FILE * file );
+    extern bool ASC_TELEMETRY_ReadHeader( FILE * file, ASC_TELEMETRY_FILE_HEADER * header );
+    extern bool ASC_TELEMETRY_StartWriter( ASC_TELEMETRY_WRITER * writer,
+                                           ASC_TELEMETRY_RING ** rings,
+                                           uint32_t numRings,
+                                           const char * path );
+    extern bool ASC_TELEMETRY_StopWriter( ASC_TELEMETRY_WRITER * writer );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
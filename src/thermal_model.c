@@ -16,18 +16,32 @@
  * limitations under the License.
  */
 
+#include "live_state.h"
 #include "rk4solver.h"
+#include "telemetry.h"
 #include "thermal_model.h"
+#include "thermal_model_checkpoint.h"
+#include "thermal_model_cyclic.h"
 #include "thermal_model_estimator.h"
+#include "thermal_model_file.h"
+#include "thermal_model_overload_map.h"
 #include "thermal_model_overload_predictor.h"
+#include "thermal_model_setpoint_table.h"
+#include "thermal_model_step_operator.h"
 #include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <stdlib.h>
 #include <string.h>
 
 
+/* Solver storage is static so that no path through the thermal model touches
+ * the heap or sizes arrays at runtime.
+ */
+static float _overloadPredictorState[ ASC_THERMAL_MODEL_NUM_STATES ];
+static float _overloadPredictorOutputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+static float _overloadPredictorWorkspace[ RK4SOLVER_WORKSPACE_LENGTH( ASC_THERMAL_MODEL_NUM_STATES,
+                                                                      ASC_THERMAL_MODEL_NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
 static RK4SOLVER_INPUT _overloadPredictorInput;
 static RK4SOLVER_OUTPUT _overloadPredictorOutput;
 static ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR _overloadPredictor = 
@@ -43,12 +57,19 @@ static ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR _overloadPredictor =
   { 5.4168f, 16.0000f, 4.4368f }, // Rated Maximum Thermal Inputs
   (void*)0,
   (void*)0,
-  (void*)0
+  (void*)0,
+  (void*)0 // bound, set at setup
 };
-static bool _setupOverloadPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj, RK4SOLVER_INPUT * rk4Input, RK4SOLVER_OUTPUT * rk4Output );
+static bool _setupOverloadPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj, RK4SOLVER_INPUT * rk4Input, RK4SOLVER_OUTPUT * rk4Output,
+                                     float * state, float * outputs, float * workspace );
 static bool _cleanupOverloadPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj );
+static bool _predictOverload( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj );
 static void _updateOverloadPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj, float ambient, float * initialState );
 
+static float _estimatorState[ ASC_THERMAL_MODEL_NUM_STATES ];
+static float _estimatorOutputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+static float _estimatorWorkspace[ RK4SOLVER_WORKSPACE_LENGTH( ASC_THERMAL_MODEL_NUM_STATES,
+                                                              ASC_THERMAL_MODEL_NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
 static RK4SOLVER_INPUT _estimatorInput;
 static RK4SOLVER_OUTPUT _estimatorOutput;
 static ASC_THERMAL_MODEL_ESTIMATOR _estimator = 
@@ -60,28 +81,121 @@ static ASC_THERMAL_MODEL_ESTIMATOR _estimator =
   { 0.0f, 0.0f, 0.0f }, // Actual Thermal Inputs from the thermal period
   (void*)0,
   (void*)0,
-  (void*)0
+  (void*)0,
+  (void*)0, // period operator, set at setup
+  { { 0.0f } }, // equilibrium gain, set at setup
+  { 0.0f, 0.0f, 0.0f }, // equilibrium of the held inputs
+  0.0f, // quiescent tolerance below the equilibrium, set at setup
+  0.0f, // quiescent tolerance above the equilibrium, set at setup
+  false, // inputs held
+  false, // quiescent
+  { 0.0f, 0.0f, 0.0f }, // forced state change of the setpoint table entry
+  false // forced state change valid
 };
 
-static bool _setupEstimator( ASC_THERMAL_MODEL_ESTIMATOR * obj, RK4SOLVER_INPUT * rk4Input, RK4SOLVER_OUTPUT * rk4Output );
+/* The period operator of a model without a precomputed one, built once and
+ * shared by the estimator and every instance */
+static ASC_THERMAL_MODEL_STEP_OPERATOR _periodOperator;
+static const RK4SOLVER_CONFIGURATION * _periodOperatorConfig = (const RK4SOLVER_CONFIGURATION*)0;
+static float _periodOperatorStep = 0.0f;
+static uint32_t _periodOperatorSteps = 0U;
+
+static bool _setupEstimator( ASC_THERMAL_MODEL_ESTIMATOR * obj, RK4SOLVER_INPUT * rk4Input, RK4SOLVER_OUTPUT * rk4Output,
+                             float * state, float * outputs, float * workspace );
 static bool _cleanupEstimator( ASC_THERMAL_MODEL_ESTIMATOR * obj );
 
+static ASC_THERMAL_MODEL_OVERLOAD_MAP _overloadMap;
+
+/* Predictions whose bound stays this far below every threshold skip the full
+ * 60 s simulation */
+static ASC_THERMAL_MODEL_OVERLOAD_BOUND _overloadBound;
+#define ASC_THERMAL_MODEL_OVERLOAD_BOUND_MARGIN (2.0f) // K
+
+/* An axis holding constant inputs this close to their equilibrium skips the
+ * estimator integration. The float integration itself stalls up to ~3E-04
+ * relative short of the equilibrium, so much tighter never engages when
+ * heating. Above the equilibrium the snap lowers the estimate, so there it
+ * stays within the accuracy harness tolerance and a hot axis cooling to a warm
+ * equilibrium keeps integrating. */
+#define ASC_THERMAL_MODEL_QUIESCENT_TOLERANCE (5.0E-02f) // K
+#define ASC_THERMAL_MODEL_QUIESCENT_ABOVE_TOLERANCE (5.0E-03f) // K
+
+static ASC_THERMAL_MODEL_PUBLISHER _publisher;
+
+static ASC_THERMAL_MODEL_FILE * _model = (ASC_THERMAL_MODEL_FILE*)0; //!< Null for the compiled in model
+
+static void _publishPeriod( ASC_THERMAL_MODEL_PUBLISHER * publisher,
+                            ASC_THERMAL_MODEL_ESTIMATOR * estimator,
+                            ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor );
+static void _publishLiveState( const ASC_THERMAL_MODEL_PUBLISHER * publisher,
+                               ASC_THERMAL_MODEL_ESTIMATOR * estimator,
+                               ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor );
+static void _calculateSourceInputs( float * sourceInputs,
+                                    float * currentSensitivity,
+                                    float * speedSensitivity,
+                                    float driveCurrent,
+                                    float rotationalSpeed );
+static void _calculateLossInputs( const ASC_THERMAL_MODEL_LOSS_CONSTANTS * losses,
+                                  float * sourceInputs,
+                                  float * currentSensitivity,
+                                  float * speedSensitivity,
+                                  float driveCurrent,
+                                  float rotationalSpeed );
+
 /*!
- * \brief Setup and allocation of the overload predictor and estimator
+ * \brief Selects the model of the motor frame in use, e.g. one opened with
+ * ASC_THERMAL_MODEL_FILE_Open, so new frames deploy without a rebuild. The
+ * matrices and precomputed operator are used in place, not copied; the
+ * estimator and every instance point at the same operator.
+ * \param model The model, or null for the compiled in one. It must stay open
+ * while selected.
+ * \return success
+ * \note The source inputs use the new loss constants at once; the estimator
+ * and predictor change over at the next ASC_THERMAL_MODEL_Setup
+ */
+bool ASC_THERMAL_MODEL_SelectModel( ASC_THERMAL_MODEL_FILE * model )
+{
+  bool status = false;
+  
+  if ( !model || model->image )
+  {
+    _model = model;
+    _periodOperatorConfig = (const RK4SOLVER_CONFIGURATION*)0;
+    status = true;
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Setup of the overload predictor and estimator on static storage
  * \return success
  */
 bool ASC_THERMAL_MODEL_Setup( void )
 {
   bool status = true;
+  const ASC_THERMAL_MODEL_RATINGS * ratings = _model ? &_model->image->ratings : ASC_THERMAL_MODEL_ratings;
   
-  status &= _setupOverloadPredictor( &_overloadPredictor, &_overloadPredictorInput, &_overloadPredictorOutput );
-  status &= _setupEstimator( &_estimator, &_estimatorInput, &_estimatorOutput );
+  memcpy( (char*)_overloadPredictor.maxTempThresholds, (char*)ratings->thresholds, sizeof( ratings->thresholds ) );
+  memcpy( (char*)_overloadPredictor.overloadInputs, (char*)ratings->overloadInputs, sizeof( ratings->overloadInputs ) );
+  memcpy( (char*)_overloadPredictor.ratedInputs, (char*)ratings->ratedInputs, sizeof( ratings->ratedInputs ) );
+  
+  status &= _setupOverloadPredictor( &_overloadPredictor, &_overloadPredictorInput, &_overloadPredictorOutput,
+                                     _overloadPredictorState, _overloadPredictorOutputs, _overloadPredictorWorkspace );
+  status &= _setupEstimator( &_estimator, &_estimatorInput, &_estimatorOutput,
+                             _estimatorState, _estimatorOutputs, _estimatorWorkspace );
+  status &= ASC_THERMAL_MODEL_OVERLOAD_MAP_Setup( &_overloadMap, &_overloadPredictor );
+  status &= ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_SetupBound( &_overloadPredictor,
+                                                             &_overloadBound,
+                                                             ASC_THERMAL_MODEL_OVERLOAD_BOUND_MARGIN );
+  _publisher.modelTime = 0U;
+  _publisher.predictionTime = 0U;
   
   return status;
 }
 
 /*!
- * \brief Cleanup and deallocation of the overload predictor and estimator
+ * \brief Cleanup and release of the overload predictor and estimator storage
  * \return success
  */
 bool ASC_THERMAL_MODEL_Cleanup( void )
@@ -96,10 +210,146 @@ bool ASC_THERMAL_MODEL_Cleanup( void )
 
 /*!
  * \brief A background task that runs the Overload Predictor.
+ * \note Each run predicts from the start of the current thermal period into
+ * local peaks and only replaces the published peaks once it completes. A
+ * foreground read that preempts it sees the previous prediction, never a
+ * partial one, and repeated calls within a period give the same verdict.
  */
 void ASC_THERMAL_MODEL_BackgroundTask( void )
 {
-  ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_BackgroundTask( &_overloadPredictor );
+  if ( _predictOverload( &_overloadPredictor ) )
+  {
+    _publisher.predictionTime = _publisher.modelTime;
+  }
+  
+  _publishLiveState( &_publisher, &_estimator, &_overloadPredictor );
+}
+
+/*!
+ * \brief Sets up one axis of a drive running several axes off the selected
+ * model, the way ASC_THERMAL_MODEL_Setup sets up its own estimator and
+ * overload predictor. The instance holds all of its solver storage.
+ * \param instance The axis
+ * \return success
+ * \note The instance's estimator runs with ASC_THERMAL_MODEL_ESTIMATOR_SetInputs
+ * and ASC_THERMAL_MODEL_InstancePeriodicTask. Its predictor starts from
+ * predictor.initialState, which the caller sets from the estimator state at
+ * the start of each thermal period. Telemetry and live state are off until
+ * set after this call.
+ */
+bool ASC_THERMAL_MODEL_SetupInstance( ASC_THERMAL_MODEL_INSTANCE * instance )
+{
+  bool status = false;
+  
+  if ( instance )
+  {
+    const ASC_THERMAL_MODEL_RATINGS * ratings = _model ? &_model->image->ratings : ASC_THERMAL_MODEL_ratings;
+    
+    memset( (char*)instance, 0, sizeof( *instance ) );
+    instance->estimator.h = _estimator.h;
+    instance->estimator.periodCounts = _estimator.periodCounts;
+    instance->estimator.ambientTemp = _estimator.ambientTemp;
+    instance->predictor.h = _overloadPredictor.h;
+    instance->predictor.periodCounts = _overloadPredictor.periodCounts;
+    instance->predictor.overloadCounts = _overloadPredictor.overloadCounts;
+    instance->predictor.ambientTemp = _overloadPredictor.ambientTemp;
+    memcpy( (char*)instance->predictor.maxTempThresholds, (char*)ratings->thresholds, sizeof( ratings->thresholds ) );
+    memcpy( (char*)instance->predictor.overloadInputs, (char*)ratings->overloadInputs, sizeof( ratings->overloadInputs ) );
+    memcpy( (char*)instance->predictor.ratedInputs, (char*)ratings->ratedInputs, sizeof( ratings->ratedInputs ) );
+    
+    status = _setupOverloadPredictor( &instance->predictor, &instance->predictorInput, &instance->predictorOutput,
+                                      instance->predictorState, instance->predictorOutputs, instance->predictorWorkspace ) &&
+             _setupEstimator( &instance->estimator, &instance->estimatorInput, &instance->estimatorOutput,
+                              instance->estimatorState, instance->estimatorOutputs, instance->estimatorWorkspace );
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief A background task that runs the Overload Predictor of one instance,
+ * like ASC_THERMAL_MODEL_BackgroundTask
+ * \param instance An axis set up with ASC_THERMAL_MODEL_SetupInstance
+ * \return success, the verdict is then
+ * ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_IsOverloadAvailable of its predictor
+ */
+bool ASC_THERMAL_MODEL_InstanceBackgroundTask( ASC_THERMAL_MODEL_INSTANCE * instance )
+{
+  bool status = false;
+  
+  if ( instance )
+  {
+    status = _predictOverload( &instance->predictor );
+    
+    if ( status )
+    {
+      instance->publisher.predictionTime = instance->publisher.modelTime;
+    }
+    
+    _publishLiveState( &instance->publisher, &instance->estimator, &instance->predictor );
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief A periodic task that calculates the current temperature of one
+ * instance, like ASC_THERMAL_MODEL_PeriodicTask
+ * \param instance An axis set up with ASC_THERMAL_MODEL_SetupInstance
+ * \note The predictor's initialState is left to the caller, which hands the
+ * estimate over when no prediction of the instance is running
+ */
+void ASC_THERMAL_MODEL_InstancePeriodicTask( ASC_THERMAL_MODEL_INSTANCE * instance )
+{
+  if ( instance )
+  {
+    ASC_THERMAL_MODEL_ESTIMATOR_PeriodicTask( &instance->estimator );
+    _publishPeriod( &instance->publisher, &instance->estimator, &instance->predictor );
+  }
+}
+
+/*!
+ * \brief Routes a binary record of every thermal period of one instance into
+ * a telemetry ring, like ASC_THERMAL_MODEL_SetTelemetry
+ * \param instance An axis set up with ASC_THERMAL_MODEL_SetupInstance
+ * \param ring The ring written by ASC_THERMAL_MODEL_InstancePeriodicTask, null
+ * to stop
+ * \param axis Axis identifier stored in each record
+ */
+void ASC_THERMAL_MODEL_SetInstanceTelemetry( ASC_THERMAL_MODEL_INSTANCE * instance,
+                                             ASC_TELEMETRY_RING * ring,
+                                             uint16_t axis )
+{
+  if ( instance )
+  {
+    instance->publisher.telemetryRing = ring;
+    instance->publisher.telemetryAxis = axis;
+  }
+}
+
+/*!
+ * \brief Publishes the estimate and verdict of one instance into a live state
+ * table, like ASC_THERMAL_MODEL_SetLiveState
+ * \param instance An axis set up with ASC_THERMAL_MODEL_SetupInstance
+ * \param table A table made by ASC_LIVE_STATE_Create or ASC_LIVE_STATE_Init,
+ * null to stop
+ * \param slot The slot of this instance in the table, one per instance
+ * \param axis Axis identifier stored in the snapshot
+ * \note A slot has a single writer. When the periodic and background tasks of
+ * the instance run on different threads, they must not overlap.
+ */
+void ASC_THERMAL_MODEL_SetInstanceLiveState( ASC_THERMAL_MODEL_INSTANCE * instance,
+                                             ASC_LIVE_STATE_TABLE * table,
+                                             uint32_t slot,
+                                             uint16_t axis )
+{
+  if ( instance )
+  {
+    instance->publisher.liveState = table;
+    instance->publisher.liveStateSlot = slot;
+    instance->publisher.liveStateAxis = axis;
+    _publishLiveState( &instance->publisher, &instance->estimator, &instance->predictor );
+  }
 }
 
 /*!
@@ -111,6 +361,28 @@ void ASC_THERMAL_MODEL_PeriodicTask( void )
   ASC_THERMAL_MODEL_ESTIMATOR_PeriodicTask( &_estimator );
   
   _updateOverloadPredictor( &_overloadPredictor, _estimator.ambientTemp, _estimator.solverOutputs->nextState );
+  
+  _publishPeriod( &_publisher, &_estimator, &_overloadPredictor );
+}
+
+/*!
+ * \brief Catches the model up over an elapsed time without calling the periodic
+ * task once per missed period. The inputs last set are held for the whole gap.
+ * \param elapsed The time to advance in seconds
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_FastForward( float elapsed )
+{
+  bool status = ASC_THERMAL_MODEL_ESTIMATOR_FastForward( &_estimator, elapsed );
+  
+  if ( status )
+  {
+    _publisher.modelTime += (uint64_t)( elapsed * 1000.0f + 0.5f );
+    _updateOverloadPredictor( &_overloadPredictor, _estimator.ambientTemp, _estimator.solverOutputs->nextState );
+    _publishLiveState( &_publisher, &_estimator, &_overloadPredictor );
+  }
+  
+  return status;
 }
 
 /*!
@@ -124,6 +396,38 @@ bool ASC_THERMAL_MODEL_IsOverloadAvailable( void )
   return ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_IsOverloadAvailable( &_overloadPredictor );
 }
 
+/*!
+ * \brief Determines which combinations of overload level and duration are
+ * available for the next thermal period, in one pass instead of one overload
+ * predictor run per combination
+ * \param levels numLevels heat source input vectors, row major, see
+ * ASC_THERMAL_MODEL_CalculateSourceInputs
+ * \param numLevels Number of overload levels
+ * \param durations numDurations overload durations in seconds, one overload
+ * predictor step each
+ * \param numDurations Number of durations
+ * \param allowed [out] numLevels x numDurations availability, row major
+ * \param maxDurations [out] Longest available duration of each level in
+ * seconds, may be null
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_GetOverloadMap( const float * levels,
+                                       uint32_t numLevels,
+                                       const uint32_t * durations,
+                                       uint32_t numDurations,
+                                       bool * allowed,
+                                       uint32_t * maxDurations )
+{
+  return ASC_THERMAL_MODEL_OVERLOAD_MAP_Evaluate( &_overloadMap,
+                                                  &_overloadPredictor,
+                                                  levels,
+                                                  numLevels,
+                                                  durations,
+                                                  numDurations,
+                                                  allowed,
+                                                  maxDurations );
+}
+
 /*! 
  * \brief Gets the current estimated termperatures of the system
  * \param temperatures [out] Array of system temperatures
@@ -160,6 +464,64 @@ void ASC_THERMAL_MODEL_SetInputs( float * inputs )
   ASC_THERMAL_MODEL_ESTIMATOR_SetInputs( &_estimator, inputs );
 }
 
+/*!
+ * \brief Sets the thermal source inputs of the estimator from the setpoint
+ * loads accumulated over the previous period, in place of
+ * ASC_THERMAL_MODEL_SetInputs. The period then costs one operator application.
+ * \param acc The setpoint loads of each control tick, cleared for the next
+ * period
+ * \return success
+ * \retval false Nothing was accumulated or some tick had no setpoint entry, the
+ * inputs are unchanged: set them with ASC_THERMAL_MODEL_SetInputs instead
+ */
+bool ASC_THERMAL_MODEL_SetSetpointInputs( ASC_THERMAL_MODEL_SETPOINT_ACCUMULATOR * acc )
+{
+  float inputs[ ASC_THERMAL_MODEL_NUM_INPUTS ];
+  float forced[ ASC_THERMAL_MODEL_NUM_STATES ];
+  bool status = ASC_THERMAL_MODEL_SETPOINT_TABLE_Average( acc, inputs, forced );
+  
+  if ( status )
+  {
+    ASC_THERMAL_MODEL_ESTIMATOR_SetForcedInputs( &_estimator, inputs, forced );
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Precomputes the thermal load of each torque setpoint for
+ * ASC_TORQUE_MANAGER_SetThermalEntries, after ASC_THERMAL_MODEL_Setup
+ * \param entries [out] count entries
+ * \param count Number of setpoints, ASC_TORQUE_SETPOINT_COUNT
+ * \param currents Drive current of each setpoint in Amps
+ * \param speeds Typical rotational speed while each setpoint is active in
+ * rad/s, e.g. half the cruise speed while accelerating
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_BuildSetpointTable( ASC_THERMAL_MODEL_SETPOINT_ENTRY * entries,
+                                           uint32_t count,
+                                           const float * currents,
+                                           const float * speeds )
+{
+  bool status = false;
+  
+  if ( entries && currents && speeds && ( count > 0U ) && _estimator.periodOperator )
+  {
+    float inputs[ ASC_THERMAL_MODEL_NUM_INPUTS ];
+    uint32_t itr = 0U;
+    
+    status = true;
+    
+    for ( itr = 0U; ( itr < count ) && status; itr++ )
+    {
+      _calculateSourceInputs( inputs, (float*)0, (float*)0, currents[ itr ], speeds[ itr ] );
+      status = ASC_THERMAL_MODEL_SETPOINT_TABLE_Build( &entries[ itr ], 1U, inputs, _estimator.periodOperator );
+    }
+  }
+  
+  return status;
+}
+
 /*!
  * \brief Calculates the thermal inputs based on drive current and rotational speed
  * \param sourceInputs [out] The calculated thermal inputs in Watts
@@ -168,27 +530,199 @@ void ASC_THERMAL_MODEL_SetInputs( float * inputs )
  */
 void ASC_THERMAL_MODEL_CalculateSourceInputs( float * sourceInputs, float driveCurrent, float rotationalSpeed )
 {
-  if ( sourceInputs )
+  _calculateSourceInputs( sourceInputs, (float*)0, (float*)0, driveCurrent, rotationalSpeed );
+}
+
+/*!
+ * \brief Calculates the derivatives of the thermal inputs of
+ * ASC_THERMAL_MODEL_CalculateSourceInputs, the input sensitivities of an
+ * optimizer over current or speed
+ * \param currentSensitivity [out] d(sourceInputs)/d(driveCurrent) in W/A, may
+ * be null
+ * \param speedSensitivity [out] d(sourceInputs)/d(rotationalSpeed) in
+ * W s/rad, may be null
+ * \param driveCurrent The drive current applied to the system in Amps
+ * \param rotationalSpeed The rotational speed of the motor in rad/s
+ */
+void ASC_THERMAL_MODEL_CalculateSourceInputSensitivity( float * currentSensitivity,
+                                                        float * speedSensitivity,
+                                                        float driveCurrent,
+                                                        float rotationalSpeed )
+{
+  _calculateSourceInputs( (float*)0, currentSensitivity, speedSensitivity, driveCurrent, rotationalSpeed );
+}
+
+/*!
+ * \brief Calculates the thermal inputs like
+ * ASC_THERMAL_MODEL_CalculateSourceInputs, but with given loss constants
+ * instead of those of the selected model, e.g. for a parameter fit trying
+ * candidate constants
+ * \param losses The loss constants
+ * \param sourceInputs [out] The calculated thermal inputs in Watts
+ * \param driveCurrent The drive current applied to the system in Amps
+ * \param rotationalSpeed The rotational speed of the motor in rad/s
+ */
+void ASC_THERMAL_MODEL_CalculateLossInputs( const ASC_THERMAL_MODEL_LOSS_CONSTANTS * losses,
+                                            float * sourceInputs,
+                                            float driveCurrent,
+                                            float rotationalSpeed )
+{
+  if ( losses && sourceInputs )
+  {
+    _calculateLossInputs( losses, sourceInputs, (float*)0, (float*)0, driveCurrent, rotationalSpeed );
+  }
+}
+
+/*!
+ * \brief Predicts the overload profile at a given overload current and speed
+ * from the start of the current thermal period, and how its peaks move with
+ * that current and speed, in one pass. Lets a current limit search take
+ * gradient steps instead of re-running the prediction per candidate.
+ * \param overloadCurrent Drive current during the overload in Amps
+ * \param rotationalSpeed Speed during the overload in rad/s
+ * \param peaks [out] ASC_THERMAL_MODEL_NUM_OUTPUTS predicted peaks relative to
+ * ambient
+ * \param currentSensitivity [out] ASC_THERMAL_MODEL_NUM_OUTPUTS, d(peak)/d(current)
+ * in K/A
+ * \param speedSensitivity [out] ASC_THERMAL_MODEL_NUM_OUTPUTS, d(peak)/d(speed)
+ * in K s/rad, may be null
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_GetOverloadSensitivity( float overloadCurrent,
+                                               float rotationalSpeed,
+                                               float * peaks,
+                                               float * currentSensitivity,
+                                               float * speedSensitivity )
+{
+  bool status = false;
+  
+  if ( peaks && currentSensitivity )
   {
-    float phaseResistancex2 = 2.0f * 1.0f;
-    float rdsOnx4 = 4.0f * 1.325E-02f;
-    float busVoltagex4xtRiseFallxfSwitching = 4.0f * 48.0f * 1.4E+05f * (15E-09f + 19E-09f);
-    float rsnsx2 = 2.0f * 2.0E-02f;
-    float oneOverSqrt2 = 0.70711f;
-    float driveCurrentRms = driveCurrent * oneOverSqrt2;
-    float driveCurrentRmsSquared = driveCurrent * driveCurrent / 2.0f;
-    float measuredOtherPowerComonents = 0.27f;
+    ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR predictor = _overloadPredictor;
+    float overloadSensitivity[ 2U ][ ASC_THERMAL_MODEL_NUM_INPUTS ];
+    float ratedSensitivity[ 2U ][ ASC_THERMAL_MODEL_NUM_INPUTS ] = { { 0.0f } };
+    float peakSensitivity[ 2U ][ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
     
-    sourceInputs[ 0U ] = 3.03e-02f * powf( rotationalSpeed, 1.44f );
-    sourceInputs[ 1U ] = phaseResistancex2 * driveCurrentRmsSquared;
-    sourceInputs[ 2U ] = rdsOnx4 * driveCurrentRmsSquared +
-                         busVoltagex4xtRiseFallxfSwitching * driveCurrentRms +
-                         rsnsx2 * driveCurrentRmsSquared + 
-                         measuredOtherPowerComonents;
+    // a copy so the overload inputs can change without touching the verdict
+    _calculateSourceInputs( predictor.overloadInputs,
+                            overloadSensitivity[ 0U ],
+                            overloadSensitivity[ 1U ],
+                            overloadCurrent,
+                            rotationalSpeed );
+    
+    status = ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_PeakSensitivity( &predictor,
+                                                                   2U,
+                                                                   (float*)overloadSensitivity,
+                                                                   (float*)ratedSensitivity,
+                                                                   peaks,
+                                                                   (float*)peakSensitivity );
+    
+    if ( status )
+    {
+      memcpy( (char*)currentSensitivity, (char*)peakSensitivity[ 0U ], sizeof( peakSensitivity[ 0U ] ) );
+      
+      if ( speedSensitivity )
+      {
+        memcpy( (char*)speedSensitivity, (char*)peakSensitivity[ 1U ], sizeof( peakSensitivity[ 1U ] ) );
+      }
+    }
   }
+  
+  return status;
 }
 
-static bool _setupOverloadPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj, RK4SOLVER_INPUT * rk4Input, RK4SOLVER_OUTPUT * rk4Output )
+/*!
+ * \brief Predicts the temperatures an axis settles at when it repeats one duty
+ * cycle for hours, without simulating the hours
+ * \param inputs numPeriods x ASC_THERMAL_MODEL_NUM_INPUTS heat source inputs,
+ * one per thermal period of the cycle, see
+ * ASC_THERMAL_MODEL_CalculateSourceInputs
+ * \param numPeriods Thermal periods in one cycle
+ * \param peaks [out] ASC_THERMAL_MODEL_NUM_OUTPUTS, the highest temperatures
+ * relative to ambient over the settled cycle
+ * \param peakPeriods [out] ASC_THERMAL_MODEL_NUM_OUTPUTS, the thermal period
+ * of the cycle where each peak occurs, may be null
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_GetCyclicSteadyState( const float * inputs,
+                                             uint32_t numPeriods,
+                                             float * peaks,
+                                             uint32_t * peakPeriods )
+{
+  float startState[ ASC_THERMAL_MODEL_NUM_STATES ];
+  
+  return ASC_THERMAL_MODEL_CYCLIC_SteadyState( _estimator.stateSpaceConfig,
+                                               _estimator.periodOperator,
+                                               inputs,
+                                               numPeriods,
+                                               startState,
+                                               (float*)0,
+                                               peaks,
+                                               peakPeriods );
+}
+
+/*!
+ * \brief Routes a binary record of every thermal period into a telemetry ring
+ * instead of formatting text on the control loop
+ * \param ring The ring written by ASC_THERMAL_MODEL_PeriodicTask, null to stop
+ * \param axis Axis identifier stored in each record
+ */
+void ASC_THERMAL_MODEL_SetTelemetry( ASC_TELEMETRY_RING * ring, uint16_t axis )
+{
+  _publisher.telemetryRing = ring;
+  _publisher.telemetryAxis = axis;
+}
+
+/*!
+ * \brief Publishes the estimate after every thermal period and the verdict
+ * after every overload prediction into a live state table that monitoring
+ * processes read without disturbing the control loop
+ * \param table A table made by ASC_LIVE_STATE_Create or ASC_LIVE_STATE_Init,
+ * null to stop
+ * \param slot The slot of this model instance in the table
+ * \param axis Axis identifier stored in the snapshot
+ */
+void ASC_THERMAL_MODEL_SetLiveState( ASC_LIVE_STATE_TABLE * table, uint32_t slot, uint16_t axis )
+{
+  _publisher.liveState = table;
+  _publisher.liveStateSlot = slot;
+  _publisher.liveStateAxis = axis;
+  _publishLiveState( &_publisher, &_estimator, &_overloadPredictor );
+}
+
+/*!
+ * \brief Persists the current estimator state for a warm start after a power
+ * cycle. Intended to be called periodically and on power-fail warning.
+ * \param store The non-volatile memory access functions
+ * \param timestamp The current time in ms of a clock that survives power off
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_Checkpoint( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store, uint64_t timestamp )
+{
+  return ASC_THERMAL_MODEL_CHECKPOINT_Save( store, &_estimator, timestamp );
+}
+
+/*!
+ * \brief Restores the estimator state after ASC_THERMAL_MODEL_Setup, cooled
+ * over the power-off interval, and seeds the overload predictor with it.
+ * \param store The non-volatile memory access functions
+ * \param now The current time in ms of the clock used for the checkpoint
+ * \return success, on failure the model keeps its cold start state
+ */
+bool ASC_THERMAL_MODEL_Restore( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store, uint64_t now )
+{
+  bool status = ASC_THERMAL_MODEL_CHECKPOINT_Restore( store, &_estimator, now );
+  
+  if ( status )
+  {
+    _updateOverloadPredictor( &_overloadPredictor, _estimator.ambientTemp, _estimator.solverOutputs->nextState );
+  }
+  
+  return status;
+}
+
+static bool _setupOverloadPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj, RK4SOLVER_INPUT * rk4Input, RK4SOLVER_OUTPUT * rk4Output,
+                                     float * state, float * outputs, float * workspace )
 {
   bool status = false;
   
@@ -196,15 +730,17 @@ static bool _setupOverloadPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj,
   {
     rk4Input->h = obj->h;
     
-    rk4Input->currentState = calloc( ASC_THERMAL_MODEL_NUM_STATES, sizeof( float ) );
+    rk4Input->currentState = state;
     memcpy( (char*)rk4Input->currentState,
             (char*)obj->initialState, 
             ASC_THERMAL_MODEL_NUM_STATES * sizeof( float ) );
+    rk4Input->workspace = workspace;
       
     rk4Output->nextState = rk4Input->currentState;
-    rk4Output->nextOutput = calloc( ASC_THERMAL_MODEL_NUM_OUTPUTS, sizeof( float ) );
+    rk4Output->nextOutput = outputs;
+    memset( (char*)rk4Output->nextOutput, 0, ASC_THERMAL_MODEL_NUM_OUTPUTS * sizeof( float ) );
     
-    obj->stateSpaceConfig = ASC_THERMAL_MODEL_config;
+    obj->stateSpaceConfig = _model ? &_model->config : ASC_THERMAL_MODEL_config;
     obj->solverInputs = rk4Input;
     obj->solverOutputs = rk4Output;
     
@@ -220,10 +756,10 @@ static bool _cleanupOverloadPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * ob
   
   if ( obj )
   {
-    free( obj->solverInputs->currentState );
     obj->solverInputs->currentState = 0;
+    obj->solverInputs->workspace = 0;
     
-    free( obj->solverOutputs->nextOutput );
+    obj->solverOutputs->nextState = 0;
     obj->solverOutputs->nextOutput = 0;
     
     status = true;
@@ -232,15 +768,178 @@ static bool _cleanupOverloadPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * ob
   return status;
 }
 
+/*!
+ * \brief The heat source model with the loss constants of the selected model
+ * \param sourceInputs [out] Thermal inputs in Watts, may be null
+ * \param currentSensitivity [out] Derivatives by drive current, may be null
+ * \param speedSensitivity [out] Derivatives by rotational speed, may be null
+ * \param driveCurrent The drive current applied to the system in Amps
+ * \param rotationalSpeed The rotational speed of the motor in rad/s
+ */
+static void _calculateSourceInputs( float * sourceInputs,
+                                    float * currentSensitivity,
+                                    float * speedSensitivity,
+                                    float driveCurrent,
+                                    float rotationalSpeed )
+{
+  _calculateLossInputs( _model ? &_model->image->losses : ASC_THERMAL_MODEL_losses,
+                        sourceInputs,
+                        currentSensitivity,
+                        speedSensitivity,
+                        driveCurrent,
+                        rotationalSpeed );
+}
+
+/*!
+ * \brief The heat source model behind ASC_THERMAL_MODEL_CalculateSourceInputs
+ * and its derivatives, so all share one set of loss constants
+ * \param losses The loss constants
+ * \param sourceInputs [out] Thermal inputs in Watts, may be null
+ * \param currentSensitivity [out] Derivatives by drive current, may be null
+ * \param speedSensitivity [out] Derivatives by rotational speed, may be null
+ * \param driveCurrent The drive current applied to the system in Amps
+ * \param rotationalSpeed The rotational speed of the motor in rad/s
+ */
+static void _calculateLossInputs( const ASC_THERMAL_MODEL_LOSS_CONSTANTS * losses,
+                                  float * sourceInputs,
+                                  float * currentSensitivity,
+                                  float * speedSensitivity,
+                                  float driveCurrent,
+                                  float rotationalSpeed )
+{
+  float phaseResistancex2 = 2.0f * losses->phaseResistance;
+  float rdsOnx4 = 4.0f * losses->rdsOn;
+  float busVoltagex4xtRiseFallxfSwitching = 4.0f * losses->busVoltage * losses->switchingFrequency *
+                                            ( losses->riseTime + losses->fallTime );
+  float rsnsx2 = 2.0f * losses->senseResistance;
+  float oneOverSqrt2 = 0.70711f;
+  float driveCurrentRms = driveCurrent * oneOverSqrt2;
+  float driveCurrentRmsSquared = driveCurrent * driveCurrent / 2.0f;
+  float measuredOtherPowerComonents = losses->otherLosses;
+  
+  if ( sourceInputs )
+  {
+    sourceInputs[ 0U ] = losses->ironLossCoefficient * powf( rotationalSpeed, losses->ironLossExponent );
+    sourceInputs[ 1U ] = phaseResistancex2 * driveCurrentRmsSquared;
+    sourceInputs[ 2U ] = rdsOnx4 * driveCurrentRmsSquared +
+                         busVoltagex4xtRiseFallxfSwitching * driveCurrentRms +
+                         rsnsx2 * driveCurrentRmsSquared + 
+                         measuredOtherPowerComonents;
+  }
+  
+  // d(driveCurrentRmsSquared)/d(driveCurrent) = driveCurrent
+  if ( currentSensitivity )
+  {
+    currentSensitivity[ 0U ] = 0.0f;
+    currentSensitivity[ 1U ] = phaseResistancex2 * driveCurrent;
+    currentSensitivity[ 2U ] = rdsOnx4 * driveCurrent +
+                               busVoltagex4xtRiseFallxfSwitching * oneOverSqrt2 +
+                               rsnsx2 * driveCurrent;
+  }
+  
+  if ( speedSensitivity )
+  {
+    speedSensitivity[ 0U ] = losses->ironLossCoefficient * losses->ironLossExponent *
+                             powf( rotationalSpeed, losses->ironLossExponent - 1.0f );
+    speedSensitivity[ 1U ] = 0.0f;
+    speedSensitivity[ 2U ] = 0.0f;
+  }
+}
+
+/*!
+ * \brief Advances the model time by one thermal period and writes the period's
+ * telemetry record and live state, where set
+ * \note As this is a static function, there is no input validation
+ */
+static void _publishPeriod( ASC_THERMAL_MODEL_PUBLISHER * publisher,
+                            ASC_THERMAL_MODEL_ESTIMATOR * estimator,
+                            ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor )
+{
+  publisher->modelTime += (uint64_t)( estimator->h * (float)estimator->periodCounts * 1000.0f + 0.5f );
+  
+  if ( publisher->telemetryRing )
+  {
+    (void)ASC_TELEMETRY_Push( publisher->telemetryRing,
+                              publisher->modelTime,
+                              publisher->telemetryAxis,
+                              estimator->solverOutputs->nextOutput,
+                              estimator->aveInputs,
+                              ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_IsOverloadAvailable( predictor ) );
+  }
+  
+  _publishLiveState( publisher, estimator, predictor );
+}
+
+/*!
+ * \brief Writes the current estimate and the last verdict to the live state
+ * table, if one is set
+ * \note As this is a static function, there is no input validation
+ */
+static void _publishLiveState( const ASC_THERMAL_MODEL_PUBLISHER * publisher,
+                               ASC_THERMAL_MODEL_ESTIMATOR * estimator,
+                               ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor )
+{
+  if ( publisher->liveState && estimator->solverOutputs )
+  {
+    ASC_LIVE_STATE_SNAPSHOT snapshot;
+    
+    memset( (char*)&snapshot, 0, sizeof( snapshot ) );
+    snapshot.modelTime = publisher->modelTime;
+    snapshot.predictionTime = publisher->predictionTime;
+    snapshot.axis = publisher->liveStateAxis;
+    snapshot.verdict = ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_IsOverloadAvailable( predictor ) ? 1U : 0U;
+    memcpy( (char*)snapshot.outputs, (char*)estimator->solverOutputs->nextOutput, sizeof( snapshot.outputs ) );
+    memcpy( (char*)snapshot.maxTemps, (char*)predictor->maxTemps, sizeof( snapshot.maxTemps ) );
+    memcpy( (char*)snapshot.inputs, (char*)estimator->aveInputs, sizeof( snapshot.inputs ) );
+    
+    ASC_LIVE_STATE_Publish( publisher->liveState, publisher->liveStateSlot, &snapshot );
+  }
+}
+
+/*!
+ * \brief Predicts from the start of the thermal period into local peaks and
+ * only replaces the published ones once the prediction completes
+ * \return success
+ * \note As this is a static function, there is no input validation
+ */
+static bool _predictOverload( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj )
+{
+  float peaks[ ASC_THERMAL_MODEL_NUM_OUTPUTS ] = { 0.0f };
+  bool status = false;
+  uint32_t itr = 0U;
+  
+  memcpy( (char*)obj->solverInputs->currentState,
+          (char*)obj->initialState,
+          ASC_THERMAL_MODEL_NUM_STATES * sizeof( float ) );
+  
+  status = ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_Predict( obj, peaks );
+  
+  if ( status )
+  {
+    // one whole float per output, so each peak is either the old or the new one
+    for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_OUTPUTS; itr++ )
+    {
+      obj->maxTemps[ itr ] = peaks[ itr ];
+    }
+  }
+  
+  return status;
+}
+
 static void _updateOverloadPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj, float ambient, float * initialState )
 {
   ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_UpdateAmbientTemperature( obj, ambient );
   memcpy( (char*)obj->solverInputs->currentState,
           (char*)initialState, 
           ASC_THERMAL_MODEL_NUM_STATES * sizeof( float ) );
+  // kept as the start of the thermal period for the overload map
+  memcpy( (char*)obj->initialState,
+          (char*)initialState, 
+          ASC_THERMAL_MODEL_NUM_STATES * sizeof( float ) );
 }
 
-static bool _setupEstimator( ASC_THERMAL_MODEL_ESTIMATOR * obj, RK4SOLVER_INPUT * rk4Input, RK4SOLVER_OUTPUT * rk4Output )
+static bool _setupEstimator( ASC_THERMAL_MODEL_ESTIMATOR * obj, RK4SOLVER_INPUT * rk4Input, RK4SOLVER_OUTPUT * rk4Output,
+                             float * state, float * outputs, float * workspace )
 {
   bool status = false;
   
@@ -248,22 +947,56 @@ static bool _setupEstimator( ASC_THERMAL_MODEL_ESTIMATOR * obj, RK4SOLVER_INPUT
   {
     rk4Input->h = obj->h;
     
-    rk4Input->currentState = calloc( ASC_THERMAL_MODEL_NUM_STATES, sizeof( float ) );
+    rk4Input->currentState = state;
     memcpy( (char*)rk4Input->currentState,
             (char*)obj->initialState, 
             ASC_THERMAL_MODEL_NUM_STATES * sizeof( float ) );
     
     rk4Input->currentInput = (float*)obj->aveInputs;
     rk4Input->nextInput = (float*)obj->aveInputs;
+    rk4Input->workspace = workspace;
     
     rk4Output->nextState = rk4Input->currentState;
-    rk4Output->nextOutput = calloc( ASC_THERMAL_MODEL_NUM_OUTPUTS, sizeof( float ) );
+    rk4Output->nextOutput = outputs;
+    memset( (char*)rk4Output->nextOutput, 0, ASC_THERMAL_MODEL_NUM_OUTPUTS * sizeof( float ) );
     
-    obj->stateSpaceConfig = ASC_THERMAL_MODEL_config;
+    obj->stateSpaceConfig = _model ? &_model->config : ASC_THERMAL_MODEL_config;
     obj->solverInputs = rk4Input;
     obj->solverOutputs = rk4Output;
     
-    status = true;
+    // a model file carries the period operator for the usual estimator step
+    if ( _model && ( _model->image->operatorStep == obj->h ) && ( _model->image->operatorSteps == obj->periodCounts ) )
+    {
+      obj->periodOperator = &_model->image->periodOperator;
+      status = true;
+    }
+    else
+    {
+      status = ( _periodOperatorConfig == obj->stateSpaceConfig ) &&
+               ( _periodOperatorStep == obj->h ) && ( _periodOperatorSteps == obj->periodCounts );
+      
+      if ( !status )
+      {
+        _periodOperatorConfig = (const RK4SOLVER_CONFIGURATION*)0;
+        status = ASC_THERMAL_MODEL_STEP_OPERATOR_FromSolver( &_periodOperator,
+                                                             obj->stateSpaceConfig,
+                                                             obj->h,
+                                                             obj->periodCounts );
+        
+        if ( status )
+        {
+          _periodOperatorConfig = obj->stateSpaceConfig;
+          _periodOperatorStep = obj->h;
+          _periodOperatorSteps = obj->periodCounts;
+        }
+      }
+      
+      obj->periodOperator = &_periodOperator;
+    }
+    
+    status = status && ASC_THERMAL_MODEL_ESTIMATOR_SetupQuiescent( obj,
+                                                                     ASC_THERMAL_MODEL_QUIESCENT_TOLERANCE,
+                                                                     ASC_THERMAL_MODEL_QUIESCENT_ABOVE_TOLERANCE );
   }
   
   return status;
@@ -275,10 +1008,10 @@ static bool _cleanupEstimator( ASC_THERMAL_MODEL_ESTIMATOR * obj )
   
   if ( obj )
   {
-    free( obj->solverInputs->currentState );
     obj->solverInputs->currentState = 0;
+    obj->solverInputs->workspace = 0;
     
-    free( obj->solverOutputs->nextOutput );
+    obj->solverOutputs->nextState = 0;
     obj->solverOutputs->nextOutput = 0;
     
     status = true;
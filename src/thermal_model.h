@@ -19,6 +19,13 @@
 #ifndef _ASC_THERMAL_MODEL_H
 #define _ASC_THERMAL_MODEL_H
 
+#include "live_state.h"
+#include "telemetry.h"
+#include "thermal_model_checkpoint.h"
+#include "thermal_model_estimator.h"
+#include "thermal_model_file.h"
+#include "thermal_model_overload_predictor.h"
+#include "thermal_model_setpoint_table.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -26,15 +33,98 @@
 extern "C" {
 #endif
 
+    /*!
+     * \brief Where a model's estimate and verdict go after each thermal period
+     * and overload prediction, see ASC_THERMAL_MODEL_SetTelemetry and
+     * ASC_THERMAL_MODEL_SetLiveState
+     */
+    typedef struct
+    {
+        uint64_t modelTime; //!< Model time in ms since setup
+        uint64_t predictionTime; //!< Model time in ms the last overload prediction started from
+        ASC_TELEMETRY_RING * telemetryRing; //!< Null when no telemetry is recorded
+        uint16_t telemetryAxis; //!< Axis identifier stored in each record
+        ASC_LIVE_STATE_TABLE * liveState; //!< Null when no live state is published
+        uint32_t liveStateSlot; //!< Slot of the model in liveState
+        uint16_t liveStateAxis; //!< Axis identifier stored in the snapshot
+    } ASC_THERMAL_MODEL_PUBLISHER;
+
+    /*!
+     * \brief The estimator and overload predictor of one axis with their
+     * solver storage, see ASC_THERMAL_MODEL_SetupInstance
+     */
+    typedef struct
+    {
+        ASC_THERMAL_MODEL_ESTIMATOR estimator;
+        RK4SOLVER_INPUT estimatorInput;
+        RK4SOLVER_OUTPUT estimatorOutput;
+        float estimatorState[ ASC_THERMAL_MODEL_NUM_STATES ];
+        float estimatorOutputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+        float estimatorWorkspace[ RK4SOLVER_WORKSPACE_LENGTH( ASC_THERMAL_MODEL_NUM_STATES,
+                                                              ASC_THERMAL_MODEL_NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+        ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR predictor;
+        RK4SOLVER_INPUT predictorInput;
+        RK4SOLVER_OUTPUT predictorOutput;
+        float predictorState[ ASC_THERMAL_MODEL_NUM_STATES ];
+        float predictorOutputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+        float predictorWorkspace[ RK4SOLVER_WORKSPACE_LENGTH( ASC_THERMAL_MODEL_NUM_STATES,
+                                                              ASC_THERMAL_MODEL_NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+        ASC_THERMAL_MODEL_PUBLISHER publisher;
+    } ASC_THERMAL_MODEL_INSTANCE;
+
+    extern bool ASC_THERMAL_MODEL_SelectModel( ASC_THERMAL_MODEL_FILE * model );
     extern bool ASC_THERMAL_MODEL_Setup( void );
     extern bool ASC_THERMAL_MODEL_Cleanup( void );
     extern void ASC_THERMAL_MODEL_BackgroundTask( void );
+    extern bool ASC_THERMAL_MODEL_SetupInstance( ASC_THERMAL_MODEL_INSTANCE * instance );
+    extern bool ASC_THERMAL_MODEL_InstanceBackgroundTask( ASC_THERMAL_MODEL_INSTANCE * instance );
+    extern void ASC_THERMAL_MODEL_InstancePeriodicTask( ASC_THERMAL_MODEL_INSTANCE * instance );
+    extern void ASC_THERMAL_MODEL_SetInstanceTelemetry( ASC_THERMAL_MODEL_INSTANCE * instance,
+                                                        ASC_TELEMETRY_RING * ring,
+                                                        uint16_t axis );
+    extern void ASC_THERMAL_MODEL_SetInstanceLiveState( ASC_THERMAL_MODEL_INSTANCE * instance,
+                                                        ASC_LIVE_STATE_TABLE * table,
+                                                        uint32_t slot,
+                                                        uint16_t axis );
     extern void ASC_THERMAL_MODEL_PeriodicTask( void );
+    extern bool ASC_THERMAL_MODEL_FastForward( float elapsed );
     extern bool ASC_THERMAL_MODEL_IsOverloadAvailable( void );
+    extern bool ASC_THERMAL_MODEL_GetOverloadMap( const float * levels,
+                                                  uint32_t numLevels,
+                                                  const uint32_t * durations,
+                                                  uint32_t numDurations,
+                                                  bool * allowed,
+                                                  uint32_t * maxDurations );
+    extern bool ASC_THERMAL_MODEL_GetCyclicSteadyState( const float * inputs,
+                                                        uint32_t numPeriods,
+                                                        float * peaks,
+                                                        uint32_t * peakPeriods );
     extern uint32_t ASC_THERMAL_MODEL_GetCurrentTemp( float * temperatures );
     extern uint32_t ASC_THERMAL_MODEL_GetOLTemp( float * temperatures );
     extern void ASC_THERMAL_MODEL_SetInputs( float * inputs );
+    extern bool ASC_THERMAL_MODEL_SetSetpointInputs( ASC_THERMAL_MODEL_SETPOINT_ACCUMULATOR * acc );
+    extern bool ASC_THERMAL_MODEL_BuildSetpointTable( ASC_THERMAL_MODEL_SETPOINT_ENTRY * entries,
+                                                      uint32_t count,
+                                                      const float * currents,
+                                                      const float * speeds );
     extern void ASC_THERMAL_MODEL_CalculateSourceInputs( float * sourceInputs, float driveCurrent, float rotationalSpeed );
+    extern void ASC_THERMAL_MODEL_CalculateSourceInputSensitivity( float * currentSensitivity,
+                                                                   float * speedSensitivity,
+                                                                   float driveCurrent,
+                                                                   float rotationalSpeed );
+    extern void ASC_THERMAL_MODEL_CalculateLossInputs( const ASC_THERMAL_MODEL_LOSS_CONSTANTS * losses,
+                                                       float * sourceInputs,
+                                                       float driveCurrent,
+                                                       float rotationalSpeed );
+    extern bool ASC_THERMAL_MODEL_GetOverloadSensitivity( float overloadCurrent,
+                                                          float rotationalSpeed,
+                                                          float * peaks,
+                                                          float * currentSensitivity,
+                                                          float * speedSensitivity );
+    extern bool ASC_THERMAL_MODEL_Checkpoint( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store, uint64_t timestamp );
+    extern bool ASC_THERMAL_MODEL_Restore( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store, uint64_t now );
+    extern void ASC_THERMAL_MODEL_SetTelemetry( ASC_TELEMETRY_RING * ring, uint16_t axis );
+    extern void ASC_THERMAL_MODEL_SetLiveState( ASC_LIVE_STATE_TABLE * table, uint32_t slot, uint16_t axis );
     
 #ifdef __cplusplus
 }
@@ -0,0 +1,699 @@
+/**
+ * @file
+ * @brief Definition and implementation of the accuracy versus throughput
+ * regression harness
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "matrix_exponential.h"
+#include "rk4solver.h"
+#include "rk4solver_kernels.h"
+#include "rk4solver_multirate.h"
+#include "thermal_model_accuracy.h"
+#include "thermal_model_estimator.h"
+#include "thermal_model_setpoint_table.h"
+#include "thermal_model_state_space.h"
+#include "thermal_model_step_operator.h"
+#include "thermal_network.h"
+#include "thermal_network_krylov.h"
+#include "trbdf2solver.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+
+/* Every scenario is sampled at the 1 s thermal period with the input held
+ * over each sample, so the zero order hold exponential is the exact solution.
+ */
+static const double SAMPLE_PERIOD = 1.0;
+static const uint32_t TIMING_REPEATS = 10U;
+
+/* Samples of the reference that settle a scenario onto the equilibrium of its
+ * first input, some 45 of the model's slowest time constants */
+static const uint32_t SETTLE_SAMPLES = 50000U;
+
+#define KRYLOV_DIMENSION (8U)
+
+static const float _overloadInputs[ NUM_INPUTS ] = { 5.4168f, 23.0400f, 5.5027f };
+static const float _ratedInputs[ NUM_INPUTS ] = { 5.4168f, 16.0000f, 4.4368f };
+
+/*!
+ * \brief An input scenario sampled once per thermal period
+ */
+typedef struct
+{
+    const char * name;
+    uint32_t numSamples;
+    void (*input)( uint32_t sample, float * u );
+    bool settled; //!< Starts at the equilibrium of its first input instead of cold
+} ACCURACY_SCENARIO;
+
+/*!
+ * \brief A solver path under test, advancing one thermal period per step
+ */
+typedef struct
+{
+    const char * name;
+    float tolerance;
+    bool (*reset)( void );
+    bool (*step)( float * u, float * y );
+    bool (*available)( void ); //!< Whether this build and host can run the mode, null for always
+    uint32_t (*skipped)( void ); //!< Periods a fast path skipped, which a settled scenario must engage, null for none
+} ACCURACY_MODE;
+
+static const RK4SOLVER_CONFIGURATION * _config;
+static float _state[ NUM_STATES ];
+static float _input[ NUM_INPUTS ];
+static float _workspace[ RK4SOLVER_MULTIRATE_WORKSPACE_LENGTH( NUM_STATES, NUM_INPUTS, NUM_OUTPUTS ) ] RK4SOLVER_ALIGNED;
+static uint8_t _isSlow[ NUM_STATES ];
+static ASC_THERMAL_MODEL_STEP_OPERATOR _operator;
+static float _factors[ TRBDF2SOLVER_WORKSPACE_LENGTH( NUM_STATES ) ];
+static uint32_t _pivots[ NUM_STATES ];
+static TRBDF2SOLVER_FACTORIZATION _factorization = { 0.0f, _factors, _pivots };
+
+static float _estimatorOutput[ NUM_OUTPUTS ];
+static RK4SOLVER_INPUT _estimatorInput = { 0.1f, _state, (float*)0, (float*)0, _workspace };
+static RK4SOLVER_OUTPUT _estimatorResult = { _state, _estimatorOutput };
+static ASC_THERMAL_MODEL_ESTIMATOR _estimator;
+static ASC_THERMAL_MODEL_STEP_OPERATOR _periodOperator;
+static ASC_THERMAL_MODEL_SETPOINT_ENTRY _setpointEntry;
+static ASC_THERMAL_MODEL_SETPOINT_ACCUMULATOR _setpointSum;
+static uint32_t _quiescentPeriods;
+
+static uint16_t _packedStorage[ RK4SOLVER_PACKED_LENGTH( NUM_STATES, NUM_INPUTS, NUM_OUTPUTS ) ];
+static RK4SOLVER_PACKED _packed;
+static const RK4SOLVER_CONFIGURATION _packedConfig =
+{
+  NUM_STATES, NUM_INPUTS, NUM_OUTPUTS,
+  (const float*)0, (const float*)0, (const float*)0, (const float*)0,
+  &_packed
+};
+
+static uint32_t _networkRowStart[ NUM_STATES + 1U ];
+static uint32_t _networkColumns[ NUM_STATES * NUM_STATES ];
+static float _networkValues[ NUM_STATES * NUM_STATES ];
+static uint32_t _networkInputRowStart[ NUM_STATES + 1U ];
+static uint32_t _networkInputColumns[ NUM_STATES * NUM_INPUTS ];
+static float _networkInputValues[ NUM_STATES * NUM_INPUTS ];
+static const ASC_THERMAL_NETWORK_MODEL _network =
+{
+  NUM_STATES, NUM_INPUTS,
+  _networkRowStart, _networkColumns, _networkValues,
+  _networkInputRowStart, _networkInputColumns, _networkInputValues
+};
+static double _krylovWorkspace[ ASC_THERMAL_NETWORK_KRYLOV_WORKSPACE_LENGTH( NUM_STATES, KRYLOV_DIMENSION ) ];
+static const ASC_THERMAL_NETWORK_KRYLOV _krylov = { 1.0E-04f, KRYLOV_DIMENSION, _krylovWorkspace };
+
+static double _refPhi[ NUM_STATES * NUM_STATES ];
+static double _refGamma[ NUM_STATES * NUM_INPUTS ];
+static double _refState[ NUM_STATES ];
+static double _settledState[ NUM_STATES ];
+static double _refWorkspace[ MATEXP_DISCRETIZE_WORKSPACE_LENGTH( NUM_STATES, NUM_INPUTS ) ];
+
+/*!
+ * \brief Constant overload heating from a cold motor
+ */
+static void _StepInput( uint32_t sample, float * u )
+{
+  (void)sample;
+  memcpy( (char*)u, (const char*)_overloadInputs, sizeof( _overloadInputs ) );
+}
+
+/*!
+ * \brief The overload predictor profile repeated, 10 s overload then 50 s rated
+ */
+static void _DutyInput( uint32_t sample, float * u )
+{
+  const float * source = ( ( sample % 60U ) < 10U ) ? _overloadInputs : _ratedInputs;
+
+  memcpy( (char*)u, (const char*)source, sizeof( _overloadInputs ) );
+}
+
+/*!
+ * \brief Overload heating for 10 minutes then free cooling
+ */
+static void _CooldownInput( uint32_t sample, float * u )
+{
+  if ( sample < 600U )
+  {
+    memcpy( (char*)u, (const char*)_overloadInputs, sizeof( _overloadInputs ) );
+  }
+  else
+  {
+    memset( (char*)u, 0, sizeof( _overloadInputs ) );
+  }
+}
+
+/*!
+ * \brief An axis parked at holding current, rated heating, from its settled
+ * state, with a one minute overload move half way
+ */
+static void _ParkedInput( uint32_t sample, float * u )
+{
+  const float * source = ( ( sample >= 1800U ) && ( sample < 1860U ) ) ? _overloadInputs : _ratedInputs;
+
+  memcpy( (char*)u, (const char*)source, sizeof( _ratedInputs ) );
+}
+
+/*!
+ * \brief Runs RK4SOLVER_Solve for numSteps steps of h with the input held
+ * \note As this is a static function, there is no input validation
+ */
+static bool _SolveSteps( float h, uint32_t numSteps, float * u, float * y )
+{
+  RK4SOLVER_INPUT input = { h, _state, u, u, _workspace };
+  RK4SOLVER_OUTPUT output = { _state, y };
+  bool status = true;
+  uint32_t itr = 0U;
+
+  for ( itr = 0U; ( itr < numSteps ) && status; itr++ )
+  {
+    status = ( RK4SOLVER_Solve( _config, &input, &output ) == 1U );
+  }
+
+  return status;
+}
+
+static bool _ResetState( void )
+{
+  _config = ASC_THERMAL_MODEL_config;
+  memset( (char*)_state, 0, sizeof( _state ) );
+
+  return true;
+}
+
+static bool _Rk4EstimatorStep( float * u, float * y )
+{
+  return _SolveSteps( 0.1f, 10U, u, y );
+}
+
+static bool _Rk4PredictorStep( float * u, float * y )
+{
+  return _SolveSteps( 1.0f, 1U, u, y );
+}
+
+static bool _ScalarReset( void )
+{
+  return RK4SOLVER_KERNELS_Select( RK4SOLVER_KERNELS_SCALAR ) && _ResetState();
+}
+
+static bool _Sse42Reset( void )
+{
+  return RK4SOLVER_KERNELS_Select( RK4SOLVER_KERNELS_SSE42 ) && _ResetState();
+}
+
+static bool _Avx2Reset( void )
+{
+  return RK4SOLVER_KERNELS_Select( RK4SOLVER_KERNELS_AVX2 ) && _ResetState();
+}
+
+static bool _Avx512Reset( void )
+{
+  return RK4SOLVER_KERNELS_Select( RK4SOLVER_KERNELS_AVX512 ) && _ResetState();
+}
+
+static bool _Sse42Available( void )
+{
+  return RK4SOLVER_KERNELS_Supported( RK4SOLVER_KERNELS_SSE42 );
+}
+
+static bool _Avx2Available( void )
+{
+  return RK4SOLVER_KERNELS_Supported( RK4SOLVER_KERNELS_AVX2 );
+}
+
+static bool _Avx512Available( void )
+{
+  return RK4SOLVER_KERNELS_Supported( RK4SOLVER_KERNELS_AVX512 );
+}
+
+/*!
+ * \brief Packs the compiled-in model, which must itself be float, for the
+ * estimator step
+ * \note As this is a static function, there is no input validation
+ */
+static bool _PackedReset( uint8_t format )
+{
+  bool status = _ResetState() &&
+                ( RK4SOLVER_Pack( ASC_THERMAL_MODEL_config, format, &_packed, _packedStorage ) == 1U );
+
+  _config = &_packedConfig;
+
+  return status;
+}
+
+static bool _Float16Reset( void )
+{
+  return _PackedReset( RK4SOLVER_PACKED_FLOAT16 );
+}
+
+static bool _Int16Reset( void )
+{
+  return _PackedReset( RK4SOLVER_PACKED_INT16 );
+}
+
+static bool _PackedAvailable( void )
+{
+  return !ASC_THERMAL_MODEL_config->packed;
+}
+
+static bool _MultirateReset( void )
+{
+  RK4SOLVER_MULTIRATE_Partition( ASC_THERMAL_MODEL_config, 100.0f, _isSlow );
+
+  return _ResetState();
+}
+
+static bool _MultirateStep( float * u, float * y )
+{
+  RK4SOLVER_MULTIRATE_CONFIGURATION multirate = { 10U, _isSlow };
+  RK4SOLVER_INPUT input = { 0.1f, _state, u, u, _workspace };
+  RK4SOLVER_OUTPUT output = { _state, y };
+
+  return ( RK4SOLVER_MULTIRATE_Solve( ASC_THERMAL_MODEL_config, &multirate, &input, &output ) == 1U );
+}
+
+/*!
+ * \brief Stores the compiled-in [A] and [B] as a network model, every
+ * coefficient a nonzero, for the Krylov propagator
+ */
+static bool _KrylovReset( void )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < NUM_STATES; i++ )
+  {
+    _networkRowStart[ i ] = i * NUM_STATES;
+    _networkInputRowStart[ i ] = i * NUM_INPUTS;
+
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      _networkColumns[ ( i * NUM_STATES ) + j ] = j;
+      _networkValues[ ( i * NUM_STATES ) + j ] =
+        RK4SOLVER_GetCoefficient( ASC_THERMAL_MODEL_config, RK4SOLVER_MATRIX_A, ( i * NUM_STATES ) + j );
+    }
+
+    for ( j = 0U; j < NUM_INPUTS; j++ )
+    {
+      _networkInputColumns[ ( i * NUM_INPUTS ) + j ] = j;
+      _networkInputValues[ ( i * NUM_INPUTS ) + j ] =
+        RK4SOLVER_GetCoefficient( ASC_THERMAL_MODEL_config, RK4SOLVER_MATRIX_B, ( i * NUM_INPUTS ) + j );
+    }
+  }
+
+  _networkRowStart[ NUM_STATES ] = NUM_STATES * NUM_STATES;
+  _networkInputRowStart[ NUM_STATES ] = NUM_STATES * NUM_INPUTS;
+
+  return _ResetState();
+}
+
+static bool _KrylovStep( float * u, float * y )
+{
+  return ASC_THERMAL_NETWORK_KRYLOV_Advance( &_krylov, &_network, _state, u, (float)SAMPLE_PERIOD,
+                                             (ASC_THERMAL_NETWORK_KRYLOV_STATS*)0 ) &&
+         ( RK4SOLVER_Output( ASC_THERMAL_MODEL_config, _state, u, y ) == 1U );
+}
+
+static bool _PeriodOperatorReset( void )
+{
+  return ASC_THERMAL_MODEL_STEP_OPERATOR_FromSolver( &_operator, ASC_THERMAL_MODEL_config, 0.1f, 10U ) &&
+         _ResetState();
+}
+
+static bool _ExactOperatorReset( void )
+{
+  return ASC_THERMAL_MODEL_STEP_OPERATOR_Exact( &_operator, ASC_THERMAL_MODEL_config, (float)SAMPLE_PERIOD ) &&
+         _ResetState();
+}
+
+static bool _OperatorStep( float * u, float * y )
+{
+  float next[ NUM_STATES ];
+
+  ASC_THERMAL_MODEL_STEP_OPERATOR_Apply( &_operator, _state, u, next );
+  memcpy( (char*)_state, (char*)next, sizeof( _state ) );
+
+  return ( RK4SOLVER_Output( ASC_THERMAL_MODEL_config, _state, u, y ) == 1U );
+}
+
+/*!
+ * \brief Runs TRBDF2SOLVER_Solve for as many steps of the factored h as make
+ * up one thermal period, with the input held
+ * \note As this is a static function, there is no input validation
+ */
+static bool _TrBdf2Steps( float * u, float * y )
+{
+  RK4SOLVER_INPUT input = { _factorization.h, _state, u, u, (float*)0 };
+  RK4SOLVER_OUTPUT output = { _state, y };
+  uint32_t numSteps = (uint32_t)( ( (float)SAMPLE_PERIOD / _factorization.h ) + 0.5f );
+  bool status = true;
+  uint32_t itr = 0U;
+
+  for ( itr = 0U; ( itr < numSteps ) && status; itr++ )
+  {
+    status = ( TRBDF2SOLVER_Solve( ASC_THERMAL_MODEL_config, &_factorization, &input, &output ) == 1U );
+  }
+
+  return status;
+}
+
+static bool _TrBdf2EstimatorReset( void )
+{
+  _factorization.h = 0.1f;
+
+  return ( TRBDF2SOLVER_Factor( ASC_THERMAL_MODEL_config, &_factorization ) == 1U ) && _ResetState();
+}
+
+static bool _TrBdf2PredictorReset( void )
+{
+  _factorization.h = 1.0f;
+
+  return ( TRBDF2SOLVER_Factor( ASC_THERMAL_MODEL_config, &_factorization ) == 1U ) && _ResetState();
+}
+
+/*!
+ * \brief Sets up an estimator the way ASC_THERMAL_MODEL_Setup does
+ * \note As this is a static function, there is no input validation
+ */
+static bool _EstimatorReset( float tolerance, float aboveTolerance )
+{
+  memset( (char*)&_estimator, 0, sizeof( _estimator ) );
+  _estimator.h = 0.1f;
+  _estimator.periodCounts = 10U;
+  _estimator.stateSpaceConfig = ASC_THERMAL_MODEL_config;
+  _estimatorInput.currentInput = _estimator.aveInputs;
+  _estimatorInput.nextInput = _estimator.aveInputs;
+  _estimator.solverInputs = &_estimatorInput;
+  _estimator.solverOutputs = &_estimatorResult;
+  _estimator.periodOperator = &_periodOperator;
+
+  return ASC_THERMAL_MODEL_STEP_OPERATOR_FromSolver( &_periodOperator, ASC_THERMAL_MODEL_config, 0.1f, 10U ) &&
+         ASC_THERMAL_MODEL_ESTIMATOR_SetupQuiescent( &_estimator, tolerance, aboveTolerance ) &&
+         _ResetState();
+}
+
+/*!
+ * \brief The estimator with the quiescent fast path at the firmware's
+ * tolerances
+ */
+static bool _QuiescentReset( void )
+{
+  _quiescentPeriods = 0U;
+
+  return _EstimatorReset( 5.0E-02f, 5.0E-03f );
+}
+
+static uint32_t _QuiescentSkipped( void )
+{
+  return _quiescentPeriods;
+}
+
+static bool _SetpointReset( void )
+{
+  memset( (char*)&_setpointSum, 0, sizeof( _setpointSum ) );
+
+  return _EstimatorReset( 0.0f, 0.0f );
+}
+
+static bool _QuiescentStep( float * u, float * y )
+{
+  ASC_THERMAL_MODEL_ESTIMATOR_SetInputs( &_estimator, u );
+  ASC_THERMAL_MODEL_ESTIMATOR_PeriodicTask( &_estimator );
+  memcpy( (char*)y, (char*)_estimatorOutput, sizeof( _estimatorOutput ) );
+  _quiescentPeriods += _estimator.quiescent ? 1U : 0U;
+
+  return true;
+}
+
+/*!
+ * \brief The period's input as the entry of one setpoint held over its 100
+ * control ticks, then averaged and applied as one period operator step
+ */
+static bool _SetpointStep( float * u, float * y )
+{
+  float inputs[ NUM_INPUTS ];
+  float forced[ NUM_STATES ];
+  bool status = ASC_THERMAL_MODEL_SETPOINT_TABLE_Build( &_setpointEntry, 1U, u, &_periodOperator );
+  uint32_t tick = 0U;
+
+  for ( tick = 0U; tick < 100U; tick++ )
+  {
+    ASC_THERMAL_MODEL_SETPOINT_TABLE_Accumulate( &_setpointSum, &_setpointEntry );
+  }
+
+  status = status && ASC_THERMAL_MODEL_SETPOINT_TABLE_Average( &_setpointSum, inputs, forced );
+  ASC_THERMAL_MODEL_ESTIMATOR_SetForcedInputs( &_estimator, inputs, forced );
+  ASC_THERMAL_MODEL_ESTIMATOR_PeriodicTask( &_estimator );
+  memcpy( (char*)y, (char*)_estimatorOutput, sizeof( _estimatorOutput ) );
+
+  return status;
+}
+
+static const ACCURACY_SCENARIO _scenarios[] =
+{
+  { "step", 1800U, _StepInput, false },
+  { "duty", 1800U, _DutyInput, false },
+  { "cooldown", 1800U, _CooldownInput, false },
+  { "parked", 3600U, _ParkedInput, true }
+};
+
+static const ACCURACY_MODE _modes[] =
+{
+  { "rk4 h=0.1", 5.0E-03f, _ResetState, _Rk4EstimatorStep, (bool (*)( void ))0, (uint32_t (*)( void ))0 },
+  { "rk4 h=0.1 scalar", 5.0E-03f, _ScalarReset, _Rk4EstimatorStep, (bool (*)( void ))0, (uint32_t (*)( void ))0 },
+  { "rk4 h=0.1 sse4.2", 5.0E-03f, _Sse42Reset, _Rk4EstimatorStep, _Sse42Available, (uint32_t (*)( void ))0 },
+  { "rk4 h=0.1 avx2", 5.0E-03f, _Avx2Reset, _Rk4EstimatorStep, _Avx2Available, (uint32_t (*)( void ))0 },
+  { "rk4 h=0.1 avx512", 5.0E-03f, _Avx512Reset, _Rk4EstimatorStep, _Avx512Available, (uint32_t (*)( void ))0 },
+  { "rk4 h=1.0", 5.0E-03f, _ResetState, _Rk4PredictorStep, (bool (*)( void ))0, (uint32_t (*)( void ))0 },
+  // the coefficient rounding of packing moves the rated equilibrium by up to ~0.016 K
+  { "rk4 h=0.1 float16", 2.0E-02f, _Float16Reset, _Rk4EstimatorStep, _PackedAvailable, (uint32_t (*)( void ))0 },
+  { "rk4 h=0.1 int16", 2.0E-02f, _Int16Reset, _Rk4EstimatorStep, _PackedAvailable, (uint32_t (*)( void ))0 },
+  { "multirate 0.1x10", 5.0E-03f, _MultirateReset, _MultirateStep, (bool (*)( void ))0, (uint32_t (*)( void ))0 },
+  { "period operator", 5.0E-03f, _PeriodOperatorReset, _OperatorStep, (bool (*)( void ))0, (uint32_t (*)( void ))0 },
+  { "setpoint table", 5.0E-03f, _SetpointReset, _SetpointStep, (bool (*)( void ))0, (uint32_t (*)( void ))0 },
+  { "exact operator", 5.0E-03f, _ExactOperatorReset, _OperatorStep, (bool (*)( void ))0, (uint32_t (*)( void ))0 },
+  { "krylov expmv", 5.0E-03f, _KrylovReset, _KrylovStep, (bool (*)( void ))0, (uint32_t (*)( void ))0 },
+  { "tr-bdf2 h=0.1", 5.0E-03f, _TrBdf2EstimatorReset, _TrBdf2Steps, (bool (*)( void ))0, (uint32_t (*)( void ))0 },
+  { "tr-bdf2 h=1.0", 5.0E-03f, _TrBdf2PredictorReset, _TrBdf2Steps, (bool (*)( void ))0, (uint32_t (*)( void ))0 },
+  // held on the equilibrium while parked, left for the move
+  { "quiescent estimator", 5.0E-03f, _QuiescentReset, _QuiescentStep, (bool (*)( void ))0, _QuiescentSkipped }
+};
+
+#define NUM_SCENARIOS ( sizeof( _scenarios ) / sizeof( _scenarios[ 0 ] ) )
+#define NUM_MODES ( sizeof( _modes ) / sizeof( _modes[ 0 ] ) )
+
+/*!
+ * \brief Advances the double precision reference one sample and calculates
+ * its outputs, x = [Phi]*x + [Gamma]*u and y = [C]*x + [D]*u
+ * \note As this is a static function, there is no input validation
+ */
+static void _ReferenceStep( const float * u, double * y )
+{
+  const RK4SOLVER_CONFIGURATION * config = ASC_THERMAL_MODEL_config;
+  double next[ NUM_STATES ];
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < NUM_STATES; i++ )
+  {
+    next[ i ] = 0.0;
+
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      next[ i ] += _refPhi[ ( i * NUM_STATES ) + j ] * _refState[ j ];
+    }
+
+    for ( j = 0U; j < NUM_INPUTS; j++ )
+    {
+      next[ i ] += _refGamma[ ( i * NUM_INPUTS ) + j ] * (double)u[ j ];
+    }
+  }
+
+  memcpy( (char*)_refState, (char*)next, sizeof( _refState ) );
+
+  for ( i = 0U; i < NUM_OUTPUTS; i++ )
+  {
+    y[ i ] = 0.0;
+
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      y[ i ] += (double)RK4SOLVER_GetCoefficient( config, RK4SOLVER_MATRIX_C, ( i * NUM_STATES ) + j ) * _refState[ j ];
+    }
+
+    for ( j = 0U; j < NUM_INPUTS; j++ )
+    {
+      y[ i ] += (double)RK4SOLVER_GetCoefficient( config, RK4SOLVER_MATRIX_D, ( i * NUM_INPUTS ) + j ) * (double)u[ j ];
+    }
+  }
+}
+
+/*!
+ * \brief Settles the reference onto the equilibrium of the scenario's first
+ * input, as the start of a settled scenario
+ * \note As this is a static function, there is no input validation
+ */
+static void _Settle( const ACCURACY_SCENARIO * scenario )
+{
+  double y[ NUM_OUTPUTS ];
+  uint32_t sample = 0U;
+
+  memset( (char*)_refState, 0, sizeof( _refState ) );
+
+  if ( scenario->settled )
+  {
+    scenario->input( 0U, _input );
+
+    for ( sample = 0U; sample < SETTLE_SAMPLES; sample++ )
+    {
+      _ReferenceStep( _input, y );
+    }
+  }
+
+  memcpy( (char*)_settledState, (char*)_refState, sizeof( _settledState ) );
+}
+
+/*!
+ * \brief Resets a mode and starts it from the scenario's initial state
+ * \return success
+ * \note As this is a static function, there is no input validation
+ */
+static bool _Start( const ACCURACY_MODE * mode )
+{
+  bool status = mode->reset();
+  uint32_t i = 0U;
+
+  for ( i = 0U; i < NUM_STATES; i++ )
+  {
+    _state[ i ] = (float)_settledState[ i ];
+  }
+
+  memcpy( (char*)_refState, (char*)_settledState, sizeof( _refState ) );
+
+  return status;
+}
+
+/*!
+ * \brief Runs one mode against the reference over one scenario. In a settled
+ * scenario a mode with a fast path also fails when the path never engaged.
+ * \return success
+ * \note As this is a static function, there is no input validation
+ */
+static bool _Compare( const ACCURACY_SCENARIO * scenario,
+                      const ACCURACY_MODE * mode,
+                      ASC_THERMAL_MODEL_ACCURACY_RESULT * result )
+{
+  bool status = false;
+  bool engaged = true;
+  double sumSquares = 0.0;
+  float y[ NUM_OUTPUTS ];
+  double yRef[ NUM_OUTPUTS ];
+  uint32_t sample = 0U;
+  uint32_t repeat = 0U;
+  uint32_t i = 0U;
+  clock_t start = 0;
+
+  _Settle( scenario );
+  status = _Start( mode );
+  result->scenario = scenario->name;
+  result->mode = mode->name;
+  result->maxAbsError = 0.0f;
+  result->tolerance = mode->tolerance;
+
+  // accuracy pass, mode and reference in lockstep
+  for ( sample = 0U; ( sample < scenario->numSamples ) && status; sample++ )
+  {
+    scenario->input( sample, _input );
+    status = mode->step( _input, y );
+    _ReferenceStep( _input, yRef );
+
+    for ( i = 0U; i < NUM_OUTPUTS; i++ )
+    {
+      double error = fabs( (double)y[ i ] - yRef[ i ] );
+
+      sumSquares += error * error;
+
+      if ( error > (double)result->maxAbsError )
+      {
+        result->maxAbsError = (float)error;
+      }
+    }
+  }
+
+  result->rmsError = (float)sqrt( sumSquares / (double)( scenario->numSamples * NUM_OUTPUTS ) );
+  engaged = !scenario->settled || !mode->skipped || ( mode->skipped() > 0U );
+
+  // throughput pass, mode only
+  start = clock();
+  for ( repeat = 0U; ( repeat < TIMING_REPEATS ) && status; repeat++ )
+  {
+    status = _Start( mode );
+
+    for ( sample = 0U; ( sample < scenario->numSamples ) && status; sample++ )
+    {
+      scenario->input( sample, _input );
+      status = mode->step( _input, y );
+    }
+  }
+
+  result->nsPerStep = (float)( (double)( clock() - start ) * 1.0E+09 /
+                               ( (double)CLOCKS_PER_SEC * (double)( TIMING_REPEATS * scenario->numSamples ) ) );
+  result->passed = status && engaged && ( result->maxAbsError <= result->tolerance );
+
+  return status;
+}
+
+/*!
+ * \brief Runs every solver mode over every scenario against the double
+ * precision exact exponential reference of the compiled-in model. Modes this
+ * build or host cannot run, e.g. kernel variants the CPU lacks, are left out.
+ * \param results [out] Array receiving one result per scenario and mode,
+ * ASC_THERMAL_MODEL_ACCURACY_MAX_RESULTS covers them all
+ * \param maxResults Length of results
+ * \return Number of results filled in
+ */
+uint32_t ASC_THERMAL_MODEL_ACCURACY_Run( ASC_THERMAL_MODEL_ACCURACY_RESULT * results,
+                                         uint32_t maxResults )
+{
+  uint32_t numResults = 0U;
+
+  if ( results &&
+       ( MATEXP_Discretize( ASC_THERMAL_MODEL_config, SAMPLE_PERIOD, _refPhi, _refGamma, _refWorkspace ) == 1U ) )
+  {
+    RK4SOLVER_KERNELS_VARIANT kernels = RK4SOLVER_KERNELS_Active();
+    uint32_t scenario = 0U;
+    uint32_t mode = 0U;
+
+    for ( scenario = 0U; scenario < NUM_SCENARIOS; scenario++ )
+    {
+      for ( mode = 0U; ( mode < NUM_MODES ) && ( numResults < maxResults ); mode++ )
+      {
+        if ( !_modes[ mode ].available || _modes[ mode ].available() )
+        {
+          _Compare( &_scenarios[ scenario ], &_modes[ mode ], &results[ numResults ] );
+          (void)RK4SOLVER_KERNELS_Select( kernels );
+          numResults++;
+        }
+      }
+    }
+  }
+
+  return numResults;
+}
@@ -0,0 +1,57 @@
+/** 
+ * @file
+ * @brief Defines the interface to the accuracy versus throughput regression
+ * harness that compares every solver path against a double precision exact
+ * exponential reference
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_MODEL_ACCURACY_H_
+#define _ASC_THERMAL_MODEL_ACCURACY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Results ASC_THERMAL_MODEL_ACCURACY_Run fills in at most
+ */
+#define ASC_THERMAL_MODEL_ACCURACY_MAX_RESULTS (128U)
+
+    /*!
+     * \brief Result of one solver mode on one scenario
+     */
+    typedef struct
+    {
+        const char * scenario; //!< Name of the input scenario
+        const char * mode; //!< Name of the solver mode
+        float maxAbsError; //!< Largest output error against the reference (K)
+        float rmsError; //!< RMS output error over all samples and outputs (K)
+        float nsPerStep; //!< Wall time per 1 s thermal period
+        float tolerance; //!< Allowed maxAbsError for the mode
+        bool passed; //!< maxAbsError <= tolerance
+    } ASC_THERMAL_MODEL_ACCURACY_RESULT;
+
+    extern uint32_t ASC_THERMAL_MODEL_ACCURACY_Run( ASC_THERMAL_MODEL_ACCURACY_RESULT * results,
+                                                    uint32_t maxResults );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,281 @@
+/**
+ * @file
+ * @brief Definition and implementation of the thermal model state checkpoint
+ * and warm start after a power cycle
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define _POSIX_C_SOURCE 200809L
+#define ASC_CHECKPOINT_FILE_STORE 1
+#endif
+
+#include "matrix_exponential.h"
+#include "rk4solver.h"
+#include "thermal_model_checkpoint.h"
+#include "thermal_model_estimator.h"
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined( ASC_CHECKPOINT_FILE_STORE )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+
+/* Restore runs once at startup, so its scratch lives in static storage rather
+ * than on the stack of the caller.
+ */
+static double _scaledA[ NUM_STATES * NUM_STATES ];
+static double _transition[ NUM_STATES * NUM_STATES ];
+static double _workspace[ MATEXP_WORKSPACE_LENGTH( NUM_STATES ) ];
+
+/*!
+ * \brief Bitwise CRC-32 (IEEE 802.3, reflected) of a block of memory
+ * \param data Pointer to the bytes
+ * \param length Number of bytes
+ * \return The CRC
+ * \note As this is a static function, there is no input validation
+ */
+static uint32_t _Crc32( const uint8_t * data, size_t length )
+{
+  uint32_t crc = 0xFFFFFFFFUL;
+  size_t i = 0U;
+  uint32_t bit = 0U;
+
+  for ( i = 0U; i < length; i++ )
+  {
+    crc ^= data[ i ];
+
+    for ( bit = 0U; bit < 8U; bit++ )
+    {
+      crc = ( crc >> 1 ) ^ ( 0xEDB88320UL & ( 0U - ( crc & 1U ) ) );
+    }
+  }
+
+  return ~crc;
+}
+
+/*!
+ * \brief Writes the current estimator state and a timestamp to the store
+ * \param store The non-volatile memory access functions
+ * \param obj A pointer to the Thermal Model Estimator data structure
+ * \param timestamp The current time in ms of a clock that keeps running while
+ * the drive is powered off (RTC)
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_CHECKPOINT_Save( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store,
+                                        ASC_THERMAL_MODEL_ESTIMATOR * obj,
+                                        uint64_t timestamp )
+{
+  bool status = false;
+
+  if ( store && store->write && obj && obj->solverInputs &&
+       ( obj->stateSpaceConfig->numStates == NUM_STATES ) )
+  {
+    ASC_THERMAL_MODEL_CHECKPOINT record;
+
+    memset( (char*)&record, 0, sizeof( record ) );
+    record.magic = ASC_THERMAL_MODEL_CHECKPOINT_MAGIC;
+    record.version = ASC_THERMAL_MODEL_CHECKPOINT_VERSION;
+    record.numStates = NUM_STATES;
+    record.timestamp = timestamp;
+    record.ambientTemp = obj->ambientTemp;
+    memcpy( (char*)record.state,
+            (char*)obj->solverInputs->currentState,
+            NUM_STATES * sizeof( float ) );
+    record.crc = _Crc32( (const uint8_t*)&record, offsetof( ASC_THERMAL_MODEL_CHECKPOINT, crc ) );
+
+    status = store->write( store->context, &record );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Restores the estimator state from the store and jumps it forward over
+ * the power-off interval in closed form: x(now) = e^([A]*dt) * x(checkpoint).
+ * With the drive off the heat source inputs are zero so the free response is
+ * exact, no re-simulation is needed.
+ * \param store The non-volatile memory access functions
+ * \param obj A pointer to a set up Thermal Model Estimator data structure
+ * \param now The current time in ms of the same clock used by
+ * ASC_THERMAL_MODEL_CHECKPOINT_Save
+ * \return success, on failure the estimator state is left untouched
+ * \note If the clock went backwards the checkpoint state is restored without
+ * cooling, which is the conservative choice.
+ */
+bool ASC_THERMAL_MODEL_CHECKPOINT_Restore( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store,
+                                           ASC_THERMAL_MODEL_ESTIMATOR * obj,
+                                           uint64_t now )
+{
+  bool status = false;
+  ASC_THERMAL_MODEL_CHECKPOINT record;
+
+  if ( store && store->read && obj && obj->solverInputs && obj->solverOutputs &&
+       ( obj->stateSpaceConfig->numStates == NUM_STATES ) &&
+       store->read( store->context, &record ) )
+  {
+    uint32_t crc = _Crc32( (const uint8_t*)&record, offsetof( ASC_THERMAL_MODEL_CHECKPOINT, crc ) );
+
+    if ( ( record.magic == ASC_THERMAL_MODEL_CHECKPOINT_MAGIC ) &&
+         ( record.version == ASC_THERMAL_MODEL_CHECKPOINT_VERSION ) &&
+         ( record.numStates == NUM_STATES ) &&
+         ( record.crc == crc ) )
+    {
+      const RK4SOLVER_CONFIGURATION * config = obj->stateSpaceConfig;
+      double elapsed = ( now > record.timestamp ) ? (double)( now - record.timestamp ) / 1000.0 : 0.0;
+      float * state = obj->solverInputs->currentState;
+      uint32_t i = 0U;
+      uint32_t j = 0U;
+
+      for ( i = 0U; i < NUM_STATES * NUM_STATES; i++ )
+      {
+        _scaledA[ i ] = (double)RK4SOLVER_GetCoefficient( config, RK4SOLVER_MATRIX_A, i ) * elapsed;
+      }
+
+      if ( MATEXP_Expm( _scaledA, NUM_STATES, _transition, _workspace ) == 1U )
+      {
+        for ( i = 0U; i < NUM_STATES; i++ )
+        {
+          double sum = 0.0;
+
+          for ( j = 0U; j < NUM_STATES; j++ )
+          {
+            sum += _transition[ ( i * NUM_STATES ) + j ] * (double)record.state[ j ];
+          }
+
+          state[ i ] = (float)sum;
+        }
+
+        obj->ambientTemp = record.ambientTemp;
+        RK4SOLVER_Output( config, state, obj->aveInputs, obj->solverOutputs->nextOutput );
+
+        status = true;
+      }
+    }
+  }
+
+  return status;
+}
+
+#if defined( ASC_CHECKPOINT_FILE_STORE )
+
+/*!
+ * \brief Writes the record into the mapped file and flushes it to disk
+ * \note As this is a static function, there is no input validation
+ */
+static bool _FileStoreWrite( void * context, const ASC_THERMAL_MODEL_CHECKPOINT * record )
+{
+  memcpy( (char*)context, (const char*)record, sizeof( *record ) );
+
+  return ( msync( context, sizeof( *record ), MS_SYNC ) == 0 );
+}
+
+/*!
+ * \brief Reads the record from the mapped file
+ * \note As this is a static function, there is no input validation
+ */
+static bool _FileStoreRead( void * context, ASC_THERMAL_MODEL_CHECKPOINT * record )
+{
+  memcpy( (char*)record, (const char*)context, sizeof( *record ) );
+
+  return true;
+}
+
+/*!
+ * \brief Opens a memory-mapped file as a stand-in for drive NVM
+ * \param store [out] The store to be bound to the file
+ * \param path Path of the file, created if it does not exist
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_CHECKPOINT_OpenFileStore( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store,
+                                                 const char * path )
+{
+  bool status = false;
+
+  if ( store && path )
+  {
+    int fd = open( path, O_RDWR | O_CREAT, 0644 );
+
+    if ( fd >= 0 )
+    {
+      if ( ftruncate( fd, (off_t)sizeof( ASC_THERMAL_MODEL_CHECKPOINT ) ) == 0 )
+      {
+        void * mapping = mmap( (void*)0, sizeof( ASC_THERMAL_MODEL_CHECKPOINT ),
+                               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+        if ( mapping != MAP_FAILED )
+        {
+          store->write = _FileStoreWrite;
+          store->read = _FileStoreRead;
+          store->context = mapping;
+          status = true;
+        }
+      }
+
+      // the mapping keeps the file referenced
+      close( fd );
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Unmaps a store opened by ASC_THERMAL_MODEL_CHECKPOINT_OpenFileStore
+ * \param store The store to be released
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_CHECKPOINT_CloseFileStore( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store )
+{
+  bool status = false;
+
+  if ( store && store->context )
+  {
+    status = ( munmap( store->context, sizeof( ASC_THERMAL_MODEL_CHECKPOINT ) ) == 0 );
+    store->write = 0;
+    store->read = 0;
+    store->context = 0;
+  }
+
+  return status;
+}
+
+#else
+
+bool ASC_THERMAL_MODEL_CHECKPOINT_OpenFileStore( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store,
+                                                 const char * path )
+{
+  (void)store;
+  (void)path;
+
+  return false;
+}
+
+bool ASC_THERMAL_MODEL_CHECKPOINT_CloseFileStore( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store )
+{
+  (void)store;
+
+  return false;
+}
+
+#endif
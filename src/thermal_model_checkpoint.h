@@ -0,0 +1,73 @@
+/** 
+ * @file
+ * @brief Defines the interface to the thermal model state checkpoint and warm
+ * start after a power cycle
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_MODEL_CHECKPOINT_H_
+#define _ASC_THERMAL_MODEL_CHECKPOINT_H_
+
+#include "thermal_model_estimator.h"
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASC_THERMAL_MODEL_CHECKPOINT_MAGIC (0x43435341UL) //!< "ASCC"
+#define ASC_THERMAL_MODEL_CHECKPOINT_VERSION (1U)
+
+    /*!
+     * \brief The record written to non-volatile memory
+     */
+    typedef struct
+    {
+        uint32_t magic; //!< ASC_THERMAL_MODEL_CHECKPOINT_MAGIC
+        uint16_t version; //!< ASC_THERMAL_MODEL_CHECKPOINT_VERSION
+        uint16_t numStates; //!< number of states in the record
+        uint64_t timestamp; //!< time of the checkpoint in ms of a clock that survives power off
+        float ambientTemp; //!< The ambient temperature at the checkpoint
+        float state[ ASC_THERMAL_MODEL_NUM_STATES ]; //!< The estimator state relative to ambient
+        uint32_t crc; //!< CRC-32 of all preceding bytes
+    } ASC_THERMAL_MODEL_CHECKPOINT;
+
+    /*!
+     * \brief Non-volatile memory access used to persist a checkpoint record
+     */
+    typedef struct
+    {
+        bool (*write)( void * context, const ASC_THERMAL_MODEL_CHECKPOINT * record ); //!< Persist the record
+        bool (*read)( void * context, ASC_THERMAL_MODEL_CHECKPOINT * record ); //!< Fetch the record
+        void * context; //!< Passed through to read and write
+    } ASC_THERMAL_MODEL_CHECKPOINT_STORE;
+
+    extern bool ASC_THERMAL_MODEL_CHECKPOINT_Save( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store,
+                                                   ASC_THERMAL_MODEL_ESTIMATOR * obj,
+                                                   uint64_t timestamp );
+    extern bool ASC_THERMAL_MODEL_CHECKPOINT_Restore( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store,
+                                                      ASC_THERMAL_MODEL_ESTIMATOR * obj,
+                                                      uint64_t now );
+    extern bool ASC_THERMAL_MODEL_CHECKPOINT_OpenFileStore( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store,
+                                                            const char * path );
+    extern bool ASC_THERMAL_MODEL_CHECKPOINT_CloseFileStore( ASC_THERMAL_MODEL_CHECKPOINT_STORE * store );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * @file
+ * @brief Definition and implementation of the periodic steady state of a
+ * repeated duty cycle
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lu_decomposition.h"
+#include "rk4solver.h"
+#include "thermal_model_cyclic.h"
+#include "thermal_model_state_space.h"
+#include "thermal_model_step_operator.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+
+/*!
+ * \brief One period of the step operator in double precision,
+ * x <- [Phi]*x + [Gamma]*u, with u null for the free response
+ * \note As this is a static function, there is no input validation
+ */
+static void _Apply( const ASC_THERMAL_MODEL_STEP_OPERATOR * op, double * x, const float * u )
+{
+  double next[ NUM_STATES ];
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < NUM_STATES; i++ )
+  {
+    next[ i ] = 0.0;
+
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      next[ i ] += (double)op->Phi[ i ][ j ] * x[ j ];
+    }
+
+    for ( j = 0U; u && ( j < NUM_INPUTS ); j++ )
+    {
+      next[ i ] += (double)op->Gamma[ i ][ j ] * (double)u[ j ];
+    }
+  }
+
+  memcpy( (char*)x, (char*)next, sizeof( next ) );
+}
+
+/*!
+ * \brief Computes the periodic steady state of a duty cycle repeated forever,
+ * the start state x that one cycle maps back onto itself,
+ *  x = [Phi]^T * x + f  <=>  ( I - [Phi]^T ) * x = f
+ * with [Phi]^T the transition over the whole cycle and f the state after one
+ * cycle from zero. One LU solve and one simulated cycle replace the thousands
+ * of cycles a model with long time constants needs to settle.
+ * \param config The state space representation, for the outputs
+ * \param op The step operator of one sample of the cycle, e.g. the
+ * estimator's periodOperator
+ * \param inputs numPeriods x ASC_THERMAL_MODEL_NUM_INPUTS, held over each
+ * sample, see ASC_THERMAL_MODEL_CalculateSourceInputs
+ * \param numPeriods Samples in one cycle
+ * \param startState [out] ASC_THERMAL_MODEL_NUM_STATES, the state at the
+ * start of every settled cycle
+ * \param outputs [out] numPeriods x ASC_THERMAL_MODEL_NUM_OUTPUTS, the outputs
+ * after each sample of the settled cycle, may be null
+ * \param peaks [out] ASC_THERMAL_MODEL_NUM_OUTPUTS, the highest output over
+ * the settled cycle, sampled at the end of each sample like the estimator
+ * \param peakPeriods [out] ASC_THERMAL_MODEL_NUM_OUTPUTS, index of the sample
+ * where each peak occurs, may be null
+ * \return success
+ * \retval false I - [Phi]^T is singular, the model has a state that does not
+ * decay
+ */
+bool ASC_THERMAL_MODEL_CYCLIC_SteadyState( const RK4SOLVER_CONFIGURATION * config,
+                                           const ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                           const float * inputs,
+                                           uint32_t numPeriods,
+                                           float * startState,
+                                           float * outputs,
+                                           float * peaks,
+                                           uint32_t * peakPeriods )
+{
+  bool status = false;
+
+  if ( config && op && inputs && startState && peaks && ( numPeriods > 0U ) &&
+       ( config->numStates == NUM_STATES ) &&
+       ( config->numInputs == NUM_INPUTS ) &&
+       ( config->numOutputs == NUM_OUTPUTS ) )
+  {
+    double transition[ NUM_STATES ][ NUM_STATES ]; // column j is [Phi]^T * e(j)
+    double forced[ NUM_STATES ] = { 0.0 };
+    float system[ NUM_STATES * NUM_STATES ];
+    float rhs[ NUM_STATES ];
+    uint32_t pivots[ NUM_STATES ];
+    uint32_t period = 0U;
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+
+    // the cycle's transition and forced response, accumulated in double so
+    // that I - [Phi]^T keeps its digits when the cycle is short against the
+    // time constants
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      memset( (char*)transition[ j ], 0, sizeof( transition[ j ] ) );
+      transition[ j ][ j ] = 1.0;
+
+      for ( period = 0U; period < numPeriods; period++ )
+      {
+        _Apply( op, transition[ j ], (const float*)0 );
+      }
+    }
+
+    for ( period = 0U; period < numPeriods; period++ )
+    {
+      _Apply( op, forced, &inputs[ period * NUM_INPUTS ] );
+    }
+
+    for ( i = 0U; i < NUM_STATES; i++ )
+    {
+      for ( j = 0U; j < NUM_STATES; j++ )
+      {
+        system[ ( i * NUM_STATES ) + j ] = (float)( ( ( i == j ) ? 1.0 : 0.0 ) - transition[ j ][ i ] );
+      }
+
+      rhs[ i ] = (float)forced[ i ];
+    }
+
+    status = ( LU_Factor( system, NUM_STATES, pivots ) == 1U ) &&
+             ( LU_Solve( system, NUM_STATES, pivots, rhs, startState ) == 1U );
+
+    if ( status )
+    {
+      float x[ NUM_STATES ];
+      float next[ NUM_STATES ];
+      float y[ NUM_OUTPUTS ];
+
+      memcpy( (char*)x, (char*)startState, sizeof( x ) );
+
+      for ( period = 0U; period < numPeriods; period++ )
+      {
+        float * u = (float*)&inputs[ period * NUM_INPUTS ];
+
+        ASC_THERMAL_MODEL_STEP_OPERATOR_Apply( op, x, u, next );
+        RK4SOLVER_Output( config, next, u, y );
+        memcpy( (char*)x, (char*)next, sizeof( x ) );
+
+        for ( i = 0U; i < NUM_OUTPUTS; i++ )
+        {
+          if ( ( period == 0U ) || ( y[ i ] > peaks[ i ] ) )
+          {
+            peaks[ i ] = y[ i ];
+
+            if ( peakPeriods )
+            {
+              peakPeriods[ i ] = period;
+            }
+          }
+        }
+
+        if ( outputs )
+        {
+          memcpy( (char*)&outputs[ period * NUM_OUTPUTS ], (char*)y, sizeof( y ) );
+        }
+      }
+    }
+  }
+
+  return status;
+}
@@ -17,16 +17,28 @@
  * limitations under the License.
  */
  
+#include "lu_decomposition.h"
 #include "rk4solver.h"
 #include "thermal_model_estimator.h"
+#include "thermal_model_step_operator.h"
+#include <math.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
+static bool _isQuiescent( ASC_THERMAL_MODEL_ESTIMATOR * obj );
+static void _applyForced( ASC_THERMAL_MODEL_ESTIMATOR * obj );
+
 /*!
  * \brief A task intended to be run at the course thermal manager period (1s)
  * to calculate the current system temperatures based on the inputs of the last
  * period.
  * \param obj A pointer to the Thermal Model Estimator data structure
+ * \note Once the inputs repeat and the state has settled onto their
+ * equilibrium the integration is skipped, see
+ * ASC_THERMAL_MODEL_ESTIMATOR_SetupQuiescent. Inputs set with their forced
+ * response take one application of the period operator instead of the solver
+ * steps.
  */
 void ASC_THERMAL_MODEL_ESTIMATOR_PeriodicTask( ASC_THERMAL_MODEL_ESTIMATOR * obj )
 {
@@ -34,7 +46,14 @@ void ASC_THERMAL_MODEL_ESTIMATOR_PeriodicTask( ASC_THERMAL_MODEL_ESTIMATOR * obj
   {
     uint32_t itr = 0U;
     
-    for ( itr = 0U; itr < obj->periodCounts; itr++ )
+    obj->quiescent = _isQuiescent( obj );
+    
+    if ( obj->forcedValid && !obj->quiescent )
+    {
+      _applyForced( obj );
+    }
+    
+    for ( itr = 0U; ( itr < obj->periodCounts ) && !obj->quiescent && !obj->forcedValid; itr++ )
     {
       uint32_t result = RK4SOLVER_Solve( obj->stateSpaceConfig,
                                          obj->solverInputs, 
@@ -58,8 +77,237 @@ void ASC_THERMAL_MODEL_ESTIMATOR_SetInputs( ASC_THERMAL_MODEL_ESTIMATOR * obj, f
 {
   if ( obj && inputs )
   {
+    obj->inputsHeld = ( memcmp( (char*)obj->aveInputs,
+                                (char*)inputs,
+                                obj->stateSpaceConfig->numInputs * sizeof( float ) ) == 0 );
+    obj->forcedValid = false;
+    
     memcpy( (char*)obj->aveInputs,
     (char*)inputs,
     obj->stateSpaceConfig->numInputs * sizeof( float ) );
   }
-}
\ No newline at end of file
+}
+
+/*!
+ * \brief Sets the thermal model inputs together with their forced response
+ * over one period, as averaged from a setpoint table, see
+ * ASC_THERMAL_MODEL_SETPOINT_TABLE_Average
+ * \param obj A pointer to the Thermal Model Estimator data structure
+ * \param inputs An array of thermal state inputs
+ * \param forced [Gamma]*inputs of the period operator
+ */
+void ASC_THERMAL_MODEL_ESTIMATOR_SetForcedInputs( ASC_THERMAL_MODEL_ESTIMATOR * obj, float * inputs, float * forced )
+{
+  if ( obj && inputs && forced )
+  {
+    ASC_THERMAL_MODEL_ESTIMATOR_SetInputs( obj, inputs );
+    
+    memcpy( (char*)obj->aveForced, (char*)forced, sizeof( obj->aveForced ) );
+    obj->forcedValid = true;
+  }
+}
+
+/*!
+ * \brief Advances the estimator by an arbitrary elapsed time with the current
+ * aveInputs held, for catching up after the periodic task was disabled or
+ * starved. Whole thermal periods are covered by the cached period operator
+ * in O(log k) matrix products, the remainder by at most periodCounts solver
+ * steps, so the cost is bounded regardless of the length of the gap.
+ * \param obj A pointer to the Thermal Model Estimator data structure
+ * \param elapsed The time to advance in seconds
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_ESTIMATOR_FastForward( ASC_THERMAL_MODEL_ESTIMATOR * obj, float elapsed )
+{
+  bool status = false;
+  
+  if ( obj && obj->periodOperator && ( obj->periodOperator->h > 0.0f ) && ( elapsed >= 0.0f ) )
+  {
+    float period = obj->periodOperator->h;
+    uint64_t periods = (uint64_t)( elapsed / period );
+    uint32_t remainderSteps = (uint32_t)( ( ( elapsed - (float)periods * period ) / obj->h ) + 0.5f );
+    uint32_t itr = 0U;
+    
+    if ( remainderSteps >= obj->periodCounts )
+    {
+      periods++;
+      remainderSteps = 0U;
+    }
+    
+    ASC_THERMAL_MODEL_STEP_OPERATOR_Advance( obj->periodOperator,
+                                             obj->solverInputs->currentState,
+                                             obj->aveInputs,
+                                             periods );
+    
+    status = ( RK4SOLVER_Output( obj->stateSpaceConfig,
+                                 obj->solverInputs->currentState,
+                                 obj->aveInputs,
+                                 obj->solverOutputs->nextOutput ) == 1U );
+    
+    for ( itr = 0U; ( itr < remainderSteps ) && status; itr++ )
+    {
+      status = ( RK4SOLVER_Solve( obj->stateSpaceConfig,
+                                  obj->solverInputs, 
+                                  obj->solverOutputs ) == 1U );
+    }
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Prepares the quiescent fast path of the periodic task. An axis parked
+ * at holding current sends the same inputs every period and its state settles
+ * onto the equilibrium -[A]^-1*[B]*u, which is also the fixed point of the
+ * solver step. Once the inputs repeat and the state is within tolerance of
+ * that equilibrium, the state is set onto it and the integration is skipped
+ * until the inputs change.
+ * \param obj A pointer to the Thermal Model Estimator data structure, with the
+ * periodOperator set
+ * \param tolerance Largest distance in K below equilibrium, in any state, that
+ * counts as settled. Setting such a state onto the equilibrium raises the
+ * estimate, so this may be looser than the estimator's accuracy.
+ * \param aboveTolerance Largest distance in K above equilibrium that counts as
+ * settled. Setting such a state onto the equilibrium lowers the estimate, so
+ * this should not exceed the estimator's accuracy.
+ * \return success
+ * \retval false [A] is singular, the fast path stays disabled
+ * \note The fast path is only enabled when the period map contracts,
+ * ||[Phi]||inf < 1. The skipped periods would then only have shrunk the
+ * remaining error, so the held estimate never strays further from the
+ * integrated one than the tolerance of the side it was set from.
+ */
+bool ASC_THERMAL_MODEL_ESTIMATOR_SetupQuiescent( ASC_THERMAL_MODEL_ESTIMATOR * obj, float tolerance, float aboveTolerance )
+{
+  bool status = false;
+  
+  if ( obj && obj->stateSpaceConfig && obj->periodOperator &&
+       ( obj->stateSpaceConfig->numStates == ASC_THERMAL_MODEL_NUM_STATES ) &&
+       ( obj->stateSpaceConfig->numInputs == ASC_THERMAL_MODEL_NUM_INPUTS ) )
+  {
+    float lu[ ASC_THERMAL_MODEL_NUM_STATES * ASC_THERMAL_MODEL_NUM_STATES ];
+    uint32_t pivots[ ASC_THERMAL_MODEL_NUM_STATES ];
+    float decay = 0.0f;
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+    
+    (void)RK4SOLVER_GetMatrix( obj->stateSpaceConfig, RK4SOLVER_MATRIX_A, lu );
+    obj->quiescentTolerance = 0.0f;
+    obj->quiescentAboveTolerance = 0.0f;
+    obj->quiescent = false;
+    
+    status = ( LU_Factor( lu, ASC_THERMAL_MODEL_NUM_STATES, pivots ) == 1U );
+    
+    for ( j = 0U; ( j < ASC_THERMAL_MODEL_NUM_INPUTS ) && status; j++ )
+    {
+      float b[ ASC_THERMAL_MODEL_NUM_STATES ];
+      float x[ ASC_THERMAL_MODEL_NUM_STATES ];
+      
+      for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_STATES; i++ )
+      {
+        b[ i ] = -RK4SOLVER_GetCoefficient( obj->stateSpaceConfig, RK4SOLVER_MATRIX_B, ( i * ASC_THERMAL_MODEL_NUM_INPUTS ) + j );
+      }
+      
+      status = ( LU_Solve( lu, ASC_THERMAL_MODEL_NUM_STATES, pivots, b, x ) == 1U );
+      
+      for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_STATES; i++ )
+      {
+        obj->equilibriumGain[ i ][ j ] = x[ i ];
+      }
+    }
+    
+    for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_STATES; i++ )
+    {
+      float rowSum = 0.0f;
+      
+      for ( j = 0U; j < ASC_THERMAL_MODEL_NUM_STATES; j++ )
+      {
+        rowSum += fabsf( obj->periodOperator->Phi[ i ][ j ] );
+      }
+      
+      decay = ( rowSum > decay ) ? rowSum : decay;
+    }
+    
+    if ( status && ( decay < 1.0f ) )
+    {
+      obj->quiescentTolerance = tolerance;
+      obj->quiescentAboveTolerance = aboveTolerance;
+    }
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Decides whether the coming period can be skipped. Entering the
+ * quiescent mode sets the state onto the equilibrium and its outputs once; it
+ * is left on the first input change or when anything else moved the state.
+ * \note As this is a static function, there is no input validation
+ */
+static bool _isQuiescent( ASC_THERMAL_MODEL_ESTIMATOR * obj )
+{
+  bool quiescent = false;
+  float * state = obj->solverInputs->currentState;
+  
+  if ( obj->inputsHeld && ( obj->quiescentTolerance > 0.0f ) )
+  {
+    if ( obj->quiescent )
+    {
+      quiescent = ( memcmp( (char*)state, (char*)obj->equilibrium, sizeof( obj->equilibrium ) ) == 0 );
+    }
+    else
+    {
+      uint32_t i = 0U;
+      uint32_t j = 0U;
+      
+      quiescent = true;
+      
+      for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_STATES; i++ )
+      {
+        obj->equilibrium[ i ] = 0.0f;
+        
+        for ( j = 0U; j < ASC_THERMAL_MODEL_NUM_INPUTS; j++ )
+        {
+          obj->equilibrium[ i ] += obj->equilibriumGain[ i ][ j ] * obj->aveInputs[ j ];
+        }
+        
+        quiescent = quiescent && ( ( obj->equilibrium[ i ] - state[ i ] ) <= obj->quiescentTolerance ) &&
+                                 ( ( state[ i ] - obj->equilibrium[ i ] ) <= obj->quiescentAboveTolerance );
+      }
+      
+      if ( quiescent )
+      {
+        memcpy( (char*)state, (char*)obj->equilibrium, sizeof( obj->equilibrium ) );
+        RK4SOLVER_Output( obj->stateSpaceConfig, state, obj->aveInputs, obj->solverOutputs->nextOutput );
+      }
+    }
+  }
+  
+  return quiescent;
+}
+
+/*!
+ * \brief One thermal period as x <- [Phi]*x + aveForced, and the outputs of
+ * the new state
+ * \note As this is a static function, there is no input validation
+ */
+static void _applyForced( ASC_THERMAL_MODEL_ESTIMATOR * obj )
+{
+  float * state = obj->solverInputs->currentState;
+  float next[ ASC_THERMAL_MODEL_NUM_STATES ];
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+  
+  for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_STATES; i++ )
+  {
+    next[ i ] = obj->aveForced[ i ];
+    
+    for ( j = 0U; j < ASC_THERMAL_MODEL_NUM_STATES; j++ )
+    {
+      next[ i ] += obj->periodOperator->Phi[ i ][ j ] * state[ j ];
+    }
+  }
+  
+  memcpy( (char*)state, (char*)next, sizeof( next ) );
+  RK4SOLVER_Output( obj->stateSpaceConfig, state, obj->aveInputs, obj->solverOutputs->nextOutput );
+}
@@ -20,6 +20,7 @@
 
 #include "rk4solver.h"
 #include "thermal_model_state_space.h"
+#include "thermal_model_step_operator.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -37,13 +38,25 @@ extern "C" {
       float ambientTemp; //!< The ambient temperature
       float initialState[ ASC_THERMAL_MODEL_NUM_STATES ]; //!< The initial temperatures for the thermal period
       float aveInputs[ ASC_THERMAL_MODEL_NUM_INPUTS ]; //!< The heat source inputs from the period
-      RK4SOLVER_CONFIGURATION * stateSpaceConfig; //!< The state space thermal model
+      const RK4SOLVER_CONFIGURATION * stateSpaceConfig; //!< The state space thermal model
       RK4SOLVER_INPUT * solverInputs; //!< Collection of thermal inputs for the RK4 Solver
       RK4SOLVER_OUTPUT * solverOutputs; //!< Collection of thermal outputs for the RK4 Solver
+      const ASC_THERMAL_MODEL_STEP_OPERATOR * periodOperator; //!< Map of one thermal period, used in place from the model file or from the one built at setup
+      float equilibriumGain[ ASC_THERMAL_MODEL_NUM_STATES ][ ASC_THERMAL_MODEL_NUM_INPUTS ]; //!< -[A]^-1*[B], the state held inputs settle to
+      float equilibrium[ ASC_THERMAL_MODEL_NUM_STATES ]; //!< The settled state of the held aveInputs
+      float quiescentTolerance; //!< Largest state error in K below the equilibrium accepted to skip the period, 0 disables the fast path
+      float quiescentAboveTolerance; //!< Largest state error in K above the equilibrium, where setting the state onto it lowers the estimate
+      bool inputsHeld; //!< The last SetInputs repeated the previous inputs
+      bool quiescent; //!< The state sits at equilibrium and the periodic integration is skipped
+      float aveForced[ ASC_THERMAL_MODEL_NUM_STATES ]; //!< [Gamma]*aveInputs when set from a setpoint table
+      bool forcedValid; //!< aveForced belongs to aveInputs, the period is one operator application
   } ASC_THERMAL_MODEL_ESTIMATOR;
   
   extern void ASC_THERMAL_MODEL_ESTIMATOR_PeriodicTask( ASC_THERMAL_MODEL_ESTIMATOR * obj );
   extern void ASC_THERMAL_MODEL_ESTIMATOR_SetInputs( ASC_THERMAL_MODEL_ESTIMATOR * obj, float * inputs );
+  extern bool ASC_THERMAL_MODEL_ESTIMATOR_FastForward( ASC_THERMAL_MODEL_ESTIMATOR * obj, float elapsed );
+  extern bool ASC_THERMAL_MODEL_ESTIMATOR_SetupQuiescent( ASC_THERMAL_MODEL_ESTIMATOR * obj, float tolerance, float aboveTolerance );
+  extern void ASC_THERMAL_MODEL_ESTIMATOR_SetForcedInputs( ASC_THERMAL_MODEL_ESTIMATOR * obj, float * inputs, float * forced );
   
 #ifdef __cplusplus
 }
@@ -0,0 +1,259 @@
+/**
+ * @file
+ * @brief Definition and implementation of the binary thermal model file
+ * format and its zero copy loader
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "rk4solver.h"
+#include "thermal_model_file.h"
+#include "thermal_model_state_space.h"
+#include "thermal_model_step_operator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined( ASC_THERMAL_MODEL_FILE_HAS_MMAP )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+
+/*!
+ * \brief Bitwise CRC-32 (IEEE 802.3), only run when a model is built or bound
+ * \note As this is a static function, there is no input validation
+ */
+static uint32_t _Crc32( const uint8_t * data, size_t length )
+{
+  uint32_t crc = 0xFFFFFFFFUL;
+  size_t i = 0U;
+  uint32_t bit = 0U;
+
+  for ( i = 0U; i < length; i++ )
+  {
+    crc ^= data[ i ];
+
+    for ( bit = 0U; bit < 8U; bit++ )
+    {
+      crc = ( crc >> 1 ) ^ ( 0xEDB88320UL & ( 0U - ( crc & 1U ) ) );
+    }
+  }
+
+  return ~crc;
+}
+
+/*!
+ * \brief Fills an image from a model, precomputing the estimator period
+ * operator so loading it costs no setup time
+ * \param image [out] The image, ready to be written to a file as is
+ * \param name Motor frame name, truncated to fit
+ * \param config The state space model, ASC_THERMAL_MODEL_NUM_* dimensions
+ * \param losses The heat source constants
+ * \param ratings The overload limits and loads
+ * \param operatorStep Solver step of the estimator, e.g. 0.1 s
+ * \param operatorSteps Solver steps per estimator period, e.g. 10
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_FILE_Build( ASC_THERMAL_MODEL_FILE_IMAGE * image,
+                                   const char * name,
+                                   const RK4SOLVER_CONFIGURATION * config,
+                                   const ASC_THERMAL_MODEL_LOSS_CONSTANTS * losses,
+                                   const ASC_THERMAL_MODEL_RATINGS * ratings,
+                                   float operatorStep,
+                                   uint32_t operatorSteps )
+{
+  bool status = false;
+
+  if ( image && name && config && losses && ratings &&
+       ( config->numStates == NUM_STATES ) &&
+       ( config->numInputs == NUM_INPUTS ) &&
+       ( config->numOutputs == NUM_OUTPUTS ) )
+  {
+    memset( (char*)image, 0, sizeof( *image ) );
+    image->magic = ASC_THERMAL_MODEL_FILE_MAGIC;
+    image->version = ASC_THERMAL_MODEL_FILE_VERSION;
+    image->numStates = (uint16_t)NUM_STATES;
+    image->numInputs = (uint16_t)NUM_INPUTS;
+    image->numOutputs = (uint16_t)NUM_OUTPUTS;
+    image->size = (uint32_t)sizeof( *image );
+    strncpy( image->name, name, sizeof( image->name ) - 1U );
+    // packed configurations are expanded, files always hold float matrices
+    (void)RK4SOLVER_GetMatrix( config, RK4SOLVER_MATRIX_A, &image->A[ 0 ][ 0 ] );
+    (void)RK4SOLVER_GetMatrix( config, RK4SOLVER_MATRIX_B, &image->B[ 0 ][ 0 ] );
+    (void)RK4SOLVER_GetMatrix( config, RK4SOLVER_MATRIX_C, &image->C[ 0 ][ 0 ] );
+    (void)RK4SOLVER_GetMatrix( config, RK4SOLVER_MATRIX_D, &image->D[ 0 ][ 0 ] );
+    image->losses = *losses;
+    image->ratings = *ratings;
+    image->operatorStep = operatorStep;
+    image->operatorSteps = operatorSteps;
+
+    status = ASC_THERMAL_MODEL_STEP_OPERATOR_FromSolver( &image->periodOperator,
+                                                         config,
+                                                         operatorStep,
+                                                         operatorSteps );
+
+    image->crc = _Crc32( (const uint8_t*)image, offsetof( ASC_THERMAL_MODEL_FILE_IMAGE, crc ) );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Validates an image in memory, e.g. linked into flash, and points a
+ * handle at it without copying
+ * \param file [out] The handle
+ * \param data The image, 4 byte aligned, must outlive the handle
+ * \param size Bytes available at data
+ * \return success
+ * \retval false Not a model image, another version or layout, or corrupt
+ */
+bool ASC_THERMAL_MODEL_FILE_Bind( ASC_THERMAL_MODEL_FILE * file, const void * data, size_t size )
+{
+  bool status = false;
+
+  if ( file && data && ( size >= sizeof( ASC_THERMAL_MODEL_FILE_IMAGE ) ) &&
+       ( ( (uintptr_t)data & 3U ) == 0U ) )
+  {
+    const ASC_THERMAL_MODEL_FILE_IMAGE * image = (const ASC_THERMAL_MODEL_FILE_IMAGE*)data;
+
+    status = ( image->magic == ASC_THERMAL_MODEL_FILE_MAGIC ) &&
+             ( image->version == ASC_THERMAL_MODEL_FILE_VERSION ) &&
+             ( image->numStates == NUM_STATES ) &&
+             ( image->numInputs == NUM_INPUTS ) &&
+             ( image->numOutputs == NUM_OUTPUTS ) &&
+             ( image->size == sizeof( ASC_THERMAL_MODEL_FILE_IMAGE ) ) &&
+             ( image->crc == _Crc32( (const uint8_t*)image, offsetof( ASC_THERMAL_MODEL_FILE_IMAGE, crc ) ) );
+
+    if ( status )
+    {
+      file->image = image;
+      file->mappedSize = 0U;
+      file->config.numStates = NUM_STATES;
+      file->config.numInputs = NUM_INPUTS;
+      file->config.numOutputs = NUM_OUTPUTS;
+      file->config.A = &image->A[ 0 ][ 0 ];
+      file->config.B = &image->B[ 0 ][ 0 ];
+      file->config.C = &image->C[ 0 ][ 0 ];
+      file->config.D = &image->D[ 0 ][ 0 ];
+      file->config.packed = (const RK4SOLVER_PACKED*)0;
+    }
+  }
+
+  return status;
+}
+
+#if defined( ASC_THERMAL_MODEL_FILE_HAS_MMAP )
+
+/*!
+ * \brief Maps a model file read only. Every process mapping the same file
+ * shares its pages, and every model selecting the handle shares the mapping.
+ * \param file [out] The handle
+ * \param path Path of a file written from ASC_THERMAL_MODEL_FILE_Build
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_FILE_Open( ASC_THERMAL_MODEL_FILE * file, const char * path )
+{
+  bool status = false;
+
+  if ( file && path )
+  {
+    int fd = open( path, O_RDONLY );
+
+    if ( fd >= 0 )
+    {
+      struct stat info;
+
+      if ( ( fstat( fd, &info ) == 0 ) && ( info.st_size >= (off_t)sizeof( ASC_THERMAL_MODEL_FILE_IMAGE ) ) )
+      {
+        size_t size = (size_t)info.st_size;
+        void * mapping = mmap( (void*)0, size, PROT_READ, MAP_SHARED, fd, 0 );
+
+        if ( mapping != MAP_FAILED )
+        {
+          status = ASC_THERMAL_MODEL_FILE_Bind( file, mapping, size );
+
+          if ( status )
+          {
+            file->mappedSize = size;
+          }
+          else
+          {
+            munmap( mapping, size );
+          }
+        }
+      }
+
+      // the mapping keeps the file referenced
+      close( fd );
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Releases a handle, unmapping it if ASC_THERMAL_MODEL_FILE_Open
+ * mapped it. No thermal model may still select it.
+ * \param file The handle
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_FILE_Close( ASC_THERMAL_MODEL_FILE * file )
+{
+  bool status = false;
+
+  if ( file && file->image )
+  {
+    status = ( file->mappedSize == 0U ) ||
+             ( munmap( (void*)file->image, file->mappedSize ) == 0 );
+    memset( (char*)file, 0, sizeof( *file ) );
+  }
+
+  return status;
+}
+
+#else
+
+bool ASC_THERMAL_MODEL_FILE_Open( ASC_THERMAL_MODEL_FILE * file, const char * path )
+{
+  (void)file;
+  (void)path;
+
+  return false;
+}
+
+bool ASC_THERMAL_MODEL_FILE_Close( ASC_THERMAL_MODEL_FILE * file )
+{
+  bool status = false;
+
+  if ( file && file->image )
+  {
+    memset( (char*)file, 0, sizeof( *file ) );
+    status = true;
+  }
+
+  return status;
+}
+
+#endif
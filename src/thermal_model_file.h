@@ -0,0 +1,94 @@
+/**
+ * @file
+ * @brief Defines the binary thermal model file format and its zero copy
+ * loader
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_MODEL_FILE_H_
+#define _ASC_THERMAL_MODEL_FILE_H_
+
+#include "rk4solver.h"
+#include "thermal_model_state_space.h"
+#include "thermal_model_step_operator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define ASC_THERMAL_MODEL_FILE_HAS_MMAP 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASC_THERMAL_MODEL_FILE_MAGIC (0x4D435341UL) //!< "ASCM"
+#define ASC_THERMAL_MODEL_FILE_VERSION (1U)
+#define ASC_THERMAL_MODEL_FILE_NAME_LENGTH (32U)
+
+    /*!
+     * \brief One motor frame's model as stored in a file, in host byte order.
+     * All fields are 4 byte quantities, so the image is used in place
+     * wherever it is mapped or linked.
+     */
+    typedef struct
+    {
+        uint32_t magic; //!< ASC_THERMAL_MODEL_FILE_MAGIC, also rejects the other byte order
+        uint16_t version; //!< ASC_THERMAL_MODEL_FILE_VERSION
+        uint16_t numStates; //!< Must match ASC_THERMAL_MODEL_NUM_STATES
+        uint16_t numInputs; //!< Must match ASC_THERMAL_MODEL_NUM_INPUTS
+        uint16_t numOutputs; //!< Must match ASC_THERMAL_MODEL_NUM_OUTPUTS
+        uint32_t size; //!< sizeof( ASC_THERMAL_MODEL_FILE_IMAGE )
+        char name[ ASC_THERMAL_MODEL_FILE_NAME_LENGTH ]; //!< Motor frame, NUL terminated
+        float A[ ASC_THERMAL_MODEL_NUM_STATES ][ ASC_THERMAL_MODEL_NUM_STATES ];
+        float B[ ASC_THERMAL_MODEL_NUM_STATES ][ ASC_THERMAL_MODEL_NUM_INPUTS ];
+        float C[ ASC_THERMAL_MODEL_NUM_OUTPUTS ][ ASC_THERMAL_MODEL_NUM_STATES ];
+        float D[ ASC_THERMAL_MODEL_NUM_OUTPUTS ][ ASC_THERMAL_MODEL_NUM_INPUTS ];
+        ASC_THERMAL_MODEL_LOSS_CONSTANTS losses;
+        ASC_THERMAL_MODEL_RATINGS ratings;
+        float operatorStep; //!< Solver step periodOperator was built with
+        uint32_t operatorSteps; //!< Solver steps periodOperator covers
+        ASC_THERMAL_MODEL_STEP_OPERATOR periodOperator; //!< Precomputed estimator period
+        uint32_t crc; //!< CRC-32 of all preceding bytes
+    } ASC_THERMAL_MODEL_FILE_IMAGE;
+
+    /*!
+     * \brief A validated image and the solver configuration pointing into it.
+     * Any number of thermal models may share one.
+     */
+    typedef struct
+    {
+        const ASC_THERMAL_MODEL_FILE_IMAGE * image;
+        size_t mappedSize; //!< Length of the mapping owned by this handle, 0 when bound to caller memory
+        RK4SOLVER_CONFIGURATION config; //!< A, B, C and D of the image, read only
+    } ASC_THERMAL_MODEL_FILE;
+
+    extern bool ASC_THERMAL_MODEL_FILE_Build( ASC_THERMAL_MODEL_FILE_IMAGE * image,
+                                              const char * name,
+                                              const RK4SOLVER_CONFIGURATION * config,
+                                              const ASC_THERMAL_MODEL_LOSS_CONSTANTS * losses,
+                                              const ASC_THERMAL_MODEL_RATINGS * ratings,
+                                              float operatorStep,
+                                              uint32_t operatorSteps );
+    extern bool ASC_THERMAL_MODEL_FILE_Bind( ASC_THERMAL_MODEL_FILE * file, const void * data, size_t size );
+    extern bool ASC_THERMAL_MODEL_FILE_Open( ASC_THERMAL_MODEL_FILE * file, const char * path );
+    extern bool ASC_THERMAL_MODEL_FILE_Close( ASC_THERMAL_MODEL_FILE * file );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
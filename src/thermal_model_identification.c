@@ -0,0 +1,917 @@
+/**
+ * @file
+ * @brief Implements the identification of the thermal model parameters from
+ * logged current, speed and temperatures
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rk4solver.h"
+#include "thermal_model.h"
+#include "thermal_model_file.h"
+#include "thermal_model_identification.h"
+#include "thermal_model_state_space.h"
+#include "work_pool.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+#define MAX_PARAMS ASC_THERMAL_MODEL_IDENTIFICATION_MAX_PARAMS
+#define CANDIDATES ASC_THERMAL_MODEL_IDENTIFICATION_CANDIDATES
+#define AUGMENTED_STATES ( 2U * NUM_STATES )
+
+/* Damping of the first iteration and the bound past which the fit gives up */
+#define INITIAL_DAMPING (1e-3)
+#define MAX_DAMPING (1e12)
+
+/*!
+ * \brief What a parameter is
+ */
+typedef enum
+{
+  PARAM_A = 0,
+  PARAM_B,
+  PARAM_IRON_LOSS_EXPONENT,
+  PARAM_OTHER_LOSSES
+} PARAM_KIND;
+
+/*!
+ * \brief A fitted parameter, value = initial + scale * p, so every p starts
+ * at 0 and moves on the order of 1
+ */
+typedef struct
+{
+  PARAM_KIND kind;
+  uint32_t row; //!< A and B only
+  uint32_t column; //!< A and B only
+  float initial;
+  float scale;
+} PARAM;
+
+/*!
+ * \brief A parameter set and the map the solver applies per step with the
+ * input interpolated across the step,
+ *  x(n+1) = [M]*x(n) + [N0]*u(n) + [N1]*u(n+1)
+ */
+typedef struct
+{
+  double p[ MAX_PARAMS ];
+  float A[ NUM_STATES ][ NUM_STATES ];
+  float B[ NUM_STATES ][ NUM_INPUTS ];
+  ASC_THERMAL_MODEL_LOSS_CONSTANTS losses;
+  double M[ NUM_STATES ][ NUM_STATES ];
+  double N0[ NUM_STATES ][ NUM_INPUTS ];
+  double N1[ NUM_STATES ][ NUM_INPUTS ];
+  bool valid; //!< The step map was recorded
+} CANDIDATE;
+
+/*!
+ * \brief Derivatives of the step map by each parameter p
+ */
+typedef struct
+{
+  double M[ MAX_PARAMS ][ NUM_STATES ][ NUM_STATES ];
+  double N0[ MAX_PARAMS ][ NUM_STATES ][ NUM_INPUTS ];
+  double N1[ MAX_PARAMS ][ NUM_STATES ][ NUM_INPUTS ];
+} DERIVATIVES;
+
+typedef struct
+{
+  const ASC_THERMAL_MODEL_IDENTIFICATION_LOG * logs;
+  uint32_t numLogs;
+  float h;
+  const ASC_THERMAL_MODEL_FILE_IMAGE * model; //!< Initial values, C and D
+  uint32_t numParams;
+  PARAM params[ MAX_PARAMS ];
+  CANDIDATE current; //!< The accepted parameters
+  DERIVATIVES derivatives; //!< Of the accepted parameters
+  CANDIDATE candidates[ CANDIDATES ];
+  ASC_THERMAL_MODEL_IDENTIFICATION_TERMS sums; //!< Of all logs at the accepted parameters
+  ASC_THERMAL_MODEL_IDENTIFICATION_TERMS * terms;
+} PROBLEM;
+
+/*!
+ * \brief Lists the parameters to fit: every nonzero entry of A and B, so the
+ * structure of the network is kept, the iron loss exponent and the other
+ * losses. The remaining loss constants only scale a column of B, so they stay
+ * as they are and B absorbs their error.
+ * \note As this is a static function, there is no input validation
+ */
+static void _ListParams( PROBLEM * problem )
+{
+  const ASC_THERMAL_MODEL_FILE_IMAGE * model = problem->model;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  problem->numParams = 0U;
+
+  for ( i = 0U; i < NUM_STATES; i++ )
+  {
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      if ( model->A[ i ][ j ] != 0.0f )
+      {
+        PARAM param = { PARAM_A, i, j, model->A[ i ][ j ], fabsf( model->A[ i ][ j ] ) };
+
+        problem->params[ problem->numParams++ ] = param;
+      }
+    }
+
+    for ( j = 0U; j < NUM_INPUTS; j++ )
+    {
+      if ( model->B[ i ][ j ] != 0.0f )
+      {
+        PARAM param = { PARAM_B, i, j, model->B[ i ][ j ], fabsf( model->B[ i ][ j ] ) };
+
+        problem->params[ problem->numParams++ ] = param;
+      }
+    }
+  }
+
+  if ( model->losses.ironLossCoefficient != 0.0f )
+  {
+    PARAM param = { PARAM_IRON_LOSS_EXPONENT, 0U, 0U, model->losses.ironLossExponent, 1.0f };
+
+    problem->params[ problem->numParams++ ] = param;
+  }
+
+  {
+    PARAM param = { PARAM_OTHER_LOSSES, 0U, 0U, model->losses.otherLosses,
+                    ( model->losses.otherLosses != 0.0f ) ? fabsf( model->losses.otherLosses ) : 1.0f };
+
+    problem->params[ problem->numParams++ ] = param;
+  }
+}
+
+/*!
+ * \brief Sets a candidate's model from its parameters and records the step
+ * map by probing the solver with unit states and inputs
+ * \return success
+ * \note As this is a static function, there is no input validation
+ */
+static bool _Apply( const PROBLEM * problem, CANDIDATE * candidate )
+{
+  const ASC_THERMAL_MODEL_FILE_IMAGE * model = problem->model;
+  RK4SOLVER_CONFIGURATION config =
+    { NUM_STATES, NUM_INPUTS, NUM_OUTPUTS,
+      &candidate->A[ 0 ][ 0 ], &candidate->B[ 0 ][ 0 ], &model->C[ 0 ][ 0 ], &model->D[ 0 ][ 0 ],
+      (const RK4SOLVER_PACKED*)0 };
+  float workspace[ RK4SOLVER_WORKSPACE_LENGTH( NUM_STATES, NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+  float state[ NUM_STATES ];
+  float outputs[ NUM_OUTPUTS ];
+  float currentInput[ NUM_INPUTS ];
+  float nextInput[ NUM_INPUTS ];
+  RK4SOLVER_INPUT solverInputs = { problem->h, state, currentInput, nextInput, workspace };
+  RK4SOLVER_OUTPUT solverOutputs = { state, outputs };
+  bool status = true;
+  uint32_t k = 0U;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  memcpy( (char*)candidate->A, (char*)model->A, sizeof( candidate->A ) );
+  memcpy( (char*)candidate->B, (char*)model->B, sizeof( candidate->B ) );
+  candidate->losses = model->losses;
+
+  for ( k = 0U; k < problem->numParams; k++ )
+  {
+    const PARAM * param = &problem->params[ k ];
+    float value = param->initial + ( param->scale * (float)candidate->p[ k ] );
+
+    switch ( param->kind )
+    {
+      case PARAM_A:
+        candidate->A[ param->row ][ param->column ] = value;
+        break;
+      case PARAM_B:
+        candidate->B[ param->row ][ param->column ] = value;
+        break;
+      case PARAM_IRON_LOSS_EXPONENT:
+        candidate->losses.ironLossExponent = value;
+        break;
+      default:
+        candidate->losses.otherLosses = value;
+        break;
+    }
+  }
+
+  // a unit state gives a column of M, a unit input at either end of the step
+  // a column of N0 or N1
+  for ( j = 0U; ( j < ( NUM_STATES + ( 2U * NUM_INPUTS ) ) ) && status; j++ )
+  {
+    memset( (char*)state, 0, sizeof( state ) );
+    memset( (char*)currentInput, 0, sizeof( currentInput ) );
+    memset( (char*)nextInput, 0, sizeof( nextInput ) );
+
+    if ( j < NUM_STATES )
+    {
+      state[ j ] = 1.0f;
+    }
+    else if ( j < ( NUM_STATES + NUM_INPUTS ) )
+    {
+      currentInput[ j - NUM_STATES ] = 1.0f;
+    }
+    else
+    {
+      nextInput[ j - NUM_STATES - NUM_INPUTS ] = 1.0f;
+    }
+
+    status = ( RK4SOLVER_Solve( &config, &solverInputs, &solverOutputs ) == 1U );
+
+    for ( i = 0U; i < NUM_STATES; i++ )
+    {
+      if ( j < NUM_STATES )
+      {
+        candidate->M[ i ][ j ] = (double)state[ i ];
+      }
+      else if ( j < ( NUM_STATES + NUM_INPUTS ) )
+      {
+        candidate->N0[ i ][ j - NUM_STATES ] = (double)state[ i ];
+      }
+      else
+      {
+        candidate->N1[ i ][ j - NUM_STATES - NUM_INPUTS ] = (double)state[ i ];
+      }
+    }
+  }
+
+  candidate->valid = status;
+
+  return status;
+}
+
+/*!
+ * \brief Derivatives of the step map by the A and B parameters. The solver
+ * runs the model together with its tangent,
+ *  d/dt [x; s] = [A 0; dA A]*[x; s] + [B; dB]*u
+ * so the probes return exactly the derivative of the solver's own step, not
+ * of the continuous model.
+ * \return success
+ * \note As this is a static function, there is no input validation
+ */
+static bool _Differentiate( PROBLEM * problem )
+{
+  const CANDIDATE * candidate = &problem->current;
+  float A[ AUGMENTED_STATES ][ AUGMENTED_STATES ];
+  float B[ AUGMENTED_STATES ][ NUM_INPUTS ];
+  float C[ AUGMENTED_STATES ] = { 0.0f };
+  float D[ NUM_INPUTS ] = { 0.0f };
+  RK4SOLVER_CONFIGURATION config =
+    { AUGMENTED_STATES, NUM_INPUTS, 1U, &A[ 0 ][ 0 ], &B[ 0 ][ 0 ], C, D, (const RK4SOLVER_PACKED*)0 };
+  float workspace[ RK4SOLVER_WORKSPACE_LENGTH( AUGMENTED_STATES, NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+  float state[ AUGMENTED_STATES ];
+  float output = 0.0f;
+  float currentInput[ NUM_INPUTS ];
+  float nextInput[ NUM_INPUTS ];
+  RK4SOLVER_INPUT solverInputs = { problem->h, state, currentInput, nextInput, workspace };
+  RK4SOLVER_OUTPUT solverOutputs = { state, &output };
+  bool status = true;
+  uint32_t k = 0U;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  memset( (char*)&problem->derivatives, 0, sizeof( problem->derivatives ) );
+
+  for ( k = 0U; ( k < problem->numParams ) && status; k++ )
+  {
+    const PARAM * param = &problem->params[ k ];
+
+    // the loss constants only move the inputs
+    if ( ( param->kind != PARAM_A ) && ( param->kind != PARAM_B ) )
+    {
+      continue;
+    }
+
+    memset( (char*)A, 0, sizeof( A ) );
+    memset( (char*)B, 0, sizeof( B ) );
+
+    for ( i = 0U; i < NUM_STATES; i++ )
+    {
+      for ( j = 0U; j < NUM_STATES; j++ )
+      {
+        A[ i ][ j ] = candidate->A[ i ][ j ];
+        A[ NUM_STATES + i ][ NUM_STATES + j ] = candidate->A[ i ][ j ];
+      }
+
+      for ( j = 0U; j < NUM_INPUTS; j++ )
+      {
+        B[ i ][ j ] = candidate->B[ i ][ j ];
+      }
+    }
+
+    if ( param->kind == PARAM_A )
+    {
+      A[ NUM_STATES + param->row ][ param->column ] = param->scale;
+    }
+    else
+    {
+      B[ NUM_STATES + param->row ][ param->column ] = param->scale;
+    }
+
+    for ( j = 0U; ( j < ( NUM_STATES + ( 2U * NUM_INPUTS ) ) ) && status; j++ )
+    {
+      memset( (char*)state, 0, sizeof( state ) );
+      memset( (char*)currentInput, 0, sizeof( currentInput ) );
+      memset( (char*)nextInput, 0, sizeof( nextInput ) );
+
+      if ( j < NUM_STATES )
+      {
+        state[ j ] = 1.0f;
+      }
+      else if ( j < ( NUM_STATES + NUM_INPUTS ) )
+      {
+        currentInput[ j - NUM_STATES ] = 1.0f;
+      }
+      else
+      {
+        nextInput[ j - NUM_STATES - NUM_INPUTS ] = 1.0f;
+      }
+
+      status = ( RK4SOLVER_Solve( &config, &solverInputs, &solverOutputs ) == 1U );
+
+      for ( i = 0U; i < NUM_STATES; i++ )
+      {
+        if ( j < NUM_STATES )
+        {
+          problem->derivatives.M[ k ][ i ][ j ] = (double)state[ NUM_STATES + i ];
+        }
+        else if ( j < ( NUM_STATES + NUM_INPUTS ) )
+        {
+          problem->derivatives.N0[ k ][ i ][ j - NUM_STATES ] = (double)state[ NUM_STATES + i ];
+        }
+        else
+        {
+          problem->derivatives.N1[ k ][ i ][ j - NUM_STATES - NUM_INPUTS ] = (double)state[ NUM_STATES + i ];
+        }
+      }
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Heat source inputs of one sample and their derivatives by the loss
+ * parameters, those of ASC_THERMAL_MODEL_CalculateLossInputs: the iron loss
+ * k*w^e moves by k*w^e*ln(w) per unit exponent, the other losses add to the
+ * drive input one to one
+ * \param inputs [out] NUM_INPUTS
+ * \param sensitivity [out] MAX_PARAMS x NUM_INPUTS, loss parameters only,
+ * null for none
+ * \note As this is a static function, there is no input validation
+ */
+static void _Inputs( const PROBLEM * problem,
+                     const CANDIDATE * candidate,
+                     const ASC_THERMAL_MODEL_IDENTIFICATION_LOG * record,
+                     uint32_t sample,
+                     double * inputs,
+                     double (*sensitivity)[ NUM_INPUTS ] )
+{
+  float speed = fabsf( record->speed[ sample ] );
+  float values[ NUM_INPUTS ];
+  uint32_t k = 0U;
+  uint32_t j = 0U;
+
+  ASC_THERMAL_MODEL_CalculateLossInputs( &candidate->losses, values, record->current[ sample ], speed );
+
+  for ( j = 0U; j < NUM_INPUTS; j++ )
+  {
+    inputs[ j ] = (double)values[ j ];
+  }
+
+  for ( k = 0U; sensitivity && ( k < problem->numParams ); k++ )
+  {
+    if ( problem->params[ k ].kind == PARAM_IRON_LOSS_EXPONENT )
+    {
+      sensitivity[ k ][ 0 ] = ( speed > 0.0f ) ?
+        ( (double)values[ 0 ] * log( (double)speed ) * (double)problem->params[ k ].scale ) : 0.0;
+    }
+    else if ( problem->params[ k ].kind == PARAM_OTHER_LOSSES )
+    {
+      sensitivity[ k ][ 2 ] = (double)problem->params[ k ].scale;
+    }
+  }
+}
+
+/*!
+ * \brief y += [M]*x for a small row major matrix
+ * \note As this is a static function, there is no input validation
+ */
+static void _MatVec( const double * M, uint32_t rows, uint32_t columns, const double * x, double * y )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < rows; i++ )
+  {
+    for ( j = 0U; j < columns; j++ )
+    {
+      y[ i ] += M[ ( i * columns ) + j ] * x[ j ];
+    }
+  }
+}
+
+/*!
+ * \brief Simulates one log with a candidate from a zero state and sums the
+ * squared residuals, and with derivatives also J' * r and J' * J through the
+ * forward sensitivities of the state
+ * \param derivatives Of the candidate's step map, null for the cost alone
+ * \note As this is a static function, there is no input validation
+ */
+static void _Simulate( const PROBLEM * problem,
+                       const CANDIDATE * candidate,
+                       const DERIVATIVES * derivatives,
+                       const ASC_THERMAL_MODEL_IDENTIFICATION_LOG * record,
+                       ASC_THERMAL_MODEL_IDENTIFICATION_TERMS * terms )
+{
+  const ASC_THERMAL_MODEL_FILE_IMAGE * model = problem->model;
+  uint32_t numParams = derivatives ? problem->numParams : 0U;
+  double state[ NUM_STATES ] = { 0.0 };
+  double nextState[ NUM_STATES ];
+  double currentInput[ NUM_INPUTS ];
+  double nextInput[ NUM_INPUTS ];
+  double sensitivity[ MAX_PARAMS ][ NUM_STATES ];
+  double nextSensitivity[ MAX_PARAMS ][ NUM_STATES ];
+  double currentInputSensitivity[ MAX_PARAMS ][ NUM_INPUTS ];
+  double nextInputSensitivity[ MAX_PARAMS ][ NUM_INPUTS ];
+  double gradient[ MAX_PARAMS ];
+  uint32_t stateTerms[ NUM_OUTPUTS ][ NUM_STATES ];
+  uint32_t inputTerms[ NUM_OUTPUTS ][ NUM_INPUTS ];
+  uint32_t numStateTerms[ NUM_OUTPUTS ] = { 0U };
+  uint32_t numInputTerms[ NUM_OUTPUTS ] = { 0U };
+  uint32_t numMatrixParams = 0U;
+  uint32_t n = 0U;
+  uint32_t k = 0U;
+  uint32_t l = 0U;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  memset( (char*)terms, 0, sizeof( *terms ) );
+  memset( (char*)sensitivity, 0, sizeof( sensitivity ) );
+  memset( (char*)currentInputSensitivity, 0, sizeof( currentInputSensitivity ) );
+  memset( (char*)nextInputSensitivity, 0, sizeof( nextInputSensitivity ) );
+
+  // A and B are listed first and leave the inputs alone
+  while ( ( numMatrixParams < numParams ) &&
+          ( ( problem->params[ numMatrixParams ].kind == PARAM_A ) || ( problem->params[ numMatrixParams ].kind == PARAM_B ) ) )
+  {
+    numMatrixParams++;
+  }
+
+  // C and D are mostly zeros, so every output keeps its nonzero terms
+  for ( i = 0U; i < NUM_OUTPUTS; i++ )
+  {
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      if ( model->C[ i ][ j ] != 0.0f )
+      {
+        stateTerms[ i ][ numStateTerms[ i ]++ ] = j;
+      }
+    }
+
+    for ( j = 0U; j < NUM_INPUTS; j++ )
+    {
+      if ( model->D[ i ][ j ] != 0.0f )
+      {
+        inputTerms[ i ][ numInputTerms[ i ]++ ] = j;
+      }
+    }
+  }
+
+  if ( record->count > 0U )
+  {
+    _Inputs( problem, candidate, record, 0U, currentInput, derivatives ? currentInputSensitivity : (double(*)[ NUM_INPUTS ])0 );
+  }
+
+  for ( n = 0U; ( n + 1U ) < record->count; n++ )
+  {
+    const float * measured = &record->measured[ ( n + 1U ) * NUM_OUTPUTS ];
+
+    _Inputs( problem, candidate, record, n + 1U, nextInput, derivatives ? nextInputSensitivity : (double(*)[ NUM_INPUTS ])0 );
+
+    memset( (char*)nextState, 0, sizeof( nextState ) );
+    _MatVec( &candidate->M[ 0 ][ 0 ], NUM_STATES, NUM_STATES, state, nextState );
+    _MatVec( &candidate->N0[ 0 ][ 0 ], NUM_STATES, NUM_INPUTS, currentInput, nextState );
+    _MatVec( &candidate->N1[ 0 ][ 0 ], NUM_STATES, NUM_INPUTS, nextInput, nextState );
+
+    // s(n+1) = M*s + dM*x + dN0*u(n) + dN1*u(n+1) + N0*du(n) + N1*du(n+1)
+    for ( k = 0U; k < numMatrixParams; k++ )
+    {
+      memset( (char*)nextSensitivity[ k ], 0, sizeof( nextSensitivity[ k ] ) );
+      _MatVec( &candidate->M[ 0 ][ 0 ], NUM_STATES, NUM_STATES, sensitivity[ k ], nextSensitivity[ k ] );
+      _MatVec( &derivatives->M[ k ][ 0 ][ 0 ], NUM_STATES, NUM_STATES, state, nextSensitivity[ k ] );
+      _MatVec( &derivatives->N0[ k ][ 0 ][ 0 ], NUM_STATES, NUM_INPUTS, currentInput, nextSensitivity[ k ] );
+      _MatVec( &derivatives->N1[ k ][ 0 ][ 0 ], NUM_STATES, NUM_INPUTS, nextInput, nextSensitivity[ k ] );
+    }
+
+    for ( k = numMatrixParams; k < numParams; k++ )
+    {
+      memset( (char*)nextSensitivity[ k ], 0, sizeof( nextSensitivity[ k ] ) );
+      _MatVec( &candidate->M[ 0 ][ 0 ], NUM_STATES, NUM_STATES, sensitivity[ k ], nextSensitivity[ k ] );
+      _MatVec( &candidate->N0[ 0 ][ 0 ], NUM_STATES, NUM_INPUTS, currentInputSensitivity[ k ], nextSensitivity[ k ] );
+      _MatVec( &candidate->N1[ 0 ][ 0 ], NUM_STATES, NUM_INPUTS, nextInputSensitivity[ k ], nextSensitivity[ k ] );
+    }
+
+    // y(n+1) = C*x(n+1) + D*u(n+1), against the logged outputs
+    for ( i = 0U; ( i < NUM_OUTPUTS ) && ( ( n + 1U ) >= record->skip ); i++ )
+    {
+      if ( !isnan( measured[ i ] ) )
+      {
+        double output = 0.0;
+        double residual = 0.0;
+
+        for ( j = 0U; j < numStateTerms[ i ]; j++ )
+        {
+          output += (double)model->C[ i ][ stateTerms[ i ][ j ] ] * nextState[ stateTerms[ i ][ j ] ];
+        }
+
+        for ( j = 0U; j < numInputTerms[ i ]; j++ )
+        {
+          output += (double)model->D[ i ][ inputTerms[ i ][ j ] ] * nextInput[ inputTerms[ i ][ j ] ];
+        }
+
+        residual = (double)measured[ i ] - output;
+        terms->cost += residual * residual;
+        terms->numResiduals++;
+
+        for ( k = 0U; k < numParams; k++ )
+        {
+          gradient[ k ] = 0.0;
+
+          for ( j = 0U; j < numStateTerms[ i ]; j++ )
+          {
+            gradient[ k ] += (double)model->C[ i ][ stateTerms[ i ][ j ] ] * nextSensitivity[ k ][ stateTerms[ i ][ j ] ];
+          }
+
+          for ( j = 0U; ( j < numInputTerms[ i ] ) && ( k >= numMatrixParams ); j++ )
+          {
+            gradient[ k ] += (double)model->D[ i ][ inputTerms[ i ][ j ] ] * nextInputSensitivity[ k ][ inputTerms[ i ][ j ] ];
+          }
+
+          terms->gradient[ k ] += gradient[ k ] * residual;
+
+          for ( l = 0U; l <= k; l++ )
+          {
+            terms->hessian[ l ][ k ] += gradient[ l ] * gradient[ k ];
+          }
+        }
+      }
+    }
+
+    memcpy( (char*)state, (char*)nextState, sizeof( state ) );
+    memcpy( (char*)currentInput, (char*)nextInput, sizeof( currentInput ) );
+    memcpy( (char*)sensitivity, (char*)nextSensitivity, numParams * sizeof( sensitivity[ 0 ] ) );
+    memcpy( (char*)currentInputSensitivity, (char*)nextInputSensitivity, numParams * sizeof( currentInputSensitivity[ 0 ] ) );
+  }
+}
+
+/*!
+ * \brief Work pool task, cost and derivative sums of the accepted parameters
+ * over the logs [begin, end)
+ */
+static void _GradientTask( void * context, uint32_t begin, uint32_t end, uint32_t worker )
+{
+  PROBLEM * problem = (PROBLEM*)context;
+  uint32_t index = 0U;
+
+  (void)worker;
+
+  for ( index = begin; index < end; index++ )
+  {
+    _Simulate( problem, &problem->current, &problem->derivatives, &problem->logs[ index ], &problem->terms[ index ] );
+  }
+}
+
+/*!
+ * \brief Work pool task, cost of every candidate over every log, the items
+ * [begin, end) of candidate-major pairs
+ */
+static void _CostTask( void * context, uint32_t begin, uint32_t end, uint32_t worker )
+{
+  PROBLEM * problem = (PROBLEM*)context;
+  uint32_t index = 0U;
+
+  (void)worker;
+
+  for ( index = begin; index < end; index++ )
+  {
+    const CANDIDATE * candidate = &problem->candidates[ index / problem->numLogs ];
+
+    if ( candidate->valid )
+    {
+      _Simulate( problem, candidate, (const DERIVATIVES*)0, &problem->logs[ index % problem->numLogs ], &problem->terms[ index ] );
+    }
+  }
+}
+
+/*!
+ * \brief Solves [M]*x = b in place for a symmetric positive definite [M] by
+ * its Cholesky factor [L]*[L]'. Only the lower triangle of [M] is read.
+ * \param M [in,out] n x n row major, its lower triangle becomes [L]
+ * \param b [in,out] n elements, becomes x
+ * \return success
+ * \retval false [M] is not numerically positive definite
+ * \note As this is a static function, there is no input validation
+ */
+static bool _CholeskySolve( double * M, uint32_t n, double * b )
+{
+  bool status = true;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+  uint32_t k = 0U;
+
+  for ( j = 0U; ( j < n ) && status; j++ )
+  {
+    double pivot = M[ ( j * n ) + j ];
+
+    for ( k = 0U; k < j; k++ )
+    {
+      pivot -= M[ ( j * n ) + k ] * M[ ( j * n ) + k ];
+    }
+
+    status = ( pivot > 0.0 );
+
+    if ( status )
+    {
+      M[ ( j * n ) + j ] = sqrt( pivot );
+
+      for ( i = j + 1U; i < n; i++ )
+      {
+        double sum = M[ ( i * n ) + j ];
+
+        for ( k = 0U; k < j; k++ )
+        {
+          sum -= M[ ( i * n ) + k ] * M[ ( j * n ) + k ];
+        }
+
+        M[ ( i * n ) + j ] = sum / M[ ( j * n ) + j ];
+      }
+    }
+  }
+
+  // [L]*y = b, then [L]'*x = y
+  for ( i = 0U; ( i < n ) && status; i++ )
+  {
+    for ( k = 0U; k < i; k++ )
+    {
+      b[ i ] -= M[ ( i * n ) + k ] * b[ k ];
+    }
+
+    b[ i ] /= M[ ( i * n ) + i ];
+  }
+
+  for ( i = n; ( i > 0U ) && status; i-- )
+  {
+    for ( k = i; k < n; k++ )
+    {
+      b[ i - 1U ] -= M[ ( k * n ) + i - 1U ] * b[ k ];
+    }
+
+    b[ i - 1U ] /= M[ ( ( i - 1U ) * n ) + i - 1U ];
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Solves the damped normal equations for a step,
+ *  ( J'J + damping * diag( J'J ) ) * step = J' * r
+ * The system is symmetric positive definite and, for the parameters of an RC
+ * network, badly conditioned, so it is solved in double like it is summed.
+ * \return success
+ * \note As this is a static function, there is no input validation
+ */
+static bool _Step( const ASC_THERMAL_MODEL_IDENTIFICATION_TERMS * sums,
+                   uint32_t numParams,
+                   double damping,
+                   double * step )
+{
+  double matrix[ MAX_PARAMS * MAX_PARAMS ];
+  bool status = false;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < numParams; i++ )
+  {
+    for ( j = 0U; j < i; j++ )
+    {
+      matrix[ ( i * numParams ) + j ] = sums->hessian[ j ][ i ];
+    }
+
+    // a parameter the logs do not see still gets a damped, finite step
+    matrix[ ( i * numParams ) + i ] = sums->hessian[ i ][ i ] * ( 1.0 + damping ) + 1e-12;
+    step[ i ] = sums->gradient[ i ];
+  }
+
+  status = _CholeskySolve( matrix, numParams, step );
+
+  for ( i = 0U; ( i < numParams ) && status; i++ )
+  {
+    status = isfinite( step[ i ] );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Fits the nonzero entries of A and B, the iron loss exponent and the
+ * other losses of a model to logs by Levenberg-Marquardt. Every iteration
+ * takes the exact gradient of the solver's output by forward sensitivities,
+ * one pass per log run in parallel, then tries
+ * ASC_THERMAL_MODEL_IDENTIFICATION_CANDIDATES damping factors at once, every
+ * candidate and log pair in parallel, and keeps the best. The solver's step is
+ * applied as a precomputed map per parameter set, so a pass costs a few
+ * dozen multiplies per sample and sensitivity.
+ * \param pool Work pool for the passes
+ * \param logs Logs sampled every options->h, each starting at ambient
+ * \param numLogs Number of logs
+ * \param options Step, iteration limit of at least 1 and stopping tolerance
+ * \param terms Workspace, numLogs * ASC_THERMAL_MODEL_IDENTIFICATION_CANDIDATES
+ * entries
+ * \param model [in,out] The initial model, e.g. the compiled in one built with
+ * ASC_THERMAL_MODEL_FILE_Build, replaced by the fitted model rebuilt with its
+ * name, C, D, ratings and operator step. The overload and rated inputs of the
+ * ratings move with the other losses; the iron loss part is kept as the
+ * ratings do not record the speed.
+ * \param report [out] What the fit did
+ * \return success, the model is unchanged on failure
+ */
+bool ASC_THERMAL_MODEL_IDENTIFICATION_Fit( ASC_WORK_POOL * pool,
+                                           const ASC_THERMAL_MODEL_IDENTIFICATION_LOG * logs,
+                                           uint32_t numLogs,
+                                           const ASC_THERMAL_MODEL_IDENTIFICATION_OPTIONS * options,
+                                           ASC_THERMAL_MODEL_IDENTIFICATION_TERMS * terms,
+                                           ASC_THERMAL_MODEL_FILE_IMAGE * model,
+                                           ASC_THERMAL_MODEL_IDENTIFICATION_REPORT * report )
+{
+  static const double factors[ CANDIDATES ] = { 0.1, 1.0, 10.0, 100.0 };
+  PROBLEM problem;
+  ASC_THERMAL_MODEL_FILE_IMAGE initial;
+  bool status = false;
+
+  if ( pool && logs && ( numLogs > 0U ) && options && ( options->h > 0.0f ) && ( options->maxIterations > 0U ) && terms && model && report &&
+       ( model->numStates == NUM_STATES ) && ( model->numInputs == NUM_INPUTS ) &&
+       ( model->numOutputs == NUM_OUTPUTS ) )
+  {
+    ASC_THERMAL_MODEL_IDENTIFICATION_TERMS * sums = &problem.sums;
+    double damping = INITIAL_DAMPING;
+    double cost = 0.0;
+    bool converged = false;
+    uint32_t c = 0U;
+    uint32_t k = 0U;
+    uint32_t l = 0U;
+    uint32_t i = 0U;
+
+    initial = *model;
+    memset( (char*)&problem, 0, sizeof( problem ) );
+    memset( (char*)report, 0, sizeof( *report ) );
+    problem.logs = logs;
+    problem.numLogs = numLogs;
+    problem.h = options->h;
+    problem.model = &initial;
+    problem.terms = terms;
+    _ListParams( &problem );
+    report->numParams = problem.numParams;
+    status = _Apply( &problem, &problem.current );
+
+    while ( status && !converged && ( report->iterations < options->maxIterations ) )
+    {
+      double best = 0.0;
+      uint32_t bestCandidate = CANDIDATES;
+
+      status = _Differentiate( &problem );
+
+      if ( status )
+      {
+        ASC_WORK_POOL_ParallelFor( pool, numLogs, 1U, _GradientTask, (void*)&problem );
+
+        // summed in log order, so a fit is repeatable whatever the workers do
+        *sums = terms[ 0 ];
+
+        for ( l = 1U; l < numLogs; l++ )
+        {
+          sums->cost += terms[ l ].cost;
+          sums->numResiduals += terms[ l ].numResiduals;
+
+          for ( k = 0U; k < problem.numParams; k++ )
+          {
+            sums->gradient[ k ] += terms[ l ].gradient[ k ];
+
+            for ( i = k; i < problem.numParams; i++ )
+            {
+              sums->hessian[ k ][ i ] += terms[ l ].hessian[ k ][ i ];
+            }
+          }
+        }
+
+        cost = sums->cost;
+        report->iterations++;
+        status = isfinite( cost ) && ( sums->numResiduals > 0U );
+
+        if ( report->iterations == 1U )
+        {
+          report->numResiduals = sums->numResiduals;
+          report->initialRms = (float)sqrt( cost / (double)sums->numResiduals );
+        }
+      }
+
+      // the candidates, raising the damping until one of them improves
+      while ( status && ( bestCandidate == CANDIDATES ) && !converged )
+      {
+        uint32_t numCandidates = 0U;
+        double step[ MAX_PARAMS ];
+
+        for ( c = 0U; c < CANDIDATES; c++ )
+        {
+          problem.candidates[ c ].valid = false;
+
+          if ( _Step( sums, problem.numParams, damping * factors[ c ], step ) )
+          {
+            for ( k = 0U; k < problem.numParams; k++ )
+            {
+              problem.candidates[ c ].p[ k ] = problem.current.p[ k ] + step[ k ];
+            }
+
+            (void)_Apply( &problem, &problem.candidates[ c ] );
+          }
+
+          numCandidates += problem.candidates[ c ].valid ? 1U : 0U;
+        }
+
+        if ( numCandidates > 0U )
+        {
+          ASC_WORK_POOL_ParallelFor( pool, CANDIDATES * numLogs, 1U, _CostTask, (void*)&problem );
+          report->evaluations += numCandidates;
+        }
+
+        for ( c = 0U; c < CANDIDATES; c++ )
+        {
+          double candidateCost = 0.0;
+
+          for ( l = 0U; l < numLogs; l++ )
+          {
+            candidateCost += terms[ ( c * numLogs ) + l ].cost;
+          }
+
+          // an unstable or failed candidate has a cost of NaN or inf and loses
+          if ( problem.candidates[ c ].valid && ( candidateCost < cost ) &&
+               ( ( bestCandidate == CANDIDATES ) || ( candidateCost < best ) ) )
+          {
+            best = candidateCost;
+            bestCandidate = c;
+          }
+        }
+
+        if ( bestCandidate < CANDIDATES )
+        {
+          problem.current = problem.candidates[ bestCandidate ];
+          damping *= factors[ bestCandidate ];
+          converged = ( ( cost - best ) < ( (double)options->tolerance * cost ) );
+          cost = best;
+        }
+        else
+        {
+          damping *= 1000.0;
+          converged = ( damping > MAX_DAMPING );
+        }
+      }
+    }
+
+    if ( status )
+    {
+      RK4SOLVER_CONFIGURATION config =
+        { NUM_STATES, NUM_INPUTS, NUM_OUTPUTS,
+          &problem.current.A[ 0 ][ 0 ], &problem.current.B[ 0 ][ 0 ], &initial.C[ 0 ][ 0 ], &initial.D[ 0 ][ 0 ],
+          (const RK4SOLVER_PACKED*)0 };
+      ASC_THERMAL_MODEL_RATINGS ratings = initial.ratings;
+      float shift = problem.current.losses.otherLosses - initial.losses.otherLosses;
+
+      ratings.overloadInputs[ 2 ] += shift;
+      ratings.ratedInputs[ 2 ] += shift;
+      report->finalRms = (float)sqrt( cost / (double)report->numResiduals );
+      status = ASC_THERMAL_MODEL_FILE_Build( model, initial.name, &config, &problem.current.losses, &ratings,
+                                             initial.operatorStep, initial.operatorSteps );
+
+      if ( !status )
+      {
+        *model = initial;
+      }
+    }
+  }
+
+  return status;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file
+ * @brief Defines the interface to the identification of the thermal model
+ * parameters from logged current, speed and temperatures
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_MODEL_IDENTIFICATION_H_
+#define _ASC_THERMAL_MODEL_IDENTIFICATION_H_
+
+#include "thermal_model_file.h"
+#include "thermal_model_state_space.h"
+#include "work_pool.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Every entry of A and B, the iron loss exponent and the other losses */
+#define ASC_THERMAL_MODEL_IDENTIFICATION_MAX_PARAMS \
+    ( ( ASC_THERMAL_MODEL_NUM_STATES * ASC_THERMAL_MODEL_NUM_STATES ) + \
+      ( ASC_THERMAL_MODEL_NUM_STATES * ASC_THERMAL_MODEL_NUM_INPUTS ) + 2U )
+/* Damping factors tried side by side in every iteration */
+#define ASC_THERMAL_MODEL_IDENTIFICATION_CANDIDATES (4U)
+
+    /*!
+     * \brief One log, sampled every step, starting with the motor at ambient
+     */
+    typedef struct
+    {
+        const float * current; //!< count drive currents in A
+        const float * speed; //!< count rotational speeds in rad/s
+        const float * measured; //!< count x ASC_THERMAL_MODEL_NUM_OUTPUTS temperatures in K above ambient, NaN where not logged
+        uint32_t count; //!< Samples
+        uint32_t skip; //!< Samples at the start left out of the fit, e.g. while a start above ambient decays
+    } ASC_THERMAL_MODEL_IDENTIFICATION_LOG;
+
+    /*!
+     * \brief Sums of one log at one parameter set, see
+     * ASC_THERMAL_MODEL_IDENTIFICATION_Fit
+     */
+    typedef struct
+    {
+        double cost; //!< Sum of squared residuals in K^2
+        uint32_t numResiduals;
+        double gradient[ ASC_THERMAL_MODEL_IDENTIFICATION_MAX_PARAMS ]; //!< J' * r
+        double hessian[ ASC_THERMAL_MODEL_IDENTIFICATION_MAX_PARAMS ][ ASC_THERMAL_MODEL_IDENTIFICATION_MAX_PARAMS ]; //!< J' * J, upper triangle
+    } ASC_THERMAL_MODEL_IDENTIFICATION_TERMS;
+
+    typedef struct
+    {
+        float h; //!< Sample interval and solver step in s
+        uint32_t maxIterations;
+        float tolerance; //!< Stop once an iteration lowers the cost by less than this fraction
+    } ASC_THERMAL_MODEL_IDENTIFICATION_OPTIONS;
+
+    typedef struct
+    {
+        uint32_t numParams; //!< Parameters fitted
+        uint32_t numResiduals; //!< Logged temperatures compared
+        uint32_t iterations; //!< Gradient evaluations
+        uint32_t evaluations; //!< Cost evaluations of candidates
+        float initialRms; //!< Residual at the start in K
+        float finalRms; //!< Residual of the fitted model in K
+    } ASC_THERMAL_MODEL_IDENTIFICATION_REPORT;
+
+    extern bool ASC_THERMAL_MODEL_IDENTIFICATION_Fit( ASC_WORK_POOL * pool,
+                                                      const ASC_THERMAL_MODEL_IDENTIFICATION_LOG * logs,
+                                                      uint32_t numLogs,
+                                                      const ASC_THERMAL_MODEL_IDENTIFICATION_OPTIONS * options,
+                                                      ASC_THERMAL_MODEL_IDENTIFICATION_TERMS * terms,
+                                                      ASC_THERMAL_MODEL_FILE_IMAGE * model,
+                                                      ASC_THERMAL_MODEL_IDENTIFICATION_REPORT * report );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
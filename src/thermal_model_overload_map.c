@@ -0,0 +1,212 @@
+/**
+ * @file
+ * @brief Definition and implementation of the overload capability map, the
+ * overload predictor evaluated for many overload levels and durations at once
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rk4solver.h"
+#include "thermal_model_overload_map.h"
+#include "thermal_model_overload_predictor.h"
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+#define MAX_STEPS ASC_THERMAL_MODEL_OVERLOAD_MAP_MAX_STEPS
+
+/* The map is built at setup time and evaluated from the background task, so
+ * the scratch lives in static storage. Neither is reentrant.
+ */
+static float _state[ NUM_STATES ];
+static float _zeroInput[ NUM_INPUTS ];
+static float _unitInput[ NUM_INPUTS ];
+static float _output[ NUM_OUTPUTS ];
+static float _workspace[ RK4SOLVER_WORKSPACE_LENGTH( NUM_STATES, NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+static float _free[ MAX_STEPS ][ NUM_OUTPUTS ];
+static float _forced[ MAX_STEPS ][ NUM_OUTPUTS ];
+static float _release[ MAX_STEPS ][ NUM_OUTPUTS ];
+
+/*!
+ * \brief Runs the predictor's solver for numSteps steps from _state and
+ * records the output after every step. The first step goes from firstInput to
+ * input, the rest hold input.
+ * \return success
+ * \note As this is a static function, there is no input validation
+ */
+static bool _Respond( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor,
+                      uint32_t numSteps,
+                      float * firstInput,
+                      float * input,
+                      float response[ MAX_STEPS ][ NUM_OUTPUTS ] )
+{
+  RK4SOLVER_INPUT solverInput = { predictor->h, _state, firstInput, input, _workspace };
+  RK4SOLVER_OUTPUT solverOutput = { _state, _output };
+  uint32_t itr = 0U;
+  bool status = true;
+
+  for ( itr = 0U; ( itr < numSteps ) && status; itr++ )
+  {
+    status = ( RK4SOLVER_Solve( predictor->stateSpaceConfig, &solverInput, &solverOutput ) == 1U );
+    memcpy( (char*)response[ itr ], (char*)_output, sizeof( _output ) );
+    solverInput.currentInput = input;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Records the unit responses of the predictor's solver. The model is
+ * linear so any overload profile's output is a weighted sum of them.
+ * \param map [out] The map to be built
+ * \param predictor A set up overload predictor, its h, periodCounts and
+ * configuration are used
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_OVERLOAD_MAP_Setup( ASC_THERMAL_MODEL_OVERLOAD_MAP * map,
+                                           ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor )
+{
+  bool status = false;
+
+  if ( map && predictor && predictor->stateSpaceConfig &&
+       ( predictor->periodCounts <= MAX_STEPS ) &&
+       ( predictor->stateSpaceConfig->numStates == NUM_STATES ) &&
+       ( predictor->stateSpaceConfig->numInputs == NUM_INPUTS ) &&
+       ( predictor->stateSpaceConfig->numOutputs == NUM_OUTPUTS ) )
+  {
+    uint32_t input = 0U;
+
+    memset( (char*)map, 0, sizeof( *map ) );
+    map->numSteps = predictor->periodCounts;
+    status = true;
+
+    for ( input = 0U; ( input < NUM_INPUTS ) && status; input++ )
+    {
+      memset( (char*)_unitInput, 0, sizeof( _unitInput ) );
+      memset( (char*)_zeroInput, 0, sizeof( _zeroInput ) );
+      _unitInput[ input ] = 1.0f;
+
+      memset( (char*)_state, 0, sizeof( _state ) );
+      status = _Respond( predictor, map->numSteps, _unitInput, _unitInput, map->stepResponse[ input ] );
+
+      memset( (char*)_state, 0, sizeof( _state ) );
+      status = status && _Respond( predictor, map->numSteps, _zeroInput, _unitInput, map->rampResponse[ input ] );
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Evaluates the overload predictor's profile, level for duration steps
+ * then the rated inputs until the end of the horizon, for every pair of level
+ * and duration from the predictor's initial state in one pass.
+ * The predictor holds the overload input through the step where it switches
+ * to rated, so with S and T the step and ramp responses the output after
+ * step k is
+ *  y(k) = free(k) + S(k)*level - [k >= d] * T(k-d)*( level - rated )
+ * The free response is computed once and each level costs one weighted sum
+ * of S and T, after which every duration only shifts T.
+ * \param map A map built by ASC_THERMAL_MODEL_OVERLOAD_MAP_Setup
+ * \param predictor The overload predictor supplying the initial state, rated
+ * inputs and thresholds
+ * \param levels numLevels heat source input vectors, row major
+ * \param numLevels Number of overload levels
+ * \param durations numDurations overload durations in predictor steps
+ * \param numDurations Number of durations
+ * \param allowed [out] numLevels x numDurations, row major, true where the
+ * peak temperatures stay within the thresholds
+ * \param maxDurations [out] numLevels, the longest allowed duration of each
+ * level, 0 if none is allowed. May be null.
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_OVERLOAD_MAP_Evaluate( const ASC_THERMAL_MODEL_OVERLOAD_MAP * map,
+                                              ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor,
+                                              const float * levels,
+                                              uint32_t numLevels,
+                                              const uint32_t * durations,
+                                              uint32_t numDurations,
+                                              bool * allowed,
+                                              uint32_t * maxDurations )
+{
+  bool status = false;
+
+  if ( map && predictor && predictor->stateSpaceConfig && levels && durations && allowed &&
+       ( map->numSteps > 0U ) )
+  {
+    uint32_t level = 0U;
+    uint32_t k = 0U;
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+
+    memcpy( (char*)_state, (char*)predictor->initialState, sizeof( _state ) );
+    memset( (char*)_zeroInput, 0, sizeof( _zeroInput ) );
+    status = _Respond( predictor, map->numSteps, _zeroInput, _zeroInput, _free );
+
+    for ( level = 0U; ( level < numLevels ) && status; level++ )
+    {
+      const float * inputs = &levels[ level * NUM_INPUTS ];
+      uint32_t duration = 0U;
+
+      for ( k = 0U; k < map->numSteps; k++ )
+      {
+        for ( i = 0U; i < NUM_OUTPUTS; i++ )
+        {
+          _forced[ k ][ i ] = _free[ k ][ i ];
+          _release[ k ][ i ] = 0.0f;
+
+          for ( j = 0U; j < NUM_INPUTS; j++ )
+          {
+            _forced[ k ][ i ] += map->stepResponse[ j ][ k ][ i ] * inputs[ j ];
+            _release[ k ][ i ] += map->rampResponse[ j ][ k ][ i ] * ( inputs[ j ] - predictor->ratedInputs[ j ] );
+          }
+        }
+      }
+
+      if ( maxDurations )
+      {
+        maxDurations[ level ] = 0U;
+      }
+
+      for ( duration = 0U; duration < numDurations; duration++ )
+      {
+        uint32_t d = durations[ duration ];
+        bool within = true;
+
+        for ( k = 0U; ( k < map->numSteps ) && within; k++ )
+        {
+          for ( i = 0U; i < NUM_OUTPUTS; i++ )
+          {
+            float y = _forced[ k ][ i ] - ( ( k >= d ) ? _release[ k - d ][ i ] : 0.0f );
+
+            within = within && ( y <= predictor->maxTempThresholds[ i ] );
+          }
+        }
+
+        allowed[ ( level * numDurations ) + duration ] = within;
+
+        if ( maxDurations && within && ( d > maxDurations[ level ] ) )
+        {
+          maxDurations[ level ] = d;
+        }
+      }
+    }
+  }
+
+  return status;
+}
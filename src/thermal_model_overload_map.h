@@ -0,0 +1,61 @@
+/** 
+ * @file
+ * @brief Defines the interface to the overload capability map, the overload
+ * predictor evaluated for many overload levels and durations at once
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_MODEL_OVERLOAD_MAP_H_
+#define _ASC_THERMAL_MODEL_OVERLOAD_MAP_H_
+
+#include "thermal_model_overload_predictor.h"
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Longest predictor horizon, in predictor steps, the map can be built for */
+#define ASC_THERMAL_MODEL_OVERLOAD_MAP_MAX_STEPS (60U)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /*!
+     * \brief Output responses of the overload predictor's solver to unit
+     * inputs from a zero state. Element [i][k] is the output after step k.
+     */
+    typedef struct
+    {
+        uint32_t numSteps; //!< The predictor horizon in steps
+        float stepResponse[ ASC_THERMAL_MODEL_NUM_INPUTS ][ ASC_THERMAL_MODEL_OVERLOAD_MAP_MAX_STEPS ][ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< Unit input i held from step 0
+        float rampResponse[ ASC_THERMAL_MODEL_NUM_INPUTS ][ ASC_THERMAL_MODEL_OVERLOAD_MAP_MAX_STEPS ][ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< Unit input i rising during step 0, then held
+    } ASC_THERMAL_MODEL_OVERLOAD_MAP;
+
+    extern bool ASC_THERMAL_MODEL_OVERLOAD_MAP_Setup( ASC_THERMAL_MODEL_OVERLOAD_MAP * map,
+                                                      ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor );
+    extern bool ASC_THERMAL_MODEL_OVERLOAD_MAP_Evaluate( const ASC_THERMAL_MODEL_OVERLOAD_MAP * map,
+                                                         ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor,
+                                                         const float * levels,
+                                                         uint32_t numLevels,
+                                                         const uint32_t * durations,
+                                                         uint32_t numDurations,
+                                                         bool * allowed,
+                                                         uint32_t * maxDurations );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,6 +22,7 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 /* Some embedded compilers are not 100% C99 compliant and the built-in fmaxf is
  * not in math.h. Also, including tgmath.h in this situation does not always
@@ -66,50 +67,196 @@ bool ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_IsOverloadAvailable( ASC_THERMAL_MODEL
 }
 
 /*!
- * \brief A background task that calculates the temperature and captures peaks
- * of the system based on 60s overload profile.
+ * \brief Sensitivities carried through the overload profile
+ */
+typedef struct
+{
+  RK4SOLVER_SENSITIVITY solver; //!< State, input and output sensitivities
+  float * overloadInputs; //!< numParams x numInputs, d(overloadInputs)/dp
+  float * ratedInputs; //!< numParams x numInputs, d(ratedInputs)/dp
+  float * peaks; //!< numParams x numOutputs, d(peak)/dp
+} PROFILE_SENSITIVITY;
+
+/*!
+ * \brief Integrates the overload profile from the solver's current state and
+ * captures the peak of every output
  * \param obj Thermal Model Overload Predictor Object
+ * \param solverInputs Solver input, its state is advanced to the end of the
+ * horizon
+ * \param solverOutputs Solver output
+ * \param peaks [in,out] Peaks, only raised
+ * \param sensitivity Optional, carried along and sampled where each peak is
+ * raised, null for the plain prediction
+ * \return success
+ * \note As this is a static function, there is no input validation
  */
-void ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_BackgroundTask( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj )
+static bool _runProfile( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj,
+                         RK4SOLVER_INPUT * solverInputs,
+                         RK4SOLVER_OUTPUT * solverOutputs,
+                         float * peaks,
+                         PROFILE_SENSITIVITY * sensitivity )
 {
-  if ( obj )
+  bool status = true;
+  float t = solverInputs->h;
+  uint32_t itr = 0U;
+  
+  for ( itr = 0U; itr < obj->periodCounts; itr++ )
   {
-    float t = obj->solverInputs->h;
-    uint32_t itr = 0U;
+    if ( itr < obj->overloadCounts )
+    {
+      solverInputs->currentInput = (float*)&obj->overloadInputs;
+      solverInputs->nextInput = (float*)&obj->overloadInputs;
+    }
+    else if ( itr == obj->overloadCounts )
+    {
+      solverInputs->nextInput = (float*)&obj->ratedInputs;
+    }
+    else
+    {
+      solverInputs->currentInput = (float*)&obj->ratedInputs;
+      solverInputs->nextInput = (float*)&obj->ratedInputs;
+    }
     
-    for ( itr = 0U; itr < obj->periodCounts; itr++ )
+    if ( sensitivity )
     {
-      if ( itr < obj->overloadCounts )
-      {
-        obj->solverInputs->currentInput = (float*)&obj->overloadInputs;
-        obj->solverInputs->nextInput = (float*)&obj->overloadInputs;
-      }
-      else if ( itr == obj->overloadCounts )
-      {
-        obj->solverInputs->nextInput = (float*)&obj->ratedInputs;
-      }
-      else
-      {
-        obj->solverInputs->currentInput = (float*)&obj->ratedInputs;
-        obj->solverInputs->nextInput = (float*)&obj->ratedInputs;
-      }
+      sensitivity->solver.currentInputs = ( itr <= obj->overloadCounts ) ? sensitivity->overloadInputs : sensitivity->ratedInputs;
+      sensitivity->solver.nextInputs = ( itr < obj->overloadCounts ) ? sensitivity->overloadInputs : sensitivity->ratedInputs;
       
-      if ( RK4SOLVER_Solve( obj->stateSpaceConfig, obj->solverInputs, obj->solverOutputs ) == 1U )
+      if ( RK4SOLVER_SolveSensitivity( obj->stateSpaceConfig, solverInputs, solverOutputs, &sensitivity->solver ) == 1U )
       {
         uint32_t j = 0U;
+        uint32_t p = 0U;
         
         for ( j = 0U; j < obj->stateSpaceConfig->numOutputs; j++ )
         {
-          obj->maxTemps[ j ] = fmaxf( obj->solverOutputs->nextOutput[ j ], obj->maxTemps[ j ] );
+          if ( solverOutputs->nextOutput[ j ] > peaks[ j ] )
+          {
+            peaks[ j ] = solverOutputs->nextOutput[ j ];
+            
+            for ( p = 0U; p < sensitivity->solver.numParams; p++ )
+            {
+              sensitivity->peaks[ ( p * ASC_THERMAL_MODEL_NUM_OUTPUTS ) + j ] =
+                sensitivity->solver.outputs[ ( p * ASC_THERMAL_MODEL_NUM_OUTPUTS ) + j ];
+            }
+          }
         }
-        
-        t += obj->solverInputs->h;
       }
       else
       {
+        status = false;
         break;
       }
     }
+    else if ( RK4SOLVER_Solve( obj->stateSpaceConfig, solverInputs, solverOutputs ) == 1U )
+    {
+      uint32_t j = 0U;
+      
+      for ( j = 0U; j < obj->stateSpaceConfig->numOutputs; j++ )
+      {
+        peaks[ j ] = fmaxf( solverOutputs->nextOutput[ j ], peaks[ j ] );
+      }
+      
+      t += solverInputs->h;
+    }
+    else
+    {
+      status = false;
+      break;
+    }
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Evaluates the precomputed bound from the solver's current state and,
+ * if every output stays at least the margin below its threshold, raises the
+ * given peaks to the bound
+ * \param obj Thermal Model Overload Predictor Object
+ * \param peaks [in,out] Peaks, only raised
+ * \return true if the bound settles the prediction
+ * \note As this is a static function, there is no input validation
+ */
+static bool _isWithinBound( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj, float * peaks )
+{
+  ASC_THERMAL_MODEL_OVERLOAD_BOUND * bound = obj->bound;
+  float bounds[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+  bool within = true;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+  
+  for ( i = 0U; ( i < ASC_THERMAL_MODEL_NUM_OUTPUTS ) && within; i++ )
+  {
+    bounds[ i ] = bound->forcedPeak[ i ];
+    
+    for ( j = 0U; j < ASC_THERMAL_MODEL_NUM_STATES; j++ )
+    {
+      bounds[ i ] += bound->freeGain[ i ][ j ] * fabsf( obj->solverInputs->currentState[ j ] );
+    }
+    
+    within = ( bounds[ i ] <= ( obj->maxTempThresholds[ i ] - bound->margin ) );
+  }
+  
+  if ( within )
+  {
+    for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_OUTPUTS; i++ )
+    {
+      peaks[ i ] = fmaxf( bounds[ i ], peaks[ i ] );
+    }
+  }
+  
+  return within;
+}
+
+/*!
+ * \brief Predicts the peaks of the overload profile from the solver's current
+ * state into the given peaks instead of maxTemps, e.g. so a caller can publish
+ * them only once the prediction completes
+ * \param obj Thermal Model Overload Predictor Object
+ * \param peaks [in,out] Peaks, only raised
+ * \return success
+ * \note With a bound set up, a start state far enough from the thresholds is
+ * settled by the bound: the peaks are then raised to the bound, not to the
+ * simulated peaks, and the solver state is not advanced. Otherwise the full
+ * horizon is simulated exactly as without a bound.
+ */
+bool ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_Predict( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj, float * peaks )
+{
+  bool status = false;
+  
+  if ( obj && peaks )
+  {
+    if ( obj->bound && _isWithinBound( obj, peaks ) )
+    {
+      obj->bound->numBounded++;
+      status = true;
+    }
+    else
+    {
+      if ( obj->bound )
+      {
+        obj->bound->numSimulated++;
+      }
+      
+      status = _runProfile( obj, obj->solverInputs, obj->solverOutputs, peaks, (PROFILE_SENSITIVITY*)0 );
+    }
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief A background task that calculates the temperature and captures peaks
+ * of the system based on 60s overload profile.
+ * \param obj Thermal Model Overload Predictor Object
+ * \note The captured peaks are only raised, see
+ * ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_Predict
+ */
+void ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_BackgroundTask( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj )
+{
+  if ( obj )
+  {
+    (void)ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_Predict( obj, obj->maxTemps );
   }
 }
 
@@ -132,3 +279,134 @@ void ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_UpdateAmbientTemperature( ASC_THERMAL_
     }
   }
 }
+
+/*!
+ * \brief Precomputes the gains of the conservative peak bound with the
+ * predictor's own solver and enables the fast path of the background task.
+ * Call again after changing the profile inputs, h or the horizon.
+ * \param obj A set up Thermal Model Overload Predictor Object, its solver
+ * state is left untouched
+ * \param bound [out] Storage for the gains, must outlive the predictor
+ * \param margin Distance in K below the thresholds at which the full
+ * prediction takes over. It also absorbs the float rounding of the bound, so
+ * it should not be below a few hundredths of a kelvin.
+ * \return success, the fast path stays disabled on failure
+ */
+bool ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_SetupBound( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj,
+                                                      ASC_THERMAL_MODEL_OVERLOAD_BOUND * bound,
+                                                      float margin )
+{
+  bool status = false;
+  
+  if ( obj && bound && obj->stateSpaceConfig && obj->solverInputs && ( margin >= 0.0f ) &&
+       ( obj->stateSpaceConfig->numStates == ASC_THERMAL_MODEL_NUM_STATES ) &&
+       ( obj->stateSpaceConfig->numInputs == ASC_THERMAL_MODEL_NUM_INPUTS ) &&
+       ( obj->stateSpaceConfig->numOutputs == ASC_THERMAL_MODEL_NUM_OUTPUTS ) )
+  {
+    float state[ ASC_THERMAL_MODEL_NUM_STATES ];
+    float outputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+    float zeroInputs[ ASC_THERMAL_MODEL_NUM_INPUTS ] = { 0.0f };
+    RK4SOLVER_INPUT solverInputs = { obj->solverInputs->h, state, zeroInputs, zeroInputs, obj->solverInputs->workspace };
+    RK4SOLVER_OUTPUT solverOutputs = { state, outputs };
+    uint32_t itr = 0U;
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+    
+    memset( (char*)bound, 0, sizeof( *bound ) );
+    bound->margin = margin;
+    obj->bound = (ASC_THERMAL_MODEL_OVERLOAD_BOUND*)0;
+    status = true;
+    
+    // free response, largest magnitude of each output from each unit state
+    for ( j = 0U; ( j < ASC_THERMAL_MODEL_NUM_STATES ) && status; j++ )
+    {
+      memset( (char*)state, 0, sizeof( state ) );
+      state[ j ] = 1.0f;
+      
+      for ( itr = 0U; ( itr < obj->periodCounts ) && status; itr++ )
+      {
+        status = ( RK4SOLVER_Solve( obj->stateSpaceConfig, &solverInputs, &solverOutputs ) == 1U );
+        
+        for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_OUTPUTS; i++ )
+        {
+          bound->freeGain[ i ][ j ] = fmaxf( fabsf( outputs[ i ] ), bound->freeGain[ i ][ j ] );
+        }
+      }
+    }
+    
+    // forced response of the profile itself, from a zero state
+    memset( (char*)state, 0, sizeof( state ) );
+    status = status && _runProfile( obj, &solverInputs, &solverOutputs, bound->forcedPeak, (PROFILE_SENSITIVITY*)0 );
+    
+    if ( status )
+    {
+      obj->bound = bound;
+    }
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Runs the overload profile from the predictor's initial state like the
+ * background task and also returns how each predicted peak moves with up to
+ * ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_MAX_PARAMS parameters of the profile,
+ * e.g. the overload current. The sensitivities are integrated alongside the
+ * state in the same pass, see RK4SOLVER_SolveSensitivity, and each peak's is
+ * taken at the step where the peak occurs. The solver state, maxTemps and the
+ * verdict are left untouched.
+ * \param obj Thermal Model Overload Predictor Object
+ * \param numParams Number of parameters
+ * \param overloadInputSensitivity numParams x ASC_THERMAL_MODEL_NUM_INPUTS,
+ * d(overloadInputs)/dp, see ASC_THERMAL_MODEL_CalculateSourceInputSensitivity
+ * \param ratedInputSensitivity numParams x ASC_THERMAL_MODEL_NUM_INPUTS,
+ * d(ratedInputs)/dp
+ * \param peaks [out] ASC_THERMAL_MODEL_NUM_OUTPUTS predicted peaks, the same
+ * values the full background task captures
+ * \param peakSensitivity [out] numParams x ASC_THERMAL_MODEL_NUM_OUTPUTS,
+ * d(peak)/dp, 0 for a peak that never rises above zero
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_PeakSensitivity( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj,
+                                                           uint32_t numParams,
+                                                           const float * overloadInputSensitivity,
+                                                           const float * ratedInputSensitivity,
+                                                           float * peaks,
+                                                           float * peakSensitivity )
+{
+  bool status = false;
+  
+  if ( obj && obj->stateSpaceConfig && obj->solverInputs && overloadInputSensitivity &&
+       ratedInputSensitivity && peaks && peakSensitivity &&
+       ( numParams > 0U ) && ( numParams <= ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_MAX_PARAMS ) &&
+       ( obj->stateSpaceConfig->numStates == ASC_THERMAL_MODEL_NUM_STATES ) &&
+       ( obj->stateSpaceConfig->numInputs == ASC_THERMAL_MODEL_NUM_INPUTS ) &&
+       ( obj->stateSpaceConfig->numOutputs == ASC_THERMAL_MODEL_NUM_OUTPUTS ) )
+  {
+    float state[ ASC_THERMAL_MODEL_NUM_STATES ];
+    float outputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+    float stateSensitivity[ ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_MAX_PARAMS * ASC_THERMAL_MODEL_NUM_STATES ] = { 0.0f };
+    float outputSensitivity[ ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_MAX_PARAMS * ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+    RK4SOLVER_INPUT solverInputs = { obj->solverInputs->h, state, (float*)0, (float*)0, obj->solverInputs->workspace };
+    RK4SOLVER_OUTPUT solverOutputs = { state, outputs };
+    PROFILE_SENSITIVITY sensitivity;
+    
+    // the start of the period is a measurement, it does not move with p
+    memcpy( (char*)state, (char*)obj->initialState, sizeof( state ) );
+    memset( (char*)peaks, 0, ASC_THERMAL_MODEL_NUM_OUTPUTS * sizeof( float ) );
+    memset( (char*)peakSensitivity, 0, numParams * ASC_THERMAL_MODEL_NUM_OUTPUTS * sizeof( float ) );
+    
+    sensitivity.solver.numParams = numParams;
+    sensitivity.solver.states = stateSensitivity;
+    sensitivity.solver.currentInputs = (float*)0;
+    sensitivity.solver.nextInputs = (float*)0;
+    sensitivity.solver.outputs = outputSensitivity;
+    sensitivity.overloadInputs = (float*)overloadInputSensitivity;
+    sensitivity.ratedInputs = (float*)ratedInputSensitivity;
+    sensitivity.peaks = peakSensitivity;
+    
+    status = _runProfile( obj, &solverInputs, &solverOutputs, peaks, &sensitivity );
+  }
+  
+  return status;
+}
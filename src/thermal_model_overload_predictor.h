@@ -25,10 +25,29 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+/* Parameters ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_PeakSensitivity carries at once */
+#define ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_MAX_PARAMS (4U)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+    /*!
+     * \brief Precomputed gains of a conservative bound on the predicted peaks.
+     * The solver is linear, so every output after step k is the free response
+     * of the start state plus the response of the overload profile from zero,
+     *  peak(i) <= sum over j of freeGain(i,j)*|x0(j)| + forcedPeak(i)
+     * with freeGain(i,j) the largest |y(i)| over the horizon from unit state j.
+     */
+    typedef struct
+    {
+        float freeGain[ ASC_THERMAL_MODEL_NUM_OUTPUTS ][ ASC_THERMAL_MODEL_NUM_STATES ];
+        float forcedPeak[ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< Peaks of the profile from a zero state
+        float margin; //!< The full prediction runs once a bound is within margin of its threshold
+        uint32_t numBounded; //!< Predictions answered by the bound
+        uint32_t numSimulated; //!< Predictions that ran the full horizon
+    } ASC_THERMAL_MODEL_OVERLOAD_BOUND;
+
     typedef struct 
     {
         float h;
@@ -40,14 +59,25 @@ extern "C" {
         float initialState[ ASC_THERMAL_MODEL_NUM_STATES ];
         float overloadInputs[ ASC_THERMAL_MODEL_NUM_INPUTS ];
         float ratedInputs[ ASC_THERMAL_MODEL_NUM_INPUTS ];
-        RK4SOLVER_CONFIGURATION * stateSpaceConfig;
+        const RK4SOLVER_CONFIGURATION * stateSpaceConfig;
         RK4SOLVER_INPUT * solverInputs;
         RK4SOLVER_OUTPUT * solverOutputs;
+        ASC_THERMAL_MODEL_OVERLOAD_BOUND * bound; //!< Optional fast path, null to always simulate
     } ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR;
 
     extern bool ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_IsOverloadAvailable( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj );
     extern void ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_BackgroundTask( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj );
+    extern bool ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_Predict( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj, float * peaks );
     extern void ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_UpdateAmbientTemperature( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj, float ambient );
+    extern bool ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_SetupBound( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj,
+                                                                 ASC_THERMAL_MODEL_OVERLOAD_BOUND * bound,
+                                                                 float margin );
+    extern bool ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_PeakSensitivity( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * obj,
+                                                                      uint32_t numParams,
+                                                                      const float * overloadInputSensitivity,
+                                                                      const float * ratedInputSensitivity,
+                                                                      float * peaks,
+                                                                      float * peakSensitivity );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,571 @@
+/**
+ * @file
+ * @brief Implements the overload prediction service shared by many axes of one
+ * motor model
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rk4solver.h"
+#include "rk4solver_kernels.h"
+#include "thermal_model_prediction_service.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Slots of the table that finds near identical states of a batch, a power of
+ * two at least twice the batch */
+#define SERVICE_TABLE_LENGTH (2U * ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH)
+#define SERVICE_TABLE_EMPTY (0xFFFFFFFFU)
+
+/*!
+ * \brief Runs the overload profile of the predictor from a given start state
+ * and records the outputs after every step, the same steps as the predictor's
+ * own background task
+ * \param predictor The predictor
+ * \param state [in,out] Start state, advanced to the end of the horizon
+ * \param profile Inputs of the profile, false holds them at zero
+ * \param outputs [out] periodCounts x ASC_THERMAL_MODEL_NUM_OUTPUTS
+ * \return success
+ * \note As this is a static function, there is no input validation
+ */
+static bool _Record( const ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor,
+                     float * state,
+                     bool profile,
+                     float * outputs )
+{
+  bool status = true;
+  float workspace[ RK4SOLVER_WORKSPACE_LENGTH( ASC_THERMAL_MODEL_NUM_STATES, ASC_THERMAL_MODEL_NUM_INPUTS ) ];
+  float zeroInputs[ ASC_THERMAL_MODEL_NUM_INPUTS ] = { 0.0f };
+  float * overloadInputs = profile ? (float*)predictor->overloadInputs : zeroInputs;
+  float * ratedInputs = profile ? (float*)predictor->ratedInputs : zeroInputs;
+  RK4SOLVER_INPUT solverInputs = { predictor->h, state, overloadInputs, overloadInputs, workspace };
+  RK4SOLVER_OUTPUT solverOutputs = { state, (float*)0 };
+  uint32_t itr = 0U;
+
+  for ( itr = 0U; ( itr < predictor->periodCounts ) && status; itr++ )
+  {
+    // overload, then the step from overload to rated, then rated
+    solverInputs.currentInput = ( itr <= predictor->overloadCounts ) ? overloadInputs : ratedInputs;
+    solverInputs.nextInput = ( itr < predictor->overloadCounts ) ? overloadInputs : ratedInputs;
+    solverOutputs.nextOutput = &outputs[ itr * ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+    status = ( RK4SOLVER_Solve( predictor->stateSpaceConfig, &solverInputs, &solverOutputs ) == 1U );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Key of a state for finding near identical ones, the cell of the
+ * tolerance grid it falls in, or the state itself for a tolerance of 0
+ * \param service The service
+ * \param state ASC_THERMAL_MODEL_NUM_STATES
+ * \param key [out] ASC_THERMAL_MODEL_NUM_STATES
+ * \return Hash of the key
+ * \note As this is a static function, there is no input validation
+ */
+static uint32_t _Key( const ASC_THERMAL_MODEL_PREDICTION_SERVICE * service, const float * state, float * key )
+{
+  uint32_t hash = 2166136261U;
+  uint32_t j = 0U;
+
+  for ( j = 0U; j < ASC_THERMAL_MODEL_NUM_STATES; j++ )
+  {
+    uint32_t bits = 0U;
+
+    // adding zero folds -0 into +0 so both hash alike
+    key[ j ] = ( ( service->tolerance > 0.0f ) ? floorf( state[ j ] / service->tolerance ) : state[ j ] ) + 0.0f;
+    memcpy( (char*)&bits, (char*)&key[ j ], sizeof( bits ) );
+    hash = ( hash ^ bits ) * 16777619U;
+  }
+
+  return hash;
+}
+
+/*!
+ * \brief Predicts the peaks of up to ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH
+ * requests, sharing the prediction of states that fall in the same cell. The
+ * first state of a cell is predicted exactly; the others get its peaks raised
+ * by the share margin, which no state of the cell can exceed, so a shared
+ * verdict is never less conservative than the request's own.
+ * \return Number of distinct states predicted
+ * \note As this is a static function, there is no input validation
+ */
+static uint32_t _PredictBatch( const ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                               const ASC_THERMAL_MODEL_PREDICTION_REQUEST * requests,
+                               uint32_t count,
+                               ASC_THERMAL_MODEL_PREDICTION_RESULT * results )
+{
+  const RK4SOLVER_KERNELS * kernels = RK4SOLVER_KERNELS_Get();
+  uint32_t table[ SERVICE_TABLE_LENGTH ];
+  uint32_t distinct[ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH ]; // column of each request
+  float keys[ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH ][ ASC_THERMAL_MODEL_NUM_STATES ];
+  float states[ ASC_THERMAL_MODEL_NUM_STATES ][ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH ];
+  float peaks[ ASC_THERMAL_MODEL_NUM_OUTPUTS ][ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH ];
+  float outputs[ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH ];
+  uint32_t numDistinct = 0U;
+  uint32_t b = 0U;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+  uint32_t t = 0U;
+
+  memset( (char*)table, 0xFF, sizeof( table ) );
+
+  // gather the distinct states column wise, so the kernels run across them
+  for ( b = 0U; b < count; b++ )
+  {
+    float key[ ASC_THERMAL_MODEL_NUM_STATES ];
+    uint32_t slot = _Key( service, requests[ b ].state, key ) & ( SERVICE_TABLE_LENGTH - 1U );
+
+    while ( ( table[ slot ] != SERVICE_TABLE_EMPTY ) &&
+            ( memcmp( (char*)keys[ table[ slot ] ], (char*)key, sizeof( key ) ) != 0 ) )
+    {
+      slot = ( slot + 1U ) & ( SERVICE_TABLE_LENGTH - 1U );
+    }
+
+    results[ b ].shared = ( table[ slot ] != SERVICE_TABLE_EMPTY );
+
+    if ( !results[ b ].shared )
+    {
+      table[ slot ] = numDistinct;
+      memcpy( (char*)keys[ numDistinct ], (char*)key, sizeof( key ) );
+
+      for ( j = 0U; j < ASC_THERMAL_MODEL_NUM_STATES; j++ )
+      {
+        states[ j ][ numDistinct ] = requests[ b ].state[ j ];
+      }
+
+      numDistinct++;
+    }
+
+    distinct[ b ] = table[ slot ];
+  }
+
+  // peaks start at zero, as the model's background task clears them
+  memset( (char*)peaks, 0, sizeof( peaks ) );
+
+  for ( t = 0U; t < service->horizon; t++ )
+  {
+    for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_OUTPUTS; i++ )
+    {
+      for ( b = 0U; b < numDistinct; b++ )
+      {
+        outputs[ b ] = service->forcedOutput[ t ][ i ];
+      }
+
+      for ( j = 0U; j < ASC_THERMAL_MODEL_NUM_STATES; j++ )
+      {
+        kernels->Axpy( service->freeGain[ t ][ i ][ j ], states[ j ], outputs, numDistinct );
+      }
+
+      for ( b = 0U; b < numDistinct; b++ )
+      {
+        peaks[ i ][ b ] = fmaxf( outputs[ b ], peaks[ i ][ b ] );
+      }
+    }
+  }
+
+  // each request is judged at its own ambient, shared or not
+  for ( b = 0U; b < count; b++ )
+  {
+    results[ b ].instance = requests[ b ].instance;
+    results[ b ].overloadAvailable = true;
+
+    for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_OUTPUTS; i++ )
+    {
+      results[ b ].peaks[ i ] = peaks[ i ][ distinct[ b ] ] + ( results[ b ].shared ? service->shareMargin[ i ] : 0.0f );
+      results[ b ].overloadAvailable = results[ b ].overloadAvailable &&
+        ( results[ b ].peaks[ i ] <= ( service->thresholds[ i ] + ( service->referenceAmbient - requests[ b ].ambient ) ) );
+    }
+  }
+
+  return numDistinct;
+}
+
+/*!
+ * \brief Takes the waiting requests as one batch, predicts them without the
+ * lock and completes them. Call with the lock held and requests waiting.
+ * \note As this is a static function, there is no input validation
+ */
+static void _RunBatch( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service )
+{
+  uint32_t count = ( service->numRequests < ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH ) ?
+                   service->numRequests : ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH;
+  uint32_t numDistinct = 0U;
+  uint32_t b = 0U;
+
+  for ( b = 0U; b < count; b++ )
+  {
+    service->batch[ b ] = service->requests[ ( service->requestHead + b ) % ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED ];
+  }
+
+  service->requestHead = ( service->requestHead + count ) % ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED;
+  service->numRequests -= count;
+  service->inFlight = count;
+
+  pthread_mutex_unlock( &service->lock );
+
+  numDistinct = _PredictBatch( service, service->batch, count, service->batchResults );
+
+  if ( service->callback )
+  {
+    for ( b = 0U; b < count; b++ )
+    {
+      service->callback( service->context, &service->batchResults[ b ] );
+    }
+  }
+
+  pthread_mutex_lock( &service->lock );
+
+  if ( !service->callback )
+  {
+    for ( b = 0U; b < count; b++ )
+    {
+      if ( service->numResults < ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED )
+      {
+        service->results[ ( service->resultHead + service->numResults ) % ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED ] =
+          service->batchResults[ b ];
+        service->numResults++;
+      }
+      else
+      {
+        service->stats.dropped++;
+      }
+    }
+  }
+
+  service->stats.batches++;
+  service->stats.shared += count - numDistinct;
+  service->inFlight = 0U;
+  pthread_cond_broadcast( &service->done );
+}
+
+/*!
+ * \brief Service thread, predicts whatever requests have come in since the
+ * last batch
+ */
+static void * _ServiceThread( void * context )
+{
+  ASC_THERMAL_MODEL_PREDICTION_SERVICE * service = (ASC_THERMAL_MODEL_PREDICTION_SERVICE*)context;
+
+  pthread_mutex_lock( &service->lock );
+
+  while ( !service->shutdown )
+  {
+    if ( service->numRequests == 0U )
+    {
+      pthread_cond_wait( &service->wake, &service->lock );
+    }
+    else
+    {
+      _RunBatch( service );
+    }
+  }
+
+  pthread_mutex_unlock( &service->lock );
+
+  return (void*)0;
+}
+
+/*!
+ * \brief Sets up the service from a set up predictor and starts its thread.
+ * The outputs after each step of the predictor's horizon are recorded once
+ * from every unit start state and once for the profile from a zero state,
+ * with the predictor's own solver, so a prediction is the same sum the solver
+ * would form, up to float rounding.
+ * \param service The service
+ * \param predictor A set up Thermal Model Overload Predictor Object giving the
+ * model, step, horizon, profile, thresholds and their ambient. It is only
+ * read during the call.
+ * \param tolerance Requests of a batch whose states fall in the same cell of
+ * this size in K share one prediction. States of a cell differ by less than
+ * the tolerance in every state, so a peak differs by less than the tolerance
+ * times the sum over the states of the largest magnitude of its free gain
+ * over the horizon. That is the share margin, added to the shared peaks. 0
+ * shares exact duplicates only.
+ * \param callback Called with every result, null to queue the results for
+ * ASC_THERMAL_MODEL_PREDICTION_SERVICE_Poll
+ * \param context Passed to callback
+ * \param threaded Start a service thread, else requests wait for
+ * ASC_THERMAL_MODEL_PREDICTION_SERVICE_Flush, which runs them on the caller
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_PREDICTION_SERVICE_Create( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                                                  const ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor,
+                                                  float tolerance,
+                                                  ASC_THERMAL_MODEL_PREDICTION_CALLBACK callback,
+                                                  void * context,
+                                                  bool threaded )
+{
+  bool status = false;
+
+  if ( service && predictor && predictor->stateSpaceConfig && ( tolerance >= 0.0f ) &&
+       ( predictor->periodCounts > 0U ) &&
+       ( predictor->periodCounts <= ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_HORIZON ) &&
+       ( predictor->stateSpaceConfig->numStates == ASC_THERMAL_MODEL_NUM_STATES ) &&
+       ( predictor->stateSpaceConfig->numInputs == ASC_THERMAL_MODEL_NUM_INPUTS ) &&
+       ( predictor->stateSpaceConfig->numOutputs == ASC_THERMAL_MODEL_NUM_OUTPUTS ) )
+  {
+    float state[ ASC_THERMAL_MODEL_NUM_STATES ];
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+    uint32_t t = 0U;
+
+    memset( (char*)service, 0, sizeof( *service ) );
+    service->horizon = predictor->periodCounts;
+    service->referenceAmbient = predictor->ambientTemp;
+    service->tolerance = tolerance;
+    service->callback = callback;
+    service->context = context;
+    memcpy( (char*)service->thresholds, (char*)predictor->maxTempThresholds, sizeof( service->thresholds ) );
+    status = true;
+
+    // free response of each unit state, recorded in the forced table and
+    // moved into its column of the gains
+    for ( j = 0U; ( j < ASC_THERMAL_MODEL_NUM_STATES ) && status; j++ )
+    {
+      memset( (char*)state, 0, sizeof( state ) );
+      state[ j ] = 1.0f;
+      status = _Record( predictor, state, false, &service->forcedOutput[ 0 ][ 0 ] );
+
+      for ( t = 0U; t < service->horizon; t++ )
+      {
+        for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_OUTPUTS; i++ )
+        {
+          service->freeGain[ t ][ i ][ j ] = service->forcedOutput[ t ][ i ];
+        }
+      }
+    }
+
+    // forced response of the profile itself, from a zero state
+    memset( (char*)state, 0, sizeof( state ) );
+    status = status && _Record( predictor, state, true, &service->forcedOutput[ 0 ][ 0 ] );
+
+    for ( i = 0U; ( i < ASC_THERMAL_MODEL_NUM_OUTPUTS ) && ( tolerance > 0.0f ); i++ )
+    {
+      for ( j = 0U; j < ASC_THERMAL_MODEL_NUM_STATES; j++ )
+      {
+        float largest = 0.0f;
+
+        for ( t = 0U; t < service->horizon; t++ )
+        {
+          largest = fmaxf( fabsf( service->freeGain[ t ][ i ][ j ] ), largest );
+        }
+
+        service->shareMargin[ i ] += tolerance * largest;
+      }
+    }
+
+    if ( status )
+    {
+      pthread_mutex_init( &service->lock, (pthread_mutexattr_t*)0 );
+      pthread_cond_init( &service->wake, (pthread_condattr_t*)0 );
+      pthread_cond_init( &service->done, (pthread_condattr_t*)0 );
+
+      if ( threaded )
+      {
+        service->threaded = ( pthread_create( &service->thread, (pthread_attr_t*)0,
+                                              _ServiceThread, (void*)service ) == 0 );
+        status = service->threaded;
+      }
+
+      if ( !status )
+      {
+        pthread_cond_destroy( &service->done );
+        pthread_cond_destroy( &service->wake );
+        pthread_mutex_destroy( &service->lock );
+      }
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Predicts a set of requests on the caller, without the queues. This
+ * is the batch the service thread runs; it can also be called directly, e.g.
+ * from a scheduler's background job.
+ * \param service A created service
+ * \param requests The requests
+ * \param count Number of requests, any number
+ * \param results [out] count results, in the order of the requests
+ * \return Number of distinct states predicted, count less the shared ones
+ */
+uint32_t ASC_THERMAL_MODEL_PREDICTION_SERVICE_Predict( const ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                                                       const ASC_THERMAL_MODEL_PREDICTION_REQUEST * requests,
+                                                       uint32_t count,
+                                                       ASC_THERMAL_MODEL_PREDICTION_RESULT * results )
+{
+  uint32_t numDistinct = 0U;
+
+  if ( service && requests && results )
+  {
+    uint32_t first = 0U;
+
+    for ( first = 0U; first < count; first += ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH )
+    {
+      uint32_t batch = ( ( count - first ) < ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH ) ?
+                       ( count - first ) : ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH;
+
+      numDistinct += _PredictBatch( service, &requests[ first ], batch, &results[ first ] );
+    }
+  }
+
+  return numDistinct;
+}
+
+/*!
+ * \brief Queues a prediction of an axis, e.g. at the point its own background
+ * task would have been started
+ * \param service The service
+ * \param instance Handed back with the result
+ * \param state ASC_THERMAL_MODEL_NUM_STATES, the axis' state in K above ambient,
+ * copied
+ * \param ambient The axis' ambient temperature
+ * \return false if the request queue is full
+ */
+bool ASC_THERMAL_MODEL_PREDICTION_SERVICE_Submit( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                                                  void * instance,
+                                                  const float * state,
+                                                  float ambient )
+{
+  bool status = false;
+
+  if ( service && state )
+  {
+    pthread_mutex_lock( &service->lock );
+
+    if ( service->numRequests < ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED )
+    {
+      ASC_THERMAL_MODEL_PREDICTION_REQUEST * request =
+        &service->requests[ ( service->requestHead + service->numRequests ) % ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED ];
+
+      request->instance = instance;
+      memcpy( (char*)request->state, (char*)state, sizeof( request->state ) );
+      request->ambient = ambient;
+      service->numRequests++;
+      service->stats.requests++;
+      pthread_cond_signal( &service->wake );
+      status = true;
+    }
+    else
+    {
+      service->stats.rejected++;
+    }
+
+    pthread_mutex_unlock( &service->lock );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Takes the oldest completed result, for a service without a callback
+ * \param service The service
+ * \param result [out] The result
+ * \return false if none is waiting
+ */
+bool ASC_THERMAL_MODEL_PREDICTION_SERVICE_Poll( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                                                ASC_THERMAL_MODEL_PREDICTION_RESULT * result )
+{
+  bool status = false;
+
+  if ( service && result )
+  {
+    pthread_mutex_lock( &service->lock );
+
+    if ( service->numResults > 0U )
+    {
+      *result = service->results[ service->resultHead ];
+      service->resultHead = ( service->resultHead + 1U ) % ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED;
+      service->numResults--;
+      status = true;
+    }
+
+    pthread_mutex_unlock( &service->lock );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Returns once every request submitted so far is completed. Without a
+ * service thread the batches run here, on the caller, one at a time: a caller
+ * finding a batch in flight waits for it, as the batch buffers are shared.
+ * \param service The service
+ */
+void ASC_THERMAL_MODEL_PREDICTION_SERVICE_Flush( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service )
+{
+  if ( service )
+  {
+    pthread_mutex_lock( &service->lock );
+
+    while ( ( service->numRequests > 0U ) || ( service->inFlight > 0U ) )
+    {
+      if ( service->threaded || ( service->inFlight > 0U ) )
+      {
+        pthread_cond_wait( &service->done, &service->lock );
+      }
+      else
+      {
+        _RunBatch( service );
+      }
+    }
+
+    pthread_mutex_unlock( &service->lock );
+  }
+}
+
+/*!
+ * \brief Copies the totals
+ * \param service The service
+ * \param stats [out] The totals
+ */
+void ASC_THERMAL_MODEL_PREDICTION_SERVICE_GetStats( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                                                    ASC_THERMAL_MODEL_PREDICTION_STATS * stats )
+{
+  if ( service && stats )
+  {
+    pthread_mutex_lock( &service->lock );
+    *stats = service->stats;
+    pthread_mutex_unlock( &service->lock );
+  }
+}
+
+/*!
+ * \brief Stops and joins the service thread. Requests still queued are not
+ * predicted, flush first to complete them.
+ * \param service The service to be destroyed
+ */
+void ASC_THERMAL_MODEL_PREDICTION_SERVICE_Destroy( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service )
+{
+  if ( service )
+  {
+    pthread_mutex_lock( &service->lock );
+    service->shutdown = true;
+    pthread_cond_broadcast( &service->wake );
+    pthread_mutex_unlock( &service->lock );
+
+    if ( service->threaded )
+    {
+      pthread_join( service->thread, (void**)0 );
+    }
+
+    pthread_cond_destroy( &service->done );
+    pthread_cond_destroy( &service->wake );
+    pthread_mutex_destroy( &service->lock );
+  }
+}
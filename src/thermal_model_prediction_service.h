@@ -0,0 +1,149 @@
+/**
+ * @file
+ * @brief Defines the interface to the overload prediction service shared by
+ * many axes of one motor model
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_MODEL_PREDICTION_SERVICE_H_
+#define _ASC_THERMAL_MODEL_PREDICTION_SERVICE_H_
+
+#include "thermal_model_overload_predictor.h"
+#include "thermal_model_state_space.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bounds of the service storage, define at build time to size it for a
+ * smaller target */
+#ifndef ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_HORIZON
+#define ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_HORIZON (600U) //!< Predictor steps
+#endif
+#ifndef ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH
+#define ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH (256U) //!< Requests per batched kernel call
+#endif
+#ifndef ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED
+#define ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED (1024U) //!< Requests and results waiting
+#endif
+
+    /*!
+     * \brief One prediction request, the state of an axis at the start of its
+     * thermal period
+     */
+    typedef struct
+    {
+        void * instance; //!< The requesting axis, handed back with the result
+        float state[ ASC_THERMAL_MODEL_NUM_STATES ]; //!< Estimated state, K above ambient
+        float ambient; //!< Ambient temperature of the axis
+    } ASC_THERMAL_MODEL_PREDICTION_REQUEST;
+
+    /*!
+     * \brief The outcome of one request
+     */
+    typedef struct
+    {
+        void * instance; //!< From the request
+        float peaks[ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< Peaks over the profile, like the predictor's maxTemps; when shared, raised by the service's shareMargin so never below the request's own
+        bool overloadAvailable; //!< Every peak within its threshold at the request's ambient
+        bool shared; //!< Answered by a near identical state of the same batch
+    } ASC_THERMAL_MODEL_PREDICTION_RESULT;
+
+    /*!
+     * \brief Completion callback, called on the service thread, outside the
+     * service lock
+     * \param context The context the service was created with
+     * \param result The result, valid for the duration of the call
+     */
+    typedef void (*ASC_THERMAL_MODEL_PREDICTION_CALLBACK)( void * context,
+                                                            const ASC_THERMAL_MODEL_PREDICTION_RESULT * result );
+
+    /*!
+     * \brief Totals since the service was created
+     */
+    typedef struct
+    {
+        uint64_t requests; //!< Accepted requests
+        uint64_t rejected; //!< Requests refused with the queue full
+        uint64_t batches; //!< Batched kernel calls
+        uint64_t shared; //!< Requests answered by a near identical state
+        uint64_t dropped; //!< Results lost with the completion queue full
+    } ASC_THERMAL_MODEL_PREDICTION_STATS;
+
+    /*!
+     * \brief A prediction service for every axis sharing one motor model and
+     * overload profile. The profile is linear in the start state, so the
+     * outputs after each step are precomputed as a gain on the start state
+     * plus the common response of the profile, and a batch of requests is a
+     * handful of vector kernel calls instead of one solver run per axis.
+     */
+    typedef struct
+    {
+        uint32_t horizon; //!< Predictor steps, periodCounts
+        float freeGain[ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_HORIZON ][ ASC_THERMAL_MODEL_NUM_OUTPUTS ][ ASC_THERMAL_MODEL_NUM_STATES ]; //!< Outputs after each step per unit start state
+        float forcedOutput[ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_HORIZON ][ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< Outputs after each step of the profile from a zero state
+        float thresholds[ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< At the reference ambient
+        float referenceAmbient; //!< Ambient the thresholds belong to
+        float tolerance; //!< States closer than this in K share a prediction, 0 shares exact duplicates only
+        float shareMargin[ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< Most a peak can rise within one cell, added to shared peaks
+        ASC_THERMAL_MODEL_PREDICTION_CALLBACK callback; //!< Null queues the results for ASC_THERMAL_MODEL_PREDICTION_SERVICE_Poll
+        void * context;
+        ASC_THERMAL_MODEL_PREDICTION_REQUEST requests[ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED ]; //!< Ring of waiting requests
+        uint32_t requestHead;
+        uint32_t numRequests;
+        uint32_t inFlight; //!< Requests taken by the service thread and not yet completed
+        ASC_THERMAL_MODEL_PREDICTION_RESULT results[ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED ]; //!< Ring of completed results
+        uint32_t resultHead;
+        uint32_t numResults;
+        ASC_THERMAL_MODEL_PREDICTION_REQUEST batch[ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH ]; //!< Service thread copy of the batch
+        ASC_THERMAL_MODEL_PREDICTION_RESULT batchResults[ ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_BATCH ];
+        pthread_t thread;
+        bool threaded; //!< A service thread runs the batches, else ASC_THERMAL_MODEL_PREDICTION_SERVICE_Flush does
+        pthread_mutex_t lock;
+        pthread_cond_t wake; //!< Signals requests or shutdown
+        pthread_cond_t done; //!< Signals completed batches
+        bool shutdown;
+        ASC_THERMAL_MODEL_PREDICTION_STATS stats;
+    } ASC_THERMAL_MODEL_PREDICTION_SERVICE;
+
+    extern bool ASC_THERMAL_MODEL_PREDICTION_SERVICE_Create( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                                                             const ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor,
+                                                             float tolerance,
+                                                             ASC_THERMAL_MODEL_PREDICTION_CALLBACK callback,
+                                                             void * context,
+                                                             bool threaded );
+    extern uint32_t ASC_THERMAL_MODEL_PREDICTION_SERVICE_Predict( const ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                                                                  const ASC_THERMAL_MODEL_PREDICTION_REQUEST * requests,
+                                                                  uint32_t count,
+                                                                  ASC_THERMAL_MODEL_PREDICTION_RESULT * results );
+    extern bool ASC_THERMAL_MODEL_PREDICTION_SERVICE_Submit( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                                                             void * instance,
+                                                             const float * state,
+                                                             float ambient );
+    extern bool ASC_THERMAL_MODEL_PREDICTION_SERVICE_Poll( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                                                           ASC_THERMAL_MODEL_PREDICTION_RESULT * result );
+    extern void ASC_THERMAL_MODEL_PREDICTION_SERVICE_Flush( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service );
+    extern void ASC_THERMAL_MODEL_PREDICTION_SERVICE_GetStats( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service,
+                                                               ASC_THERMAL_MODEL_PREDICTION_STATS * stats );
+    extern void ASC_THERMAL_MODEL_PREDICTION_SERVICE_Destroy( ASC_THERMAL_MODEL_PREDICTION_SERVICE * service );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
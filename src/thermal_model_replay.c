@@ -0,0 +1,222 @@
+/**
+ * @file
+ * @brief Definition and implementation of the parallel replay of one long
+ * input trace through the thermal model
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rk4solver.h"
+#include "thermal_model_replay.h"
+#include "thermal_model_state_space.h"
+#include "thermal_model_step_operator.h"
+#include "work_pool.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+#define MAX_CHUNKS ASC_THERMAL_MODEL_REPLAY_MAX_CHUNKS
+
+typedef struct
+{
+  const RK4SOLVER_CONFIGURATION * config;
+  const ASC_THERMAL_MODEL_STEP_OPERATOR * op;
+  const float * inputs;
+  uint32_t numSteps;
+  uint32_t chunkLength;
+  float * states;
+  float * outputs;
+  float forced[ MAX_CHUNKS ][ NUM_STATES ]; //!< Chunk response from a zero state
+  float start[ MAX_CHUNKS ][ NUM_STATES ]; //!< State entering each chunk
+} REPLAY_CONTEXT;
+
+/*!
+ * \brief Work pool task, the forced response of each chunk in [begin, end)
+ * from a zero state, the offset of the chunk's composite affine map
+ */
+static void _ComposeChunks( void * context, uint32_t begin, uint32_t end, uint32_t worker )
+{
+  REPLAY_CONTEXT * replay = (REPLAY_CONTEXT*)context;
+  uint32_t chunk = 0U;
+
+  (void)worker;
+
+  for ( chunk = begin; chunk < end; chunk++ )
+  {
+    uint32_t first = chunk * replay->chunkLength;
+    uint32_t last = first + replay->chunkLength;
+    float x[ NUM_STATES ] = { 0.0f };
+    float next[ NUM_STATES ];
+    uint32_t step = 0U;
+
+    last = ( last < replay->numSteps ) ? last : replay->numSteps;
+
+    for ( step = first; step < last; step++ )
+    {
+      ASC_THERMAL_MODEL_STEP_OPERATOR_Apply( replay->op, x, &replay->inputs[ step * NUM_INPUTS ], next );
+      memcpy( (char*)x, (char*)next, sizeof( x ) );
+    }
+
+    memcpy( (char*)replay->forced[ chunk ], (char*)x, sizeof( x ) );
+  }
+}
+
+/*!
+ * \brief Work pool task, replays each chunk in [begin, end) from its entry
+ * state and writes the per-step states and outputs
+ */
+static void _ReplayChunks( void * context, uint32_t begin, uint32_t end, uint32_t worker )
+{
+  REPLAY_CONTEXT * replay = (REPLAY_CONTEXT*)context;
+  uint32_t chunk = 0U;
+
+  (void)worker;
+
+  for ( chunk = begin; chunk < end; chunk++ )
+  {
+    uint32_t first = chunk * replay->chunkLength;
+    uint32_t last = first + replay->chunkLength;
+    const float * x = replay->start[ chunk ];
+    uint32_t step = 0U;
+
+    last = ( last < replay->numSteps ) ? last : replay->numSteps;
+
+    for ( step = first; step < last; step++ )
+    {
+      float * u = (float*)&replay->inputs[ step * NUM_INPUTS ];
+      float * next = &replay->states[ step * NUM_STATES ];
+
+      ASC_THERMAL_MODEL_STEP_OPERATOR_Apply( replay->op, x, u, next );
+
+      if ( replay->outputs )
+      {
+        RK4SOLVER_Output( replay->config, next, u, &replay->outputs[ step * NUM_OUTPUTS ] );
+      }
+
+      x = next;
+    }
+  }
+}
+
+/*!
+ * \brief Entry state of every chunk by a scan over the chunk maps,
+ * x(c+1) = [Phi]^L * x(c) + forced(c). The maps are composed in O(log L) by
+ * ASC_THERMAL_MODEL_STEP_OPERATOR_Advance applied to the unit states.
+ * \note As this is a static function, there is no input validation
+ */
+static void _ScanChunks( REPLAY_CONTEXT * replay, const float * initialState, uint32_t numChunks )
+{
+  static const float zeroInput[ NUM_INPUTS ] = { 0.0f };
+  float power[ NUM_STATES ][ NUM_STATES ]; // column j is [Phi]^L * e(j)
+  uint32_t chunk = 0U;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( j = 0U; j < NUM_STATES; j++ )
+  {
+    memset( (char*)power[ j ], 0, sizeof( power[ j ] ) );
+    power[ j ][ j ] = 1.0f;
+    ASC_THERMAL_MODEL_STEP_OPERATOR_Advance( replay->op, power[ j ], zeroInput, replay->chunkLength );
+  }
+
+  memcpy( (char*)replay->start[ 0 ], (const char*)initialState, sizeof( replay->start[ 0 ] ) );
+
+  // only the last chunk can be short and nothing follows it
+  for ( chunk = 0U; ( chunk + 1U ) < numChunks; chunk++ )
+  {
+    for ( i = 0U; i < NUM_STATES; i++ )
+    {
+      double sum = (double)replay->forced[ chunk ][ i ];
+
+      for ( j = 0U; j < NUM_STATES; j++ )
+      {
+        sum += (double)power[ j ][ i ] * (double)replay->start[ chunk ][ j ];
+      }
+
+      replay->start[ chunk + 1U ][ i ] = (float)sum;
+    }
+  }
+}
+
+/*!
+ * \brief Replays an input trace through a step operator on every worker of a
+ * pool. Each step x -> [Phi]*x + [Gamma]*u is affine and affine maps compose
+ * associatively, so the trace is cut into chunks whose composite maps are
+ * built in parallel, chained by a short sequential scan, and then each chunk
+ * is replayed from its entry state in parallel. About twice the sequential
+ * work, spread over all cores.
+ * \param pool The work pool, null to run on the calling thread
+ * \param config The state space representation, for the outputs
+ * \param op The step operator of one trace sample, e.g. the estimator's
+ * periodOperator
+ * \param initialState The state before the first sample
+ * \param inputs numSteps x ASC_THERMAL_MODEL_NUM_INPUTS, held over each sample
+ * \param numSteps Number of samples
+ * \param states [out] numSteps x ASC_THERMAL_MODEL_NUM_STATES, the state after
+ * each sample
+ * \param outputs [out] numSteps x ASC_THERMAL_MODEL_NUM_OUTPUTS, may be null
+ * \return success
+ * \note Not reentrant, the chunk table lives in static storage
+ */
+bool ASC_THERMAL_MODEL_REPLAY_Run( ASC_WORK_POOL * pool,
+                                   const RK4SOLVER_CONFIGURATION * config,
+                                   const ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                   const float * initialState,
+                                   const float * inputs,
+                                   uint32_t numSteps,
+                                   float * states,
+                                   float * outputs )
+{
+  static REPLAY_CONTEXT replay;
+  bool status = false;
+
+  if ( config && op && initialState && inputs && states && ( numSteps > 0U ) &&
+       ( config->numStates == NUM_STATES ) &&
+       ( config->numInputs == NUM_INPUTS ) &&
+       ( config->numOutputs == NUM_OUTPUTS ) )
+  {
+    uint32_t numChunks = pool ? ( pool->numWorkers * ASC_THERMAL_MODEL_REPLAY_CHUNKS_PER_WORKER ) : 1U;
+
+    numChunks = ( numChunks < numSteps ) ? numChunks : numSteps;
+
+    replay.config = config;
+    replay.op = op;
+    replay.inputs = inputs;
+    replay.numSteps = numSteps;
+    replay.chunkLength = ( numSteps + numChunks - 1U ) / numChunks;
+    replay.states = states;
+    replay.outputs = outputs;
+    numChunks = ( numSteps + replay.chunkLength - 1U ) / replay.chunkLength;
+
+    if ( numChunks > 1U )
+    {
+      ASC_WORK_POOL_ParallelFor( pool, numChunks, 1U, _ComposeChunks, (void*)&replay );
+      _ScanChunks( &replay, initialState, numChunks );
+      ASC_WORK_POOL_ParallelFor( pool, numChunks, 1U, _ReplayChunks, (void*)&replay );
+    }
+    else
+    {
+      // a single chunk is the plain sequential replay
+      memcpy( (char*)replay.start[ 0 ], (const char*)initialState, sizeof( replay.start[ 0 ] ) );
+      _ReplayChunks( (void*)&replay, 0U, 1U, 0U );
+    }
+
+    status = true;
+  }
+
+  return status;
+}
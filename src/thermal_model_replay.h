@@ -0,0 +1,50 @@
+/** 
+ * @file
+ * @brief Defines the interface to the parallel replay of one long input trace
+ * through the thermal model
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_MODEL_REPLAY_H_
+#define _ASC_THERMAL_MODEL_REPLAY_H_
+
+#include "rk4solver.h"
+#include "thermal_model_step_operator.h"
+#include "work_pool.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Chunks per worker, more than one so a slow worker can be stolen from */
+#define ASC_THERMAL_MODEL_REPLAY_CHUNKS_PER_WORKER (4U)
+#define ASC_THERMAL_MODEL_REPLAY_MAX_CHUNKS ( ASC_WORK_POOL_MAX_WORKERS * ASC_THERMAL_MODEL_REPLAY_CHUNKS_PER_WORKER )
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern bool ASC_THERMAL_MODEL_REPLAY_Run( ASC_WORK_POOL * pool,
+                                              const RK4SOLVER_CONFIGURATION * config,
+                                              const ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                              const float * initialState,
+                                              const float * inputs,
+                                              uint32_t numSteps,
+                                              float * states,
+                                              float * outputs );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
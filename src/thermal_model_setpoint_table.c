@@ -0,0 +1,148 @@
+/**
+ * @file
+ * @brief Definition and implementation of the per setpoint table of thermal
+ * inputs and forced responses
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "thermal_model_setpoint_table.h"
+#include "thermal_model_state_space.h"
+#include "thermal_model_step_operator.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+
+/*!
+ * \brief Fills a table of setpoint loads. The estimator is linear in its
+ * inputs, so the average of the per tick forced responses is the forced
+ * response of the averaged inputs and a period reduces to
+ *  x <- [Phi]*x + average( forced )
+ * \param entries [out] count entries
+ * \param count Number of setpoints, e.g. ASC_TORQUE_SETPOINT_COUNT
+ * \param inputs count x ASC_THERMAL_MODEL_NUM_INPUTS source inputs, see
+ * ASC_THERMAL_MODEL_CalculateSourceInputs
+ * \param op The estimator's period operator
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_SETPOINT_TABLE_Build( ASC_THERMAL_MODEL_SETPOINT_ENTRY * entries,
+                                             uint32_t count,
+                                             const float * inputs,
+                                             const ASC_THERMAL_MODEL_STEP_OPERATOR * op )
+{
+  bool status = false;
+
+  if ( entries && inputs && op && ( count > 0U ) )
+  {
+    uint32_t entry = 0U;
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+
+    for ( entry = 0U; entry < count; entry++ )
+    {
+      memcpy( (char*)entries[ entry ].inputs, (const char*)&inputs[ entry * NUM_INPUTS ], sizeof( entries[ entry ].inputs ) );
+
+      for ( i = 0U; i < NUM_STATES; i++ )
+      {
+        entries[ entry ].forced[ i ] = 0.0f;
+
+        for ( j = 0U; j < NUM_INPUTS; j++ )
+        {
+          entries[ entry ].forced[ i ] += op->Gamma[ i ][ j ] * entries[ entry ].inputs[ j ];
+        }
+      }
+    }
+
+    status = true;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Adds the load of the setpoint active in this control tick
+ * \param acc The period's accumulator
+ * \param entry The active setpoint's entry, or null when the active value has
+ * none, which spoils the period's average
+ */
+void ASC_THERMAL_MODEL_SETPOINT_TABLE_Accumulate( ASC_THERMAL_MODEL_SETPOINT_ACCUMULATOR * acc,
+                                                  const ASC_THERMAL_MODEL_SETPOINT_ENTRY * entry )
+{
+  if ( acc && !entry )
+  {
+    acc->missed++;
+  }
+  else if ( acc )
+  {
+    uint32_t i = 0U;
+
+    for ( i = 0U; i < NUM_INPUTS; i++ )
+    {
+      acc->inputs[ i ] += entry->inputs[ i ];
+    }
+
+    for ( i = 0U; i < NUM_STATES; i++ )
+    {
+      acc->forced[ i ] += entry->forced[ i ];
+    }
+
+    acc->count++;
+  }
+}
+
+/*!
+ * \brief Averages the accumulated loads and clears the accumulator for the
+ * next period
+ * \param acc The period's accumulator
+ * \param inputs [out] ASC_THERMAL_MODEL_NUM_INPUTS averaged source inputs
+ * \param forced [out] ASC_THERMAL_MODEL_NUM_STATES averaged forced response
+ * \return success
+ * \retval false Nothing was accumulated or a tick had no entry, the outputs
+ * are untouched and the caller has to work the period's inputs out another
+ * way, e.g. with ASC_THERMAL_MODEL_CalculateSourceInputs
+ */
+bool ASC_THERMAL_MODEL_SETPOINT_TABLE_Average( ASC_THERMAL_MODEL_SETPOINT_ACCUMULATOR * acc,
+                                               float * inputs,
+                                               float * forced )
+{
+  bool status = false;
+
+  if ( acc && inputs && forced && ( acc->count > 0U ) && ( acc->missed == 0U ) )
+  {
+    float scale = 1.0f / (float)acc->count;
+    uint32_t i = 0U;
+
+    for ( i = 0U; i < NUM_INPUTS; i++ )
+    {
+      inputs[ i ] = acc->inputs[ i ] * scale;
+    }
+
+    for ( i = 0U; i < NUM_STATES; i++ )
+    {
+      forced[ i ] = acc->forced[ i ] * scale;
+    }
+
+    status = true;
+  }
+
+  if ( acc )
+  {
+    memset( (char*)acc, 0, sizeof( *acc ) );
+  }
+
+  return status;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @brief Defines the interface to the per setpoint table of thermal inputs
+ * and forced responses
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_MODEL_SETPOINT_TABLE_H_
+#define _ASC_THERMAL_MODEL_SETPOINT_TABLE_H_
+
+#include "thermal_model_state_space.h"
+#include "thermal_model_step_operator.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /*!
+     * \brief The thermal load of one torque setpoint, precomputed so the
+     * control tick only looks it up
+     */
+    typedef struct
+    {
+        float inputs[ ASC_THERMAL_MODEL_NUM_INPUTS ]; //!< Source inputs in W while the setpoint is active
+        float forced[ ASC_THERMAL_MODEL_NUM_STATES ]; //!< [Gamma]*inputs, the state the setpoint adds over one estimator period
+    } ASC_THERMAL_MODEL_SETPOINT_ENTRY;
+
+    /*!
+     * \brief Running sum of the entries active in each control tick of a
+     * thermal period
+     */
+    typedef struct
+    {
+        float inputs[ ASC_THERMAL_MODEL_NUM_INPUTS ];
+        float forced[ ASC_THERMAL_MODEL_NUM_STATES ];
+        uint32_t count; //!< Control ticks summed
+        uint32_t missed; //!< Control ticks without an entry, e.g. a setpoint limit no setpoint matches
+    } ASC_THERMAL_MODEL_SETPOINT_ACCUMULATOR;
+
+    extern bool ASC_THERMAL_MODEL_SETPOINT_TABLE_Build( ASC_THERMAL_MODEL_SETPOINT_ENTRY * entries,
+                                                        uint32_t count,
+                                                        const float * inputs,
+                                                        const ASC_THERMAL_MODEL_STEP_OPERATOR * op );
+    extern void ASC_THERMAL_MODEL_SETPOINT_TABLE_Accumulate( ASC_THERMAL_MODEL_SETPOINT_ACCUMULATOR * acc,
+                                                             const ASC_THERMAL_MODEL_SETPOINT_ENTRY * entry );
+    extern bool ASC_THERMAL_MODEL_SETPOINT_TABLE_Average( ASC_THERMAL_MODEL_SETPOINT_ACCUMULATOR * acc,
+                                                          float * inputs,
+                                                          float * forced );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
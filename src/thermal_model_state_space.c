@@ -20,36 +20,145 @@
 #include "rk4solver.h"
 #include <stdint.h>
 
-static float _A[ ASC_THERMAL_MODEL_NUM_STATES ][ ASC_THERMAL_MODEL_NUM_STATES ] = 
+/* ASC_THERMAL_MODEL_PACKED_FLOAT16 or ASC_THERMAL_MODEL_PACKED_INT16 replace
+ * the float matrices with 16 bit codes the solvers expand on the fly, halving
+ * the coefficient storage. The codes are the float matrices below packed by
+ * "asc_model_pack -c float16" and "-c int16" of a build without either flag,
+ * regenerate them whenever the matrices change. asc_model_pack also reports
+ * the accuracy cost of each format: for this model float16 is off by up to
+ * 0.014 K at steady state, int16 by under 0.01 K, and ctest holds both to
+ * 0.02 K.
+ */
+#if defined( ASC_THERMAL_MODEL_PACKED_FLOAT16 )
+
+static const uint16_t _packedA[ ASC_THERMAL_MODEL_NUM_STATES * ASC_THERMAL_MODEL_NUM_STATES ] =
+    {0xBBFD, 0x3B6B, 0x2571,
+     0x0000, 0xAC8E, 0x2571,
+     0x0000, 0x2C50, 0xB021};
+
+static const uint16_t _packedB[ ASC_THERMAL_MODEL_NUM_STATES * ASC_THERMAL_MODEL_NUM_INPUTS ] =
+    {0x381C, 0x30D9, 0x0000,
+     0x26D6, 0x26D6, 0x0000,
+     0x0000, 0x0000, 0x2D6C};
+
+static const uint16_t _packedC[ ASC_THERMAL_MODEL_NUM_OUTPUTS * ASC_THERMAL_MODEL_NUM_STATES ] =
+    {0x3800, 0x0000, 0x0000,
+     0x0000, 0x3800, 0x0000,
+     0x0000, 0x0000, 0x3800,
+     0x0000, 0x0000, 0x3800};
+
+static const uint16_t _packedD[ ASC_THERMAL_MODEL_NUM_OUTPUTS * ASC_THERMAL_MODEL_NUM_INPUTS ] =
+    {0x0000, 0x0000, 0x0000,
+     0x0000, 0x0000, 0x0000,
+     0x0000, 0x0000, 0x0000,
+     0x0000, 0x0000, 0x3ACD};
+
+static const RK4SOLVER_PACKED _packed =
+    { RK4SOLVER_PACKED_FLOAT16,
+      { _packedA, -6 },
+      { _packedB, -4 },
+      { _packedC, 1 },
+      { _packedD, 1 }
+    };
+
+#elif defined( ASC_THERMAL_MODEL_PACKED_INT16 )
+
+static const uint16_t _packedA[ ASC_THERMAL_MODEL_NUM_STATES * ASC_THERMAL_MODEL_NUM_STATES ] =
+    {0x802E, 0x76B6, 0x02B8,
+     0x0000, 0xF6E4, 0x02B8,
+     0x0000, 0x08A1, 0xEF7D};
+
+static const uint16_t _packedB[ ASC_THERMAL_MODEL_NUM_STATES * ASC_THERMAL_MODEL_NUM_INPUTS ] =
+    {0x41BB, 0x1365, 0x0000,
+     0x036B, 0x036B, 0x0000,
+     0x0000, 0x0000, 0x0AD7};
+
+static const uint16_t _packedC[ ASC_THERMAL_MODEL_NUM_OUTPUTS * ASC_THERMAL_MODEL_NUM_STATES ] =
+    {0x4000, 0x0000, 0x0000,
+     0x0000, 0x4000, 0x0000,
+     0x0000, 0x0000, 0x4000,
+     0x0000, 0x0000, 0x4000};
+
+static const uint16_t _packedD[ ASC_THERMAL_MODEL_NUM_OUTPUTS * ASC_THERMAL_MODEL_NUM_INPUTS ] =
+    {0x0000, 0x0000, 0x0000,
+     0x0000, 0x0000, 0x0000,
+     0x0000, 0x0000, 0x0000,
+     0x0000, 0x0000, 0x6CCD};
+
+static const RK4SOLVER_PACKED _packed =
+    { RK4SOLVER_PACKED_INT16,
+      { _packedA, -21 },
+      { _packedB, -19 },
+      { _packedC, -14 },
+      { _packedD, -14 }
+    };
+
+#else
+
+static const float _A[ ASC_THERMAL_MODEL_NUM_STATES ][ ASC_THERMAL_MODEL_NUM_STATES ] = 
     {{-1.5603E-02,  1.4491E-02,  3.3201E-04},
      { 0.0000E+00, -1.1119E-03,  3.3201E-04},
      { 0.0000E+00,  1.0531E-03, -2.0156E-03}};
      
-static float _B[ ASC_THERMAL_MODEL_NUM_STATES ][ ASC_THERMAL_MODEL_NUM_INPUTS ] = 
+static const float _B[ ASC_THERMAL_MODEL_NUM_STATES ][ ASC_THERMAL_MODEL_NUM_INPUTS ] = 
     {{ 3.2095E-02,  9.4706E-03,  0.0000E+00},
      { 1.6690E-03,  1.6690E-03,  0.0000E+00},
      { 0.0000E+00,  0.0000E+00,  5.2938E-03}};;
      
-static float _C[ ASC_THERMAL_MODEL_NUM_OUTPUTS ][ ASC_THERMAL_MODEL_NUM_STATES ] = 
+static const float _C[ ASC_THERMAL_MODEL_NUM_OUTPUTS ][ ASC_THERMAL_MODEL_NUM_STATES ] = 
     {{1, 0, 0},
      {0, 1, 0},
      {0, 0, 1},
      {0, 0, 1}};;
      
-static float _D[ ASC_THERMAL_MODEL_NUM_OUTPUTS ][ ASC_THERMAL_MODEL_NUM_INPUTS ] = 
+static const float _D[ ASC_THERMAL_MODEL_NUM_OUTPUTS ][ ASC_THERMAL_MODEL_NUM_INPUTS ] = 
     {{0.000E+00, 0.000E+00, 0.000E+00},
      {0.000E+00, 0.000E+00, 0.000E+00},
      {0.000E+00, 0.000E+00, 0.000E+00},
      {0.000E+00, 0.000E+00, 1.700E+00}};
 
-static RK4SOLVER_CONFIGURATION _config =
+#endif
+
+static const RK4SOLVER_CONFIGURATION _config =
     { (uint32_t)ASC_THERMAL_MODEL_NUM_STATES,
       (uint32_t)ASC_THERMAL_MODEL_NUM_INPUTS,
       (uint32_t)ASC_THERMAL_MODEL_NUM_OUTPUTS,
-      (float*)_A,
-      (float*)_B,
-      (float*)_C,
-      (float*)_D
+#if defined( ASC_THERMAL_MODEL_PACKED_FLOAT16 ) || defined( ASC_THERMAL_MODEL_PACKED_INT16 )
+      (const float*)0,
+      (const float*)0,
+      (const float*)0,
+      (const float*)0,
+      &_packed
+#else
+      (const float*)_A,
+      (const float*)_B,
+      (const float*)_C,
+      (const float*)_D,
+      (const RK4SOLVER_PACKED*)0
+#endif
     };
     
-RK4SOLVER_CONFIGURATION * ASC_THERMAL_MODEL_config = &_config;
+const RK4SOLVER_CONFIGURATION * const ASC_THERMAL_MODEL_config = &_config;
+
+static const ASC_THERMAL_MODEL_LOSS_CONSTANTS _losses =
+    { 1.0f, // phase resistance
+      1.325E-02f, // Rds(on)
+      48.0f, // bus voltage
+      1.4E+05f, // switching frequency
+      15E-09f, // rise time
+      19E-09f, // fall time
+      2.0E-02f, // sense resistor
+      3.03e-02f, // iron loss coefficient
+      1.44f, // iron loss exponent
+      0.27f // measured other power components
+    };
+
+const ASC_THERMAL_MODEL_LOSS_CONSTANTS * const ASC_THERMAL_MODEL_losses = &_losses;
+
+static const ASC_THERMAL_MODEL_RATINGS _ratings =
+    { { 80.0f-20.0f, 60.0f-20.0f, 60.0f-20.0f, 80.0f-20.0f }, // temperature thresholds (relative to 20 C ambient)
+      { 5.4168f, 23.0400f, 5.5027f }, // Overload Maximum Thermal Inputs
+      { 5.4168f, 16.0000f, 4.4368f } // Rated Maximum Thermal Inputs
+    };
+
+const ASC_THERMAL_MODEL_RATINGS * const ASC_THERMAL_MODEL_ratings = &_ratings;
@@ -30,7 +30,36 @@ extern "C" {
 #define ASC_THERMAL_MODEL_NUM_INPUTS (3U)
 #define ASC_THERMAL_MODEL_NUM_OUTPUTS (4U)
 
-extern RK4SOLVER_CONFIGURATION * ASC_THERMAL_MODEL_config;
+/*!
+ * \brief Drive and motor constants of the heat source model, see
+ * ASC_THERMAL_MODEL_CalculateSourceInputs
+ */
+typedef struct {
+    float phaseResistance; //!< Winding resistance per phase in Ohm
+    float rdsOn; //!< Bridge switch on resistance in Ohm
+    float busVoltage; //!< V
+    float switchingFrequency; //!< Hz
+    float riseTime; //!< Switch rise time in s
+    float fallTime; //!< Switch fall time in s
+    float senseResistance; //!< Current sense shunt per phase in Ohm
+    float ironLossCoefficient; //!< Iron loss in W at 1 rad/s
+    float ironLossExponent; //!< Iron loss grows with speed to this power
+    float otherLosses; //!< Measured constant drive losses in W
+} ASC_THERMAL_MODEL_LOSS_CONSTANTS;
+
+/*!
+ * \brief Overload limits and the worst case loads the overload predictor
+ * tests against them
+ */
+typedef struct {
+    float thresholds[ ASC_THERMAL_MODEL_NUM_OUTPUTS ]; //!< Temperature limits relative to ambient in K
+    float overloadInputs[ ASC_THERMAL_MODEL_NUM_INPUTS ]; //!< Source inputs at the overload current in W
+    float ratedInputs[ ASC_THERMAL_MODEL_NUM_INPUTS ]; //!< Source inputs at the rated current in W
+} ASC_THERMAL_MODEL_RATINGS;
+
+extern const RK4SOLVER_CONFIGURATION * const ASC_THERMAL_MODEL_config;
+extern const ASC_THERMAL_MODEL_LOSS_CONSTANTS * const ASC_THERMAL_MODEL_losses;
+extern const ASC_THERMAL_MODEL_RATINGS * const ASC_THERMAL_MODEL_ratings;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,298 @@
+/**
+ * @file
+ * @brief Definition and implementation of the discrete step operator of the
+ * thermal model
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "matrix_exponential.h"
+#include "rk4solver.h"
+#include "thermal_model_state_space.h"
+#include "thermal_model_step_operator.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+
+/* Operators are built at setup time, so the scratch lives in static storage.
+ * Building is not reentrant.
+ */
+static float _probeState[ NUM_STATES ];
+static float _probeInput[ NUM_INPUTS ];
+static float _probeOutput[ NUM_OUTPUTS ];
+static float _solverWorkspace[ RK4SOLVER_WORKSPACE_LENGTH( NUM_STATES, NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+static double _Phi[ NUM_STATES * NUM_STATES ];
+static double _Gamma[ NUM_STATES * NUM_INPUTS ];
+static double _discretizeWorkspace[ MATEXP_DISCRETIZE_WORKSPACE_LENGTH( NUM_STATES, NUM_INPUTS ) ];
+
+/*!
+ * \brief Runs numSteps solver steps from the probe state and input
+ * \param config The state space representation
+ * \param h The solver time step
+ * \param numSteps The number of solver steps
+ * \return success
+ * \note As this is a static function, there is no input validation
+ */
+static bool _RunProbe( const RK4SOLVER_CONFIGURATION * config, float h, uint32_t numSteps )
+{
+  RK4SOLVER_INPUT input = { h, _probeState, _probeInput, _probeInput, _solverWorkspace };
+  RK4SOLVER_OUTPUT output = { _probeState, _probeOutput };
+  uint32_t itr = 0U;
+  bool status = true;
+
+  for ( itr = 0U; ( itr < numSteps ) && status; itr++ )
+  {
+    status = ( RK4SOLVER_Solve( config, &input, &output ) == 1U );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Builds the step operator that reproduces numSteps RK4SOLVER_Solve
+ * steps of h with a constant input. Because the model is linear time
+ * invariant the solver is an affine map; its columns are found by probing
+ * with unit states (for Phi) and unit inputs (for Gamma).
+ * \param op [out] The step operator, op->h = h * numSteps
+ * \param config The state space representation
+ * \param h The solver time step
+ * \param numSteps The number of solver steps covered by one application
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_STEP_OPERATOR_FromSolver( ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                                 const RK4SOLVER_CONFIGURATION * config,
+                                                 float h,
+                                                 uint32_t numSteps )
+{
+  bool status = false;
+
+  if ( op && config &&
+       ( config->numStates == NUM_STATES ) &&
+       ( config->numInputs == NUM_INPUTS ) &&
+       ( config->numOutputs == NUM_OUTPUTS ) )
+  {
+    uint32_t column = 0U;
+    uint32_t row = 0U;
+
+    status = true;
+
+    for ( column = 0U; ( column < NUM_STATES ) && status; column++ )
+    {
+      memset( (char*)_probeState, 0, sizeof( _probeState ) );
+      memset( (char*)_probeInput, 0, sizeof( _probeInput ) );
+      _probeState[ column ] = 1.0f;
+
+      status = _RunProbe( config, h, numSteps );
+
+      for ( row = 0U; row < NUM_STATES; row++ )
+      {
+        op->Phi[ row ][ column ] = _probeState[ row ];
+      }
+    }
+
+    for ( column = 0U; ( column < NUM_INPUTS ) && status; column++ )
+    {
+      memset( (char*)_probeState, 0, sizeof( _probeState ) );
+      memset( (char*)_probeInput, 0, sizeof( _probeInput ) );
+      _probeInput[ column ] = 1.0f;
+
+      status = _RunProbe( config, h, numSteps );
+
+      for ( row = 0U; row < NUM_STATES; row++ )
+      {
+        op->Gamma[ row ][ column ] = _probeState[ row ];
+      }
+    }
+
+    op->h = h * (float)numSteps;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Builds the exact zero order hold step operator over h,
+ * [Phi] = e^([A]*h) and [Gamma] = integral( e^([A]*s) ds, 0, h ) * [B]
+ * \param op [out] The step operator
+ * \param config The state space representation
+ * \param h The interval in seconds
+ * \return success
+ */
+bool ASC_THERMAL_MODEL_STEP_OPERATOR_Exact( ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                            const RK4SOLVER_CONFIGURATION * config,
+                                            float h )
+{
+  bool status = false;
+
+  if ( op && config &&
+       ( config->numStates == NUM_STATES ) &&
+       ( config->numInputs == NUM_INPUTS ) &&
+       ( MATEXP_Discretize( config, (double)h, _Phi, _Gamma, _discretizeWorkspace ) == 1U ) )
+  {
+    uint32_t row = 0U;
+    uint32_t column = 0U;
+
+    for ( row = 0U; row < NUM_STATES; row++ )
+    {
+      for ( column = 0U; column < NUM_STATES; column++ )
+      {
+        op->Phi[ row ][ column ] = (float)_Phi[ ( row * NUM_STATES ) + column ];
+      }
+
+      for ( column = 0U; column < NUM_INPUTS; column++ )
+      {
+        op->Gamma[ row ][ column ] = (float)_Gamma[ ( row * NUM_INPUTS ) + column ];
+      }
+    }
+
+    op->h = h;
+    status = true;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Applies the operator once: nextState = [Phi]*state + [Gamma]*input
+ * \param op The step operator
+ * \param state Pointer to the state
+ * \param input Pointer to the input held over the interval
+ * \param nextState [out] Pointer to the resulting state, must not alias state
+ */
+void ASC_THERMAL_MODEL_STEP_OPERATOR_Apply( const ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                            const float * state,
+                                            const float * input,
+                                            float * nextState )
+{
+  if ( op && state && input && nextState )
+  {
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+
+    for ( i = 0U; i < NUM_STATES; i++ )
+    {
+      float sum = 0.0f;
+
+      for ( j = 0U; j < NUM_STATES; j++ )
+      {
+        sum += op->Phi[ i ][ j ] * state[ j ];
+      }
+
+      for ( j = 0U; j < NUM_INPUTS; j++ )
+      {
+        sum += op->Gamma[ i ][ j ] * input[ j ];
+      }
+
+      nextState[ i ] = sum;
+    }
+  }
+}
+
+/*!
+ * \brief Applies the operator count times with a constant input in O(log count)
+ * matrix products by exponentiation by squaring of the affine map. With
+ * P = [Phi]^(2^k) and g = forced response over 2^k intervals:
+ *  P(k+1) = P(k) * P(k)
+ *  g(k+1) = P(k) * g(k) + g(k)
+ * and the state absorbs ( P(k), g(k) ) for every set bit k of count.
+ * Accumulation is done in double so long gaps do not lose precision.
+ * \param op The step operator
+ * \param state [in,out] Pointer to the state
+ * \param input Pointer to the input held over all intervals
+ * \param count The number of intervals
+ */
+void ASC_THERMAL_MODEL_STEP_OPERATOR_Advance( const ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                              float * state,
+                                              const float * input,
+                                              uint64_t count )
+{
+  if ( op && state && input )
+  {
+    double power[ NUM_STATES ][ NUM_STATES ];
+    double square[ NUM_STATES ][ NUM_STATES ];
+    double forced[ NUM_STATES ];
+    double scratch[ NUM_STATES ];
+    double x[ NUM_STATES ];
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+    uint32_t k = 0U;
+
+    for ( i = 0U; i < NUM_STATES; i++ )
+    {
+      x[ i ] = (double)state[ i ];
+      forced[ i ] = 0.0;
+
+      for ( j = 0U; j < NUM_STATES; j++ )
+      {
+        power[ i ][ j ] = (double)op->Phi[ i ][ j ];
+      }
+
+      for ( j = 0U; j < NUM_INPUTS; j++ )
+      {
+        forced[ i ] += (double)op->Gamma[ i ][ j ] * (double)input[ j ];
+      }
+    }
+
+    while ( count > 0U )
+    {
+      if ( ( count & 1U ) != 0U )
+      {
+        for ( i = 0U; i < NUM_STATES; i++ )
+        {
+          scratch[ i ] = forced[ i ];
+
+          for ( j = 0U; j < NUM_STATES; j++ )
+          {
+            scratch[ i ] += power[ i ][ j ] * x[ j ];
+          }
+        }
+
+        memcpy( (char*)x, (char*)scratch, sizeof( x ) );
+      }
+
+      count >>= 1;
+
+      if ( count > 0U )
+      {
+        for ( i = 0U; i < NUM_STATES; i++ )
+        {
+          scratch[ i ] = forced[ i ];
+
+          for ( j = 0U; j < NUM_STATES; j++ )
+          {
+            scratch[ i ] += power[ i ][ j ] * forced[ j ];
+            square[ i ][ j ] = 0.0;
+
+            for ( k = 0U; k < NUM_STATES; k++ )
+            {
+              square[ i ][ j ] += power[ i ][ k ] * power[ k ][ j ];
+            }
+          }
+        }
+
+        memcpy( (char*)forced, (char*)scratch, sizeof( forced ) );
+        memcpy( (char*)power, (char*)square, sizeof( power ) );
+      }
+    }
+
+    for ( i = 0U; i < NUM_STATES; i++ )
+    {
+      state[ i ] = (float)x[ i ];
+    }
+  }
+}
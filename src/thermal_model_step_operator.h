@@ -0,0 +1,63 @@
+/** 
+ * @file
+ * @brief Defines the interface to the discrete step operator of the thermal
+ * model, the affine map x -> [Phi]*x + [Gamma]*u over a fixed interval
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_MODEL_STEP_OPERATOR_H_
+#define _ASC_THERMAL_MODEL_STEP_OPERATOR_H_
+
+#include "rk4solver.h"
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /*!
+     * \brief The affine map taking the state across one interval with the
+     * input held constant: x(t+h) = [Phi]*x(t) + [Gamma]*u
+     */
+    typedef struct
+    {
+        float h; //!< The interval covered by one application
+        float Phi[ ASC_THERMAL_MODEL_NUM_STATES ][ ASC_THERMAL_MODEL_NUM_STATES ]; //!< State transition
+        float Gamma[ ASC_THERMAL_MODEL_NUM_STATES ][ ASC_THERMAL_MODEL_NUM_INPUTS ]; //!< Input contribution
+    } ASC_THERMAL_MODEL_STEP_OPERATOR;
+
+    extern bool ASC_THERMAL_MODEL_STEP_OPERATOR_FromSolver( ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                                            const RK4SOLVER_CONFIGURATION * config,
+                                                            float h,
+                                                            uint32_t numSteps );
+    extern bool ASC_THERMAL_MODEL_STEP_OPERATOR_Exact( ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                                       const RK4SOLVER_CONFIGURATION * config,
+                                                       float h );
+    extern void ASC_THERMAL_MODEL_STEP_OPERATOR_Apply( const ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                                       const float * state,
+                                                       const float * input,
+                                                       float * nextState );
+    extern void ASC_THERMAL_MODEL_STEP_OPERATOR_Advance( const ASC_THERMAL_MODEL_STEP_OPERATOR * op,
+                                                         float * state,
+                                                         const float * input,
+                                                         uint64_t count );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
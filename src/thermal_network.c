@@ -0,0 +1,515 @@
+/**
+ * @file
+ * @brief Definition and implementation of the thermal RC network builder and
+ * its sparse state space model
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rk4solver.h"
+#include "thermal_network.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ONEBYSIX (0.1666666666666667f)
+
+/*!
+ * \brief Sorts each row of a compressed sparse matrix by column and sums
+ * entries sharing a column, e.g. parallel edges, compacting the storage
+ * \note As this is a static function, there is no input validation
+ */
+static void _compressRows( uint32_t * rowStart, uint32_t * columns, float * values, uint32_t numRows )
+{
+  uint32_t write = 0U;
+  uint32_t row = 0U;
+
+  for ( row = 0U; row < numRows; row++ )
+  {
+    uint32_t start = rowStart[ row ];
+    uint32_t end = rowStart[ row + 1U ];
+    uint32_t i = 0U;
+
+    // rows hold a handful of entries, insertion sort is enough
+    for ( i = start + 1U; i < end; i++ )
+    {
+      uint32_t column = columns[ i ];
+      float value = values[ i ];
+      uint32_t j = i;
+
+      while ( ( j > start ) && ( columns[ j - 1U ] > column ) )
+      {
+        columns[ j ] = columns[ j - 1U ];
+        values[ j ] = values[ j - 1U ];
+        j--;
+      }
+
+      columns[ j ] = column;
+      values[ j ] = value;
+    }
+
+    rowStart[ row ] = write;
+
+    for ( i = start; i < end; i++ )
+    {
+      if ( ( write > rowStart[ row ] ) && ( columns[ write - 1U ] == columns[ i ] ) )
+      {
+        values[ write - 1U ] += values[ i ];
+      }
+      else
+      {
+        columns[ write ] = columns[ i ];
+        values[ write ] = values[ i ];
+        write++;
+      }
+    }
+  }
+
+  rowStart[ numRows ] = write;
+}
+
+/*!
+ * \brief [dx/dt] = [A]*x + [B]*u over the nonzeros only
+ * \note As this is a static function, there is no input validation
+ */
+static void _fx( const ASC_THERMAL_NETWORK_MODEL * model, const float * x, const float * u, float * dx )
+{
+  uint32_t row = 0U;
+  uint32_t k = 0U;
+
+  for ( row = 0U; row < model->numStates; row++ )
+  {
+    float sum = 0.0f;
+
+    for ( k = model->rowStart[ row ]; k < model->rowStart[ row + 1U ]; k++ )
+    {
+      sum += model->values[ k ] * x[ model->columns[ k ] ];
+    }
+
+    for ( k = model->inputRowStart[ row ]; k < model->inputRowStart[ row + 1U ]; k++ )
+    {
+      sum += model->inputValues[ k ] * u[ model->inputColumns[ k ] ];
+    }
+
+    dx[ row ] = sum;
+  }
+}
+
+/*!
+ * \brief Prepares an empty network on caller storage
+ * \param net [out] The network
+ * \param maxNodes Capacity of capacitance and ambientConductance
+ * \param capacitance Node storage
+ * \param ambientConductance Node storage
+ * \param maxEdges Capacity of edges
+ * \param edges Edge storage
+ * \param maxSources Capacity of sources
+ * \param sources Source storage
+ * \return success
+ */
+bool ASC_THERMAL_NETWORK_Init( ASC_THERMAL_NETWORK * net,
+                               uint32_t maxNodes,
+                               float * capacitance,
+                               float * ambientConductance,
+                               uint32_t maxEdges,
+                               ASC_THERMAL_NETWORK_EDGE * edges,
+                               uint32_t maxSources,
+                               ASC_THERMAL_NETWORK_SOURCE * sources )
+{
+  bool status = false;
+
+  if ( net && capacitance && ambientConductance && ( maxNodes > 0U ) &&
+       ( edges || ( maxEdges == 0U ) ) && ( sources || ( maxSources == 0U ) ) )
+  {
+    memset( (char*)net, 0, sizeof( *net ) );
+    net->maxNodes = maxNodes;
+    net->maxEdges = maxEdges;
+    net->maxSources = maxSources;
+    net->capacitance = capacitance;
+    net->ambientConductance = ambientConductance;
+    net->edges = edges;
+    net->sources = sources;
+    status = true;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Adds a thermal mass
+ * \param net The network
+ * \param capacitance Heat capacity in J/K, positive
+ * \param ambientConductance Conductance to ambient in W/K, 0 for none
+ * \return Index of the node, ASC_THERMAL_NETWORK_INVALID_NODE when full or
+ * out of range
+ */
+uint32_t ASC_THERMAL_NETWORK_AddNode( ASC_THERMAL_NETWORK * net,
+                                      float capacitance,
+                                      float ambientConductance )
+{
+  uint32_t node = ASC_THERMAL_NETWORK_INVALID_NODE;
+
+  if ( net && ( net->numNodes < net->maxNodes ) && ( capacitance > 0.0f ) && ( ambientConductance >= 0.0f ) )
+  {
+    node = net->numNodes++;
+    net->capacitance[ node ] = capacitance;
+    net->ambientConductance[ node ] = ambientConductance;
+  }
+
+  return node;
+}
+
+/*!
+ * \brief Adds a conductance between two nodes, heat flows both ways
+ * \param net The network
+ * \param from A node
+ * \param to Another node
+ * \param conductance W/K, positive
+ * \return success
+ */
+bool ASC_THERMAL_NETWORK_Connect( ASC_THERMAL_NETWORK * net,
+                                  uint32_t from,
+                                  uint32_t to,
+                                  float conductance )
+{
+  bool status = false;
+
+  if ( net && ( net->numEdges < net->maxEdges ) && ( from < net->numNodes ) &&
+       ( to < net->numNodes ) && ( from != to ) && ( conductance > 0.0f ) )
+  {
+    ASC_THERMAL_NETWORK_EDGE * edge = &net->edges[ net->numEdges++ ];
+
+    edge->from = from;
+    edge->to = to;
+    edge->conductance = conductance;
+    status = true;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Routes a share of an input's heat into a node
+ * \param net The network
+ * \param node The heated node
+ * \param input Index into the input vector, e.g. from
+ * ASC_THERMAL_MODEL_CalculateSourceInputs
+ * \param gain Share of the input in W/W
+ * \return success
+ */
+bool ASC_THERMAL_NETWORK_AddSource( ASC_THERMAL_NETWORK * net,
+                                    uint32_t node,
+                                    uint32_t input,
+                                    float gain )
+{
+  bool status = false;
+
+  if ( net && ( net->numSources < net->maxSources ) && ( node < net->numNodes ) )
+  {
+    ASC_THERMAL_NETWORK_SOURCE * source = &net->sources[ net->numSources++ ];
+
+    source->node = node;
+    source->input = input;
+    source->gain = gain;
+    net->numInputs = ( input >= net->numInputs ) ? ( input + 1U ) : net->numInputs;
+    status = true;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Adds a copy of a sub-network, e.g. one axis. Couple the copies by
+ * connecting their nodes to shared ones such as cabinet air or a mounting
+ * plate.
+ * \param net The network
+ * \param block The sub-network with local node and input indices
+ * \param inputOffset Added to the block's input indices, so each copy has its
+ * own heat sources
+ * \return Index of the block's first node, its node k is that plus k.
+ * ASC_THERMAL_NETWORK_INVALID_NODE if it does not fit, the network is left
+ * unchanged.
+ */
+uint32_t ASC_THERMAL_NETWORK_AddBlock( ASC_THERMAL_NETWORK * net,
+                                       const ASC_THERMAL_NETWORK_BLOCK * block,
+                                       uint32_t inputOffset )
+{
+  uint32_t first = ASC_THERMAL_NETWORK_INVALID_NODE;
+
+  if ( net && block && block->capacitance && block->ambientConductance &&
+       ( ( net->numNodes + block->numNodes ) <= net->maxNodes ) &&
+       ( ( net->numEdges + block->numEdges ) <= net->maxEdges ) &&
+       ( ( net->numSources + block->numSources ) <= net->maxSources ) )
+  {
+    ASC_THERMAL_NETWORK saved = *net;
+    bool status = true;
+    uint32_t itr = 0U;
+
+    first = net->numNodes;
+
+    for ( itr = 0U; ( itr < block->numNodes ) && status; itr++ )
+    {
+      status = ( ASC_THERMAL_NETWORK_AddNode( net, block->capacitance[ itr ], block->ambientConductance[ itr ] ) !=
+                 ASC_THERMAL_NETWORK_INVALID_NODE );
+    }
+
+    for ( itr = 0U; ( itr < block->numEdges ) && status; itr++ )
+    {
+      status = ( block->edges[ itr ].from < block->numNodes ) &&
+               ( block->edges[ itr ].to < block->numNodes ) &&
+               ASC_THERMAL_NETWORK_Connect( net,
+                                            first + block->edges[ itr ].from,
+                                            first + block->edges[ itr ].to,
+                                            block->edges[ itr ].conductance );
+    }
+
+    for ( itr = 0U; ( itr < block->numSources ) && status; itr++ )
+    {
+      status = ( block->sources[ itr ].node < block->numNodes ) &&
+               ASC_THERMAL_NETWORK_AddSource( net,
+                                              first + block->sources[ itr ].node,
+                                              inputOffset + block->sources[ itr ].input,
+                                              block->sources[ itr ].gain );
+    }
+
+    if ( !status )
+    {
+      *net = saved;
+      first = ASC_THERMAL_NETWORK_INVALID_NODE;
+    }
+  }
+
+  return first;
+}
+
+/*!
+ * \brief Assembles the state space model of the network,
+ *  C(i) dT(i)/dt = -G(i,amb) T(i) + sum G(i,j) ( T(j) - T(i) ) + sum gain u
+ * straight into compressed sparse rows. The cost and storage grow with the
+ * number of nodes and connections, not with their square.
+ * \param net The network
+ * \param model [out] Arrays sized as documented in ASC_THERMAL_NETWORK_MODEL
+ * for the network's capacities
+ * \return success
+ */
+bool ASC_THERMAL_NETWORK_Assemble( const ASC_THERMAL_NETWORK * net,
+                                   ASC_THERMAL_NETWORK_MODEL * model )
+{
+  bool status = false;
+
+  if ( net && model && model->rowStart && model->columns && model->values &&
+       model->inputRowStart && ( model->inputColumns || ( net->numSources == 0U ) ) &&
+       ( model->inputValues || ( net->numSources == 0U ) ) && ( net->numNodes > 0U ) )
+  {
+    uint32_t n = net->numNodes;
+    uint32_t itr = 0U;
+
+    model->numStates = n;
+    model->numInputs = net->numInputs;
+
+    // count the entries of each row one ahead, a diagonal plus the edges
+    memset( (char*)model->rowStart, 0, ( n + 1U ) * sizeof( uint32_t ) );
+    memset( (char*)model->inputRowStart, 0, ( n + 1U ) * sizeof( uint32_t ) );
+
+    for ( itr = 0U; itr < n; itr++ )
+    {
+      model->rowStart[ itr + 1U ] = 1U;
+    }
+
+    for ( itr = 0U; itr < net->numEdges; itr++ )
+    {
+      model->rowStart[ net->edges[ itr ].from + 1U ]++;
+      model->rowStart[ net->edges[ itr ].to + 1U ]++;
+    }
+
+    for ( itr = 0U; itr < net->numSources; itr++ )
+    {
+      model->inputRowStart[ net->sources[ itr ].node + 1U ]++;
+    }
+
+    for ( itr = 0U; itr < n; itr++ )
+    {
+      model->rowStart[ itr + 1U ] += model->rowStart[ itr ];
+      model->inputRowStart[ itr + 1U ] += model->inputRowStart[ itr ];
+    }
+
+    // fill, using rowStart[ i ] as the cursor of row i, then shift back
+    for ( itr = 0U; itr < n; itr++ )
+    {
+      uint32_t k = model->rowStart[ itr ]++;
+
+      model->columns[ k ] = itr;
+      model->values[ k ] = -net->ambientConductance[ itr ] / net->capacitance[ itr ];
+    }
+
+    for ( itr = 0U; itr < net->numEdges; itr++ )
+    {
+      const ASC_THERMAL_NETWORK_EDGE * edge = &net->edges[ itr ];
+      uint32_t k = model->rowStart[ edge->from ]++;
+
+      model->columns[ k ] = edge->to;
+      model->values[ k ] = edge->conductance / net->capacitance[ edge->from ];
+
+      k = model->rowStart[ edge->to ]++;
+      model->columns[ k ] = edge->from;
+      model->values[ k ] = edge->conductance / net->capacitance[ edge->to ];
+    }
+
+    for ( itr = 0U; itr < net->numSources; itr++ )
+    {
+      const ASC_THERMAL_NETWORK_SOURCE * source = &net->sources[ itr ];
+      uint32_t k = model->inputRowStart[ source->node ]++;
+
+      model->inputColumns[ k ] = source->input;
+      model->inputValues[ k ] = source->gain / net->capacitance[ source->node ];
+    }
+
+    for ( itr = n; itr > 0U; itr-- )
+    {
+      model->rowStart[ itr ] = model->rowStart[ itr - 1U ];
+      model->inputRowStart[ itr ] = model->inputRowStart[ itr - 1U ];
+    }
+    model->rowStart[ 0U ] = 0U;
+    model->inputRowStart[ 0U ] = 0U;
+
+    // every edge leaves both of its nodes through the diagonal
+    for ( itr = 0U; itr < net->numEdges; itr++ )
+    {
+      const ASC_THERMAL_NETWORK_EDGE * edge = &net->edges[ itr ];
+
+      model->values[ model->rowStart[ edge->from ] ] -= edge->conductance / net->capacitance[ edge->from ];
+      model->values[ model->rowStart[ edge->to ] ] -= edge->conductance / net->capacitance[ edge->to ];
+    }
+
+    _compressRows( model->rowStart, model->columns, model->values, n );
+    _compressRows( model->inputRowStart, model->inputColumns, model->inputValues, n );
+
+    status = true;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief One RK4 step of the sparse model, the same scheme and input
+ * interpolation as RK4SOLVER_Solve
+ * \param model The assembled network
+ * \param input h, states, inputs and a workspace of
+ * RK4SOLVER_WORKSPACE_LENGTH( numStates, numInputs ) floats
+ * \param output nextState, may alias currentState, and nextOutput, the node
+ * temperatures, may be null
+ * \return success
+ */
+bool ASC_THERMAL_NETWORK_Solve( const ASC_THERMAL_NETWORK_MODEL * model,
+                                RK4SOLVER_INPUT * input,
+                                RK4SOLVER_OUTPUT * output )
+{
+  bool status = false;
+
+  if ( model && input && output && input->currentState && input->currentInput &&
+       input->nextInput && input->workspace && output->nextState )
+  {
+    uint32_t n = model->numStates;
+    uint32_t stride = RK4SOLVER_PAD_LENGTH( n );
+    float * K0 = input->workspace;
+    float * K1 = K0 + stride;
+    float * K2 = K1 + stride;
+    float * K3 = K2 + stride;
+    float * x = K3 + stride;
+    float * u = x + stride;
+    float h = input->h;
+    uint32_t i = 0U;
+
+    _fx( model, input->currentState, input->currentInput, K0 );
+
+    for ( i = 0U; i < model->numInputs; i++ )
+    {
+      u[ i ] = ( input->currentInput[ i ] + input->nextInput[ i ] ) * 0.5f;
+    }
+
+    for ( i = 0U; i < n; i++ )
+    {
+      x[ i ] = input->currentState[ i ] + ( h * 0.5f ) * K0[ i ];
+    }
+    _fx( model, x, u, K1 );
+
+    for ( i = 0U; i < n; i++ )
+    {
+      x[ i ] = input->currentState[ i ] + ( h * 0.5f ) * K1[ i ];
+    }
+    _fx( model, x, u, K2 );
+
+    for ( i = 0U; i < n; i++ )
+    {
+      x[ i ] = input->currentState[ i ] + h * K2[ i ];
+    }
+    _fx( model, x, input->nextInput, K3 );
+
+    for ( i = 0U; i < n; i++ )
+    {
+      output->nextState[ i ] = input->currentState[ i ] +
+                               ( h * ONEBYSIX ) * ( K0[ i ] + 2.0f * K1[ i ] + 2.0f * K2[ i ] + K3[ i ] );
+    }
+
+    if ( output->nextOutput && ( output->nextOutput != output->nextState ) )
+    {
+      memcpy( (char*)output->nextOutput, (char*)output->nextState, n * sizeof( float ) );
+    }
+
+    status = true;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Expands the sparse model into the dense row major [A] and [B] of
+ * RK4SOLVER_CONFIGURATION, for small networks and cross checks
+ * \param model The assembled network
+ * \param A [out] numStates x numStates
+ * \param B [out] numStates x numInputs
+ * \return success
+ */
+bool ASC_THERMAL_NETWORK_ToDense( const ASC_THERMAL_NETWORK_MODEL * model,
+                                  float * A,
+                                  float * B )
+{
+  bool status = false;
+
+  if ( model && A && B )
+  {
+    uint32_t row = 0U;
+    uint32_t k = 0U;
+
+    memset( (char*)A, 0, model->numStates * model->numStates * sizeof( float ) );
+    memset( (char*)B, 0, model->numStates * model->numInputs * sizeof( float ) );
+
+    for ( row = 0U; row < model->numStates; row++ )
+    {
+      for ( k = model->rowStart[ row ]; k < model->rowStart[ row + 1U ]; k++ )
+      {
+        A[ ( row * model->numStates ) + model->columns[ k ] ] = model->values[ k ];
+      }
+
+      for ( k = model->inputRowStart[ row ]; k < model->inputRowStart[ row + 1U ]; k++ )
+      {
+        B[ ( row * model->numInputs ) + model->inputColumns[ k ] ] = model->inputValues[ k ];
+      }
+    }
+
+    status = true;
+  }
+
+  return status;
+}
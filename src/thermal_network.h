@@ -0,0 +1,145 @@
+/**
+ * @file
+ * @brief Defines the interface to the thermal RC network builder and its
+ * sparse state space model
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_NETWORK_H_
+#define _ASC_THERMAL_NETWORK_H_
+
+#include "rk4solver.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASC_THERMAL_NETWORK_INVALID_NODE (0xFFFFFFFFUL)
+
+/*!
+ * Nonzeros of the assembled [A], a diagonal per node and both directions of
+ * every edge. Sizes ASC_THERMAL_NETWORK_MODEL columns and values.
+ */
+#define ASC_THERMAL_NETWORK_MAX_NONZEROS( maxNodes, maxEdges ) \
+    ( (uint32_t)(maxNodes) + 2U * (uint32_t)(maxEdges) )
+
+    /*!
+     * \brief A thermal conductance between two nodes
+     */
+    typedef struct
+    {
+        uint32_t from;
+        uint32_t to;
+        float conductance; //!< W/K
+    } ASC_THERMAL_NETWORK_EDGE;
+
+    /*!
+     * \brief Routes a share of a heat source input into a node
+     */
+    typedef struct
+    {
+        uint32_t node;
+        uint32_t input; //!< Index into the input vector
+        float gain; //!< Share of the input in W/W
+    } ASC_THERMAL_NETWORK_SOURCE;
+
+    /*!
+     * \brief A reusable sub-network, e.g. one axis of motor, housing and
+     * drive. Node and input indices are local to the block.
+     */
+    typedef struct
+    {
+        uint32_t numNodes;
+        const float * capacitance; //!< J/K per node
+        const float * ambientConductance; //!< W/K per node to ambient
+        uint32_t numEdges;
+        const ASC_THERMAL_NETWORK_EDGE * edges;
+        uint32_t numSources;
+        const ASC_THERMAL_NETWORK_SOURCE * sources;
+    } ASC_THERMAL_NETWORK_BLOCK;
+
+    /*!
+     * \brief The network being built, on storage supplied by the caller.
+     * Temperatures are relative to ambient.
+     */
+    typedef struct
+    {
+        uint32_t maxNodes;
+        uint32_t maxEdges;
+        uint32_t maxSources;
+        uint32_t numNodes;
+        uint32_t numEdges;
+        uint32_t numSources;
+        uint32_t numInputs; //!< One past the highest input index used
+        float * capacitance; //!< maxNodes
+        float * ambientConductance; //!< maxNodes
+        ASC_THERMAL_NETWORK_EDGE * edges; //!< maxEdges
+        ASC_THERMAL_NETWORK_SOURCE * sources; //!< maxSources
+    } ASC_THERMAL_NETWORK;
+
+    /*!
+     * \brief [dx/dt] = [A]*x + [B]*u in compressed sparse rows, outputs are the
+     * node temperatures
+     */
+    typedef struct
+    {
+        uint32_t numStates;
+        uint32_t numInputs;
+        uint32_t * rowStart; //!< numStates + 1
+        uint32_t * columns; //!< ASC_THERMAL_NETWORK_MAX_NONZEROS
+        float * values; //!< ASC_THERMAL_NETWORK_MAX_NONZEROS
+        uint32_t * inputRowStart; //!< numStates + 1
+        uint32_t * inputColumns; //!< maxSources
+        float * inputValues; //!< maxSources
+    } ASC_THERMAL_NETWORK_MODEL;
+
+    extern bool ASC_THERMAL_NETWORK_Init( ASC_THERMAL_NETWORK * net,
+                                          uint32_t maxNodes,
+                                          float * capacitance,
+                                          float * ambientConductance,
+                                          uint32_t maxEdges,
+                                          ASC_THERMAL_NETWORK_EDGE * edges,
+                                          uint32_t maxSources,
+                                          ASC_THERMAL_NETWORK_SOURCE * sources );
+    extern uint32_t ASC_THERMAL_NETWORK_AddNode( ASC_THERMAL_NETWORK * net,
+                                                 float capacitance,
+                                                 float ambientConductance );
+    extern bool ASC_THERMAL_NETWORK_Connect( ASC_THERMAL_NETWORK * net,
+                                             uint32_t from,
+                                             uint32_t to,
+                                             float conductance );
+    extern bool ASC_THERMAL_NETWORK_AddSource( ASC_THERMAL_NETWORK * net,
+                                               uint32_t node,
+                                               uint32_t input,
+                                               float gain );
+    extern uint32_t ASC_THERMAL_NETWORK_AddBlock( ASC_THERMAL_NETWORK * net,
+                                                  const ASC_THERMAL_NETWORK_BLOCK * block,
+                                                  uint32_t inputOffset );
+    extern bool ASC_THERMAL_NETWORK_Assemble( const ASC_THERMAL_NETWORK * net,
+                                              ASC_THERMAL_NETWORK_MODEL * model );
+    extern bool ASC_THERMAL_NETWORK_Solve( const ASC_THERMAL_NETWORK_MODEL * model,
+                                           RK4SOLVER_INPUT * input,
+                                           RK4SOLVER_OUTPUT * output );
+    extern bool ASC_THERMAL_NETWORK_ToDense( const ASC_THERMAL_NETWORK_MODEL * model,
+                                             float * A,
+                                             float * B );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
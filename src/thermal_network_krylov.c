@@ -0,0 +1,477 @@
+/**
+ * @file
+ * @brief Definition and implementation of the Krylov subspace propagator of
+ * large sparse thermal networks
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "matrix_exponential.h"
+#include "thermal_network.h"
+#include "thermal_network_krylov.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* The error estimate needs a small exponential, taken every few basis
+ * vectors rather than after each one.
+ */
+static const uint32_t CHECK_EVERY = 4U;
+/* A new basis vector this small against ||A|| means the subspace is invariant
+ * and the step exact.
+ */
+static const double BREAKDOWN = 1.0E-12;
+static const uint32_t MAX_REJECTIONS = 40U;
+/* A remainder this small against the interval is folded into the last
+ * substep rather than taken as a step of its own.
+ */
+static const double REMAINDER = 1.0E-06;
+
+/*!
+ * \brief Product with the augmented operator of the held input,
+ *  [ A  b ] * [ v    ]
+ *  [ 0  0 ]   [ v(n) ]
+ * whose exponential carries [ x; 1 ] to [ x(t); 1 ]
+ * \note As this is a static function, there is no input validation
+ */
+static void _matvec( const ASC_THERMAL_NETWORK_MODEL * model, const double * b, const double * v, double * w )
+{
+  uint32_t n = model->numStates;
+  uint32_t row = 0U;
+  uint32_t k = 0U;
+
+  for ( row = 0U; row < n; row++ )
+  {
+    double sum = b[ row ] * v[ n ];
+
+    for ( k = model->rowStart[ row ]; k < model->rowStart[ row + 1U ]; k++ )
+    {
+      sum += (double)model->values[ k ] * v[ model->columns[ k ] ];
+    }
+
+    w[ row ] = sum;
+  }
+
+  w[ n ] = 0.0;
+}
+
+/*!
+ * \brief Infinity norm of the augmented operator
+ * \note As this is a static function, there is no input validation
+ */
+static double _norm( const ASC_THERMAL_NETWORK_MODEL * model, const double * b )
+{
+  double norm = 0.0;
+  uint32_t row = 0U;
+  uint32_t k = 0U;
+
+  for ( row = 0U; row < model->numStates; row++ )
+  {
+    double sum = fabs( b[ row ] );
+
+    for ( k = model->rowStart[ row ]; k < model->rowStart[ row + 1U ]; k++ )
+    {
+      sum += fabs( (double)model->values[ k ] );
+    }
+
+    norm = ( sum > norm ) ? sum : norm;
+  }
+
+  return norm;
+}
+
+/*!
+ * \brief Dot product
+ * \note As this is a static function, there is no input validation
+ */
+static double _dot( const double * x, const double * y, uint32_t length )
+{
+  double sum = 0.0;
+  uint32_t i = 0U;
+
+  for ( i = 0U; i < length; i++ )
+  {
+    sum += x[ i ] * y[ i ];
+  }
+
+  return sum;
+}
+
+/*!
+ * \brief The forcing b = [B]*u of a held input
+ * \note As this is a static function, there is no input validation
+ */
+static void _forcing( const ASC_THERMAL_NETWORK_MODEL * model, const float * input, double * b )
+{
+  uint32_t row = 0U;
+  uint32_t k = 0U;
+
+  for ( row = 0U; row < model->numStates; row++ )
+  {
+    b[ row ] = 0.0;
+
+    for ( k = model->inputRowStart[ row ]; k < model->inputRowStart[ row + 1U ]; k++ )
+    {
+      b[ row ] += (double)model->inputValues[ k ] * (double)input[ model->inputColumns[ k ] ];
+    }
+  }
+}
+
+/*!
+ * \brief Carries the augmented vector w across elapsed seconds,
+ *  w <- e^( [ A b; 0 0 ]*elapsed ) * w
+ * in substeps tau, each projected onto the Krylov subspace of w,
+ *  e^( tau*Aaug ) * w ~= beta * [V] * e^( tau*[H] ) * e1
+ * with [V] the Arnoldi basis and [H] the Hessenberg projection. The subspace
+ * grows until the first two terms of the error series of Saad,
+ *  beta * h(m+1,m) * ( | e(m)' * tau*phi1( tau*[H] ) * e1 | +
+ *                      | e(m)' * tau^2*phi2( tau*[H] ) * e1 | * ||A*v(m+1)|| )
+ * meet the substep's share of the tolerance, and the substep is shortened
+ * where the largest subspace does not.
+ * \note As this is a static function, there is no input validation
+ */
+static bool _propagate( const ASC_THERMAL_NETWORK_KRYLOV * krylov,
+                        const ASC_THERMAL_NETWORK_MODEL * model,
+                        double * w,
+                        const double * b,
+                        double elapsed,
+                        double tolerance,
+                        ASC_THERMAL_NETWORK_KRYLOV_STATS * stats )
+{
+  uint32_t N = model->numStates + 1U;
+  uint32_t M = krylov->maxDim;
+  double * V = krylov->workspace + ( 2U * N ); // M + 1 basis vectors and A*v(M+1) after w and b
+  double * H = V + ( ( M + 2U ) * N ); // ( M + 1 ) x M
+  double * S = H + ( ( M + 1U ) * M ); // ( M + 2 ) x ( M + 2 )
+  double * E = S + ( ( M + 2U ) * ( M + 2U ) );
+  double * scratch = E + ( ( M + 2U ) * ( M + 2U ) );
+  double breakdown = BREAKDOWN * _norm( model, b );
+  double t = 0.0;
+  double tau = elapsed;
+  bool status = true;
+
+  while ( status && ( t < elapsed ) )
+  {
+    double beta = sqrt( _dot( w, w, N ) );
+    double error = 0.0;
+    bool accepted = false;
+    bool exact = false;
+    bool pending = false;
+    uint32_t m = 0U;
+    uint32_t rejections = 0U;
+    uint32_t i = 0U;
+    uint32_t j = 0U;
+
+    if ( ( tau + ( REMAINDER * elapsed ) ) > ( elapsed - t ) )
+    {
+      tau = elapsed - t;
+    }
+
+    if ( beta == 0.0 )
+    {
+      break; // nothing to carry
+    }
+
+    for ( i = 0U; i < N; i++ )
+    {
+      V[ i ] = w[ i ] / beta;
+    }
+
+    memset( (char*)H, 0, ( M + 1U ) * M * sizeof( double ) );
+
+    // Arnoldi with modified Gram-Schmidt
+    for ( j = 0U; ( j < M ) && !accepted && status; j++ )
+    {
+      double * p = &V[ ( j + 1U ) * N ];
+      double next = 0.0;
+      double product = 0.0;
+      bool check = false;
+
+      if ( !pending )
+      {
+        _matvec( model, b, &V[ j * N ], p );
+
+        if ( stats )
+        {
+          stats->matvecs++;
+        }
+      }
+      pending = false;
+
+      for ( i = 0U; i <= j; i++ )
+      {
+        double h = _dot( &V[ i * N ], p, N );
+        uint32_t k = 0U;
+
+        H[ ( i * M ) + j ] = h;
+
+        for ( k = 0U; k < N; k++ )
+        {
+          p[ k ] -= h * V[ ( i * N ) + k ];
+        }
+      }
+
+      next = sqrt( _dot( p, p, N ) );
+      H[ ( ( j + 1U ) * M ) + j ] = next;
+      m = j + 1U;
+      exact = ( next <= breakdown );
+
+      check = exact || ( m == M ) || ( ( m % CHECK_EVERY ) == 0U );
+
+      if ( !exact )
+      {
+        for ( i = 0U; i < N; i++ )
+        {
+          p[ i ] /= next;
+        }
+
+        // ||A*v(m+1)|| for the second term of the estimate, the product is
+        // kept for the next basis vector
+        if ( check )
+        {
+          _matvec( model, b, p, p + N );
+          product = sqrt( _dot( p + N, p + N, N ) );
+          pending = true;
+
+          if ( stats )
+          {
+            stats->matvecs++;
+          }
+        }
+      }
+
+      while ( status && !accepted && check )
+      {
+        uint32_t size = m + 2U;
+        double allowed = tolerance * ( tau / elapsed );
+        double first = 0.0;
+        double second = 0.0;
+
+        // exp of [ tau*H 0 0; tau*h*e(m)' 0 0; 0 tau 0 ] holds e^( tau*H )*e1
+        // in its first column over tau*h*e(m)'*phi1( tau*H )*e1 and
+        // tau*tau*h*e(m)'*phi2( tau*H )*e1
+        memset( (char*)S, 0, size * size * sizeof( double ) );
+
+        for ( i = 0U; i < m; i++ )
+        {
+          uint32_t k = 0U;
+
+          for ( k = 0U; k < m; k++ )
+          {
+            S[ ( i * size ) + k ] = tau * H[ ( i * M ) + k ];
+          }
+        }
+        S[ ( m * size ) + m - 1U ] = tau * next;
+        S[ ( ( m + 1U ) * size ) + m ] = tau;
+
+        status = ( MATEXP_Expm( S, size, E, scratch ) == 1U );
+
+        first = beta * fabs( E[ m * size ] );
+        second = beta * fabs( E[ ( m + 1U ) * size ] ) * product;
+        error = exact ? 0.0 : first + second;
+
+        if ( error <= allowed )
+        {
+          accepted = true;
+        }
+        else if ( m < M )
+        {
+          break; // grow the subspace
+        }
+        else if ( ++rejections <= MAX_REJECTIONS )
+        {
+          double shrink = 0.9 * pow( allowed / error, 1.0 / (double)m );
+
+          tau *= ( shrink < 0.1 ) ? 0.1 : ( ( shrink > 0.5 ) ? 0.5 : shrink );
+
+          if ( stats )
+          {
+            stats->rejected++;
+          }
+        }
+        else
+        {
+          status = false;
+        }
+      }
+    }
+
+    if ( status && accepted )
+    {
+      uint32_t size = m + 2U;
+
+      memset( (char*)w, 0, N * sizeof( double ) );
+
+      for ( i = 0U; i < m; i++ )
+      {
+        double c = beta * E[ i * size ];
+        uint32_t k = 0U;
+
+        for ( k = 0U; k < N; k++ )
+        {
+          w[ k ] += c * V[ ( i * N ) + k ];
+        }
+      }
+
+      t = ( tau >= ( elapsed - t ) ) ? elapsed : ( t + tau );
+
+      if ( stats )
+      {
+        stats->substeps++;
+        stats->errorEstimate += (float)error;
+      }
+
+      // a subspace well short of the limit affords a longer substep
+      if ( ( 2U * m ) <= M )
+      {
+        tau *= 2.0;
+      }
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Jumps a network across elapsed seconds with the input held, using
+ * sparse products with [A] only, e.g. to fast-forward after a pause or to
+ * step a model too large for a dense [Phi]
+ * \param krylov Tolerance, subspace limit and workspace
+ * \param model The assembled network
+ * \param state [in,out] numStates, node temperatures
+ * \param input numInputs, held across the interval
+ * \param elapsed Seconds, >= 0
+ * \param stats [in,out] Work and error estimate are added, may be null
+ * \return success
+ * \retval false An argument is invalid or the error estimate could not be met
+ */
+bool ASC_THERMAL_NETWORK_KRYLOV_Advance( const ASC_THERMAL_NETWORK_KRYLOV * krylov,
+                                         const ASC_THERMAL_NETWORK_MODEL * model,
+                                         float * state,
+                                         const float * input,
+                                         float elapsed,
+                                         ASC_THERMAL_NETWORK_KRYLOV_STATS * stats )
+{
+  bool status = false;
+
+  if ( krylov && krylov->workspace && ( krylov->maxDim >= 2U ) && ( krylov->tolerance > 0.0f ) &&
+       model && state && input && ( elapsed >= 0.0f ) )
+  {
+    uint32_t n = model->numStates;
+    double * w = krylov->workspace;
+    double * b = w + n + 1U;
+    uint32_t i = 0U;
+
+    for ( i = 0U; i < n; i++ )
+    {
+      w[ i ] = (double)state[ i ];
+    }
+    w[ n ] = 1.0;
+
+    _forcing( model, input, b );
+    status = ( elapsed == 0.0f ) ||
+             _propagate( krylov, model, w, b, (double)elapsed, (double)krylov->tolerance, stats );
+
+    for ( i = 0U; status && ( i < n ); i++ )
+    {
+      state[ i ] = (float)w[ i ];
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Forecasts the peak temperature of every node over a schedule of held
+ * inputs, e.g. an overload followed by the rated load, the way the overload
+ * predictor does for the compiled-in model
+ * \param krylov Tolerance, spread over the whole schedule, subspace limit and
+ * workspace
+ * \param model The assembled network
+ * \param state numStates, node temperatures now, left untouched
+ * \param inputs numSegments x numInputs, held over each segment
+ * \param durations numSegments, seconds
+ * \param numSegments Segments of the schedule
+ * \param samplesPerSegment Points per segment where the peaks are sampled
+ * \param peaks [out] numStates, the highest temperature of each node, now
+ * included
+ * \param finalState [out] numStates, at the end of the schedule, may be null
+ * \param stats [in,out] Work and error estimate are added, may be null
+ * \return success
+ */
+bool ASC_THERMAL_NETWORK_KRYLOV_Forecast( const ASC_THERMAL_NETWORK_KRYLOV * krylov,
+                                          const ASC_THERMAL_NETWORK_MODEL * model,
+                                          const float * state,
+                                          const float * inputs,
+                                          const float * durations,
+                                          uint32_t numSegments,
+                                          uint32_t samplesPerSegment,
+                                          float * peaks,
+                                          float * finalState,
+                                          ASC_THERMAL_NETWORK_KRYLOV_STATS * stats )
+{
+  bool status = false;
+
+  if ( krylov && krylov->workspace && ( krylov->maxDim >= 2U ) && ( krylov->tolerance > 0.0f ) &&
+       model && state && inputs && durations && ( samplesPerSegment > 0U ) && peaks )
+  {
+    uint32_t n = model->numStates;
+    double * w = krylov->workspace;
+    double * b = w + n + 1U;
+    double horizon = 0.0;
+    uint32_t segment = 0U;
+    uint32_t sample = 0U;
+    uint32_t i = 0U;
+
+    status = true;
+
+    for ( segment = 0U; segment < numSegments; segment++ )
+    {
+      status = status && ( durations[ segment ] >= 0.0f );
+      horizon += (double)durations[ segment ];
+    }
+
+    for ( i = 0U; i < n; i++ )
+    {
+      w[ i ] = (double)state[ i ];
+      peaks[ i ] = state[ i ];
+    }
+    w[ n ] = 1.0;
+
+    for ( segment = 0U; status && ( segment < numSegments ) && ( horizon > 0.0 ); segment++ )
+    {
+      double hop = (double)durations[ segment ] / (double)samplesPerSegment;
+
+      _forcing( model, &inputs[ segment * model->numInputs ], b );
+
+      for ( sample = 0U; status && ( sample < samplesPerSegment ) && ( hop > 0.0 ); sample++ )
+      {
+        status = _propagate( krylov, model, w, b, hop, (double)krylov->tolerance * ( hop / horizon ), stats );
+
+        for ( i = 0U; status && ( i < n ); i++ )
+        {
+          peaks[ i ] = ( (float)w[ i ] > peaks[ i ] ) ? (float)w[ i ] : peaks[ i ];
+        }
+      }
+    }
+
+    for ( i = 0U; status && finalState && ( i < n ); i++ )
+    {
+      finalState[ i ] = (float)w[ i ];
+    }
+  }
+
+  return status;
+}
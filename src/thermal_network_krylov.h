@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @brief Defines the interface to the Krylov subspace propagator of large
+ * sparse thermal networks
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_THERMAL_NETWORK_KRYLOV_H_
+#define _ASC_THERMAL_NETWORK_KRYLOV_H_
+
+#include "thermal_network.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Number of doubles of scratch required by the propagator of a network of
+ * numStates nodes with Krylov subspaces of at most maxDim vectors
+ */
+#define ASC_THERMAL_NETWORK_KRYLOV_WORKSPACE_LENGTH( numStates, maxDim ) \
+    ( ( (uint32_t)(maxDim) + 4U ) * ( (uint32_t)(numStates) + 1U ) + \
+      ( (uint32_t)(maxDim) + 1U ) * (uint32_t)(maxDim) + \
+      5U * ( (uint32_t)(maxDim) + 2U ) * ( (uint32_t)(maxDim) + 2U ) )
+
+    /*!
+     * \brief How much work a propagation took
+     */
+    typedef struct
+    {
+        uint32_t matvecs; //!< Sparse products with [A]
+        uint32_t substeps; //!< Accepted Krylov steps
+        uint32_t rejected; //!< Steps shortened as the error estimate was too large
+        float errorEstimate; //!< Sum of the accepted steps' estimates, K
+    } ASC_THERMAL_NETWORK_KRYLOV_STATS;
+
+    /*!
+     * \brief Settings of the propagator
+     */
+    typedef struct
+    {
+        float tolerance; //!< Absolute error allowed over the whole horizon, K
+        uint32_t maxDim; //!< Largest Krylov subspace, sizes the workspace
+        double * workspace; //!< ASC_THERMAL_NETWORK_KRYLOV_WORKSPACE_LENGTH doubles
+    } ASC_THERMAL_NETWORK_KRYLOV;
+
+    extern bool ASC_THERMAL_NETWORK_KRYLOV_Advance( const ASC_THERMAL_NETWORK_KRYLOV * krylov,
+                                                    const ASC_THERMAL_NETWORK_MODEL * model,
+                                                    float * state,
+                                                    const float * input,
+                                                    float elapsed,
+                                                    ASC_THERMAL_NETWORK_KRYLOV_STATS * stats );
+    extern bool ASC_THERMAL_NETWORK_KRYLOV_Forecast( const ASC_THERMAL_NETWORK_KRYLOV * krylov,
+                                                     const ASC_THERMAL_NETWORK_MODEL * model,
+                                                     const float * state,
+                                                     const float * inputs,
+                                                     const float * durations,
+                                                     uint32_t numSegments,
+                                                     uint32_t samplesPerSegment,
+                                                     float * peaks,
+                                                     float * finalState,
+                                                     ASC_THERMAL_NETWORK_KRYLOV_STATS * stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
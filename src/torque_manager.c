@@ -52,11 +52,47 @@ static uint8_t _applyLimit( uint8_t value, uint8_t limit )
   return retVal;    
 }
 
+/*!
+ * \brief Finds the thermal load of the active setpoint value. That is the
+ * active index's own entry unless the limit cut it down, then the entry of a
+ * setpoint with the limited value.
+ * \param obj The Torque Manager Instance
+ * \return The matching entry, or null when no setpoint has the limited value;
+ * the thermal inputs then have to come from the drive current
+ * \private 
+ */
+static const ASC_THERMAL_MODEL_SETPOINT_ENTRY * _selectThermalEntry( ASC_TORQUE_MANAGER * obj )
+{
+  const ASC_THERMAL_MODEL_SETPOINT_ENTRY * entry = (const ASC_THERMAL_MODEL_SETPOINT_ENTRY*)0;
+  
+  if( obj->thermalEntries )
+  {
+    uint8_t itr = 0U;
+    
+    if( ( obj->activeSetpointIndex < ASC_TORQUE_SETPOINT_COUNT ) &&
+        ( obj->setpoints[ obj->activeSetpointIndex ] == obj->activeSetpointValue ) )
+    {
+      entry = &obj->thermalEntries[ obj->activeSetpointIndex ];
+    }
+    
+    for( itr = 0U; ( itr < ASC_TORQUE_SETPOINT_COUNT ) && !entry; itr++ )
+    {
+      if( obj->setpoints[ itr ] == obj->activeSetpointValue )
+      {
+        entry = &obj->thermalEntries[ itr ];
+      }
+    }
+  }
+  
+  return entry;
+}
+
 /*!
  * \brief Sets the torque value by enumerated index
  * \param obj The Torque Manager Instance being modified
  * \param index The enumerated index used to select the setpoint from the setpoint list
- * \note Applies setpoint limit to result
+ * \note Applies setpoint limit to result, and selects the setpoint's thermal
+ * load in activeThermalEntry
  * \return Resulting torque value 
  */
 uint8_t ASC_TORQUE_MANAGER_SetTorqueByIndex( ASC_TORQUE_MANAGER * obj, uint8_t index )
@@ -69,6 +105,7 @@ uint8_t ASC_TORQUE_MANAGER_SetTorqueByIndex( ASC_TORQUE_MANAGER * obj, uint8_t i
     {
       obj->activeSetpointValue = _applyLimit( obj->setpoints[ index ], obj->setpointLimit );
       obj->activeSetpointIndex = index;
+      obj->activeThermalEntry = _selectThermalEntry( obj );
     }
     
     retVal = obj->activeSetpointValue;
@@ -92,6 +129,7 @@ uint8_t ASC_TORQUE_MANAGER_SetSetpointLimit( ASC_TORQUE_MANAGER * obj, uint8_t l
   {
     obj->setpointLimit = limit;
     obj->activeSetpointValue = _applyLimit( obj->activeSetpointValue, obj->setpointLimit );
+    obj->activeThermalEntry = _selectThermalEntry( obj );
     
     retVal = obj->activeSetpointValue;
   }
@@ -118,6 +156,22 @@ uint8_t ASC_TORQUE_MANAGER_SetFeedforwardValue( ASC_TORQUE_MANAGER * obj, uint8_
   return retVal;
 }
 
+/*!
+ * \brief Sets the table of thermal loads per setpoint, so every setpoint
+ * change hands the thermal model a ready input vector
+ * \param obj The Torque Manager Instance being modified
+ * \param entries ASC_TORQUE_SETPOINT_COUNT entries in setpoint index order,
+ * see ASC_THERMAL_MODEL_BuildSetpointTable, or null
+ */
+void ASC_TORQUE_MANAGER_SetThermalEntries( ASC_TORQUE_MANAGER * obj, const ASC_THERMAL_MODEL_SETPOINT_ENTRY * entries )
+{
+  if( obj )
+  {
+    obj->thermalEntries = entries;
+    obj->activeThermalEntry = _selectThermalEntry( obj );
+  }
+}
+
 /*!
  * \brief A foreground task responsible for applying limited torque value and 
  *  feedforward value to the system via the setTorque function.
@@ -133,7 +187,9 @@ void ASC_TORQUE_MANAGER_ForegroundTask( ASC_TORQUE_MANAGER * obj )
                            
     if( obj->setTorque && changeNeeded )
     {
-      uint8_t limitedSetpoint = _applyLimit( obj->activeSetpointValue + obj->activeFeedforwardValue, obj->setpointLimit );
+      uint16_t sum = (uint16_t)obj->activeSetpointValue + (uint16_t)obj->activeFeedforwardValue;
+      // saturate before narrowing, a wrapped sum would command a low torque
+      uint8_t limitedSetpoint = _applyLimit( ( sum > 0xFFU ) ? 0xFFU : (uint8_t)sum, obj->setpointLimit );
       (*obj->setTorque)( limitedSetpoint );
       obj->lastSetpointValue = obj->activeSetpointValue;
       obj->lastFeedforwardValue = obj->activeFeedforwardValue;
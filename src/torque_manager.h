@@ -20,20 +20,22 @@
 #define _ASC_TORQUE_MANAGER_H
 
 #include "int_pi_controller.h"
+#include "thermal_model_setpoint_table.h"
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
-    /* Indexes for SetTorqueByIndex selector */
-    const uint8_t ASC_TORQUE_OFF_INDEX = 0U;
-    const uint8_t ASC_TORQUE_IDLE_INDEX = 1U;
-    const uint8_t ASC_TORQUE_ACCEL_PLUS_INDEX = 2U;
-    const uint8_t ASC_TORQUE_ACCEL_MINUS_INDEX = 3U;
-    const uint8_t ASC_TORQUE_CRUISE_INDEX = 4U;
-    const uint8_t ASC_TORQUE_DECEL_PLUS_INDEX = 5U;
-    const uint8_t ASC_TORQUE_DECEL_MINUS_INDEX = 6U;
-    const uint8_t ASC_TORQUE_FULL_INDEX = 7U;
+    /* Indexes for SetTorqueByIndex selector, static so every translation unit
+     * including this header gets its own copy instead of a duplicate symbol */
+    static const uint8_t ASC_TORQUE_OFF_INDEX = 0U;
+    static const uint8_t ASC_TORQUE_IDLE_INDEX = 1U;
+    static const uint8_t ASC_TORQUE_ACCEL_PLUS_INDEX = 2U;
+    static const uint8_t ASC_TORQUE_ACCEL_MINUS_INDEX = 3U;
+    static const uint8_t ASC_TORQUE_CRUISE_INDEX = 4U;
+    static const uint8_t ASC_TORQUE_DECEL_PLUS_INDEX = 5U;
+    static const uint8_t ASC_TORQUE_DECEL_MINUS_INDEX = 6U;
+    static const uint8_t ASC_TORQUE_FULL_INDEX = 7U;
     #define ASC_TORQUE_SETPOINT_COUNT 8U
     
     typedef struct
@@ -47,11 +49,14 @@ extern "C" {
         void (*setTorque)(uint8_t value);
         uint8_t setpoints[ ASC_TORQUE_SETPOINT_COUNT ];
         INT_8_PI_CONTROLLER_t piController;
+        const ASC_THERMAL_MODEL_SETPOINT_ENTRY * thermalEntries; //!< ASC_TORQUE_SETPOINT_COUNT precomputed loads, may be null
+        const ASC_THERMAL_MODEL_SETPOINT_ENTRY * activeThermalEntry; //!< Load of activeSetpointValue, null when a limit cuts it to a value no setpoint has
     } ASC_TORQUE_MANAGER;
     
     extern uint8_t ASC_TORQUE_MANAGER_SetTorqueByIndex( ASC_TORQUE_MANAGER * obj, uint8_t index );
     extern uint8_t ASC_TORQUE_MANAGER_SetSetpointLimit( ASC_TORQUE_MANAGER * obj, uint8_t limit );
     extern uint8_t ASC_TORQUE_MANAGER_SetFeedforwardValue( ASC_TORQUE_MANAGER * obj, uint8_t feedforward );
+    extern void ASC_TORQUE_MANAGER_SetThermalEntries( ASC_TORQUE_MANAGER * obj, const ASC_THERMAL_MODEL_SETPOINT_ENTRY * entries );
     extern void ASC_TORQUE_MANAGER_ForegroundTask( ASC_TORQUE_MANAGER * obj );
     extern int32_t ASC_TORQUE_MANAGER_DynamicTorqueCalculation( ASC_TORQUE_MANAGER * obj, uint8_t feedback );
     
@@ -0,0 +1,184 @@
+/**
+ * @file
+ * @brief Definition and implementation of the TR-BDF2 implicit solver for
+ * stiff state space representations
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lu_decomposition.h"
+#include "rk4solver.h"
+#include "trbdf2solver.h"
+#include <stdint.h>
+#include <string.h>
+
+/* gamma = 2 - sqrt(2) places the stage between the trapezoidal and BDF2
+ * halves so that both use the same implicit coefficient
+ *  d  = gamma / 2 = ( 1 - gamma ) / ( 2 - gamma ) = 1 - 1 / sqrt(2)
+ * and the BDF2 stage weights are
+ *  w1 = 1 / ( gamma * ( 2 - gamma ) ) = ( sqrt(2) + 1 ) / 2
+ *  w0 = ( 1 - gamma )^2 / ( gamma * ( 2 - gamma ) ) = ( sqrt(2) - 1 ) / 2
+ */
+#define TRBDF2_GAMMA (0.58578644f)
+#define TRBDF2_D (0.29289322f)
+#define TRBDF2_W1 (1.20710678f)
+#define TRBDF2_W0 (0.20710678f)
+
+/*!
+ * \brief Accumulates result += scale * ( [A]*x + [B]*u )
+ * \note As this is a static function, there is no input validation
+ */
+static void _AddFx( const RK4SOLVER_CONFIGURATION * config,
+                    float scale,
+                    const float * x,
+                    const float * u,
+                    float * result )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+  
+  for ( i = 0U; i < config->numStates; i++ )
+  {
+    float sum = 0.0f;
+    
+    if ( x )
+    {
+      for ( j = 0U; j < config->numStates; j++ )
+      {
+        sum += RK4SOLVER_GetCoefficient( config, RK4SOLVER_MATRIX_A, ( i * config->numStates ) + j ) * x[ j ];
+      }
+    }
+    
+    for ( j = 0U; j < config->numInputs; j++ )
+    {
+      sum += RK4SOLVER_GetCoefficient( config, RK4SOLVER_MATRIX_B, ( i * config->numInputs ) + j ) * u[ j ];
+    }
+    
+    result[ i ] += scale * sum;
+  }
+}
+
+/*!
+ * \brief Factors [I] - d*h*[A] for the time step in factorization->h. Must be
+ * called again whenever [A] or h change.
+ * \param config The state space representation
+ * \param factorization [in,out] The time step and storage, receives the factors
+ * \return success of failure
+ * \retval 0U Failure
+ * \retval 1U Success
+ */
+uint8_t TRBDF2SOLVER_Factor( const RK4SOLVER_CONFIGURATION * config,
+                             TRBDF2SOLVER_FACTORIZATION * factorization )
+{
+  uint8_t status = 0U; // failure
+  
+  if ( config && factorization && factorization->workspace && factorization->pivots )
+  {
+    uint32_t n = config->numStates;
+    float * lu = factorization->workspace;
+    float scale = TRBDF2_D * factorization->h;
+    uint32_t i = 0U;
+    
+    for ( i = 0U; i < n * n; i++ )
+    {
+      lu[ i ] = -scale * RK4SOLVER_GetCoefficient( config, RK4SOLVER_MATRIX_A, i );
+    }
+    
+    for ( i = 0U; i < n; i++ )
+    {
+      lu[ ( i * n ) + i ] += 1.0f;
+    }
+    
+    status = LU_Factor( lu, n, factorization->pivots );
+  }
+  
+  return status;
+}
+
+/*!
+ * \brief Runs one TR-BDF2 step, a trapezoidal stage to t + gamma*h followed
+ * by a BDF2 stage to t + h. The method is L-stable, so fast modes of a stiff
+ * model are damped instead of limiting h, and each stage is one forward and
+ * back substitution with the shared factors. Both stages are solved for the
+ * increment from xn so rounding scales with the change, not the state:
+ *  ( [I] - d*h*[A] ) * dg = d*h*( f( xn, un ) + f( xn, ug ) ), xg = xn + dg
+ *  ( [I] - d*h*[A] ) * dn = w1*dg + d*h*f( xn, un+1 ), xn+1 = xn + dn
+ * where ug interpolates the input linearly between un and un+1.
+ * \param config The state space representation
+ * \param factorization The factors from TRBDF2SOLVER_Factor
+ * \param input Current state and inputs, input->h must match the factorization
+ * and input->workspace is not used
+ * \param output The resulting state and outputs, nextState may alias
+ * currentState
+ * \return success of failure and fill in output if successful
+ * \retval 0U Failure
+ * \retval 1U Success
+ */
+uint8_t TRBDF2SOLVER_Solve( const RK4SOLVER_CONFIGURATION * config,
+                            TRBDF2SOLVER_FACTORIZATION * factorization,
+                            RK4SOLVER_INPUT * input,
+                            RK4SOLVER_OUTPUT * output )
+{
+  uint8_t status = 0U; // failure
+  
+  if ( config && factorization && input && output &&
+       input->currentState && input->currentInput && input->nextInput &&
+       output->nextState && ( input->h == factorization->h ) )
+  {
+    uint32_t n = config->numStates;
+    float * lu = factorization->workspace;
+    float * xn = lu + ( n * n );
+    float * rhs = xn + n;
+    float * increment = rhs + n;
+    float scale = TRBDF2_D * input->h;
+    uint32_t i = 0U;
+    
+    memcpy( (char*)xn, (char*)input->currentState, n * sizeof( float ) );
+    memset( (char*)rhs, 0, n * sizeof( float ) );
+    
+    // f( xn, ug ) with ug = un + gamma*( un+1 - un ) entering through [B]
+    _AddFx( config, 2.0f * scale, xn, input->currentInput, rhs );
+    _AddFx( config, scale * -TRBDF2_GAMMA, (float*)0, input->currentInput, rhs );
+    _AddFx( config, scale * TRBDF2_GAMMA, (float*)0, input->nextInput, rhs );
+    
+    status = LU_Solve( lu, n, factorization->pivots, rhs, increment );
+    
+    if ( status == 1U )
+    {
+      for ( i = 0U; i < n; i++ )
+      {
+        rhs[ i ] = TRBDF2_W1 * increment[ i ];
+      }
+      
+      _AddFx( config, scale, xn, input->nextInput, rhs );
+      
+      status = LU_Solve( lu, n, factorization->pivots, rhs, increment );
+    }
+    
+    if ( status == 1U )
+    {
+      for ( i = 0U; i < n; i++ )
+      {
+        output->nextState[ i ] = xn[ i ] + increment[ i ];
+      }
+      
+      if ( output->nextOutput )
+      {
+        status = RK4SOLVER_Output( config, output->nextState, input->currentInput, output->nextOutput );
+      }
+    }
+  }
+  
+  return status;
+}
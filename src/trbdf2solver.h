@@ -0,0 +1,57 @@
+/** 
+ * @file
+ * @brief Defines the interface to the TR-BDF2 implicit solver for stiff state
+ * space representations
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_TRBDF2SOLVER_H_
+#define _ASC_TRBDF2SOLVER_H_
+
+#include "rk4solver.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Number of floats of storage required by a factorization: the LU factors
+ * followed by three state long vectors of scratch
+ */
+#define TRBDF2SOLVER_WORKSPACE_LENGTH( numStates ) \
+    ( ( (uint32_t)(numStates) * (uint32_t)(numStates) ) + ( 3U * (uint32_t)(numStates) ) )
+
+    /*!
+     * The factorization of [I] - d*h*[A] shared by both stages of a step,
+     * computed once per configuration and time step
+     */
+    typedef struct {
+        float h; //!< time step the factorization was computed for
+        float * workspace; //!< TRBDF2SOLVER_WORKSPACE_LENGTH( numStates ) floats
+        uint32_t * pivots; //!< numStates row permutation
+    } TRBDF2SOLVER_FACTORIZATION;
+
+    extern uint8_t TRBDF2SOLVER_Factor( const RK4SOLVER_CONFIGURATION * config,
+                                        TRBDF2SOLVER_FACTORIZATION * factorization );
+    extern uint8_t TRBDF2SOLVER_Solve( const RK4SOLVER_CONFIGURATION * config,
+                                       TRBDF2SOLVER_FACTORIZATION * factorization,
+                                       RK4SOLVER_INPUT * input,
+                                       RK4SOLVER_OUTPUT * output );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,285 @@
+/**
+ * @file
+ * @brief Definition and implementation of a work-stealing thread pool
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "work_pool.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOW_WORD( r ) ( (uint32_t)( (r) & 0xFFFFFFFFULL ) )
+#define HIGH_WORD( r ) ( (uint32_t)( (r) >> 32 ) )
+#define PACK( next, end ) ( ( (uint64_t)(end) << 32 ) | (uint64_t)(next) )
+
+/*!
+ * \brief Claims a chunk from the front of the worker's own range
+ * \return true if [begin, end) was claimed
+ * \note As this is a static function, there is no input validation
+ */
+static bool _ClaimFront( ASC_WORK_POOL_QUEUE * queue, uint32_t grain, uint32_t * begin, uint32_t * end )
+{
+  bool claimed = false;
+  uint64_t range = __atomic_load_n( &queue->range, __ATOMIC_ACQUIRE );
+
+  while ( LOW_WORD( range ) < HIGH_WORD( range ) )
+  {
+    uint32_t next = LOW_WORD( range );
+    uint32_t last = HIGH_WORD( range );
+    uint32_t take = ( ( last - next ) < grain ) ? ( last - next ) : grain;
+
+    if ( __atomic_compare_exchange_n( &queue->range, &range, PACK( next + take, last ),
+                                      false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+    {
+      *begin = next;
+      *end = next + take;
+      claimed = true;
+      break;
+    }
+  }
+
+  return claimed;
+}
+
+/*!
+ * \brief Steals a chunk from the back of another worker's range
+ * \return true if [begin, end) was claimed
+ * \note As this is a static function, there is no input validation
+ */
+static bool _ClaimBack( ASC_WORK_POOL_QUEUE * queue, uint32_t grain, uint32_t * begin, uint32_t * end )
+{
+  bool claimed = false;
+  uint64_t range = __atomic_load_n( &queue->range, __ATOMIC_ACQUIRE );
+
+  while ( LOW_WORD( range ) < HIGH_WORD( range ) )
+  {
+    uint32_t next = LOW_WORD( range );
+    uint32_t last = HIGH_WORD( range );
+    uint32_t take = ( ( last - next ) < grain ) ? ( last - next ) : grain;
+
+    if ( __atomic_compare_exchange_n( &queue->range, &range, PACK( next, last - take ),
+                                      false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+    {
+      *begin = last - take;
+      *end = last;
+      claimed = true;
+      break;
+    }
+  }
+
+  return claimed;
+}
+
+/*!
+ * \brief Runs the current generation on one worker until no work is left in
+ * any queue
+ * \note As this is a static function, there is no input validation
+ */
+static void _Work( ASC_WORK_POOL * pool, uint32_t worker )
+{
+  uint32_t begin = 0U;
+  uint32_t end = 0U;
+  uint32_t victim = 0U;
+
+  while ( _ClaimFront( &pool->queues[ worker ], pool->grain, &begin, &end ) )
+  {
+    pool->task( pool->context, begin, end, worker );
+  }
+
+  for ( victim = 1U; victim < pool->numWorkers; victim++ )
+  {
+    ASC_WORK_POOL_QUEUE * queue = &pool->queues[ ( worker + victim ) % pool->numWorkers ];
+
+    while ( _ClaimBack( queue, pool->grain, &begin, &end ) )
+    {
+      __atomic_add_fetch( &pool->steals, 1U, __ATOMIC_RELAXED );
+      pool->task( pool->context, begin, end, worker );
+    }
+  }
+}
+
+/*!
+ * \brief Helper thread, waits for a generation, works it, reports completion
+ */
+static void * _WorkerThread( void * context )
+{
+  ASC_WORK_POOL_WORKER * args = (ASC_WORK_POOL_WORKER*)context;
+  ASC_WORK_POOL * pool = (ASC_WORK_POOL*)args->pool;
+  uint32_t seen = 0U; // generation at creation, so work posted before this thread ran is not missed
+
+  pthread_mutex_lock( &pool->lock );
+
+  while ( !pool->shutdown )
+  {
+    if ( pool->generation == seen )
+    {
+      pthread_cond_wait( &pool->start, &pool->lock );
+    }
+    else
+    {
+      seen = pool->generation;
+      pthread_mutex_unlock( &pool->lock );
+
+      _Work( pool, args->index );
+
+      pthread_mutex_lock( &pool->lock );
+      pool->active--;
+
+      if ( pool->active == 0U )
+      {
+        pthread_cond_signal( &pool->done );
+      }
+    }
+  }
+
+  pthread_mutex_unlock( &pool->lock );
+
+  return (void*)0;
+}
+
+/*!
+ * \brief Starts the helper threads of a pool
+ * \param pool The pool to be created
+ * \param numWorkers Workers including the submitting thread, 0 for one per
+ * online processor
+ * \return success, on failure no thread is left running
+ */
+bool ASC_WORK_POOL_Create( ASC_WORK_POOL * pool, uint32_t numWorkers )
+{
+  bool status = false;
+
+  if ( pool )
+  {
+    uint32_t worker = 0U;
+
+    if ( numWorkers == 0U )
+    {
+      long online = sysconf( _SC_NPROCESSORS_ONLN );
+
+      numWorkers = ( online > 0 ) ? (uint32_t)online : 1U;
+    }
+
+    if ( numWorkers > ASC_WORK_POOL_MAX_WORKERS )
+    {
+      numWorkers = ASC_WORK_POOL_MAX_WORKERS;
+    }
+
+    memset( (char*)pool, 0, sizeof( *pool ) );
+    pool->numWorkers = numWorkers;
+    pthread_mutex_init( &pool->lock, (pthread_mutexattr_t*)0 );
+    pthread_cond_init( &pool->start, (pthread_condattr_t*)0 );
+    pthread_cond_init( &pool->done, (pthread_condattr_t*)0 );
+    status = true;
+
+    for ( worker = 1U; ( worker < numWorkers ) && status; worker++ )
+    {
+      pool->workers[ worker ].pool = (void*)pool;
+      pool->workers[ worker ].index = worker;
+      status = ( pthread_create( &pool->threads[ worker ], (pthread_attr_t*)0,
+                                 _WorkerThread, (void*)&pool->workers[ worker ] ) == 0 );
+
+      if ( !status )
+      {
+        // stop the workers already started, the caller has nothing to destroy
+        pool->numWorkers = worker;
+        ASC_WORK_POOL_Destroy( pool );
+      }
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Runs task over the items [0, count) on every worker and returns when
+ * all items are done. Items start evenly split between the workers; a worker
+ * that runs out steals chunks from the back of the others.
+ * \param pool The pool
+ * \param count Number of items
+ * \param grain Items per claim, 0 selects 1
+ * \param task The loop body
+ * \param context Passed through to task
+ */
+void ASC_WORK_POOL_ParallelFor( ASC_WORK_POOL * pool,
+                                uint32_t count,
+                                uint32_t grain,
+                                ASC_WORK_POOL_TASK task,
+                                void * context )
+{
+  if ( pool && task )
+  {
+    uint32_t worker = 0U;
+    uint32_t share = count / pool->numWorkers;
+    uint32_t extra = count % pool->numWorkers;
+    uint32_t next = 0U;
+
+    for ( worker = 0U; worker < pool->numWorkers; worker++ )
+    {
+      uint32_t length = share + ( ( worker < extra ) ? 1U : 0U );
+
+      __atomic_store_n( &pool->queues[ worker ].range, PACK( next, next + length ), __ATOMIC_RELEASE );
+      next += length;
+    }
+
+    pthread_mutex_lock( &pool->lock );
+    pool->task = task;
+    pool->context = context;
+    pool->grain = ( grain > 0U ) ? grain : 1U;
+    pool->active = pool->numWorkers - 1U;
+    pool->generation++;
+    pthread_cond_broadcast( &pool->start );
+    pthread_mutex_unlock( &pool->lock );
+
+    _Work( pool, 0U );
+
+    pthread_mutex_lock( &pool->lock );
+    while ( pool->active > 0U )
+    {
+      pthread_cond_wait( &pool->done, &pool->lock );
+    }
+    pthread_mutex_unlock( &pool->lock );
+  }
+}
+
+/*!
+ * \brief Stops and joins the helper threads
+ * \param pool The pool to be destroyed
+ */
+void ASC_WORK_POOL_Destroy( ASC_WORK_POOL * pool )
+{
+  if ( pool )
+  {
+    uint32_t worker = 0U;
+
+    pthread_mutex_lock( &pool->lock );
+    pool->shutdown = true;
+    pthread_cond_broadcast( &pool->start );
+    pthread_mutex_unlock( &pool->lock );
+
+    for ( worker = 1U; worker < pool->numWorkers; worker++ )
+    {
+      pthread_join( pool->threads[ worker ], (void**)0 );
+    }
+
+    pthread_cond_destroy( &pool->start );
+    pthread_cond_destroy( &pool->done );
+    pthread_mutex_destroy( &pool->lock );
+  }
+}
@@ -0,0 +1,92 @@
+/** 
+ * @file
+ * @brief Defines the interface to a work-stealing thread pool for running
+ * many thermal model instances in parallel on a host
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASC_WORK_POOL_H_
+#define _ASC_WORK_POOL_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASC_WORK_POOL_MAX_WORKERS (64U)
+
+    /*!
+     * \brief Body of a parallel loop, called for the items [begin, end)
+     * \param context The context passed to ASC_WORK_POOL_ParallelFor
+     * \param begin First item
+     * \param end One past the last item
+     * \param worker Index of the calling worker, 0 is the submitting thread
+     */
+    typedef void (*ASC_WORK_POOL_TASK)( void * context, uint32_t begin, uint32_t end, uint32_t worker );
+
+    /*!
+     * \brief The range of items owned by one worker. The owner takes chunks
+     * from the front and thieves take chunks from the back; both ends are
+     * packed in one word so every claim is a single compare-and-swap.
+     */
+    typedef struct
+    {
+        volatile uint64_t range; //!< next item in the low word, end in the high word
+        uint8_t pad[ 56 ]; //!< keeps each queue on its own cache line
+    } ASC_WORK_POOL_QUEUE;
+
+    /*!
+     * \brief Start argument of a helper thread
+     */
+    typedef struct
+    {
+        void * pool; //!< The owning ASC_WORK_POOL
+        uint32_t index; //!< Worker index, 1 .. numWorkers - 1
+    } ASC_WORK_POOL_WORKER;
+
+    typedef struct
+    {
+        uint32_t numWorkers; //!< Workers including the submitting thread
+        pthread_t threads[ ASC_WORK_POOL_MAX_WORKERS ];
+        ASC_WORK_POOL_WORKER workers[ ASC_WORK_POOL_MAX_WORKERS ];
+        ASC_WORK_POOL_QUEUE queues[ ASC_WORK_POOL_MAX_WORKERS ];
+        pthread_mutex_t lock;
+        pthread_cond_t start; //!< Signals a new generation of work
+        pthread_cond_t done; //!< Signals the last helper finished
+        uint32_t generation; //!< Incremented for every ParallelFor
+        uint32_t active; //!< Helpers still working on the generation
+        bool shutdown;
+        ASC_WORK_POOL_TASK task;
+        void * context;
+        uint32_t grain; //!< Items per claim
+        volatile uint32_t steals; //!< Chunks taken from another worker
+    } ASC_WORK_POOL;
+
+    extern bool ASC_WORK_POOL_Create( ASC_WORK_POOL * pool, uint32_t numWorkers );
+    extern void ASC_WORK_POOL_ParallelFor( ASC_WORK_POOL * pool,
+                                           uint32_t count,
+                                           uint32_t grain,
+                                           ASC_WORK_POOL_TASK task,
+                                           void * context );
+    extern void ASC_WORK_POOL_Destroy( ASC_WORK_POOL * pool );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @brief Runs the accuracy harness over every solver mode and scenario and
+ * fails when a mode strays further from the exact exponential than allowed
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_accuracy_check
+ *
+ * Prints one line per scenario and mode, see ASC_THERMAL_MODEL_ACCURACY_Run.
+ * Exits 0 when every mode stays within its tolerance.
+ */
+
+#include "thermal_model_accuracy.h"
+#include <stdint.h>
+#include <stdio.h>
+
+int main( int argc, char *argv[] )
+{
+  static ASC_THERMAL_MODEL_ACCURACY_RESULT results[ ASC_THERMAL_MODEL_ACCURACY_MAX_RESULTS ];
+  uint32_t numResults = 0U;
+  uint32_t numFailed = 0U;
+  uint32_t itr = 0U;
+
+  if ( argc > 1 )
+  {
+    fprintf( stderr, "usage: %s\n", argv[ 0 ] );
+    return 1;
+  }
+
+  numResults = ASC_THERMAL_MODEL_ACCURACY_Run( results, ASC_THERMAL_MODEL_ACCURACY_MAX_RESULTS );
+
+  printf( "%-10s %-22s %10s %10s %10s %10s\n", "scenario", "mode", "max err", "rms err", "tolerance", "ns/step" );
+
+  for ( itr = 0U; itr < numResults; itr++ )
+  {
+    printf( "%-10s %-22s %10.3e %10.3e %10.3e %10.1f %s\n",
+            results[ itr ].scenario,
+            results[ itr ].mode,
+            results[ itr ].maxAbsError,
+            results[ itr ].rmsError,
+            results[ itr ].tolerance,
+            results[ itr ].nsPerStep,
+            results[ itr ].passed ? "ok" : "FAIL" );
+
+    numFailed += results[ itr ].passed ? 0U : 1U;
+  }
+
+  if ( numResults == 0U )
+  {
+    fprintf( stderr, "the accuracy harness could not build its reference\n" );
+  }
+
+  printf( "%u of %u within tolerance\n", (unsigned)( numResults - numFailed ), (unsigned)numResults );
+
+  return ( ( numResults > 0U ) && ( numFailed == 0U ) ) ? 0 : 1;
+}
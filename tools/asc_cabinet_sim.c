@@ -0,0 +1,429 @@
+/**
+ * @file
+ * @brief Simulates a cabinet of axes heating each other through shared air and
+ * a shared mounting plate, built as one sparse RC network
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_cabinet_sim [-n axes] [-t seconds] [-f seconds] [-x] [-v]
+ * Every axis is a winding, housing and drive block; the housings and drives
+ * couple through the cabinet air and the plate they are mounted on. Axis k
+ * runs a 60 s duty cycle offset by k seconds with its own duty. The network
+ * is stepped with the sparse solver and, as a check, with the dense
+ * RK4SOLVER on the expanded matrices, -x skips the dense check for large
+ * cabinets. -f then forecasts every axis moving for the given seconds with
+ * the Krylov propagator and compares it against sparse RK4 steps. -v writes
+ * one CSV line per minute.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "rk4solver.h"
+#include "thermal_model.h"
+#include "thermal_network.h"
+#include "thermal_network_krylov.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define AXIS_NODES (3U) // winding, housing, drive
+#define AXIS_INPUTS (3U) // iron, copper, drive losses
+#define STEP (0.1f) // s
+#define CYCLE (60U) // s
+#define KRYLOV_DIM (30U)
+#define FORECAST_SAMPLES (10U)
+
+static const float _axisCapacitance[ AXIS_NODES ] = { 60.0f, 600.0f, 190.0f }; // J/K
+static const float _axisAmbient[ AXIS_NODES ] = { 0.0f, 0.0f, 0.0f }; // all heat leaves through the cabinet
+static const ASC_THERMAL_NETWORK_EDGE _axisEdges[] =
+{
+  { 0U, 1U, 0.87f } // winding to housing, W/K
+};
+static const ASC_THERMAL_NETWORK_SOURCE _axisSources[] =
+{
+  { 1U, 0U, 1.0f }, // iron losses heat the housing
+  { 0U, 1U, 1.0f }, // copper losses the winding
+  { 2U, 2U, 1.0f } // drive losses the drive
+};
+
+/*!
+ * \brief Builds the cabinet
+ * \return success
+ */
+static bool _BuildCabinet( ASC_THERMAL_NETWORK * net, uint32_t numAxes, uint32_t * air, uint32_t * plate )
+{
+  ASC_THERMAL_NETWORK_BLOCK axis =
+  {
+    AXIS_NODES, _axisCapacitance, _axisAmbient,
+    (uint32_t)( sizeof( _axisEdges ) / sizeof( _axisEdges[ 0 ] ) ), _axisEdges,
+    (uint32_t)( sizeof( _axisSources ) / sizeof( _axisSources[ 0 ] ) ), _axisSources
+  };
+  bool status = true;
+  uint32_t itr = 0U;
+
+  *air = ASC_THERMAL_NETWORK_AddNode( net, 20000.0f, 8.0f ); // air and walls, vented
+  *plate = ASC_THERMAL_NETWORK_AddNode( net, 15000.0f, 4.0f );
+  status = ( *plate != ASC_THERMAL_NETWORK_INVALID_NODE ) &&
+           ASC_THERMAL_NETWORK_Connect( net, *air, *plate, 3.0f );
+
+  for ( itr = 0U; ( itr < numAxes ) && status; itr++ )
+  {
+    uint32_t first = ASC_THERMAL_NETWORK_AddBlock( net, &axis, itr * AXIS_INPUTS );
+
+    status = ( first != ASC_THERMAL_NETWORK_INVALID_NODE ) &&
+             ASC_THERMAL_NETWORK_Connect( net, first + 1U, *air, 0.4f ) &&
+             ASC_THERMAL_NETWORK_Connect( net, first + 1U, *plate, 0.3f ) &&
+             ASC_THERMAL_NETWORK_Connect( net, first + 2U, *air, 0.2f ) &&
+             ASC_THERMAL_NETWORK_Connect( net, first + 2U, *plate, 0.2f );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Losses of every axis at time t
+ */
+static void _AxisInputs( float * inputs, uint32_t numAxes, uint32_t t )
+{
+  uint32_t itr = 0U;
+
+  for ( itr = 0U; itr < numAxes; itr++ )
+  {
+    uint32_t onTime = ( CYCLE * ( 2U + 6U * ( itr % 5U ) / 4U ) ) / 10U;
+    bool moving = ( ( t + itr ) % CYCLE ) < onTime;
+
+    ASC_THERMAL_MODEL_CalculateSourceInputs( &inputs[ itr * AXIS_INPUTS ],
+                                             moving ? 4.0f : 0.5f,
+                                             moving ? 36.7f : 0.0f );
+  }
+}
+
+/*!
+ * \brief Seconds between two clock readings
+ */
+static double _Seconds( const struct timespec * start, const struct timespec * stop )
+{
+  return (double)( stop->tv_sec - start->tv_sec ) + (double)( stop->tv_nsec - start->tv_nsec ) * 1e-9;
+}
+
+/*!
+ * \brief Forecasts every axis moving from the current state, once with the
+ * Krylov propagator and once with sparse RK4 steps
+ * \return success
+ */
+static bool _Forecast( const ASC_THERMAL_NETWORK_MODEL * model, uint32_t numAxes, const float * state,
+                       float * inputs, float * workspace, uint32_t horizon )
+{
+  uint32_t n = model->numStates;
+  float * peaks = (float*)calloc( 4U * n, sizeof( float ) );
+  double * krylovWorkspace = (double*)calloc( ASC_THERMAL_NETWORK_KRYLOV_WORKSPACE_LENGTH( n, KRYLOV_DIM ), sizeof( double ) );
+  bool status = false;
+
+  if ( peaks && krylovWorkspace )
+  {
+    ASC_THERMAL_NETWORK_KRYLOV krylov;
+    ASC_THERMAL_NETWORK_KRYLOV_STATS stats;
+    RK4SOLVER_INPUT input;
+    RK4SOLVER_OUTPUT output;
+    float * finalState = peaks + n;
+    float * rk4Peaks = finalState + n;
+    float * rk4State = rk4Peaks + n;
+    float duration = (float)horizon;
+    float peakDifference = 0.0f;
+    float stateDifference = 0.0f;
+    struct timespec start;
+    struct timespec stop;
+    double krylovTime = 0.0;
+    double rk4Time = 0.0;
+    uint32_t step = 0U;
+    uint32_t itr = 0U;
+
+    for ( itr = 0U; itr < numAxes; itr++ )
+    {
+      ASC_THERMAL_MODEL_CalculateSourceInputs( &inputs[ itr * AXIS_INPUTS ], 4.0f, 36.7f );
+    }
+
+    krylov.tolerance = 1.0E-03f;
+    krylov.maxDim = KRYLOV_DIM;
+    krylov.workspace = krylovWorkspace;
+    memset( (char*)&stats, 0, sizeof( stats ) );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    status = ASC_THERMAL_NETWORK_KRYLOV_Forecast( &krylov, model, state, inputs, &duration, 1U,
+                                                  FORECAST_SAMPLES, peaks, finalState, &stats );
+    clock_gettime( CLOCK_MONOTONIC, &stop );
+    krylovTime = _Seconds( &start, &stop );
+
+    memcpy( (char*)rk4State, (char*)state, n * sizeof( float ) );
+    memcpy( (char*)rk4Peaks, (char*)state, n * sizeof( float ) );
+    input.h = STEP;
+    input.currentState = rk4State;
+    input.currentInput = inputs;
+    input.nextInput = inputs;
+    input.workspace = workspace;
+    output.nextState = rk4State;
+    output.nextOutput = (float*)0;
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for ( step = 0U; step < 10U * horizon; step++ )
+    {
+      ASC_THERMAL_NETWORK_Solve( model, &input, &output );
+
+      if ( ( ( step + 1U ) % ( ( 10U * horizon ) / FORECAST_SAMPLES ) ) == 0U )
+      {
+        for ( itr = 0U; itr < n; itr++ )
+        {
+          rk4Peaks[ itr ] = fmaxf( rk4Peaks[ itr ], rk4State[ itr ] );
+        }
+      }
+    }
+    clock_gettime( CLOCK_MONOTONIC, &stop );
+    rk4Time = _Seconds( &start, &stop );
+
+    for ( itr = 0U; itr < n; itr++ )
+    {
+      peakDifference = fmaxf( peakDifference, fabsf( peaks[ itr ] - rk4Peaks[ itr ] ) );
+      stateDifference = fmaxf( stateDifference, fabsf( finalState[ itr ] - rk4State[ itr ] ) );
+    }
+
+    fprintf( stderr, "%u s forecast: krylov %.2f ms (%u products, %u substeps, %u rejected, estimate %.1e K), "
+             "rk4 %.2f ms, largest difference %.2e K in the peaks and %.2e K at the end\n",
+             horizon, krylovTime * 1e3, stats.matvecs, stats.substeps, stats.rejected,
+             (double)stats.errorEstimate, rk4Time * 1e3, peakDifference, stateDifference );
+  }
+
+  free( (void*)krylovWorkspace );
+  free( (void*)peaks );
+
+  return status;
+}
+
+int main( int argc, char *argv[] )
+{
+  int exitCode = 1;
+  uint32_t numAxes = 24U;
+  uint32_t duration = 3600U;
+  uint32_t horizon = 0U;
+  bool verbose = false;
+  bool dense = true;
+  int arg = 0;
+
+  for ( arg = 1; arg < argc; arg++ )
+  {
+    if ( ( strcmp( argv[ arg ], "-n" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      numAxes = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-t" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      duration = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-f" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      horizon = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( strcmp( argv[ arg ], "-x" ) == 0 )
+    {
+      dense = false;
+    }
+    else if ( strcmp( argv[ arg ], "-v" ) == 0 )
+    {
+      verbose = true;
+    }
+    else
+    {
+      fprintf( stderr, "usage: %s [-n axes] [-t seconds] [-f seconds] [-x] [-v]\n", argv[ 0 ] );
+      return 1;
+    }
+  }
+
+  {
+    uint32_t maxNodes = 2U + AXIS_NODES * numAxes;
+    uint32_t maxEdges = 1U + 5U * numAxes;
+    uint32_t maxSources = AXIS_INPUTS * numAxes;
+    uint32_t maxNonzeros = ASC_THERMAL_NETWORK_MAX_NONZEROS( maxNodes, maxEdges );
+    uint32_t numInputs = AXIS_INPUTS * numAxes;
+    uint32_t workspaceLength = RK4SOLVER_WORKSPACE_LENGTH( maxNodes, numInputs );
+    float * capacitance = (float*)calloc( maxNodes, sizeof( float ) );
+    float * ambient = (float*)calloc( maxNodes, sizeof( float ) );
+    ASC_THERMAL_NETWORK_EDGE * edges = (ASC_THERMAL_NETWORK_EDGE*)calloc( maxEdges, sizeof( ASC_THERMAL_NETWORK_EDGE ) );
+    ASC_THERMAL_NETWORK_SOURCE * sources = (ASC_THERMAL_NETWORK_SOURCE*)calloc( maxSources, sizeof( ASC_THERMAL_NETWORK_SOURCE ) );
+    uint32_t * rowStart = (uint32_t*)calloc( 2U * ( maxNodes + 1U ) + maxNonzeros + maxSources, sizeof( uint32_t ) );
+    float * values = (float*)calloc( maxNonzeros + maxSources, sizeof( float ) );
+    float * matrices = dense ? (float*)calloc( 2U * maxNodes * ( maxNodes + numInputs ), sizeof( float ) ) : (float*)0; // A, B then C, D
+    float * state = (float*)calloc( 3U * maxNodes + numInputs + 2U * workspaceLength, sizeof( float ) );
+    ASC_THERMAL_NETWORK net;
+    ASC_THERMAL_NETWORK_MODEL model;
+    uint32_t air = 0U;
+    uint32_t plate = 0U;
+
+    if ( capacitance && ambient && edges && sources && rowStart && values && ( matrices || !dense ) && state && ( numAxes > 0U ) &&
+         ASC_THERMAL_NETWORK_Init( &net, maxNodes, capacitance, ambient, maxEdges, edges, maxSources, sources ) &&
+         _BuildCabinet( &net, numAxes, &air, &plate ) )
+    {
+      RK4SOLVER_CONFIGURATION config = { 0U, 0U, 0U, (float*)0, (float*)0, (float*)0, (float*)0,
+                                         (const RK4SOLVER_PACKED*)0 };
+      RK4SOLVER_INPUT sparseInput;
+      RK4SOLVER_OUTPUT sparseOutput;
+      RK4SOLVER_INPUT denseInput;
+      RK4SOLVER_OUTPUT denseOutput;
+      float * sparseState = state;
+      float * denseState = sparseState + maxNodes;
+      float * inputs = denseState + maxNodes;
+      float * denseOutputs = inputs + numInputs; // C = I, one output per state
+      float * sparseWorkspace = denseOutputs + maxNodes;
+      float * denseWorkspace = sparseWorkspace + workspaceLength;
+      double sparseTime = 0.0;
+      double denseTime = 0.0;
+      float maxDifference = 0.0f;
+      float hottest = 0.0f;
+      uint32_t hottestAxis = 0U;
+      uint32_t second = 0U;
+      uint32_t step = 0U;
+      uint32_t itr = 0U;
+
+      model.rowStart = rowStart;
+      model.inputRowStart = rowStart + maxNodes + 1U;
+      model.columns = model.inputRowStart + maxNodes + 1U;
+      model.inputColumns = model.columns + maxNonzeros;
+      model.values = values;
+      model.inputValues = values + maxNonzeros;
+
+      ASC_THERMAL_NETWORK_Assemble( &net, &model );
+
+      // the dense solver's outputs are y = [C]*x + [D]*u, the node temperatures
+      if ( dense )
+      {
+        float * C = matrices + ( model.numStates * ( model.numStates + model.numInputs ) );
+
+        ASC_THERMAL_NETWORK_ToDense( &model, matrices, matrices + ( model.numStates * model.numStates ) );
+
+        for ( itr = 0U; itr < model.numStates; itr++ )
+        {
+          C[ ( itr * model.numStates ) + itr ] = 1.0f;
+        }
+
+        config.numStates = model.numStates;
+        config.numInputs = model.numInputs;
+        config.numOutputs = model.numStates;
+        config.A = matrices;
+        config.B = matrices + ( model.numStates * model.numStates );
+        config.C = C;
+        config.D = C + ( model.numStates * model.numStates );
+      }
+
+      sparseInput.h = STEP;
+      sparseInput.currentState = sparseState;
+      sparseInput.currentInput = inputs;
+      sparseInput.nextInput = inputs;
+      sparseInput.workspace = sparseWorkspace;
+      sparseOutput.nextState = sparseState;
+      sparseOutput.nextOutput = (float*)0;
+
+      denseInput = sparseInput;
+      denseInput.currentState = denseState;
+      denseInput.workspace = denseWorkspace;
+      denseOutput.nextState = denseState;
+      denseOutput.nextOutput = denseOutputs;
+
+      if ( verbose )
+      {
+        printf( "t,air,plate,hottest_winding,hottest_drive\n" );
+      }
+
+      for ( second = 0U; second < duration; second++ )
+      {
+        struct timespec start;
+        struct timespec stop;
+
+        _AxisInputs( inputs, numAxes, second );
+
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        for ( step = 0U; step < 10U; step++ )
+        {
+          ASC_THERMAL_NETWORK_Solve( &model, &sparseInput, &sparseOutput );
+        }
+        clock_gettime( CLOCK_MONOTONIC, &stop );
+        sparseTime += _Seconds( &start, &stop );
+
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        for ( step = 0U; dense && ( step < 10U ); step++ )
+        {
+          RK4SOLVER_Solve( &config, &denseInput, &denseOutput );
+        }
+        clock_gettime( CLOCK_MONOTONIC, &stop );
+        denseTime += _Seconds( &start, &stop );
+
+        for ( itr = 0U; dense && ( itr < model.numStates ); itr++ )
+        {
+          float difference = fabsf( sparseState[ itr ] - denseState[ itr ] );
+
+          maxDifference = ( difference > maxDifference ) ? difference : maxDifference;
+        }
+
+        if ( verbose && ( ( ( second + 1U ) % 60U ) == 0U ) )
+        {
+          float winding = 0.0f;
+          float drive = 0.0f;
+
+          for ( itr = 0U; itr < numAxes; itr++ )
+          {
+            winding = fmaxf( winding, sparseState[ 2U + ( itr * AXIS_NODES ) ] );
+            drive = fmaxf( drive, sparseState[ 2U + ( itr * AXIS_NODES ) + 2U ] );
+          }
+          printf( "%u,%.3f,%.3f,%.3f,%.3f\n", second + 1U, sparseState[ air ], sparseState[ plate ], winding, drive );
+        }
+      }
+
+      for ( itr = 0U; itr < numAxes; itr++ )
+      {
+        if ( sparseState[ 2U + ( itr * AXIS_NODES ) ] > hottest )
+        {
+          hottest = sparseState[ 2U + ( itr * AXIS_NODES ) ];
+          hottestAxis = itr;
+        }
+      }
+
+      fprintf( stderr, "%u axes, %u nodes, %u edges: %u nonzeros of %u dense entries\n",
+               numAxes, model.numStates, net.numEdges, model.rowStart[ model.numStates ],
+               model.numStates * model.numStates );
+      fprintf( stderr, "%u s: sparse %.3f s, dense %.3f s, largest difference %.2e K\n",
+               duration, sparseTime, denseTime, maxDifference );
+      fprintf( stderr, "rise over ambient: air %.2f K, plate %.2f K, hottest winding %.2f K on axis %u\n",
+               sparseState[ air ], sparseState[ plate ], hottest, hottestAxis );
+
+      exitCode = ( ( horizon == 0U ) ||
+                   _Forecast( &model, numAxes, sparseState, inputs, sparseWorkspace, horizon ) ) ? 0 : 1;
+    }
+    else
+    {
+      fprintf( stderr, "cannot build a cabinet of %u axes\n", numAxes );
+    }
+
+    free( (void*)state );
+    free( (void*)matrices );
+    free( (void*)values );
+    free( (void*)rowStart );
+    free( (void*)sources );
+    free( (void*)edges );
+    free( (void*)ambient );
+    free( (void*)capacitance );
+  }
+
+  return exitCode;
+}
@@ -0,0 +1,573 @@
+/**
+ * @file
+ * @brief Closed-loop co-simulation of the torque manager, PI controller and
+ * thermal model against a stand-in stepper drive plant on a virtual clock
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_cosim [-t seconds] [-s seed] [-l load scale] [-d dwell scale] [-v]
+ *                  [-m name [-r]] [-p] [-M model.bin]
+ * Runs the drive firmware tasks on a virtual clock: the torque manager and
+ * DynamicTorqueCalculation every 10 ms, the thermal model periodic and
+ * background tasks every 1 s. The plant is integrated at 1 ms. Moves, loads
+ * and durations come from a seeded generator, so a seed always reproduces the
+ * same run. -l scales the move loads, moves above HEAVY_LOAD cruise at the FULL
+ * setpoint, which the thermal policy only allows while the overload predictor
+ * does. -d scales the standstill between moves. -v writes one CSV line per
+ * second to stdout. -m publishes the model into the live state table <name>
+ * for asc_live_monitor, -r then paces the virtual clock to real time. -p feeds
+ * the model from the precomputed setpoint loads the torque manager selects
+ * instead of the measured current, as firmware without current sensing would.
+ * -M runs the firmware on a model file from asc_model_convert, the plant keeps
+ * the compiled in matrices.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "live_state.h"
+#include "rk4solver.h"
+#include "thermal_model.h"
+#include "thermal_model_state_space.h"
+#include "torque_manager.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+
+/* Virtual clock */
+#define PLANT_STEP (0.001f) // s
+#define CONTROL_TICKS (10U) // plant steps per control tick
+#define THERMAL_TICKS (100U) // control ticks per thermal period
+#define CONTROL_STEP ( PLANT_STEP * (float)CONTROL_TICKS )
+
+/* Stand-in stepper drive, same electrical constants as
+ * ASC_THERMAL_MODEL_CalculateSourceInputs
+ */
+#define PLANT_BUS_VOLTAGE (48.0f) // V
+#define PLANT_PHASE_RESISTANCE (1.0f) // Ohm at ambient
+#define PLANT_ELECTRICAL_TAU (0.002f) // s, L/R
+#define PLANT_BACK_EMF (0.3f) // V s/rad
+#define PLANT_TORQUE_CONSTANT (0.3f) // N m/A
+#define PLANT_INERTIA (2.0E-04f) // kg m^2
+#define PLANT_FRICTION (0.05f) // N m
+#define PLANT_MAX_CURRENT (6.0f) // A peak at torque value 255
+#define PLANT_COPPER_TEMPCO (0.0039f) // 1/K
+#define PLANT_STALL_TIME (0.005f) // s of torque deficit before the rotor loses a step
+
+#define HEAVY_LOAD (0.5f) // N m, moves above it cruise at the FULL setpoint
+#define FEEDFORWARD_SHIFT (2U) // PI output is scaled down before it is used as feedforward
+#define TYPICAL_SPEED (32.5f) // rad/s, mean cruise speed of the generated moves
+
+/*!
+ * \brief One move of the generated motion profile
+ */
+typedef struct
+{
+  float speed; //!< Cruise speed in rad/s
+  float accel; //!< rad/s^2
+  float load; //!< Load torque in N m
+  float cruise; //!< Cruise time in s
+  float dwell; //!< Standstill after the move in s
+} COSIM_MOVE;
+
+typedef enum
+{
+  PHASE_ACCEL = 0,
+  PHASE_CRUISE,
+  PHASE_DECEL,
+  PHASE_DWELL
+} COSIM_PHASE;
+
+/*!
+ * \brief Plant state
+ */
+typedef struct
+{
+  float current; //!< Phase current amplitude in A
+  float commandCurrent; //!< From the last setTorque call
+  float speed; //!< rad/s
+  float requiredTorque; //!< Load plus inertia torque of the commanded motion
+  float deficitTime; //!< How long the torque has been short of the required torque
+  bool stalled; //!< Lost synchronism for the rest of the move
+  float thermalState[ NUM_STATES ]; //!< The "true" temperatures
+  float thermalOutputs[ NUM_OUTPUTS ];
+} COSIM_PLANT;
+
+/*!
+ * \brief Run statistics
+ */
+typedef struct
+{
+  uint32_t moves;
+  uint32_t stalls;
+  uint32_t torqueCommands;
+  uint32_t deniedPeriods;
+  float peakPlant[ NUM_OUTPUTS ];
+  float peakModel[ NUM_OUTPUTS ];
+  float maxEstimateError;
+  double energy; //!< Copper and drive losses in J
+} COSIM_STATS;
+
+static COSIM_PLANT _plant;
+static uint32_t _rng = 1U;
+static float _loadScale = 1.0f;
+static float _dwellScale = 1.0f;
+
+/*!
+ * \brief xorshift32, the only source of randomness so runs are reproducible
+ * \return Uniform value in [0, 1)
+ */
+static float _Random( void )
+{
+  _rng ^= _rng << 13;
+  _rng ^= _rng >> 17;
+  _rng ^= _rng << 5;
+
+  return (float)( _rng >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+/*!
+ * \brief Draws the next move of the motion profile
+ */
+static void _NextMove( COSIM_MOVE * move )
+{
+  move->speed = 15.0f + 35.0f * _Random();
+  move->accel = 100.0f + 400.0f * _Random();
+  move->load = _loadScale * ( 0.1f + 0.9f * _Random() * _Random() );
+  move->cruise = 0.5f + 8.0f * _Random();
+  move->dwell = _dwellScale * ( ( _Random() < 0.2f ) ? ( 5.0f + 25.0f * _Random() ) : ( 0.2f + 1.5f * _Random() ) );
+}
+
+/*!
+ * \brief setTorque callback of the torque manager, the drive's current
+ * reference
+ */
+static void _SetTorque( uint8_t value )
+{
+  _plant.commandCurrent = PLANT_MAX_CURRENT * (float)value / 255.0f;
+}
+
+/*!
+ * \brief Advances the electrical and mechanical plant by one step. The
+ * stepper follows the commanded speed while the torque it can produce covers
+ * the load and inertia torque, a deficit longer than PLANT_STALL_TIME stalls
+ * it until the next move.
+ */
+static void _PlantStep( float commandSpeed, float commandAccel, float load )
+{
+  float resistance = PLANT_PHASE_RESISTANCE * ( 1.0f + PLANT_COPPER_TEMPCO * _plant.thermalOutputs[ 1 ] );
+  float headroom = ( PLANT_BUS_VOLTAGE - PLANT_BACK_EMF * _plant.speed ) / resistance;
+  float target = ( _plant.commandCurrent < headroom ) ? _plant.commandCurrent : headroom;
+
+  target = ( target > 0.0f ) ? target : 0.0f;
+  _plant.current += ( target - _plant.current ) * ( PLANT_STEP / PLANT_ELECTRICAL_TAU );
+
+  _plant.requiredTorque = ( commandSpeed > 0.0f ) ? ( load + PLANT_FRICTION + PLANT_INERTIA * commandAccel ) : 0.0f;
+
+  if ( _plant.requiredTorque > PLANT_TORQUE_CONSTANT * _plant.current )
+  {
+    _plant.deficitTime += PLANT_STEP;
+    _plant.stalled = _plant.stalled || ( _plant.deficitTime > PLANT_STALL_TIME );
+  }
+  else
+  {
+    _plant.deficitTime = 0.0f;
+  }
+
+  _plant.speed = _plant.stalled ? 0.0f : commandSpeed;
+}
+
+/*!
+ * \brief Torque margin in percent, the feedback of DynamicTorqueCalculation
+ */
+static uint8_t _TorqueMargin( void )
+{
+  float available = PLANT_TORQUE_CONSTANT * _plant.current;
+  float margin = ( available > 0.0f ) ? ( 100.0f * ( 1.0f - _plant.requiredTorque / available ) ) : 0.0f;
+
+  margin = ( margin > 0.0f ) ? margin : 0.0f;
+
+  return (uint8_t)( ( margin < 100.0f ) ? margin : 100.0f );
+}
+
+/*!
+ * \brief Integrates the plant temperatures over one thermal period with the
+ * losses the plant actually produced, including the copper resistance rise
+ * that the model does not know about
+ */
+static void _PlantThermalStep( float * inputs )
+{
+  static float workspace[ RK4SOLVER_WORKSPACE_LENGTH( NUM_STATES, NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+  RK4SOLVER_INPUT input = { 0.1f, _plant.thermalState, inputs, inputs, workspace };
+  RK4SOLVER_OUTPUT output = { _plant.thermalState, _plant.thermalOutputs };
+  uint32_t itr = 0U;
+
+  for ( itr = 0U; itr < 10U; itr++ )
+  {
+    RK4SOLVER_Solve( ASC_THERMAL_MODEL_config, &input, &output );
+  }
+}
+
+int main( int argc, char *argv[] )
+{
+  uint32_t duration = 4U * 3600U;
+  uint32_t seed = 1U;
+  bool verbose = false;
+  bool realTime = false;
+  bool setpointInputs = false;
+  const char * modelPath = (const char*)0;
+  ASC_THERMAL_MODEL_FILE model;
+  ASC_THERMAL_MODEL_SETPOINT_ENTRY setpointLoads[ ASC_TORQUE_SETPOINT_COUNT ];
+  ASC_THERMAL_MODEL_SETPOINT_ACCUMULATOR setpointSum;
+  const char * liveStateName = (const char*)0;
+  ASC_LIVE_STATE_TABLE liveState;
+  ASC_TORQUE_MANAGER manager =
+  {
+    255U, // setpoint limit
+    0U,
+    0U,
+    0U,
+    0U,
+    0U,
+    _SetTorque,
+    { 0U, 30U, 170U, 150U, 110U, 150U, 130U, 230U }, // OFF .. FULL
+    { 10, 1, 1, 10, 0, 64U, 0U, 1U }, // same tuning as the torque manager's own controller
+    (const ASC_THERMAL_MODEL_SETPOINT_ENTRY*)0, // thermal entries, set by ASC_TORQUE_MANAGER_SetThermalEntries
+    (const ASC_THERMAL_MODEL_SETPOINT_ENTRY*)0
+  };
+  COSIM_MOVE move;
+  COSIM_PHASE phase = PHASE_DWELL;
+  COSIM_STATS stats;
+  float phaseTime = 0.0f;
+  float commandSpeed = 0.0f;
+  float commandAccel = 0.0f;
+  float modelSum[ NUM_INPUTS ];
+  float plantSum[ NUM_INPUTS ];
+  float modelTemps[ NUM_OUTPUTS ];
+  struct timespec start;
+  struct timespec stop;
+  double wall = 0.0;
+  uint32_t second = 0U;
+  uint32_t tick = 0U;
+  uint32_t step = 0U;
+  uint32_t i = 0U;
+  int arg = 0;
+
+  for ( arg = 1; arg < argc; arg++ )
+  {
+    if ( ( strcmp( argv[ arg ], "-t" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      duration = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-s" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      seed = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-l" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      _loadScale = strtof( argv[ ++arg ], (char**)0 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-d" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      _dwellScale = strtof( argv[ ++arg ], (char**)0 );
+    }
+    else if ( strcmp( argv[ arg ], "-v" ) == 0 )
+    {
+      verbose = true;
+    }
+    else if ( ( strcmp( argv[ arg ], "-m" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      liveStateName = argv[ ++arg ];
+    }
+    else if ( strcmp( argv[ arg ], "-r" ) == 0 )
+    {
+      realTime = true;
+    }
+    else if ( strcmp( argv[ arg ], "-p" ) == 0 )
+    {
+      setpointInputs = true;
+    }
+    else if ( ( strcmp( argv[ arg ], "-M" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      modelPath = argv[ ++arg ];
+    }
+    else
+    {
+      fprintf( stderr, "usage: %s [-t seconds] [-s seed] [-l load scale] [-d dwell scale] [-v] [-m name [-r]] [-p] [-M model.bin]\n", argv[ 0 ] );
+      return 1;
+    }
+  }
+
+  _rng = ( seed != 0U ) ? seed : 1U;
+  memset( (char*)&_plant, 0, sizeof( _plant ) );
+  memset( (char*)&stats, 0, sizeof( stats ) );
+  memset( (char*)&move, 0, sizeof( move ) );
+  memset( (char*)&setpointSum, 0, sizeof( setpointSum ) );
+
+  if ( modelPath )
+  {
+    if ( !ASC_THERMAL_MODEL_FILE_Open( &model, modelPath ) || !ASC_THERMAL_MODEL_SelectModel( &model ) )
+    {
+      fprintf( stderr, "%s: not a model file for this model layout\n", modelPath );
+      return 1;
+    }
+
+    fprintf( stderr, "model %s\n", model.image->name );
+  }
+
+  if ( !ASC_THERMAL_MODEL_Setup() )
+  {
+    fprintf( stderr, "thermal model setup failed\n" );
+    return 1;
+  }
+
+  if ( setpointInputs )
+  {
+    float currents[ ASC_TORQUE_SETPOINT_COUNT ];
+    float speeds[ ASC_TORQUE_SETPOINT_COUNT ];
+
+    for ( i = 0U; i < ASC_TORQUE_SETPOINT_COUNT; i++ )
+    {
+      currents[ i ] = PLANT_MAX_CURRENT * (float)manager.setpoints[ i ] / 255.0f;
+      speeds[ i ] = ( ( i == ASC_TORQUE_CRUISE_INDEX ) || ( i == ASC_TORQUE_FULL_INDEX ) ) ? TYPICAL_SPEED :
+                    ( ( i == ASC_TORQUE_OFF_INDEX ) || ( i == ASC_TORQUE_IDLE_INDEX ) ) ? 0.0f : 0.5f * TYPICAL_SPEED;
+    }
+
+    if ( !ASC_THERMAL_MODEL_BuildSetpointTable( setpointLoads, ASC_TORQUE_SETPOINT_COUNT, currents, speeds ) )
+    {
+      fprintf( stderr, "setpoint table build failed\n" );
+      return 1;
+    }
+
+    ASC_TORQUE_MANAGER_SetThermalEntries( &manager, setpointLoads );
+  }
+
+  if ( liveStateName )
+  {
+    if ( !ASC_LIVE_STATE_Create( &liveState, liveStateName, 1U ) )
+    {
+      fprintf( stderr, "%s: cannot create the live state table\n", liveStateName );
+      return 1;
+    }
+
+    ASC_THERMAL_MODEL_SetLiveState( &liveState, 0U, 0U );
+  }
+
+  if ( verbose )
+  {
+    printf( "t,speed,current,torque_index,limit,overload" );
+    for ( i = 0U; i < NUM_OUTPUTS; i++ )
+    {
+      printf( ",plant_y%u,model_y%u", i, i );
+    }
+    printf( "\n" );
+  }
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  for ( second = 0U; second < duration; second++ )
+  {
+    memset( (char*)modelSum, 0, sizeof( modelSum ) );
+    memset( (char*)plantSum, 0, sizeof( plantSum ) );
+
+    for ( tick = 0U; tick < THERMAL_TICKS; tick++ )
+    {
+      float inputs[ NUM_INPUTS ];
+      uint8_t index = ASC_TORQUE_IDLE_INDEX;
+
+      // motion profile, trapezoidal moves separated by dwells
+      phaseTime += CONTROL_STEP;
+
+      switch ( phase )
+      {
+        case PHASE_ACCEL:
+          index = ASC_TORQUE_ACCEL_PLUS_INDEX;
+          commandAccel = move.accel;
+          commandSpeed += move.accel * CONTROL_STEP;
+          if ( commandSpeed >= move.speed )
+          {
+            commandSpeed = move.speed;
+            phase = PHASE_CRUISE;
+            phaseTime = 0.0f;
+          }
+          break;
+
+        case PHASE_CRUISE:
+          index = ( move.load > HEAVY_LOAD ) ? ASC_TORQUE_FULL_INDEX : ASC_TORQUE_CRUISE_INDEX;
+          commandAccel = 0.0f;
+          if ( phaseTime >= move.cruise )
+          {
+            phase = PHASE_DECEL;
+            phaseTime = 0.0f;
+          }
+          break;
+
+        case PHASE_DECEL:
+          index = ASC_TORQUE_DECEL_PLUS_INDEX;
+          commandAccel = move.accel;
+          commandSpeed -= move.accel * CONTROL_STEP;
+          if ( commandSpeed <= 0.0f )
+          {
+            commandSpeed = 0.0f;
+            phase = PHASE_DWELL;
+            phaseTime = 0.0f;
+          }
+          break;
+
+        default:
+          index = ASC_TORQUE_IDLE_INDEX;
+          commandAccel = 0.0f;
+          commandSpeed = 0.0f;
+          if ( phaseTime >= move.dwell )
+          {
+            _NextMove( &move );
+            stats.moves++;
+            stats.stalls += _plant.stalled ? 1U : 0U;
+            _plant.stalled = false;
+            phase = PHASE_ACCEL;
+            phaseTime = 0.0f;
+          }
+          break;
+      }
+
+      // firmware control tick
+      ASC_TORQUE_MANAGER_SetTorqueByIndex( &manager, index );
+      ASC_TORQUE_MANAGER_SetFeedforwardValue( &manager,
+        (uint8_t)( ASC_TORQUE_MANAGER_DynamicTorqueCalculation( &manager, _TorqueMargin() ) >> FEEDFORWARD_SHIFT ) );
+
+      if ( ( manager.lastSetpointValue != manager.activeSetpointValue ) ||
+           ( manager.lastFeedforwardValue != manager.activeFeedforwardValue ) )
+      {
+        stats.torqueCommands++;
+      }
+
+      ASC_TORQUE_MANAGER_ForegroundTask( &manager );
+
+      if ( setpointInputs )
+      {
+        ASC_THERMAL_MODEL_SETPOINT_TABLE_Accumulate( &setpointSum, manager.activeThermalEntry );
+      }
+
+      for ( step = 0U; step < CONTROL_TICKS; step++ )
+      {
+        _PlantStep( commandSpeed, commandAccel, move.load );
+      }
+
+      // losses of this tick, averaged over the thermal period
+      ASC_THERMAL_MODEL_CalculateSourceInputs( inputs, _plant.current, _plant.speed );
+
+      for ( i = 0U; i < NUM_INPUTS; i++ )
+      {
+        float actual = inputs[ i ] * ( ( i == 1U ) ? ( 1.0f + PLANT_COPPER_TEMPCO * _plant.thermalOutputs[ 1 ] ) : 1.0f );
+
+        modelSum[ i ] += inputs[ i ] / (float)THERMAL_TICKS;
+        plantSum[ i ] += actual / (float)THERMAL_TICKS;
+        stats.energy += (double)actual * (double)CONTROL_STEP;
+      }
+    }
+
+    _PlantThermalStep( plantSum );
+
+    // the firmware sees the losses of its own model, without the resistance rise
+    if ( !setpointInputs || !ASC_THERMAL_MODEL_SetSetpointInputs( &setpointSum ) )
+    {
+      ASC_THERMAL_MODEL_SetInputs( modelSum );
+    }
+    ASC_THERMAL_MODEL_PeriodicTask();
+    ASC_THERMAL_MODEL_BackgroundTask();
+    ASC_THERMAL_MODEL_GetCurrentTemp( modelTemps );
+
+    // thermal policy: overload setpoints only while the predictor allows them
+    if ( ASC_THERMAL_MODEL_IsOverloadAvailable() )
+    {
+      ASC_TORQUE_MANAGER_SetSetpointLimit( &manager, 255U );
+    }
+    else
+    {
+      ASC_TORQUE_MANAGER_SetSetpointLimit( &manager, manager.setpoints[ ASC_TORQUE_CRUISE_INDEX ] );
+      stats.deniedPeriods++;
+    }
+
+    for ( i = 0U; i < NUM_OUTPUTS; i++ )
+    {
+      float error = modelTemps[ i ] - _plant.thermalOutputs[ i ];
+
+      error = ( error < 0.0f ) ? -error : error;
+      stats.maxEstimateError = ( error > stats.maxEstimateError ) ? error : stats.maxEstimateError;
+      stats.peakPlant[ i ] = ( _plant.thermalOutputs[ i ] > stats.peakPlant[ i ] ) ? _plant.thermalOutputs[ i ] : stats.peakPlant[ i ];
+      stats.peakModel[ i ] = ( modelTemps[ i ] > stats.peakModel[ i ] ) ? modelTemps[ i ] : stats.peakModel[ i ];
+    }
+
+    if ( verbose )
+    {
+      printf( "%u,%.2f,%.3f,%u,%u,%u", second + 1U, _plant.speed, _plant.current,
+              manager.activeSetpointIndex, manager.setpointLimit,
+              ASC_THERMAL_MODEL_IsOverloadAvailable() ? 1U : 0U );
+      for ( i = 0U; i < NUM_OUTPUTS; i++ )
+      {
+        printf( ",%.3f,%.3f", _plant.thermalOutputs[ i ], modelTemps[ i ] );
+      }
+      printf( "\n" );
+    }
+
+    if ( realTime )
+    {
+      struct timespec period = { 1, 0 };
+
+      nanosleep( &period, (struct timespec*)0 );
+    }
+  }
+
+  clock_gettime( CLOCK_MONOTONIC, &stop );
+  wall = (double)( stop.tv_sec - start.tv_sec ) + (double)( stop.tv_nsec - start.tv_nsec ) * 1e-9;
+
+  fprintf( stderr, "seed %u: %u s simulated in %.3f s (x%.0f real time)\n",
+           seed, duration, wall, ( wall > 0.0 ) ? (double)duration / wall : 0.0 );
+  fprintf( stderr, "  %u moves, %u stalled, %u torque commands, overload denied %u of %u s\n",
+           stats.moves, stats.stalls, stats.torqueCommands, stats.deniedPeriods, duration );
+  fprintf( stderr, "  losses %.1f kJ, estimate error max %.3f K\n", stats.energy / 1000.0, stats.maxEstimateError );
+  fprintf( stderr, "  peak rise plant" );
+  for ( i = 0U; i < NUM_OUTPUTS; i++ )
+  {
+    fprintf( stderr, " %.2f", stats.peakPlant[ i ] );
+  }
+  fprintf( stderr, ", model" );
+  for ( i = 0U; i < NUM_OUTPUTS; i++ )
+  {
+    fprintf( stderr, " %.2f", stats.peakModel[ i ] );
+  }
+  fprintf( stderr, "\n" );
+
+  if ( liveStateName )
+  {
+    ASC_THERMAL_MODEL_SetLiveState( (ASC_LIVE_STATE_TABLE*)0, 0U, 0U );
+    ASC_LIVE_STATE_Close( &liveState );
+  }
+
+  ASC_THERMAL_MODEL_Cleanup();
+
+  if ( modelPath )
+  {
+    ASC_THERMAL_MODEL_SelectModel( (ASC_THERMAL_MODEL_FILE*)0 );
+    ASC_THERMAL_MODEL_FILE_Close( &model );
+  }
+
+  return 0;
+}
@@ -0,0 +1,480 @@
+/**
+ * @file
+ * @brief Fleet simulator, runs the thermal model of every axis of a machine
+ * park in parallel and reports peak temperatures and overload denials
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Fleet description, one directive per line, '#' starts a comment:
+ *   ambient <degC>
+ *   duration <s>
+ *   predict <s>                 interval between overload predictions
+ *   profile <name> <s> <A> <rad/s> [<s> <A> <rad/s> ...]   repeating duty cycle
+ *   axes <count> <profile> [<stagger s>]   axis k starts k*stagger into the cycle
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "rk4solver.h"
+#include "thermal_model.h"
+#include "thermal_model_state_space.h"
+#include "work_pool.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+
+#define MAX_PROFILES (32U)
+#define MAX_SEGMENTS (64U)
+#define MAX_NAME (32U)
+#define CHUNK_AXES (64U) // axes integrated together by one batch
+
+/* Same schedule as the single axis model: estimator 10 x 0.1 s per second,
+ * predictor 10 s overload then rated over 60 x 1 s
+ */
+#define ESTIMATOR_H (0.1f)
+#define ESTIMATOR_STEPS (10U)
+#define PREDICTOR_H (1.0f)
+#define PREDICTOR_STEPS (60U)
+#define PREDICTOR_OVERLOAD_STEPS (10U)
+
+static const float _overloadInputs[ NUM_INPUTS ] = { 5.4168f, 23.0400f, 5.5027f };
+static const float _ratedInputs[ NUM_INPUTS ] = { 5.4168f, 16.0000f, 4.4368f };
+static const float _thresholds[ NUM_OUTPUTS ] = { 80.0f-20.0f, 60.0f-20.0f, 60.0f-20.0f, 80.0f-20.0f };
+
+typedef struct
+{
+  char name[ MAX_NAME ];
+  uint32_t numSegments;
+  uint32_t cycle; //!< Seconds per repetition
+  uint32_t seconds[ MAX_SEGMENTS ];
+  float inputs[ MAX_SEGMENTS ][ NUM_INPUTS ]; //!< Heat source inputs of each segment
+} FLEET_PROFILE;
+
+typedef struct
+{
+  uint32_t profile;
+  uint32_t phase; //!< Seconds into the cycle at t = 0
+  float peak[ NUM_OUTPUTS ]; //!< Peak rise above ambient
+  uint32_t predictions;
+  uint32_t denied;
+} FLEET_AXIS;
+
+typedef struct
+{
+  float ambient;
+  uint32_t duration;
+  uint32_t predictInterval;
+  uint32_t numProfiles;
+  FLEET_PROFILE profiles[ MAX_PROFILES ];
+  uint32_t numAxes;
+  FLEET_AXIS * axes;
+} FLEET;
+
+/*!
+ * \brief Structure-of-arrays storage of one chunk of axes
+ */
+typedef struct
+{
+  float states[ NUM_STATES * CHUNK_AXES ];
+  float inputs[ NUM_INPUTS * CHUNK_AXES ];
+  float outputs[ NUM_OUTPUTS * CHUNK_AXES ];
+  float predictorStates[ NUM_STATES * CHUNK_AXES ];
+  float predictorInputs[ NUM_INPUTS * CHUNK_AXES ];
+  float predictorOutputs[ NUM_OUTPUTS * CHUNK_AXES ];
+  float workspace[ RK4SOLVER_BATCH_WORKSPACE_LENGTH( NUM_STATES, CHUNK_AXES ) ];
+} FLEET_CHUNK;
+
+/*!
+ * \brief Finds a profile by name
+ * \return Profile index, numProfiles if not found
+ */
+static uint32_t _FindProfile( const FLEET * fleet, const char * name )
+{
+  uint32_t itr = 0U;
+
+  for ( itr = 0U; itr < fleet->numProfiles; itr++ )
+  {
+    if ( strcmp( fleet->profiles[ itr ].name, name ) == 0 )
+    {
+      break;
+    }
+  }
+
+  return itr;
+}
+
+/*!
+ * \brief Reads a fleet description
+ * \return success, errors are reported on stderr with their line number
+ */
+static bool _ParseFleet( FILE * file, FLEET * fleet )
+{
+  bool status = true;
+  char line[ 1024 ];
+  uint32_t lineNumber = 0U;
+  uint32_t capacity = 0U;
+
+  fleet->ambient = 20.0f;
+  fleet->duration = 3600U;
+  fleet->predictInterval = 10U;
+
+  while ( status && fgets( line, (int)sizeof( line ), file ) )
+  {
+    char * comment = strchr( line, '#' );
+    char * keyword = (char*)0;
+
+    lineNumber++;
+
+    if ( comment )
+    {
+      *comment = '\0';
+    }
+
+    keyword = strtok( line, " \t\r\n" );
+
+    if ( !keyword )
+    {
+      continue;
+    }
+    else if ( strcmp( keyword, "ambient" ) == 0 )
+    {
+      char * value = strtok( (char*)0, " \t\r\n" );
+
+      status = ( value != (char*)0 );
+      fleet->ambient = status ? strtof( value, (char**)0 ) : 0.0f;
+    }
+    else if ( ( strcmp( keyword, "duration" ) == 0 ) || ( strcmp( keyword, "predict" ) == 0 ) )
+    {
+      char * value = strtok( (char*)0, " \t\r\n" );
+      uint32_t seconds = value ? (uint32_t)strtoul( value, (char**)0, 10 ) : 0U;
+
+      status = ( seconds > 0U );
+      *( ( keyword[ 0 ] == 'd' ) ? &fleet->duration : &fleet->predictInterval ) = seconds;
+    }
+    else if ( strcmp( keyword, "profile" ) == 0 )
+    {
+      char * name = strtok( (char*)0, " \t\r\n" );
+      FLEET_PROFILE * profile = &fleet->profiles[ fleet->numProfiles ];
+
+      status = name && ( fleet->numProfiles < MAX_PROFILES ) && ( strlen( name ) < MAX_NAME );
+
+      if ( status )
+      {
+        char * seconds = (char*)0;
+
+        memset( (char*)profile, 0, sizeof( *profile ) );
+        strcpy( profile->name, name );
+
+        while ( status && ( ( seconds = strtok( (char*)0, " \t\r\n" ) ) != (char*)0 ) )
+        {
+          char * current = strtok( (char*)0, " \t\r\n" );
+          char * speed = strtok( (char*)0, " \t\r\n" );
+
+          status = current && speed && ( profile->numSegments < MAX_SEGMENTS );
+
+          if ( status )
+          {
+            uint32_t segment = profile->numSegments++;
+
+            profile->seconds[ segment ] = (uint32_t)strtoul( seconds, (char**)0, 10 );
+            profile->cycle += profile->seconds[ segment ];
+            ASC_THERMAL_MODEL_CalculateSourceInputs( profile->inputs[ segment ],
+                                                     strtof( current, (char**)0 ),
+                                                     strtof( speed, (char**)0 ) );
+          }
+        }
+
+        status = status && ( profile->cycle > 0U );
+        fleet->numProfiles += status ? 1U : 0U;
+      }
+    }
+    else if ( strcmp( keyword, "axes" ) == 0 )
+    {
+      char * count = strtok( (char*)0, " \t\r\n" );
+      char * name = strtok( (char*)0, " \t\r\n" );
+      char * stagger = strtok( (char*)0, " \t\r\n" );
+      uint32_t numAxes = count ? (uint32_t)strtoul( count, (char**)0, 10 ) : 0U;
+      uint32_t profile = name ? _FindProfile( fleet, name ) : fleet->numProfiles;
+
+      status = ( numAxes > 0U ) && ( profile < fleet->numProfiles );
+
+      if ( status && ( ( fleet->numAxes + numAxes ) > capacity ) )
+      {
+        FLEET_AXIS * axes = (FLEET_AXIS*)0;
+
+        capacity = ( fleet->numAxes + numAxes ) * 2U;
+        axes = (FLEET_AXIS*)realloc( (void*)fleet->axes, capacity * sizeof( FLEET_AXIS ) );
+        status = ( axes != (FLEET_AXIS*)0 );
+        fleet->axes = status ? axes : fleet->axes;
+      }
+
+      if ( status )
+      {
+        uint32_t step = stagger ? (uint32_t)strtoul( stagger, (char**)0, 10 ) : 0U;
+        uint32_t itr = 0U;
+
+        for ( itr = 0U; itr < numAxes; itr++ )
+        {
+          FLEET_AXIS * axis = &fleet->axes[ fleet->numAxes++ ];
+
+          memset( (char*)axis, 0, sizeof( *axis ) );
+          axis->profile = profile;
+          axis->phase = ( itr * step ) % fleet->profiles[ profile ].cycle;
+        }
+      }
+    }
+    else
+    {
+      status = false;
+    }
+
+    if ( !status )
+    {
+      fprintf( stderr, "line %u: invalid '%s' directive\n", lineNumber, keyword );
+    }
+  }
+
+  if ( status && ( fleet->numAxes == 0U ) )
+  {
+    fprintf( stderr, "fleet has no axes\n" );
+    status = false;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Heat source inputs of a profile at a point of its cycle
+ */
+static const float * _ProfileInputs( const FLEET_PROFILE * profile, uint32_t t )
+{
+  uint32_t offset = t % profile->cycle;
+  uint32_t segment = 0U;
+
+  while ( offset >= profile->seconds[ segment ] )
+  {
+    offset -= profile->seconds[ segment ];
+    segment++;
+  }
+
+  return profile->inputs[ segment ];
+}
+
+/*!
+ * \brief Runs the overload predictor from the current states of a chunk and
+ * counts the denials
+ */
+static void _Predict( FLEET_CHUNK * chunk, FLEET_AXIS * axes, uint32_t count )
+{
+  RK4SOLVER_BATCH batch = { PREDICTOR_H, count, chunk->predictorStates, chunk->predictorInputs,
+                            chunk->predictorOutputs, chunk->workspace };
+  float peak[ NUM_OUTPUTS * CHUNK_AXES ];
+  uint32_t step = 0U;
+  uint32_t i = 0U;
+  uint32_t b = 0U;
+
+  memcpy( (char*)chunk->predictorStates, (char*)chunk->states, NUM_STATES * count * sizeof( float ) );
+  memcpy( (char*)peak, (char*)chunk->outputs, NUM_OUTPUTS * count * sizeof( float ) );
+
+  for ( step = 0U; step < PREDICTOR_STEPS; step++ )
+  {
+    if ( ( step == 0U ) || ( step == PREDICTOR_OVERLOAD_STEPS ) )
+    {
+      const float * inputs = ( step == 0U ) ? _overloadInputs : _ratedInputs;
+
+      for ( i = 0U; i < NUM_INPUTS; i++ )
+      {
+        for ( b = 0U; b < count; b++ )
+        {
+          chunk->predictorInputs[ ( i * count ) + b ] = inputs[ i ];
+        }
+      }
+    }
+
+    RK4SOLVER_SolveBatch( ASC_THERMAL_MODEL_config, &batch );
+
+    for ( i = 0U; i < NUM_OUTPUTS * count; i++ )
+    {
+      peak[ i ] = ( chunk->predictorOutputs[ i ] > peak[ i ] ) ? chunk->predictorOutputs[ i ] : peak[ i ];
+    }
+  }
+
+  for ( b = 0U; b < count; b++ )
+  {
+    bool denied = false;
+
+    for ( i = 0U; i < NUM_OUTPUTS; i++ )
+    {
+      denied = denied || ( peak[ ( i * count ) + b ] > _thresholds[ i ] );
+    }
+
+    axes[ b ].predictions++;
+    axes[ b ].denied += denied ? 1U : 0U;
+  }
+}
+
+/*!
+ * \brief Work pool task, simulates the whole duration of each chunk in
+ * [begin, end)
+ */
+static void _SimulateChunks( void * context, uint32_t begin, uint32_t end, uint32_t worker )
+{
+  FLEET * fleet = (FLEET*)context;
+  FLEET_CHUNK * chunk = (FLEET_CHUNK*)calloc( 1U, sizeof( FLEET_CHUNK ) );
+  uint32_t index = 0U;
+
+  (void)worker;
+
+  for ( index = begin; ( index < end ) && chunk; index++ )
+  {
+    FLEET_AXIS * axes = &fleet->axes[ index * CHUNK_AXES ];
+    uint32_t count = fleet->numAxes - ( index * CHUNK_AXES );
+    RK4SOLVER_BATCH batch = { ESTIMATOR_H, 0U, chunk->states, chunk->inputs, chunk->outputs, chunk->workspace };
+    uint32_t t = 0U;
+    uint32_t i = 0U;
+    uint32_t b = 0U;
+
+    count = ( count < CHUNK_AXES ) ? count : CHUNK_AXES;
+    batch.count = count;
+    memset( (char*)chunk, 0, sizeof( *chunk ) );
+
+    for ( t = 0U; t < fleet->duration; t++ )
+    {
+      uint32_t step = 0U;
+
+      for ( b = 0U; b < count; b++ )
+      {
+        const float * inputs = _ProfileInputs( &fleet->profiles[ axes[ b ].profile ], t + axes[ b ].phase );
+
+        for ( i = 0U; i < NUM_INPUTS; i++ )
+        {
+          chunk->inputs[ ( i * count ) + b ] = inputs[ i ];
+        }
+      }
+
+      for ( step = 0U; step < ESTIMATOR_STEPS; step++ )
+      {
+        RK4SOLVER_SolveBatch( ASC_THERMAL_MODEL_config, &batch );
+      }
+
+      for ( i = 0U; i < NUM_OUTPUTS; i++ )
+      {
+        for ( b = 0U; b < count; b++ )
+        {
+          float y = chunk->outputs[ ( i * count ) + b ];
+
+          axes[ b ].peak[ i ] = ( y > axes[ b ].peak[ i ] ) ? y : axes[ b ].peak[ i ];
+        }
+      }
+
+      if ( ( ( t + 1U ) % fleet->predictInterval ) == 0U )
+      {
+        _Predict( chunk, axes, count );
+      }
+    }
+  }
+
+  free( (void*)chunk );
+}
+
+int main( int argc, char *argv[] )
+{
+  int exitCode = 1;
+  FILE * file = ( argc > 1 ) ? fopen( argv[ 1 ], "r" ) : (FILE*)0;
+  FLEET * fleet = (FLEET*)calloc( 1U, sizeof( FLEET ) );
+
+  if ( !file )
+  {
+    fprintf( stderr, "usage: %s <fleet.txt> [workers]\n", argv[ 0 ] );
+  }
+  else if ( fleet && _ParseFleet( file, fleet ) )
+  {
+    ASC_WORK_POOL pool;
+    uint32_t numWorkers = ( argc > 2 ) ? (uint32_t)strtoul( argv[ 2 ], (char**)0, 10 ) : 0U;
+
+    if ( ASC_WORK_POOL_Create( &pool, numWorkers ) )
+    {
+      struct timespec start;
+      struct timespec stop;
+      double wall = 0.0;
+      uint32_t numChunks = ( fleet->numAxes + CHUNK_AXES - 1U ) / CHUNK_AXES;
+      uint32_t predictions = 0U;
+      uint32_t denied = 0U;
+      float fleetPeak[ NUM_OUTPUTS ] = { 0.0f };
+      uint32_t itr = 0U;
+      uint32_t i = 0U;
+
+      clock_gettime( CLOCK_MONOTONIC, &start );
+      ASC_WORK_POOL_ParallelFor( &pool, numChunks, 1U, _SimulateChunks, (void*)fleet );
+      clock_gettime( CLOCK_MONOTONIC, &stop );
+      wall = (double)( stop.tv_sec - start.tv_sec ) + (double)( stop.tv_nsec - start.tv_nsec ) * 1e-9;
+
+      printf( "axis,profile" );
+      for ( i = 0U; i < NUM_OUTPUTS; i++ )
+      {
+        printf( ",peak_y%u", i );
+      }
+      printf( ",predictions,denied\n" );
+
+      for ( itr = 0U; itr < fleet->numAxes; itr++ )
+      {
+        FLEET_AXIS * axis = &fleet->axes[ itr ];
+
+        printf( "%u,%s", itr, fleet->profiles[ axis->profile ].name );
+        for ( i = 0U; i < NUM_OUTPUTS; i++ )
+        {
+          printf( ",%.3f", axis->peak[ i ] + fleet->ambient );
+          fleetPeak[ i ] = ( axis->peak[ i ] > fleetPeak[ i ] ) ? axis->peak[ i ] : fleetPeak[ i ];
+        }
+        printf( ",%u,%u\n", axis->predictions, axis->denied );
+
+        predictions += axis->predictions;
+        denied += axis->denied;
+      }
+
+      fprintf( stderr, "%u axes x %u s on %u workers (%u steals) in %.3f s\n",
+               fleet->numAxes, fleet->duration, pool.numWorkers, pool.steals, wall );
+      fprintf( stderr, "fleet peak" );
+      for ( i = 0U; i < NUM_OUTPUTS; i++ )
+      {
+        fprintf( stderr, " %.3f", fleetPeak[ i ] + fleet->ambient );
+      }
+      fprintf( stderr, ", overload denied %u of %u predictions (%.1f%%)\n",
+               denied, predictions, ( predictions > 0U ) ? 100.0 * (double)denied / (double)predictions : 0.0 );
+
+      ASC_WORK_POOL_Destroy( &pool );
+      exitCode = 0;
+    }
+  }
+
+  if ( file )
+  {
+    fclose( file );
+  }
+
+  if ( fleet )
+  {
+    free( (void*)fleet->axes );
+    free( (void*)fleet );
+  }
+
+  return exitCode;
+}
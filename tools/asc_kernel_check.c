@@ -0,0 +1,300 @@
+/**
+ * @file
+ * @brief Checks every solver kernel variant this host supports against the
+ * scalar one, at the kernel and at the solver level, and times a solve with
+ * each
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_kernel_check [-s slowdown]
+ *   -s slowdown  largest time of one RK4SOLVER_Solve of the compiled in model
+ *                with a variant over the scalar time, default 2
+ *
+ * Each variant is forced in turn. RK4SOLVER_Solve and RK4SOLVER_SolveBatch
+ * then run the compiled in model, fewer rows than any vector, and a 37 state
+ * model, which leaves a remainder for every vector width. Their states and
+ * outputs must match the scalar variant bit for bit. Exits 0 when every
+ * supported variant matches and none is slower than allowed.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "rk4solver.h"
+#include "rk4solver_kernels.h"
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LARGE_STATES (37U)
+#define LARGE_INPUTS (5U)
+#define LARGE_OUTPUTS (11U)
+#define MAX_STATES LARGE_STATES
+#define MAX_INPUTS LARGE_INPUTS
+#define MAX_OUTPUTS LARGE_OUTPUTS
+#define BATCH_COUNT (21U)
+#define STEPS (200U)
+#define TIMED_STEPS (20000U)
+#define TIMED_RUNS (5U)
+/* States and outputs of every step, single then batched */
+#define TRACE_LENGTH ( STEPS * ( ( MAX_STATES + MAX_OUTPUTS ) * ( 1U + BATCH_COUNT ) ) )
+
+static float _A[ LARGE_STATES * LARGE_STATES ];
+static float _B[ LARGE_STATES * LARGE_INPUTS ];
+static float _C[ LARGE_OUTPUTS * LARGE_STATES ];
+static float _D[ LARGE_OUTPUTS * LARGE_INPUTS ];
+static const RK4SOLVER_CONFIGURATION _large =
+  { LARGE_STATES, LARGE_INPUTS, LARGE_OUTPUTS, _A, _B, _C, _D, (const RK4SOLVER_PACKED*)0 };
+static float _reference[ 2 ][ TRACE_LENGTH ];
+static float _trace[ TRACE_LENGTH ];
+static uint32_t _seed = 12345U;
+
+/*!
+ * \brief Seconds since an arbitrary point
+ */
+static double _Now( void )
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/*!
+ * \brief Uniform random value
+ * \return -0.5 .. 0.5
+ */
+static float _Random( void )
+{
+  _seed = ( _seed * 1664525U ) + 1013904223U;
+
+  return ( (float)( _seed >> 8 ) / 16777216.0f ) - 0.5f;
+}
+
+/*!
+ * \brief A stable network with every fifth coupling zero, as in sparse thermal
+ * models: each node loses more to ambient than it exchanges with the others
+ */
+static void _BuildLarge( void )
+{
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < LARGE_STATES; i++ )
+  {
+    for ( j = 0U; j < LARGE_STATES; j++ )
+    {
+      float coupling = _Random();
+
+      _A[ ( i * LARGE_STATES ) + j ] = ( ( _seed >> 8 ) % 5U == 0U ) ? 0.0f : 0.01f * ( coupling + 0.5f );
+    }
+
+    _A[ ( i * LARGE_STATES ) + i ] = -0.5f - ( 0.5f * ( _Random() + 0.5f ) );
+
+    for ( j = 0U; j < LARGE_INPUTS; j++ )
+    {
+      _B[ ( i * LARGE_INPUTS ) + j ] = 0.1f * ( _Random() + 0.5f );
+    }
+  }
+
+  for ( i = 0U; i < LARGE_OUTPUTS; i++ )
+  {
+    for ( j = 0U; j < LARGE_STATES; j++ )
+    {
+      _C[ ( i * LARGE_STATES ) + j ] = _Random();
+    }
+
+    for ( j = 0U; j < LARGE_INPUTS; j++ )
+    {
+      _D[ ( i * LARGE_INPUTS ) + j ] = 0.1f * _Random();
+    }
+  }
+}
+
+/*!
+ * \brief Runs a model with the active variant and records every state and
+ * output, single instance then batch
+ * \param trace [out] TRACE_LENGTH floats, unused ones zero
+ * \return success
+ */
+static bool _Run( const RK4SOLVER_CONFIGURATION * config, float * trace )
+{
+  float workspace[ RK4SOLVER_WORKSPACE_LENGTH( MAX_STATES, MAX_INPUTS ) ] RK4SOLVER_ALIGNED;
+  float batchWorkspace[ RK4SOLVER_BATCH_WORKSPACE_LENGTH( MAX_STATES, BATCH_COUNT ) ] RK4SOLVER_ALIGNED;
+  float state[ MAX_STATES ] = { 0.0f };
+  float outputs[ MAX_OUTPUTS ];
+  float currentInput[ MAX_INPUTS ];
+  float nextInput[ MAX_INPUTS ];
+  float batchStates[ MAX_STATES * BATCH_COUNT ] = { 0.0f };
+  float batchInputs[ MAX_INPUTS * BATCH_COUNT ];
+  float batchOutputs[ MAX_OUTPUTS * BATCH_COUNT ];
+  RK4SOLVER_INPUT input = { 0.1f, state, currentInput, nextInput, workspace };
+  RK4SOLVER_OUTPUT output = { state, outputs };
+  RK4SOLVER_BATCH batch = { 0.1f, BATCH_COUNT, batchStates, batchInputs, batchOutputs, batchWorkspace };
+  uint32_t numStates = config->numStates;
+  uint32_t numOutputs = config->numOutputs;
+  bool status = true;
+  uint32_t n = 0U;
+  uint32_t i = 0U;
+
+  memset( (char*)trace, 0, TRACE_LENGTH * sizeof( float ) );
+
+  for ( i = 0U; i < config->numInputs; i++ )
+  {
+    currentInput[ i ] = 10.0f * ( (float)i + 1.0f );
+  }
+
+  for ( n = 0U; ( n < STEPS ) && status; n++ )
+  {
+    // a different input every step, the same sequence for every variant
+    for ( i = 0U; i < config->numInputs; i++ )
+    {
+      nextInput[ i ] = currentInput[ i ] + (float)( ( ( n * 7U ) + i ) % 11U ) - 5.0f;
+    }
+
+    for ( i = 0U; i < ( config->numInputs * BATCH_COUNT ); i++ )
+    {
+      batchInputs[ i ] = nextInput[ i / BATCH_COUNT ] * ( 1.0f + ( 0.01f * (float)( i % BATCH_COUNT ) ) );
+    }
+
+    status = ( RK4SOLVER_Solve( config, &input, &output ) == 1U ) &&
+             ( RK4SOLVER_SolveBatch( config, &batch ) == 1U );
+    memcpy( (char*)currentInput, (char*)nextInput, config->numInputs * sizeof( float ) );
+
+    memcpy( (char*)trace, (char*)state, numStates * sizeof( float ) );
+    memcpy( (char*)&trace[ numStates ], (char*)outputs, numOutputs * sizeof( float ) );
+    trace += numStates + numOutputs;
+    memcpy( (char*)trace, (char*)batchStates, numStates * BATCH_COUNT * sizeof( float ) );
+    memcpy( (char*)&trace[ numStates * BATCH_COUNT ], (char*)batchOutputs, numOutputs * BATCH_COUNT * sizeof( float ) );
+    trace += ( numStates + numOutputs ) * BATCH_COUNT;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Best time of one RK4SOLVER_Solve of the compiled in model with the
+ * active variant
+ * \return Seconds
+ */
+static double _TimeSolve( void )
+{
+  float workspace[ RK4SOLVER_WORKSPACE_LENGTH( ASC_THERMAL_MODEL_NUM_STATES, ASC_THERMAL_MODEL_NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+  float state[ ASC_THERMAL_MODEL_NUM_STATES ] = { 0.0f };
+  float outputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+  float inputs[ ASC_THERMAL_MODEL_NUM_INPUTS ] = { 5.4168f, 16.0f, 4.4368f };
+  RK4SOLVER_INPUT input = { 0.1f, state, inputs, inputs, workspace };
+  RK4SOLVER_OUTPUT output = { state, outputs };
+  double best = 0.0;
+  uint32_t run = 0U;
+  uint32_t n = 0U;
+
+  for ( run = 0U; run < TIMED_RUNS; run++ )
+  {
+    double start = _Now();
+    double elapsed = 0.0;
+
+    for ( n = 0U; n < TIMED_STEPS; n++ )
+    {
+      (void)RK4SOLVER_Solve( ASC_THERMAL_MODEL_config, &input, &output );
+    }
+
+    elapsed = ( _Now() - start ) / (double)TIMED_STEPS;
+    best = ( ( run == 0U ) || ( elapsed < best ) ) ? elapsed : best;
+  }
+
+  return best;
+}
+
+int main( int argc, char *argv[] )
+{
+  const RK4SOLVER_CONFIGURATION * models[ 2 ] = { (const RK4SOLVER_CONFIGURATION*)0, &_large };
+  const char * names[ 2 ] = { "compiled in", "37 state" };
+  RK4SOLVER_KERNELS_VARIANT selected = RK4SOLVER_KERNELS_Active();
+  double scalarTime = 0.0;
+  float slowdown = 2.0f;
+  uint32_t failed = 0U;
+  bool status = true;
+  uint32_t variant = 0U;
+  uint32_t m = 0U;
+
+  if ( ( argc == 3 ) && ( strcmp( argv[ 1 ], "-s" ) == 0 ) )
+  {
+    slowdown = strtof( argv[ 2 ], (char**)0 );
+  }
+  else if ( argc != 1 )
+  {
+    slowdown = 0.0f;
+  }
+
+  if ( !( slowdown > 0.0f ) )
+  {
+    fprintf( stderr, "usage: %s [-s slowdown]\n", argv[ 0 ] );
+    return 1;
+  }
+
+  models[ 0 ] = ASC_THERMAL_MODEL_config;
+  _BuildLarge();
+
+  status = RK4SOLVER_KERNELS_SelfCheck( &failed );
+  printf( "kernels, %s selected at load\n", RK4SOLVER_KERNELS_Name( selected ) );
+
+  for ( variant = 0U; variant < (uint32_t)RK4SOLVER_KERNELS_NUM_VARIANTS; variant++ )
+  {
+    if ( RK4SOLVER_KERNELS_Select( (RK4SOLVER_KERNELS_VARIANT)variant ) )
+    {
+      bool matches = ( ( failed & ( 1UL << variant ) ) == 0U );
+      double time = _TimeSolve();
+
+      for ( m = 0U; m < 2U; m++ )
+      {
+        // the scalar variant records the reference, it only has to solve
+        bool solved = _Run( models[ m ], ( variant == 0U ) ? _reference[ m ] : _trace );
+
+        if ( !solved || ( ( variant != 0U ) &&
+                          ( memcmp( (char*)_reference[ m ], (char*)_trace, sizeof( _trace ) ) != 0 ) ) )
+        {
+          printf( "  %-8s %s model: %s\n", RK4SOLVER_KERNELS_Name( (RK4SOLVER_KERNELS_VARIANT)variant ),
+                  names[ m ], solved ? "solver results differ from scalar" : "solve failed" );
+          matches = false;
+        }
+      }
+
+      scalarTime = ( variant == 0U ) ? time : scalarTime;
+      printf( "  %-8s %s, solve %.0f ns\n", RK4SOLVER_KERNELS_Name( (RK4SOLVER_KERNELS_VARIANT)variant ),
+              ( variant == 0U ) ? "reference" : ( matches ? "matches scalar" : "MISMATCH" ), time * 1e9 );
+
+      if ( ( variant != 0U ) && ( time > ( (double)slowdown * scalarTime ) ) )
+      {
+        printf( "  %-8s solve is %.1f times the scalar time\n",
+                RK4SOLVER_KERNELS_Name( (RK4SOLVER_KERNELS_VARIANT)variant ), time / scalarTime );
+        matches = false;
+      }
+
+      status = status && matches;
+    }
+    else
+    {
+      printf( "  %-8s unsupported\n", RK4SOLVER_KERNELS_Name( (RK4SOLVER_KERNELS_VARIANT)variant ) );
+    }
+  }
+
+  (void)RK4SOLVER_KERNELS_Select( selected );
+
+  return status ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file
+ * @brief Prints the live state table published by a running controller
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_live_monitor [-i milliseconds] [-n samples] <name>
+ * Attaches read only to the shared memory table <name> and writes one CSV
+ * line per published slot every interval. -n 0, the default, runs until
+ * interrupted; the mapping stays valid after the controller exits.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "live_state.h"
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int main( int argc, char *argv[] )
+{
+  int exitCode = 1;
+  uint32_t interval = 1000U;
+  uint32_t samples = 0U;
+  const char * name = (const char*)0;
+  ASC_LIVE_STATE_TABLE table;
+  int arg = 0;
+
+  for ( arg = 1; arg < argc; arg++ )
+  {
+    if ( ( strcmp( argv[ arg ], "-i" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      interval = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-n" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      samples = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else
+    {
+      name = argv[ arg ];
+    }
+  }
+
+  if ( !name )
+  {
+    fprintf( stderr, "usage: %s [-i milliseconds] [-n samples] <name>\n", argv[ 0 ] );
+  }
+  else if ( !ASC_LIVE_STATE_Attach( &table, name ) )
+  {
+    fprintf( stderr, "%s: no live state table for this model layout\n", name );
+  }
+  else
+  {
+    struct timespec pause = { (time_t)( interval / 1000U ), (long)( interval % 1000U ) * 1000000L };
+    uint32_t sample = 0U;
+    uint32_t slot = 0U;
+    uint32_t itr = 0U;
+
+    printf( "sample,slot,axis,publish_count,model_time_ms,prediction_time_ms,verdict" );
+    for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_OUTPUTS; itr++ )
+    {
+      printf( ",y%u", itr );
+    }
+    for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_OUTPUTS; itr++ )
+    {
+      printf( ",peak%u", itr );
+    }
+    printf( "\n" );
+
+    for ( sample = 0U; ( samples == 0U ) || ( sample < samples ); sample++ )
+    {
+      for ( slot = 0U; slot < table.numSlots; slot++ )
+      {
+        ASC_LIVE_STATE_SNAPSHOT snapshot;
+
+        if ( ASC_LIVE_STATE_Read( &table, slot, &snapshot ) && ( snapshot.publishCount > 0U ) )
+        {
+          printf( "%u,%u,%u,%u,%llu,%llu,%u", sample, slot,
+                  (unsigned int)snapshot.axis,
+                  (unsigned int)snapshot.publishCount,
+                  (unsigned long long)snapshot.modelTime,
+                  (unsigned long long)snapshot.predictionTime,
+                  (unsigned int)snapshot.verdict );
+          for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_OUTPUTS; itr++ )
+          {
+            printf( ",%.4f", snapshot.outputs[ itr ] );
+          }
+          for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_OUTPUTS; itr++ )
+          {
+            printf( ",%.4f", snapshot.maxTemps[ itr ] );
+          }
+          printf( "\n" );
+        }
+      }
+
+      fflush( stdout );
+      nanosleep( &pause, (struct timespec*)0 );
+    }
+
+    ASC_LIVE_STATE_Close( &table );
+    exitCode = 0;
+  }
+
+  return exitCode;
+}
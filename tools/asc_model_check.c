@@ -0,0 +1,519 @@
+/**
+ * @file
+ * @brief Checks the analyses built on the thermal model against the plain
+ * simulation they shortcut
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_model_check check
+ *   multirate     RK4SOLVER_MULTIRATE_Solve against single-rate RK4 with the
+ *                 compiled in model split at a 100 s time constant, heating
+ *                 at the overload inputs from cold and then cooling
+ *   overload_map  ASC_THERMAL_MODEL_OVERLOAD_MAP_Evaluate against one overload
+ *                 predictor run per level and duration, from start states
+ *                 heated for longer and longer
+ *   cyclic_steady_state  ASC_THERMAL_MODEL_GetCyclicSteadyState against the
+ *                 last cycle of 10 h of ASC_THERMAL_MODEL_PeriodicTask for
+ *                 two duty cycles
+ *   overload_sensitivity  ASC_THERMAL_MODEL_GetOverloadSensitivity against
+ *                 central differences of its peaks in current and speed,
+ *                 from cold and after minutes of overload
+ *
+ * Prints the worst error of the check next to its tolerance. Exits 0 when the
+ * check stays within it.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "rk4solver.h"
+#include "rk4solver_multirate.h"
+#include "thermal_model.h"
+#include "thermal_model_overload_map.h"
+#include "thermal_model_overload_predictor.h"
+#include "thermal_model_state_space.h"
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Multirate split and run, 30 min of 0.1 s fast steps each way */
+#define MULTIRATE_TAU_SPLIT (100.0f) // s
+#define MULTIRATE_RATIO (10U)
+#define MULTIRATE_MACRO_STEPS (1800U)
+#define MULTIRATE_TOLERANCE (2.5E-04f) // K
+
+/* Overload map grid, start states 5 min of overload apart */
+#define MAP_LEVELS (8U)
+#define MAP_DURATIONS (8U)
+#define MAP_STARTS (9U)
+#define MAP_HEATING (300U) // predictor steps
+#define MAP_TOLERANCE (1.0E-03f) // K
+
+/* Cyclic steady state, against the last of 10 h of thermal periods. Both
+ * sides round in float: each is up to ~3E-04 K off a double precision run at
+ * 28 K, in opposite directions. */
+#define CYCLIC_MAX_PERIODS (20U)
+#define CYCLIC_HOURS (10U)
+#define CYCLIC_TOLERANCE (1.0E-03f) // K
+
+/* Overload sensitivities, against central differences of the peaks */
+#define SENSITIVITY_STARTS (4U)
+#define SENSITIVITY_HEATING (120U) // thermal periods
+#define SENSITIVITY_CURRENT_STEP (0.01f) // A
+#define SENSITIVITY_SPEED_STEP (0.5f) // rad/s
+#define SENSITIVITY_FLOOR (1.0E-02f)
+#define SENSITIVITY_TOLERANCE (1.0E-02f)
+
+typedef struct
+{
+  const char * name;
+  bool (*run)( void );
+} CHECK;
+
+/*!
+ * \brief Runs the multirate solver beside single-rate RK4 while heating at
+ * the overload inputs from cold, then while cooling from there with no input
+ * \return true if neither run strays further than MULTIRATE_TOLERANCE and the
+ * multirate solver evaluates fewer rows
+ */
+static bool _Multirate( void )
+{
+  static float workspace[ RK4SOLVER_MULTIRATE_WORKSPACE_LENGTH( ASC_THERMAL_MODEL_NUM_STATES,
+                                                                ASC_THERMAL_MODEL_NUM_INPUTS,
+                                                                ASC_THERMAL_MODEL_NUM_OUTPUTS ) ] RK4SOLVER_ALIGNED;
+  float zero[ ASC_THERMAL_MODEL_NUM_INPUTS ] = { 0.0f };
+  float overload[ ASC_THERMAL_MODEL_NUM_INPUTS ];
+  float state[ ASC_THERMAL_MODEL_NUM_STATES ] = { 0.0f };
+  float outputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+  uint8_t isSlow[ ASC_THERMAL_MODEL_NUM_STATES ];
+  RK4SOLVER_MULTIRATE_CONFIGURATION multirate = { MULTIRATE_RATIO, isSlow };
+  RK4SOLVER_MULTIRATE_REPORT report[ 2U ];
+  RK4SOLVER_INPUT input = { 0.1f, state, overload, overload, workspace };
+  RK4SOLVER_OUTPUT output = { state, outputs };
+  uint32_t numSlow = RK4SOLVER_MULTIRATE_Partition( ASC_THERMAL_MODEL_config, MULTIRATE_TAU_SPLIT, isSlow );
+  bool status = ( numSlow > 0U ) && ( numSlow < ASC_THERMAL_MODEL_NUM_STATES );
+  uint32_t step = 0U;
+  uint32_t run = 0U;
+
+  memcpy( (char*)overload, (char*)ASC_THERMAL_MODEL_ratings->overloadInputs, sizeof( overload ) );
+
+  status = status &&
+           ( RK4SOLVER_MULTIRATE_ErrorReport( ASC_THERMAL_MODEL_config, &multirate, &input,
+                                              MULTIRATE_MACRO_STEPS, &report[ 0U ] ) == 1U );
+
+  // the report leaves the start state alone, heat it for the cooling run
+  for ( step = 0U; status && ( step < ( MULTIRATE_MACRO_STEPS * MULTIRATE_RATIO ) ); step++ )
+  {
+    status = ( RK4SOLVER_Solve( ASC_THERMAL_MODEL_config, &input, &output ) == 1U );
+  }
+
+  input.currentInput = zero;
+  input.nextInput = zero;
+  status = status &&
+           ( RK4SOLVER_MULTIRATE_ErrorReport( ASC_THERMAL_MODEL_config, &multirate, &input,
+                                              MULTIRATE_MACRO_STEPS, &report[ 1U ] ) == 1U );
+
+  printf( "%u of %u states slow, ratio %u\n", (unsigned)numSlow, (unsigned)ASC_THERMAL_MODEL_NUM_STATES,
+          (unsigned)MULTIRATE_RATIO );
+
+  for ( run = 0U; status && ( run < 2U ); run++ )
+  {
+    bool passed = ( report[ run ].maxAbsError <= MULTIRATE_TOLERANCE ) &&
+                  ( report[ run ].multirateRowEvaluations < report[ run ].singleRateRowEvaluations );
+
+    printf( "%-8s max error %9.3e final error %9.3e tolerance %9.3e, fx rows %u of %u %s\n",
+            ( run == 0U ) ? "heating" : "cooling",
+            report[ run ].maxAbsError,
+            report[ run ].finalAbsError,
+            MULTIRATE_TOLERANCE,
+            (unsigned)report[ run ].multirateRowEvaluations,
+            (unsigned)report[ run ].singleRateRowEvaluations,
+            passed ? "ok" : "FAIL" );
+
+    status = passed;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Sets up an overload predictor of the compiled in model like the one
+ * of ASC_THERMAL_MODEL_Setup, without the bound
+ * \param predictor [out] The predictor, 1 s steps over a 60 s horizon
+ * \param input [out] Its solver input, on state and workspace
+ * \param output [out] Its solver output, on state and outputs
+ * \note As this is a static function, there is no input validation
+ */
+static void _SetupPredictor( ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor,
+                             RK4SOLVER_INPUT * input,
+                             RK4SOLVER_OUTPUT * output,
+                             float * state,
+                             float * outputs,
+                             float * workspace )
+{
+  memset( (char*)predictor, 0, sizeof( *predictor ) );
+  predictor->h = 1.0f;
+  predictor->periodCounts = 60U;
+  predictor->overloadCounts = 10U;
+  predictor->ambientTemp = 20.0f;
+  memcpy( (char*)predictor->maxTempThresholds, (char*)ASC_THERMAL_MODEL_ratings->thresholds,
+          sizeof( predictor->maxTempThresholds ) );
+  memcpy( (char*)predictor->overloadInputs, (char*)ASC_THERMAL_MODEL_ratings->overloadInputs,
+          sizeof( predictor->overloadInputs ) );
+  memcpy( (char*)predictor->ratedInputs, (char*)ASC_THERMAL_MODEL_ratings->ratedInputs,
+          sizeof( predictor->ratedInputs ) );
+  predictor->stateSpaceConfig = ASC_THERMAL_MODEL_config;
+  predictor->solverInputs = input;
+  predictor->solverOutputs = output;
+  predictor->bound = (ASC_THERMAL_MODEL_OVERLOAD_BOUND*)0;
+
+  input->h = predictor->h;
+  input->currentState = state;
+  input->currentInput = predictor->ratedInputs;
+  input->nextInput = predictor->ratedInputs;
+  input->workspace = workspace;
+  output->nextState = state;
+  output->nextOutput = outputs;
+}
+
+/*!
+ * \brief Evaluates the overload map from start states heated for longer and
+ * longer at the overload inputs and compares every verdict and longest
+ * duration with one full predictor run per level and duration
+ * \return true if no verdict differs, apart from runs whose peak is within
+ * MAP_TOLERANCE of a threshold
+ */
+static bool _OverloadMap( void )
+{
+  static ASC_THERMAL_MODEL_OVERLOAD_MAP map;
+  static float workspace[ RK4SOLVER_WORKSPACE_LENGTH( ASC_THERMAL_MODEL_NUM_STATES,
+                                                      ASC_THERMAL_MODEL_NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+  const uint32_t durations[ MAP_DURATIONS ] = { 5U, 10U, 15U, 20U, 30U, 40U, 50U, 60U };
+  ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR predictor;
+  RK4SOLVER_INPUT input;
+  RK4SOLVER_OUTPUT output;
+  float state[ ASC_THERMAL_MODEL_NUM_STATES ];
+  float outputs[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+  float heated[ ASC_THERMAL_MODEL_NUM_STATES ] = { 0.0f };
+  float overload[ ASC_THERMAL_MODEL_NUM_INPUTS ];
+  float levels[ MAP_LEVELS ][ ASC_THERMAL_MODEL_NUM_INPUTS ];
+  bool allowed[ MAP_LEVELS ][ MAP_DURATIONS ];
+  uint32_t maxDurations[ MAP_LEVELS ];
+  uint32_t numCompared = 0U;
+  uint32_t numMismatched = 0U;
+  uint32_t numLongestMismatched = 0U;
+  uint32_t numBorderline = 0U;
+  uint32_t numAllowed = 0U;
+  uint32_t start = 0U;
+  uint32_t level = 0U;
+  uint32_t duration = 0U;
+  uint32_t step = 0U;
+  uint32_t i = 0U;
+  bool status = true;
+
+  _SetupPredictor( &predictor, &input, &output, state, outputs, workspace );
+  memcpy( (char*)overload, (char*)predictor.overloadInputs, sizeof( overload ) );
+  status = ASC_THERMAL_MODEL_OVERLOAD_MAP_Setup( &map, &predictor );
+
+  for ( level = 0U; level < MAP_LEVELS; level++ )
+  {
+    ASC_THERMAL_MODEL_CalculateSourceInputs( levels[ level ], 3.6f + ( 0.4f * (float)level ), 36.7f );
+  }
+
+  for ( start = 0U; status && ( start < MAP_STARTS ); start++ )
+  {
+    memcpy( (char*)predictor.initialState, (char*)heated, sizeof( heated ) );
+    status = ASC_THERMAL_MODEL_OVERLOAD_MAP_Evaluate( &map, &predictor, (float*)levels, MAP_LEVELS,
+                                                      durations, MAP_DURATIONS, (bool*)allowed, maxDurations );
+
+    for ( level = 0U; status && ( level < MAP_LEVELS ); level++ )
+    {
+      uint32_t maxDuration = 0U;
+      bool borderline = false;
+
+      memcpy( (char*)predictor.overloadInputs, (char*)levels[ level ], sizeof( predictor.overloadInputs ) );
+
+      for ( duration = 0U; status && ( duration < MAP_DURATIONS ); duration++ )
+      {
+        float peaks[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+        bool within = true;
+        bool near = false;
+
+        for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_OUTPUTS; i++ )
+        {
+          peaks[ i ] = -FLT_MAX;
+        }
+
+        predictor.overloadCounts = durations[ duration ];
+        memcpy( (char*)state, (char*)predictor.initialState, sizeof( state ) );
+        status = ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_Predict( &predictor, peaks );
+
+        for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_OUTPUTS; i++ )
+        {
+          within = within && ( peaks[ i ] <= predictor.maxTempThresholds[ i ] );
+          near = near || ( fabsf( peaks[ i ] - predictor.maxTempThresholds[ i ] ) <= MAP_TOLERANCE );
+        }
+
+        maxDuration = within ? durations[ duration ] : maxDuration;
+        borderline = borderline || near;
+        numCompared++;
+        numAllowed += within ? 1U : 0U;
+        numBorderline += near ? 1U : 0U;
+        numMismatched += ( !near && ( within != allowed[ level ][ duration ] ) ) ? 1U : 0U;
+      }
+
+      numLongestMismatched += ( !borderline && ( maxDuration != maxDurations[ level ] ) ) ? 1U : 0U;
+    }
+
+    // the next start state, another 5 min at the overload inputs
+    memcpy( (char*)state, (char*)heated, sizeof( state ) );
+    input.currentInput = overload;
+    input.nextInput = overload;
+
+    for ( step = 0U; status && ( step < MAP_HEATING ); step++ )
+    {
+      status = ( RK4SOLVER_Solve( ASC_THERMAL_MODEL_config, &input, &output ) == 1U );
+    }
+
+    memcpy( (char*)heated, (char*)state, sizeof( heated ) );
+  }
+
+  printf( "%u levels x %u durations from %u start states, %u allowed\n",
+          (unsigned)MAP_LEVELS, (unsigned)MAP_DURATIONS, (unsigned)MAP_STARTS, (unsigned)numAllowed );
+  printf( "%u of %u verdicts and %u of %u longest durations differ, %u peaks within %.1e K of a threshold %s\n",
+          (unsigned)numMismatched, (unsigned)numCompared,
+          (unsigned)numLongestMismatched, (unsigned)( MAP_STARTS * MAP_LEVELS ),
+          (unsigned)numBorderline, MAP_TOLERANCE,
+          ( status && ( numMismatched == 0U ) && ( numLongestMismatched == 0U ) ) ? "ok" : "FAIL" );
+
+  return status && ( numMismatched == 0U ) && ( numLongestMismatched == 0U );
+}
+
+/*!
+ * \brief Predicts the settled peaks of duty cycles with
+ * ASC_THERMAL_MODEL_GetCyclicSteadyState and compares them with the highest
+ * temperatures of the last cycle after CYCLIC_HOURS of periodic tasks
+ * \return true if every peak agrees within CYCLIC_TOLERANCE, in the same
+ * period of the cycle
+ */
+static bool _CyclicSteadyState( void )
+{
+  // current and speed of each second: 12 s pick-and-place, 3 s moving loaded,
+  // 2 s returning and 7 s holding, then 20 s of a short overload and a crawl
+  const float cycles[ 2U ][ CYCLIC_MAX_PERIODS ][ 2U ] =
+  {
+    { { 4.6f, 36.7f }, { 4.6f, 36.7f }, { 4.6f, 36.7f }, { 2.0f, 20.0f }, { 2.0f, 20.0f },
+      { 0.5f, 0.0f }, { 0.5f, 0.0f }, { 0.5f, 0.0f }, { 0.5f, 0.0f }, { 0.5f, 0.0f },
+      { 0.5f, 0.0f }, { 0.5f, 0.0f } },
+    { { 5.6f, 36.7f }, { 5.6f, 36.7f }, { 5.6f, 36.7f }, { 5.6f, 36.7f }, { 5.6f, 36.7f },
+      { 1.0f, 5.0f }, { 1.0f, 5.0f }, { 1.0f, 5.0f }, { 1.0f, 5.0f }, { 1.0f, 5.0f },
+      { 1.0f, 5.0f }, { 1.0f, 5.0f }, { 1.0f, 5.0f }, { 1.0f, 5.0f }, { 1.0f, 5.0f },
+      { 1.0f, 5.0f }, { 1.0f, 5.0f }, { 1.0f, 5.0f }, { 1.0f, 5.0f }, { 1.0f, 5.0f } }
+  };
+  const uint32_t numPeriods[ 2U ] = { 12U, 20U };
+  bool status = true;
+  uint32_t cycle = 0U;
+
+  for ( cycle = 0U; status && ( cycle < 2U ); cycle++ )
+  {
+    float inputs[ CYCLIC_MAX_PERIODS ][ ASC_THERMAL_MODEL_NUM_INPUTS ];
+    float peaks[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+    float simulated[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+    float temps[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+    uint32_t peakPeriods[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+    uint32_t simulatedPeriods[ ASC_THERMAL_MODEL_NUM_OUTPUTS ] = { 0U };
+    uint32_t count = ( CYCLIC_HOURS * 3600U ) / numPeriods[ cycle ];
+    uint32_t period = 0U;
+    uint32_t i = 0U;
+
+    for ( period = 0U; period < numPeriods[ cycle ]; period++ )
+    {
+      ASC_THERMAL_MODEL_CalculateSourceInputs( inputs[ period ], cycles[ cycle ][ period ][ 0U ],
+                                               cycles[ cycle ][ period ][ 1U ] );
+    }
+
+    // each cycle starts from cold
+    status = ASC_THERMAL_MODEL_Setup() &&
+             ASC_THERMAL_MODEL_GetCyclicSteadyState( (float*)inputs, numPeriods[ cycle ], peaks, peakPeriods );
+
+    for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_OUTPUTS; i++ )
+    {
+      simulated[ i ] = -FLT_MAX;
+    }
+
+    for ( period = 0U; status && ( period < ( count * numPeriods[ cycle ] ) ); period++ )
+    {
+      ASC_THERMAL_MODEL_SetInputs( inputs[ period % numPeriods[ cycle ] ] );
+      ASC_THERMAL_MODEL_PeriodicTask();
+
+      if ( period >= ( ( count - 1U ) * numPeriods[ cycle ] ) )
+      {
+        (void)ASC_THERMAL_MODEL_GetCurrentTemp( temps );
+
+        for ( i = 0U; i < ASC_THERMAL_MODEL_NUM_OUTPUTS; i++ )
+        {
+          if ( temps[ i ] > simulated[ i ] )
+          {
+            simulated[ i ] = temps[ i ];
+            simulatedPeriods[ i ] = period % numPeriods[ cycle ];
+          }
+        }
+      }
+    }
+
+    printf( "%u s cycle, peak and period after %u h of cycles and predicted\n",
+            (unsigned)numPeriods[ cycle ], (unsigned)CYCLIC_HOURS );
+
+    for ( i = 0U; status && ( i < ASC_THERMAL_MODEL_NUM_OUTPUTS ); i++ )
+    {
+      float error = fabsf( peaks[ i ] - simulated[ i ] );
+      bool passed = ( error <= CYCLIC_TOLERANCE ) && ( peakPeriods[ i ] == simulatedPeriods[ i ] );
+
+      printf( "  y%u %8.4f @ %2u %8.4f @ %2u  error %9.3e tolerance %9.3e %s\n",
+              (unsigned)i, simulated[ i ], (unsigned)simulatedPeriods[ i ], peaks[ i ], (unsigned)peakPeriods[ i ],
+              error, CYCLIC_TOLERANCE, passed ? "ok" : "FAIL" );
+      status = passed;
+    }
+  }
+
+  status = ASC_THERMAL_MODEL_Cleanup() && status;
+
+  return status;
+}
+
+/*!
+ * \brief Compares the current and speed sensitivities of
+ * ASC_THERMAL_MODEL_GetOverloadSensitivity with central finite differences of
+ * its peaks, from cold and after each SENSITIVITY_HEATING of overload
+ * \return true if every sensitivity agrees within SENSITIVITY_TOLERANCE of the
+ * finite difference, relative to the larger of the two and
+ * SENSITIVITY_FLOOR
+ */
+static bool _OverloadSensitivity( void )
+{
+  float overload[ ASC_THERMAL_MODEL_NUM_INPUTS ];
+  char worstCase[ 96U ] = "";
+  float worst = 0.0f;
+  uint32_t numCompared = 0U;
+  bool status = ASC_THERMAL_MODEL_Setup();
+  uint32_t start = 0U;
+  uint32_t period = 0U;
+
+  memcpy( (char*)overload, (char*)ASC_THERMAL_MODEL_ratings->overloadInputs, sizeof( overload ) );
+
+  for ( start = 0U; status && ( start < SENSITIVITY_STARTS ); start++ )
+  {
+    float current = 0.0f;
+
+    for ( current = 4.0f; status && ( current < 5.65f ); current += 0.4f )
+    {
+      float peaks[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+      float dCurrent[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+      float dSpeed[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+      float upper[ 2U ][ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+      float lower[ 2U ][ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+      float unused[ ASC_THERMAL_MODEL_NUM_OUTPUTS ];
+      uint32_t i = 0U;
+
+      status = ASC_THERMAL_MODEL_GetOverloadSensitivity( current, 36.7f, peaks, dCurrent, dSpeed ) &&
+               ASC_THERMAL_MODEL_GetOverloadSensitivity( current + SENSITIVITY_CURRENT_STEP, 36.7f,
+                                                         upper[ 0U ], unused, (float*)0 ) &&
+               ASC_THERMAL_MODEL_GetOverloadSensitivity( current - SENSITIVITY_CURRENT_STEP, 36.7f,
+                                                         lower[ 0U ], unused, (float*)0 ) &&
+               ASC_THERMAL_MODEL_GetOverloadSensitivity( current, 36.7f + SENSITIVITY_SPEED_STEP,
+                                                         upper[ 1U ], unused, (float*)0 ) &&
+               ASC_THERMAL_MODEL_GetOverloadSensitivity( current, 36.7f - SENSITIVITY_SPEED_STEP,
+                                                         lower[ 1U ], unused, (float*)0 );
+
+      for ( i = 0U; status && ( i < ASC_THERMAL_MODEL_NUM_OUTPUTS ); i++ )
+      {
+        float differences[ 2U ];
+        float analytic[ 2U ];
+        uint32_t p = 0U;
+
+        differences[ 0U ] = ( upper[ 0U ][ i ] - lower[ 0U ][ i ] ) / ( 2.0f * SENSITIVITY_CURRENT_STEP );
+        differences[ 1U ] = ( upper[ 1U ][ i ] - lower[ 1U ][ i ] ) / ( 2.0f * SENSITIVITY_SPEED_STEP );
+        analytic[ 0U ] = dCurrent[ i ];
+        analytic[ 1U ] = dSpeed[ i ];
+
+        for ( p = 0U; p < 2U; p++ )
+        {
+          float scale = fmaxf( fmaxf( fabsf( analytic[ p ] ), fabsf( differences[ p ] ) ), SENSITIVITY_FLOOR );
+          float error = fabsf( analytic[ p ] - differences[ p ] ) / scale;
+
+          if ( error > worst )
+          {
+            snprintf( worstCase, sizeof( worstCase ), "y%u d/d%s at %.1f A after %u s of overload, %.5f against %.5f",
+                      (unsigned)i, ( p == 0U ) ? "current" : "speed", current,
+                      (unsigned)( start * SENSITIVITY_HEATING ), analytic[ p ], differences[ p ] );
+            worst = error;
+          }
+
+          numCompared++;
+        }
+      }
+    }
+
+    // the next start, another SENSITIVITY_HEATING periods of overload
+    ASC_THERMAL_MODEL_SetInputs( overload );
+
+    for ( period = 0U; period < SENSITIVITY_HEATING; period++ )
+    {
+      ASC_THERMAL_MODEL_PeriodicTask();
+    }
+  }
+
+  printf( "%u sensitivities, worst %s\n", (unsigned)numCompared, worstCase );
+  printf( "relative error %9.3e tolerance %9.3e %s\n", worst, SENSITIVITY_TOLERANCE,
+          ( status && ( worst <= SENSITIVITY_TOLERANCE ) ) ? "ok" : "FAIL" );
+
+  status = ASC_THERMAL_MODEL_Cleanup() && status;
+
+  return status && ( worst <= SENSITIVITY_TOLERANCE );
+}
+
+static const CHECK _checks[] =
+{
+  { "multirate", _Multirate },
+  { "overload_map", _OverloadMap },
+  { "cyclic_steady_state", _CyclicSteadyState },
+  { "overload_sensitivity", _OverloadSensitivity }
+};
+
+int main( int argc, char *argv[] )
+{
+  uint32_t numChecks = sizeof( _checks ) / sizeof( _checks[ 0U ] );
+  uint32_t itr = 0U;
+
+  for ( itr = 0U; ( argc == 2 ) && ( itr < numChecks ); itr++ )
+  {
+    if ( strcmp( argv[ 1 ], _checks[ itr ].name ) == 0 )
+    {
+      return _checks[ itr ].run() ? 0 : 1;
+    }
+  }
+
+  fprintf( stderr, "usage: %s check\n  checks:", argv[ 0 ] );
+
+  for ( itr = 0U; itr < numChecks; itr++ )
+  {
+    fprintf( stderr, " %s", _checks[ itr ].name );
+  }
+
+  fprintf( stderr, "\n" );
+
+  return 1;
+}
@@ -0,0 +1,331 @@
+/**
+ * @file
+ * @brief Converts thermal model descriptions to and from the binary model
+ * file format
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_model_convert <model.txt> <model.bin>
+ *        asc_model_convert -d <model.bin>     prints a model file as text
+ *        asc_model_convert -x [name]          prints the compiled in model
+ *
+ * Model description, one directive per line, '#' starts a comment, matrices
+ * row by row:
+ *   name <frame>
+ *   A <states x states values>
+ *   B <states x inputs values>
+ *   C <outputs x states values>
+ *   D <outputs x inputs values>
+ *   losses <phase Ohm> <Rds(on) Ohm> <bus V> <switching Hz> <rise s> <fall s>
+ *          <sense Ohm> <iron loss W> <iron loss exponent> <other W>
+ *   thresholds <K above ambient per output>
+ *   overload <W per input>
+ *   rated <W per input>
+ *   step <solver step s> <steps per estimator period>   optional, 0.1 10
+ */
+
+#include "rk4solver.h"
+#include "thermal_model_file.h"
+#include "thermal_model_state_space.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+#define NUM_LOSSES ( sizeof( ASC_THERMAL_MODEL_LOSS_CONSTANTS ) / sizeof( float ) )
+#define NUM_FIELDS (8U)
+
+/*!
+ * \brief A directive of the description and where its values go
+ */
+typedef struct
+{
+  const char * keyword;
+  float * values;
+  uint32_t count;
+} MODEL_FIELD;
+
+/*!
+ * \brief Lists the numeric directives of a model
+ * \return Number of fields
+ */
+static uint32_t _Fields( ASC_THERMAL_MODEL_FILE_IMAGE * model, MODEL_FIELD * fields )
+{
+  MODEL_FIELD list[] =
+  {
+    { "A", (float*)model->A, NUM_STATES * NUM_STATES },
+    { "B", (float*)model->B, NUM_STATES * NUM_INPUTS },
+    { "C", (float*)model->C, NUM_OUTPUTS * NUM_STATES },
+    { "D", (float*)model->D, NUM_OUTPUTS * NUM_INPUTS },
+    { "losses", (float*)&model->losses, (uint32_t)NUM_LOSSES },
+    { "thresholds", model->ratings.thresholds, NUM_OUTPUTS },
+    { "overload", model->ratings.overloadInputs, NUM_INPUTS },
+    { "rated", model->ratings.ratedInputs, NUM_INPUTS }
+  };
+
+  memcpy( (char*)fields, (char*)list, sizeof( list ) );
+
+  return (uint32_t)( sizeof( list ) / sizeof( list[ 0 ] ) );
+}
+
+/*!
+ * \brief Converts one value of a directive
+ * \return success, false if the token is not a number
+ */
+static bool _ParseValue( const char * token, float * value )
+{
+  char * end = (char*)0;
+
+  *value = strtof( token, &end );
+
+  return ( end != token ) && ( *end == '\0' );
+}
+
+/*!
+ * \brief Reads a model description into the fields of an image
+ * \return success, errors are reported on stderr with their line number
+ */
+static bool _ParseModel( FILE * file, ASC_THERMAL_MODEL_FILE_IMAGE * model )
+{
+  bool status = true;
+  MODEL_FIELD fields[ NUM_FIELDS ];
+  uint32_t numFields = _Fields( model, fields );
+  uint32_t seen = 0U;
+  char line[ 1024 ];
+  uint32_t lineNumber = 0U;
+  uint32_t itr = 0U;
+
+  model->operatorStep = 0.1f;
+  model->operatorSteps = 10U;
+
+  while ( status && fgets( line, (int)sizeof( line ), file ) )
+  {
+    char * comment = strchr( line, '#' );
+    char * keyword = (char*)0;
+
+    lineNumber++;
+
+    if ( comment )
+    {
+      *comment = '\0';
+    }
+
+    keyword = strtok( line, " \t\r\n" );
+
+    if ( !keyword )
+    {
+      continue;
+    }
+    else if ( strcmp( keyword, "name" ) == 0 )
+    {
+      char * name = strtok( (char*)0, " \t\r\n" );
+
+      status = name && ( strlen( name ) < sizeof( model->name ) );
+      if ( status )
+      {
+        strcpy( model->name, name );
+      }
+    }
+    else if ( strcmp( keyword, "step" ) == 0 )
+    {
+      char * step = strtok( (char*)0, " \t\r\n" );
+      char * steps = strtok( (char*)0, " \t\r\n" );
+
+      status = step && steps;
+      if ( status )
+      {
+        model->operatorStep = strtof( step, (char**)0 );
+        model->operatorSteps = (uint32_t)strtoul( steps, (char**)0, 10 );
+        status = ( model->operatorStep > 0.0f ) && ( model->operatorSteps > 0U );
+      }
+    }
+    else
+    {
+      for ( itr = 0U; ( itr < numFields ) && ( strcmp( keyword, fields[ itr ].keyword ) != 0 ); itr++ )
+      {
+      }
+
+      status = ( itr < numFields );
+
+      if ( status )
+      {
+        // a directive may continue over the following lines
+        uint32_t value = 0U;
+
+        while ( status && ( value < fields[ itr ].count ) )
+        {
+          char * token = strtok( (char*)0, " \t\r\n" );
+
+          if ( token )
+          {
+            status = _ParseValue( token, &fields[ itr ].values[ value++ ] );
+          }
+          else if ( fgets( line, (int)sizeof( line ), file ) )
+          {
+            lineNumber++;
+            comment = strchr( line, '#' );
+            if ( comment )
+            {
+              *comment = '\0';
+            }
+            token = strtok( line, " \t\r\n" );
+            if ( token )
+            {
+              status = _ParseValue( token, &fields[ itr ].values[ value++ ] );
+            }
+          }
+          else
+          {
+            status = false;
+          }
+        }
+
+        seen |= 1U << itr;
+      }
+    }
+
+    if ( !status )
+    {
+      fprintf( stderr, "line %u: cannot read '%s'\n", lineNumber, keyword );
+    }
+  }
+
+  if ( status && ( seen != ( ( 1U << numFields ) - 1U ) ) )
+  {
+    for ( itr = 0U; itr < numFields; itr++ )
+    {
+      if ( !( seen & ( 1U << itr ) ) )
+      {
+        fprintf( stderr, "missing '%s'\n", fields[ itr ].keyword );
+      }
+    }
+    status = false;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Writes an image as a description _ParseModel reads back
+ */
+static void _PrintModel( ASC_THERMAL_MODEL_FILE_IMAGE * model )
+{
+  MODEL_FIELD fields[ NUM_FIELDS ];
+  uint32_t numFields = _Fields( model, fields );
+  uint32_t itr = 0U;
+  uint32_t value = 0U;
+
+  printf( "name %s\n", model->name[ 0 ] ? model->name : "unnamed" );
+
+  for ( itr = 0U; itr < numFields; itr++ )
+  {
+    // matrices one row per line
+    uint32_t columns = ( itr < 4U ) ? ( ( ( itr == 1U ) || ( itr == 3U ) ) ? NUM_INPUTS : NUM_STATES ) : fields[ itr ].count;
+
+    printf( "%s", fields[ itr ].keyword );
+    for ( value = 0U; value < fields[ itr ].count; value++ )
+    {
+      printf( "%s%.9g", ( ( value > 0U ) && ( ( value % columns ) == 0U ) ) ? "\n " : " ", fields[ itr ].values[ value ] );
+    }
+    printf( "\n" );
+  }
+
+  printf( "step %.9g %u\n", model->operatorStep, model->operatorSteps );
+}
+
+int main( int argc, char *argv[] )
+{
+  int exitCode = 1;
+  static ASC_THERMAL_MODEL_FILE_IMAGE source;
+  static ASC_THERMAL_MODEL_FILE_IMAGE image;
+
+  if ( ( argc == 3 ) && ( strcmp( argv[ 1 ], "-d" ) == 0 ) )
+  {
+    ASC_THERMAL_MODEL_FILE model;
+
+    if ( ASC_THERMAL_MODEL_FILE_Open( &model, argv[ 2 ] ) )
+    {
+      memcpy( (char*)&image, (const char*)model.image, sizeof( image ) );
+      ASC_THERMAL_MODEL_FILE_Close( &model );
+      _PrintModel( &image );
+      exitCode = 0;
+    }
+    else
+    {
+      fprintf( stderr, "%s: not a version %u model file for this model layout\n",
+               argv[ 2 ], ASC_THERMAL_MODEL_FILE_VERSION );
+    }
+  }
+  else if ( ( argc >= 2 ) && ( argc <= 3 ) && ( strcmp( argv[ 1 ], "-x" ) == 0 ) )
+  {
+    if ( ASC_THERMAL_MODEL_FILE_Build( &image, ( argc == 3 ) ? argv[ 2 ] : "default",
+                                       ASC_THERMAL_MODEL_config,
+                                       ASC_THERMAL_MODEL_losses,
+                                       ASC_THERMAL_MODEL_ratings,
+                                       0.1f, 10U ) )
+    {
+      _PrintModel( &image );
+      exitCode = 0;
+    }
+  }
+  else if ( ( argc == 3 ) && ( argv[ 1 ][ 0 ] != '-' ) )
+  {
+    FILE * file = fopen( argv[ 1 ], "r" );
+
+    if ( !file )
+    {
+      fprintf( stderr, "%s: cannot open\n", argv[ 1 ] );
+    }
+    else if ( _ParseModel( file, &source ) )
+    {
+      RK4SOLVER_CONFIGURATION config =
+        { NUM_STATES, NUM_INPUTS, NUM_OUTPUTS,
+          (float*)source.A, (float*)source.B, (float*)source.C, (float*)source.D,
+          (const RK4SOLVER_PACKED*)0 };
+      FILE * output = (FILE*)0;
+
+      if ( !ASC_THERMAL_MODEL_FILE_Build( &image, source.name, &config, &source.losses, &source.ratings,
+                                          source.operatorStep, source.operatorSteps ) )
+      {
+        fprintf( stderr, "%s: cannot build the period operator\n", argv[ 1 ] );
+      }
+      else if ( ( output = fopen( argv[ 2 ], "wb" ) ) == (FILE*)0 )
+      {
+        fprintf( stderr, "%s: cannot create\n", argv[ 2 ] );
+      }
+      else
+      {
+        exitCode = ( fwrite( (const void*)&image, sizeof( image ), 1U, output ) == 1U ) ? 0 : 1;
+        exitCode = ( fclose( output ) == 0 ) ? exitCode : 1;
+      }
+    }
+
+    if ( file )
+    {
+      fclose( file );
+    }
+  }
+  else
+  {
+    fprintf( stderr, "usage: %s <model.txt> <model.bin>\n"
+                     "       %s -d <model.bin>\n"
+                     "       %s -x [name]\n", argv[ 0 ], argv[ 0 ], argv[ 0 ] );
+  }
+
+  return exitCode;
+}
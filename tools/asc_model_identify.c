@@ -0,0 +1,620 @@
+/**
+ * @file
+ * @brief Fits the thermal model of a motor to logged current, speed and
+ * temperatures and writes it in the model description and model file formats
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_model_identify [options] <log.txt> ...
+ *        asc_model_identify [options] -g <seconds> [-c logs] [-n noise]
+ *   -m model.bin   start from a model file instead of the compiled in model
+ *   -o fitted.bin  also write the fitted model file
+ *   -j workers     threads, default 4
+ *   -i iterations  default 50
+ *   -h step        sample interval in s, default 0.1
+ *   -s seconds     left out of the fit at the start of every log
+ *
+ * A log holds one sample per line, "current speed ambient t0 t1 t2 t3" in A,
+ * rad/s and the temperature unit of ambient, one temperature per model
+ * output, '-' or nan for one that is not logged. '#' starts a comment. Every
+ * log must start with the motor at ambient, or skip the start with -s.
+ *
+ * -g generates that many seconds per log from the starting model with every
+ * fitted parameter moved by up to 20 %, plus noise in K, and reports how
+ * close the fit gets to it.
+ *
+ * The fitted model is printed as a description asc_model_convert reads.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "rk4solver.h"
+#include "thermal_model.h"
+#include "thermal_model_file.h"
+#include "thermal_model_identification.h"
+#include "thermal_model_state_space.h"
+#include "work_pool.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+#define NUM_LOSSES ( sizeof( ASC_THERMAL_MODEL_LOSS_CONSTANTS ) / sizeof( float ) )
+#define MAX_LOGS (256U)
+
+/*!
+ * \brief Samples of one log, grown while reading
+ */
+typedef struct
+{
+  float * current;
+  float * speed;
+  float * measured;
+  uint32_t count;
+  uint32_t capacity;
+} SAMPLES;
+
+static ASC_WORK_POOL _pool;
+static ASC_THERMAL_MODEL_FILE_IMAGE _model;
+static ASC_THERMAL_MODEL_FILE_IMAGE _truth;
+static ASC_THERMAL_MODEL_FILE_IMAGE _initial;
+static SAMPLES _samples[ MAX_LOGS ];
+static ASC_THERMAL_MODEL_IDENTIFICATION_LOG _logs[ MAX_LOGS ];
+static uint32_t _seed = 11U;
+
+/*!
+ * \brief Seconds since an arbitrary point
+ */
+static double _Now( void )
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/*!
+ * \brief Uniform random value
+ * \return 0 .. 1
+ */
+static float _Random( void )
+{
+  _seed = ( _seed * 1103515245U ) + 12345U;
+
+  return (float)( _seed >> 8 ) / 16777216.0f;
+}
+
+/*!
+ * \brief Appends a sample to a log
+ * \return success
+ */
+static bool _Append( SAMPLES * samples, float current, float speed, const float * measured )
+{
+  bool status = true;
+
+  if ( samples->count == samples->capacity )
+  {
+    uint32_t capacity = ( samples->capacity > 0U ) ? ( samples->capacity * 2U ) : 65536U;
+    float * grownCurrent = (float*)realloc( samples->current, capacity * sizeof( float ) );
+    float * grownSpeed = grownCurrent ? (float*)realloc( samples->speed, capacity * sizeof( float ) ) : (float*)0;
+    float * grownMeasured = grownSpeed ? (float*)realloc( samples->measured, capacity * NUM_OUTPUTS * sizeof( float ) ) : (float*)0;
+
+    samples->current = grownCurrent ? grownCurrent : samples->current;
+    samples->speed = grownSpeed ? grownSpeed : samples->speed;
+    samples->measured = grownMeasured ? grownMeasured : samples->measured;
+    status = ( grownMeasured != (float*)0 );
+    samples->capacity = status ? capacity : samples->capacity;
+  }
+
+  if ( status )
+  {
+    samples->current[ samples->count ] = current;
+    samples->speed[ samples->count ] = speed;
+    memcpy( (char*)&samples->measured[ samples->count * NUM_OUTPUTS ], (const char*)measured, NUM_OUTPUTS * sizeof( float ) );
+    samples->count++;
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Reads a log, temperatures become K above ambient
+ * \return success, errors are reported on stderr with their line number
+ */
+static bool _ReadLog( const char * path, SAMPLES * samples )
+{
+  FILE * file = fopen( path, "r" );
+  bool status = ( file != (FILE*)0 );
+  char line[ 512 ];
+  uint32_t lineNumber = 0U;
+
+  if ( !status )
+  {
+    fprintf( stderr, "%s: cannot open\n", path );
+  }
+
+  while ( status && fgets( line, (int)sizeof( line ), file ) )
+  {
+    char * comment = strchr( line, '#' );
+    char * token = (char*)0;
+    float values[ 3U + NUM_OUTPUTS ];
+    uint32_t count = 0U;
+
+    lineNumber++;
+
+    if ( comment )
+    {
+      *comment = '\0';
+    }
+
+    for ( token = strtok( line, " \t,\r\n" ); token && ( count < ( 3U + NUM_OUTPUTS ) ); token = strtok( (char*)0, " \t,\r\n" ) )
+    {
+      char * end = (char*)0;
+
+      values[ count ] = ( strcmp( token, "-" ) == 0 ) ? NAN : strtof( token, &end );
+      status = status && ( ( strcmp( token, "-" ) == 0 ) || ( ( end != token ) && ( *end == '\0' ) ) );
+      count++;
+    }
+
+    if ( status && ( count == ( 3U + NUM_OUTPUTS ) ) )
+    {
+      uint32_t i = 0U;
+
+      for ( i = 0U; i < NUM_OUTPUTS; i++ )
+      {
+        values[ 3U + i ] -= values[ 2 ];
+      }
+
+      status = _Append( samples, values[ 0 ], values[ 1 ], &values[ 3 ] );
+    }
+    else if ( count > 0U )
+    {
+      fprintf( stderr, "%s:%u: expected current, speed, ambient and %u temperatures\n",
+               path, lineNumber, (unsigned)NUM_OUTPUTS );
+      status = false;
+    }
+  }
+
+  if ( file )
+  {
+    fclose( file );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Moves every entry the fit adjusts by up to 20 %, the iron loss
+ * exponent by up to 0.2 and the other losses by up to 1 W
+ */
+static void _Perturb( const ASC_THERMAL_MODEL_FILE_IMAGE * model, ASC_THERMAL_MODEL_FILE_IMAGE * truth )
+{
+  float A[ NUM_STATES ][ NUM_STATES ];
+  float B[ NUM_STATES ][ NUM_INPUTS ];
+  RK4SOLVER_CONFIGURATION config =
+    { NUM_STATES, NUM_INPUTS, NUM_OUTPUTS,
+      &A[ 0 ][ 0 ], &B[ 0 ][ 0 ], &model->C[ 0 ][ 0 ], &model->D[ 0 ][ 0 ],
+      (const RK4SOLVER_PACKED*)0 };
+  ASC_THERMAL_MODEL_LOSS_CONSTANTS losses = model->losses;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < NUM_STATES; i++ )
+  {
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      A[ i ][ j ] = model->A[ i ][ j ] * ( 0.8f + ( 0.4f * _Random() ) );
+    }
+
+    for ( j = 0U; j < NUM_INPUTS; j++ )
+    {
+      B[ i ][ j ] = model->B[ i ][ j ] * ( 0.8f + ( 0.4f * _Random() ) );
+    }
+  }
+
+  losses.ironLossExponent += 0.4f * ( _Random() - 0.5f );
+  losses.otherLosses += 2.0f * ( _Random() - 0.5f );
+  (void)ASC_THERMAL_MODEL_FILE_Build( truth, model->name, &config, &losses, &model->ratings,
+                                      model->operatorStep, model->operatorSteps );
+}
+
+/*!
+ * \brief Generates a log of a random duty cycle with the solver, starting at
+ * ambient, with uniform noise of the given amplitude in K on every output
+ * \return success
+ */
+static bool _Generate( const ASC_THERMAL_MODEL_FILE_IMAGE * truth, float h, uint32_t count, float noise, SAMPLES * samples )
+{
+  RK4SOLVER_CONFIGURATION config =
+    { NUM_STATES, NUM_INPUTS, NUM_OUTPUTS,
+      &truth->A[ 0 ][ 0 ], &truth->B[ 0 ][ 0 ], &truth->C[ 0 ][ 0 ], &truth->D[ 0 ][ 0 ],
+      (const RK4SOLVER_PACKED*)0 };
+  float workspace[ RK4SOLVER_WORKSPACE_LENGTH( NUM_STATES, NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+  float state[ NUM_STATES ] = { 0.0f };
+  float outputs[ NUM_OUTPUTS ];
+  float currentInput[ NUM_INPUTS ];
+  float nextInput[ NUM_INPUTS ];
+  RK4SOLVER_INPUT solverInputs = { h, state, currentInput, nextInput, workspace };
+  RK4SOLVER_OUTPUT solverOutputs = { state, outputs };
+  float current = 0.0f;
+  float speed = 0.0f;
+  uint32_t remaining = 0U;
+  bool status = true;
+  uint32_t n = 0U;
+  uint32_t i = 0U;
+
+  ASC_THERMAL_MODEL_CalculateLossInputs( &truth->losses, currentInput, current, speed );
+
+  for ( n = 0U; ( n < count ) && status; n++ )
+  {
+    float measured[ NUM_OUTPUTS ];
+
+    // a new operating point every 30 s to 10 min
+    if ( remaining == 0U )
+    {
+      current = 4.8f * _Random();
+      speed = 40.0f * _Random();
+      remaining = (uint32_t)( ( 30.0f + ( 570.0f * _Random() ) ) / h );
+    }
+
+    remaining--;
+
+    if ( n == 0U )
+    {
+      // the motor starts at ambient
+      for ( i = 0U; i < NUM_OUTPUTS; i++ )
+      {
+        outputs[ i ] = 0.0f;
+      }
+    }
+    else
+    {
+      ASC_THERMAL_MODEL_CalculateLossInputs( &truth->losses, nextInput, current, speed );
+      status = ( RK4SOLVER_Solve( &config, &solverInputs, &solverOutputs ) == 1U );
+
+      // the solver's output uses u(n), the logged temperature sees u(n+1)
+      for ( i = 0U; i < NUM_OUTPUTS; i++ )
+      {
+        uint32_t j = 0U;
+
+        outputs[ i ] = 0.0f;
+
+        for ( j = 0U; j < NUM_STATES; j++ )
+        {
+          outputs[ i ] += truth->C[ i ][ j ] * state[ j ];
+        }
+
+        for ( j = 0U; j < NUM_INPUTS; j++ )
+        {
+          outputs[ i ] += truth->D[ i ][ j ] * nextInput[ j ];
+        }
+      }
+
+      memcpy( (char*)currentInput, (char*)nextInput, sizeof( currentInput ) );
+    }
+
+    for ( i = 0U; i < NUM_OUTPUTS; i++ )
+    {
+      measured[ i ] = outputs[ i ] + ( noise * ( ( 2.0f * _Random() ) - 1.0f ) );
+    }
+
+    status = status && _Append( samples, current, speed, measured );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Writes an image as the description asc_model_convert reads
+ */
+static void _PrintModel( const ASC_THERMAL_MODEL_FILE_IMAGE * model )
+{
+  const float * losses = (const float*)&model->losses;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  printf( "name %s\n", model->name[ 0 ] ? model->name : "unnamed" );
+
+  for ( i = 0U; i < NUM_STATES; i++ )
+  {
+    printf( "%s", ( i == 0U ) ? "A" : "" );
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      printf( " %.9g", model->A[ i ][ j ] );
+    }
+    printf( "\n" );
+  }
+
+  for ( i = 0U; i < NUM_STATES; i++ )
+  {
+    printf( "%s", ( i == 0U ) ? "B" : "" );
+    for ( j = 0U; j < NUM_INPUTS; j++ )
+    {
+      printf( " %.9g", model->B[ i ][ j ] );
+    }
+    printf( "\n" );
+  }
+
+  for ( i = 0U; i < NUM_OUTPUTS; i++ )
+  {
+    printf( "%s", ( i == 0U ) ? "C" : "" );
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      printf( " %.9g", model->C[ i ][ j ] );
+    }
+    printf( "\n" );
+  }
+
+  for ( i = 0U; i < NUM_OUTPUTS; i++ )
+  {
+    printf( "%s", ( i == 0U ) ? "D" : "" );
+    for ( j = 0U; j < NUM_INPUTS; j++ )
+    {
+      printf( " %.9g", model->D[ i ][ j ] );
+    }
+    printf( "\n" );
+  }
+
+  printf( "losses" );
+  for ( i = 0U; i < NUM_LOSSES; i++ )
+  {
+    printf( " %.9g", losses[ i ] );
+  }
+
+  printf( "\nthresholds" );
+  for ( i = 0U; i < NUM_OUTPUTS; i++ )
+  {
+    printf( " %.9g", model->ratings.thresholds[ i ] );
+  }
+
+  printf( "\noverload" );
+  for ( i = 0U; i < NUM_INPUTS; i++ )
+  {
+    printf( " %.9g", model->ratings.overloadInputs[ i ] );
+  }
+
+  printf( "\nrated" );
+  for ( i = 0U; i < NUM_INPUTS; i++ )
+  {
+    printf( " %.9g", model->ratings.ratedInputs[ i ] );
+  }
+
+  printf( "\nstep %.9g %u\n", model->operatorStep, model->operatorSteps );
+}
+
+/*!
+ * \brief Largest relative difference of the fitted entries to a known model
+ * \return Fraction
+ */
+static float _WorstError( const ASC_THERMAL_MODEL_FILE_IMAGE * model, const ASC_THERMAL_MODEL_FILE_IMAGE * truth )
+{
+  float worst = 0.0f;
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+
+  for ( i = 0U; i < NUM_STATES; i++ )
+  {
+    for ( j = 0U; j < NUM_STATES; j++ )
+    {
+      worst = ( truth->A[ i ][ j ] != 0.0f ) ?
+        fmaxf( worst, fabsf( ( model->A[ i ][ j ] - truth->A[ i ][ j ] ) / truth->A[ i ][ j ] ) ) : worst;
+    }
+
+    for ( j = 0U; j < NUM_INPUTS; j++ )
+    {
+      worst = ( truth->B[ i ][ j ] != 0.0f ) ?
+        fmaxf( worst, fabsf( ( model->B[ i ][ j ] - truth->B[ i ][ j ] ) / truth->B[ i ][ j ] ) ) : worst;
+    }
+  }
+
+  return worst;
+}
+
+int main( int argc, char *argv[] )
+{
+  int exitCode = 1;
+  const char * modelPath = (const char*)0;
+  const char * outputPath = (const char*)0;
+  uint32_t numWorkers = 4U;
+  uint32_t generateSeconds = 0U;
+  uint32_t numLogs = 0U;
+  uint32_t numGenerated = 8U;
+  float noise = 0.05f;
+  float skipSeconds = 0.0f;
+  ASC_THERMAL_MODEL_IDENTIFICATION_OPTIONS options = { 0.1f, 50U, 1e-6f };
+  ASC_THERMAL_MODEL_IDENTIFICATION_REPORT report;
+  ASC_THERMAL_MODEL_IDENTIFICATION_TERMS * terms = (ASC_THERMAL_MODEL_IDENTIFICATION_TERMS*)0;
+  uint64_t numSamples = 0U;
+  bool status = true;
+  bool readable = true;
+  uint32_t itr = 0U;
+  int arg = 0;
+
+  for ( arg = 1; ( arg < argc ) && status && readable; arg++ )
+  {
+    bool hasValue = ( ( arg + 1 ) < argc );
+
+    if ( ( strcmp( argv[ arg ], "-m" ) == 0 ) && hasValue )
+    {
+      modelPath = argv[ ++arg ];
+    }
+    else if ( ( strcmp( argv[ arg ], "-o" ) == 0 ) && hasValue )
+    {
+      outputPath = argv[ ++arg ];
+    }
+    else if ( ( strcmp( argv[ arg ], "-j" ) == 0 ) && hasValue )
+    {
+      numWorkers = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-i" ) == 0 ) && hasValue )
+    {
+      options.maxIterations = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-h" ) == 0 ) && hasValue )
+    {
+      options.h = strtof( argv[ ++arg ], (char**)0 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-s" ) == 0 ) && hasValue )
+    {
+      skipSeconds = strtof( argv[ ++arg ], (char**)0 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-g" ) == 0 ) && hasValue )
+    {
+      generateSeconds = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-c" ) == 0 ) && hasValue )
+    {
+      numGenerated = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-n" ) == 0 ) && hasValue )
+    {
+      noise = strtof( argv[ ++arg ], (char**)0 );
+    }
+    else if ( ( argv[ arg ][ 0 ] != '-' ) && ( numLogs < MAX_LOGS ) )
+    {
+      readable = _ReadLog( argv[ arg ], &_samples[ numLogs++ ] );
+    }
+    else
+    {
+      status = false;
+    }
+  }
+
+  if ( !readable )
+  {
+    status = false;
+  }
+  else if ( !status || ( options.h <= 0.0f ) || ( ( numLogs == 0U ) && ( generateSeconds == 0U ) ) ||
+       ( numGenerated == 0U ) || ( numGenerated > MAX_LOGS ) )
+  {
+    fprintf( stderr, "usage: %s [-m model.bin] [-o fitted.bin] [-j workers] [-i iterations] [-h step] [-s seconds]\n"
+                     "       %*s <log.txt> ... | -g <seconds> [-c logs] [-n noise]\n",
+             argv[ 0 ], (int)strlen( argv[ 0 ] ), "" );
+    status = false;
+  }
+  else if ( modelPath )
+  {
+    ASC_THERMAL_MODEL_FILE file;
+
+    status = ASC_THERMAL_MODEL_FILE_Open( &file, modelPath );
+
+    if ( status )
+    {
+      memcpy( (char*)&_model, (const char*)file.image, sizeof( _model ) );
+      ASC_THERMAL_MODEL_FILE_Close( &file );
+    }
+    else
+    {
+      fprintf( stderr, "%s: not a version %u model file for this model layout\n",
+               modelPath, ASC_THERMAL_MODEL_FILE_VERSION );
+    }
+  }
+  else
+  {
+    status = ASC_THERMAL_MODEL_FILE_Build( &_model, "default", ASC_THERMAL_MODEL_config, ASC_THERMAL_MODEL_losses,
+                                           ASC_THERMAL_MODEL_ratings, 0.1f, 10U );
+  }
+
+  if ( status && ( generateSeconds > 0U ) )
+  {
+    _Perturb( &_model, &_truth );
+
+    for ( numLogs = 0U; ( numLogs < numGenerated ) && status; numLogs++ )
+    {
+      status = _Generate( &_truth, options.h, (uint32_t)( (float)generateSeconds / options.h ), noise, &_samples[ numLogs ] );
+    }
+  }
+
+  for ( itr = 0U; itr < numLogs; itr++ )
+  {
+    _logs[ itr ].current = _samples[ itr ].current;
+    _logs[ itr ].speed = _samples[ itr ].speed;
+    _logs[ itr ].measured = _samples[ itr ].measured;
+    _logs[ itr ].count = _samples[ itr ].count;
+    _logs[ itr ].skip = (uint32_t)( skipSeconds / options.h );
+    numSamples += _samples[ itr ].count;
+  }
+
+  terms = status ? (ASC_THERMAL_MODEL_IDENTIFICATION_TERMS*)calloc( numLogs * ASC_THERMAL_MODEL_IDENTIFICATION_CANDIDATES,
+                                                                    sizeof( *terms ) ) :
+                   (ASC_THERMAL_MODEL_IDENTIFICATION_TERMS*)0;
+
+  if ( terms && ASC_WORK_POOL_Create( &_pool, numWorkers ) )
+  {
+    double start = _Now();
+
+    _initial = _model;
+
+    status = ASC_THERMAL_MODEL_IDENTIFICATION_Fit( &_pool, _logs, numLogs, &options, terms, &_model, &report );
+
+    if ( status )
+    {
+      fprintf( stderr, "%u logs, %llu samples, %u parameters, %u workers: %.2f s\n",
+               (unsigned)numLogs, (unsigned long long)numSamples, (unsigned)report.numParams,
+               (unsigned)numWorkers, _Now() - start );
+      fprintf( stderr, "%u iterations, %u candidates, rms %.4f K -> %.4f K over %u temperatures\n",
+               (unsigned)report.iterations, (unsigned)report.evaluations,
+               (double)report.initialRms, (double)report.finalRms, (unsigned)report.numResiduals );
+
+      if ( generateSeconds > 0U )
+      {
+        fprintf( stderr, "worst A, B error %.2f %% (from %.2f %%), iron exponent %.4f of %.4f, other losses %.4f of %.4f W\n",
+                 100.0 * (double)_WorstError( &_model, &_truth ),
+                 100.0 * (double)_WorstError( &_initial, &_truth ),
+                 (double)_model.losses.ironLossExponent, (double)_truth.losses.ironLossExponent,
+                 (double)_model.losses.otherLosses, (double)_truth.losses.otherLosses );
+      }
+
+      _PrintModel( &_model );
+    }
+    else
+    {
+      fprintf( stderr, "the fit failed\n" );
+    }
+
+    if ( status && outputPath )
+    {
+      FILE * output = fopen( outputPath, "wb" );
+
+      status = output && ( fwrite( (const void*)&_model, sizeof( _model ), 1U, output ) == 1U );
+      status = output && ( fclose( output ) == 0 ) && status;
+
+      if ( !status )
+      {
+        fprintf( stderr, "%s: cannot write\n", outputPath );
+      }
+    }
+
+    ASC_WORK_POOL_Destroy( &_pool );
+    exitCode = status ? 0 : 1;
+  }
+
+  free( terms );
+
+  for ( itr = 0U; itr < numLogs; itr++ )
+  {
+    free( _samples[ itr ].current );
+    free( _samples[ itr ].speed );
+    free( _samples[ itr ].measured );
+  }
+
+  return exitCode;
+}
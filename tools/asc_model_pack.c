@@ -0,0 +1,361 @@
+/**
+ * @file
+ * @brief Packs thermal model coefficients into 16 bit codes and reports what
+ * the rounding costs in coefficients, simulated temperatures and steady state
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_model_pack [-m model.bin] [-t seconds] [-e kelvin]   accuracy report
+ *        asc_model_pack [-m model.bin] -c float16|int16  prints C tables
+ *
+ * Without -m the compiled in model is used. The report simulates the same
+ * random duty profile, up to the overload inputs and changing every minute,
+ * with the float and each packed model and compares the outputs. With -e the
+ * exit status fails when a steady state or duty profile error of either
+ * format exceeds the given bound.
+ */
+
+#include "lu_decomposition.h"
+#include "rk4solver.h"
+#include "thermal_model_file.h"
+#include "thermal_model_state_space.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+#define PACKED_LENGTH RK4SOLVER_PACKED_LENGTH( NUM_STATES, NUM_INPUTS, NUM_OUTPUTS )
+#define STEP (0.1f)
+#define STEPS_PER_SEGMENT (600U)
+
+static const char * const _matrixNames[ 4 ] = { "A", "B", "C", "D" };
+static const uint32_t _matrixSizes[ 4 ] = { NUM_STATES * NUM_STATES,
+                                            NUM_STATES * NUM_INPUTS,
+                                            NUM_OUTPUTS * NUM_STATES,
+                                            NUM_OUTPUTS * NUM_INPUTS };
+
+/*!
+ * \brief Steady state outputs for constant inputs, y = ( D - C*A^-1*B )*u
+ * \return success
+ * \retval false A is singular
+ */
+static bool _SteadyState( const RK4SOLVER_CONFIGURATION * config, const float * u, float * y )
+{
+  float A[ NUM_STATES * NUM_STATES ];
+  float Bu[ NUM_STATES ] = { 0.0f };
+  float x[ NUM_STATES ];
+  uint32_t pivots[ NUM_STATES ];
+  uint32_t i = 0U;
+  uint32_t j = 0U;
+  bool status = false;
+
+  (void)RK4SOLVER_GetMatrix( config, RK4SOLVER_MATRIX_A, A );
+
+  for ( i = 0U; i < NUM_STATES; i++ )
+  {
+    for ( j = 0U; j < NUM_INPUTS; j++ )
+    {
+      Bu[ i ] -= RK4SOLVER_GetCoefficient( config, RK4SOLVER_MATRIX_B, ( i * NUM_INPUTS ) + j ) * u[ j ];
+    }
+  }
+
+  status = ( LU_Factor( A, NUM_STATES, pivots ) == 1U ) &&
+           ( LU_Solve( A, NUM_STATES, pivots, Bu, x ) == 1U ) &&
+           ( RK4SOLVER_Output( config, x, (float*)u, y ) == 1U );
+
+  return status;
+}
+
+/*!
+ * \brief Simulates the float and the packed model over the same duty profile
+ * \param peak [out] Largest output difference over the profile, K
+ * \param final [out] Largest output difference at the end, K
+ * \return success
+ */
+static bool _Simulate( const RK4SOLVER_CONFIGURATION * reference,
+                       const RK4SOLVER_CONFIGURATION * packed,
+                       const ASC_THERMAL_MODEL_RATINGS * ratings,
+                       uint32_t duration,
+                       float * peak,
+                       float * final )
+{
+  static float workspace[ RK4SOLVER_WORKSPACE_LENGTH( NUM_STATES, NUM_INPUTS ) ] RK4SOLVER_ALIGNED;
+  const RK4SOLVER_CONFIGURATION * configs[ 2 ] = { reference, packed };
+  float x[ 2 ][ NUM_STATES ] = { { 0.0f } };
+  float next[ 2 ][ NUM_STATES ];
+  float y[ 2 ][ NUM_OUTPUTS ] = { { 0.0f } };
+  float u[ NUM_INPUTS ];
+  uint32_t seed = 12345U;
+  uint32_t steps = (uint32_t)( (float)duration / STEP );
+  uint32_t step = 0U;
+  uint32_t i = 0U;
+  uint32_t m = 0U;
+  bool status = true;
+
+  *peak = 0.0f;
+  *final = 0.0f;
+
+  for ( step = 0U; status && ( step < steps ); step++ )
+  {
+    if ( ( step % STEPS_PER_SEGMENT ) == 0U )
+    {
+      for ( i = 0U; i < NUM_INPUTS; i++ )
+      {
+        seed = ( seed * 1103515245U ) + 12345U;
+        u[ i ] = ratings->overloadInputs[ i ] * ( (float)( seed >> 16 ) / 65536.0f );
+      }
+    }
+
+    for ( m = 0U; status && ( m < 2U ); m++ )
+    {
+      RK4SOLVER_INPUT input = { STEP, x[ m ], u, u, workspace };
+      RK4SOLVER_OUTPUT output = { next[ m ], y[ m ] };
+
+      status = ( RK4SOLVER_Solve( configs[ m ], &input, &output ) == 1U );
+      memcpy( (char*)x[ m ], (char*)next[ m ], sizeof( x[ m ] ) );
+    }
+
+    *final = 0.0f;
+
+    for ( i = 0U; i < NUM_OUTPUTS; i++ )
+    {
+      float difference = fabsf( y[ 1 ][ i ] - y[ 0 ][ i ] );
+
+      *peak = ( difference > *peak ) ? difference : *peak;
+      *final = ( difference > *final ) ? difference : *final;
+    }
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Prints the accuracy report of one format
+ * \param bound Largest steady state and duty profile error in K, 0 for no bound
+ * \return success, false also when an error exceeds the bound
+ */
+static bool _Report( const RK4SOLVER_CONFIGURATION * config,
+                     const ASC_THERMAL_MODEL_RATINGS * ratings,
+                     uint8_t format,
+                     uint32_t duration,
+                     float bound )
+{
+  static uint16_t storage[ PACKED_LENGTH ];
+  RK4SOLVER_PACKED packed;
+  RK4SOLVER_CONFIGURATION packedConfig = { NUM_STATES, NUM_INPUTS, NUM_OUTPUTS,
+                                           (const float*)0, (const float*)0, (const float*)0, (const float*)0,
+                                           &packed };
+  const RK4SOLVER_PACKED_MATRIX * matrices[ 4 ] = { &packed.A, &packed.B, &packed.C, &packed.D };
+  float referenceSteady[ NUM_OUTPUTS ];
+  float packedSteady[ NUM_OUTPUTS ];
+  float steadyError = 0.0f;
+  float threshold = ratings->thresholds[ 0 ];
+  float peak = 0.0f;
+  float final = 0.0f;
+  uint32_t matrix = 0U;
+  uint32_t i = 0U;
+  bool status = ( RK4SOLVER_Pack( config, format, &packed, storage ) == 1U );
+
+  printf( "%s: %u coefficient bytes, %u as float\n",
+          ( format == RK4SOLVER_PACKED_FLOAT16 ) ? "float16" : "int16",
+          (unsigned)( sizeof( storage ) + 4U ), (unsigned)( PACKED_LENGTH * sizeof( float ) ) );
+
+  for ( matrix = 0U; status && ( matrix < 4U ); matrix++ )
+  {
+    float absolute = 0.0f;
+    float relative = 0.0f;
+
+    for ( i = 0U; i < _matrixSizes[ matrix ]; i++ )
+    {
+      float value = RK4SOLVER_GetCoefficient( config, (uint8_t)matrix, i );
+      float error = fabsf( RK4SOLVER_GetCoefficient( &packedConfig, (uint8_t)matrix, i ) - value );
+
+      absolute = ( error > absolute ) ? error : absolute;
+
+      if ( ( value != 0.0f ) && ( ( error / fabsf( value ) ) > relative ) )
+      {
+        relative = error / fabsf( value );
+      }
+    }
+
+    printf( "  %s  2^%-4d max error %.3e abs %.3e rel\n", _matrixNames[ matrix ],
+            (int)matrices[ matrix ]->exponent, (double)absolute, (double)relative );
+  }
+
+  for ( i = 1U; i < NUM_OUTPUTS; i++ )
+  {
+    threshold = ( ratings->thresholds[ i ] < threshold ) ? ratings->thresholds[ i ] : threshold;
+  }
+
+  status = status &&
+           _SteadyState( config, ratings->ratedInputs, referenceSteady ) &&
+           _SteadyState( &packedConfig, ratings->ratedInputs, packedSteady ) &&
+           _Simulate( config, &packedConfig, ratings, duration, &peak, &final );
+
+  for ( i = 0U; status && ( i < NUM_OUTPUTS ); i++ )
+  {
+    float error = fabsf( packedSteady[ i ] - referenceSteady[ i ] );
+
+    steadyError = ( error > steadyError ) ? error : steadyError;
+  }
+
+  if ( status )
+  {
+    printf( "  steady state at rated inputs  max error %.4f K\n", (double)steadyError );
+    printf( "  %u s duty profile  max error %.4f K, %.4f K at the end (%.3f%% of the lowest threshold)\n",
+            (unsigned)duration, (double)peak, (double)final, (double)( 100.0f * peak / threshold ) );
+
+    if ( ( bound > 0.0f ) && ( ( steadyError > bound ) || ( peak > bound ) ) )
+    {
+      printf( "  exceeds the bound of %.4f K\n", (double)bound );
+      status = false;
+    }
+  }
+  else
+  {
+    printf( "  cannot pack or simulate the model\n" );
+  }
+
+  return status;
+}
+
+/*!
+ * \brief Prints the packed tables in the layout of thermal_model_state_space.c
+ * \return success
+ */
+static bool _PrintTables( const RK4SOLVER_CONFIGURATION * config, uint8_t format )
+{
+  static uint16_t storage[ PACKED_LENGTH ];
+  RK4SOLVER_PACKED packed;
+  const RK4SOLVER_PACKED_MATRIX * matrices[ 4 ] = { &packed.A, &packed.B, &packed.C, &packed.D };
+  const uint32_t columns[ 4 ] = { NUM_STATES, NUM_INPUTS, NUM_STATES, NUM_INPUTS };
+  const char * const sizes[ 4 ] = { "ASC_THERMAL_MODEL_NUM_STATES * ASC_THERMAL_MODEL_NUM_STATES",
+                                    "ASC_THERMAL_MODEL_NUM_STATES * ASC_THERMAL_MODEL_NUM_INPUTS",
+                                    "ASC_THERMAL_MODEL_NUM_OUTPUTS * ASC_THERMAL_MODEL_NUM_STATES",
+                                    "ASC_THERMAL_MODEL_NUM_OUTPUTS * ASC_THERMAL_MODEL_NUM_INPUTS" };
+  const char * name = ( format == RK4SOLVER_PACKED_FLOAT16 ) ? "FLOAT16" : "INT16";
+  uint32_t matrix = 0U;
+  uint32_t i = 0U;
+  bool status = ( RK4SOLVER_Pack( config, format, &packed, storage ) == 1U );
+
+  for ( matrix = 0U; status && ( matrix < 4U ); matrix++ )
+  {
+    printf( "static const uint16_t _packed%s[ %s ] =\n    {", _matrixNames[ matrix ], sizes[ matrix ] );
+
+    for ( i = 0U; i < _matrixSizes[ matrix ]; i++ )
+    {
+      printf( "%s0x%04X%s", ( i == 0U ) ? "" : ( ( i % columns[ matrix ] ) == 0U ) ? "\n     " : " ",
+              (unsigned)matrices[ matrix ]->data[ i ], ( ( i + 1U ) < _matrixSizes[ matrix ] ) ? "," : "};\n\n" );
+    }
+  }
+
+  if ( status )
+  {
+    printf( "static const RK4SOLVER_PACKED _packed =\n"
+            "    { RK4SOLVER_PACKED_%s,\n", name );
+
+    for ( matrix = 0U; matrix < 4U; matrix++ )
+    {
+      printf( "      { _packed%s, %d }%s\n", _matrixNames[ matrix ], (int)matrices[ matrix ]->exponent,
+              ( matrix < 3U ) ? "," : "" );
+    }
+
+    printf( "    };\n" );
+  }
+
+  return status;
+}
+
+int main( int argc, char *argv[] )
+{
+  int exitCode = 1;
+  const char * path = (const char*)0;
+  const char * tables = (const char*)0;
+  uint32_t duration = 7200U;
+  float bound = 0.0f;
+  ASC_THERMAL_MODEL_FILE file;
+  const RK4SOLVER_CONFIGURATION * config = ASC_THERMAL_MODEL_config;
+  const ASC_THERMAL_MODEL_RATINGS * ratings = ASC_THERMAL_MODEL_ratings;
+  int arg = 0;
+
+  for ( arg = 1; arg < argc; arg++ )
+  {
+    if ( ( strcmp( argv[ arg ], "-m" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      path = argv[ ++arg ];
+    }
+    else if ( ( strcmp( argv[ arg ], "-t" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      duration = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-e" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      bound = strtof( argv[ ++arg ], (char**)0 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-c" ) == 0 ) && ( ( arg + 1 ) < argc ) &&
+              ( ( strcmp( argv[ arg + 1 ], "float16" ) == 0 ) || ( strcmp( argv[ arg + 1 ], "int16" ) == 0 ) ) )
+    {
+      tables = argv[ ++arg ];
+    }
+    else
+    {
+      fprintf( stderr, "usage: %s [-m model.bin] [-t seconds] [-e kelvin]\n"
+                       "       %s [-m model.bin] -c float16|int16\n", argv[ 0 ], argv[ 0 ] );
+      return 1;
+    }
+  }
+
+  if ( path && !ASC_THERMAL_MODEL_FILE_Open( &file, path ) )
+  {
+    fprintf( stderr, "%s: not a version %u model file for this model layout\n",
+             path, ASC_THERMAL_MODEL_FILE_VERSION );
+  }
+  else
+  {
+    if ( path )
+    {
+      config = &file.config;
+      ratings = &file.image->ratings;
+    }
+
+    if ( config->packed )
+    {
+      fprintf( stderr, "the model is already packed, build without ASC_THERMAL_MODEL_PACKED_*\n" );
+    }
+    else if ( tables )
+    {
+      exitCode = _PrintTables( config, ( strcmp( tables, "float16" ) == 0 ) ? RK4SOLVER_PACKED_FLOAT16 :
+                                                                             RK4SOLVER_PACKED_INT16 ) ? 0 : 1;
+    }
+    else
+    {
+      bool status = _Report( config, ratings, RK4SOLVER_PACKED_FLOAT16, duration, bound );
+
+      status = _Report( config, ratings, RK4SOLVER_PACKED_INT16, duration, bound ) && status;
+      exitCode = status ? 0 : 1;
+    }
+
+    if ( path )
+    {
+      (void)ASC_THERMAL_MODEL_FILE_Close( &file );
+    }
+  }
+
+  return exitCode;
+}
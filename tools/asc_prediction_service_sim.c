@@ -0,0 +1,299 @@
+/**
+ * @file
+ * @brief Predicts overload for many axes of one motor model, once with an
+ * overload predictor background task per axis and once through the prediction
+ * service, and compares the throughput and the verdicts
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_prediction_service_sim [-n axes] [-r rounds] [-g groups]
+ *                                   [-e tolerance] [-j jitter]
+ *
+ * Every round each axis gets a new state and ambient. With groups, the axes
+ * run the same duty in that many groups, so their states differ only by the
+ * jitter in K, e.g. the axes of one conveyor; the default groups make the
+ * threaded run share predictions, 0 gives every axis its own state. The
+ * service is run twice: batched on the caller without sharing, then threaded
+ * with the tolerance. Peaks below the per axis predictor's and verdicts that
+ * allow an overload it denies are unsafe, and fail the run.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "rk4solver.h"
+#include "thermal_model.h"
+#include "thermal_model_overload_predictor.h"
+#include "thermal_model_prediction_service.h"
+#include "thermal_model_state_space.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+
+/*!
+ * \brief Totals of one way of predicting against the per axis predictor
+ */
+typedef struct
+{
+  uint64_t nanoseconds;
+  double worstPeakBelow; //!< K below the reference, unsafe beyond rounding
+  double worstPeakAbove; //!< K above the reference, the price of sharing
+  uint32_t unsafeVerdicts; //!< Overload allowed where the reference denies it
+  uint32_t conservativeVerdicts; //!< Overload denied where the reference allows it
+} RUN;
+
+static ASC_THERMAL_MODEL_PREDICTION_SERVICE _batched;
+static ASC_THERMAL_MODEL_PREDICTION_SERVICE _service;
+static uint32_t _seed = 7U;
+
+/*!
+ * \brief Uniform random value
+ * \return 0 .. 1
+ */
+static float _Random( void )
+{
+  _seed = ( _seed * 1103515245U ) + 12345U;
+
+  return (float)( _seed >> 8 ) / 16777216.0f;
+}
+
+/*!
+ * \brief Monotonic time stamp
+ * \return Nanoseconds
+ */
+static uint64_t _Now( void )
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  return ( (uint64_t)now.tv_sec * 1000000000ULL ) + (uint64_t)now.tv_nsec;
+}
+
+/*!
+ * \brief Service completion callback, files the result under its axis
+ */
+static void _Complete( void * context, const ASC_THERMAL_MODEL_PREDICTION_RESULT * result )
+{
+  ASC_THERMAL_MODEL_PREDICTION_RESULT * results = (ASC_THERMAL_MODEL_PREDICTION_RESULT*)context;
+
+  results[ (uintptr_t)result->instance ] = *result;
+}
+
+/*!
+ * \brief Compares results with the per axis predictor's
+ */
+static void _Compare( RUN * run,
+                      const ASC_THERMAL_MODEL_PREDICTION_RESULT * results,
+                      const ASC_THERMAL_MODEL_PREDICTION_RESULT * reference,
+                      uint32_t numAxes )
+{
+  uint32_t a = 0U;
+  uint32_t i = 0U;
+
+  for ( a = 0U; a < numAxes; a++ )
+  {
+    for ( i = 0U; i < NUM_OUTPUTS; i++ )
+    {
+      double error = (double)results[ a ].peaks[ i ] - (double)reference[ a ].peaks[ i ];
+
+      run->worstPeakBelow = ( -error > run->worstPeakBelow ) ? -error : run->worstPeakBelow;
+      run->worstPeakAbove = ( error > run->worstPeakAbove ) ? error : run->worstPeakAbove;
+    }
+
+    run->unsafeVerdicts += ( results[ a ].overloadAvailable && !reference[ a ].overloadAvailable ) ? 1U : 0U;
+    run->conservativeVerdicts += ( !results[ a ].overloadAvailable && reference[ a ].overloadAvailable ) ? 1U : 0U;
+  }
+}
+
+/*!
+ * \brief Prints one line of results
+ */
+static void _PrintResult( const char * name, const RUN * run, uint64_t predictions, uint64_t reference )
+{
+  printf( "%-11s %8.3f us per prediction  %6.1fx  peaks -%.6f/+%.6f K  verdicts %u unsafe, %u conservative\n",
+          name, (double)run->nanoseconds * 1e-3 / (double)predictions,
+          ( run->nanoseconds > 0U ) ? (double)reference / (double)run->nanoseconds : 0.0,
+          run->worstPeakBelow, run->worstPeakAbove,
+          (unsigned)run->unsafeVerdicts, (unsigned)run->conservativeVerdicts );
+}
+
+int main( int argc, char *argv[] )
+{
+  const ASC_THERMAL_MODEL_RATINGS * ratings = ASC_THERMAL_MODEL_ratings;
+  uint32_t numAxes = 1024U;
+  uint32_t rounds = 20U;
+  uint32_t numGroups = 8U;
+  float tolerance = 0.05f;
+  float jitter = 0.005f;
+  static ASC_THERMAL_MODEL_INSTANCE axis;
+  ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR * predictor = &axis.predictor;
+  ASC_THERMAL_MODEL_PREDICTION_REQUEST * requests = (ASC_THERMAL_MODEL_PREDICTION_REQUEST*)0;
+  ASC_THERMAL_MODEL_PREDICTION_RESULT * reference = (ASC_THERMAL_MODEL_PREDICTION_RESULT*)0;
+  ASC_THERMAL_MODEL_PREDICTION_RESULT * results = (ASC_THERMAL_MODEL_PREDICTION_RESULT*)0;
+  float * groups = (float*)0;
+  RUN independent;
+  RUN batched;
+  RUN threaded;
+  ASC_THERMAL_MODEL_PREDICTION_STATS stats;
+  uint64_t distinct = 0U;
+  uint32_t round = 0U;
+  uint32_t a = 0U;
+  uint32_t i = 0U;
+  int exitCode = 1;
+  int arg = 0;
+
+  for ( arg = 1; arg < argc; arg++ )
+  {
+    if ( ( strcmp( argv[ arg ], "-n" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      numAxes = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-r" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      rounds = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-g" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      numGroups = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-e" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      tolerance = strtof( argv[ ++arg ], (char**)0 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-j" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      jitter = strtof( argv[ ++arg ], (char**)0 );
+    }
+    else
+    {
+      fprintf( stderr, "usage: %s [-n axes] [-r rounds] [-g groups] [-e tolerance] [-j jitter]\n", argv[ 0 ] );
+      return 1;
+    }
+  }
+
+  requests = (ASC_THERMAL_MODEL_PREDICTION_REQUEST*)calloc( ( numAxes > 0U ) ? numAxes : 1U, sizeof( *requests ) );
+  reference = (ASC_THERMAL_MODEL_PREDICTION_RESULT*)calloc( ( numAxes > 0U ) ? numAxes : 1U, sizeof( *reference ) );
+  results = (ASC_THERMAL_MODEL_PREDICTION_RESULT*)calloc( ( numAxes > 0U ) ? numAxes : 1U, sizeof( *results ) );
+  groups = (float*)calloc( ( ( numGroups > 0U ) ? numGroups : 1U ) * NUM_STATES, sizeof( float ) );
+  memset( (char*)&independent, 0, sizeof( independent ) );
+  memset( (char*)&batched, 0, sizeof( batched ) );
+  memset( (char*)&threaded, 0, sizeof( threaded ) );
+
+  if ( !requests || !reference || !results || !groups || ( numAxes == 0U ) || ( rounds == 0U ) ||
+       ( numAxes > ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED ) )
+  {
+    fprintf( stderr, "need 1 .. %u axes and at least one round\n", (unsigned)ASC_THERMAL_MODEL_PREDICTION_SERVICE_MAX_QUEUED );
+  }
+  // one axis of the model, reused by every axis of the independent run and
+  // the template of the service
+  else if ( !ASC_THERMAL_MODEL_SetupInstance( &axis ) ||
+            !ASC_THERMAL_MODEL_PREDICTION_SERVICE_Create( &_batched, predictor, 0.0f,
+                                                          (ASC_THERMAL_MODEL_PREDICTION_CALLBACK)0, (void*)0, false ) ||
+            !ASC_THERMAL_MODEL_PREDICTION_SERVICE_Create( &_service, predictor, tolerance, _Complete, (void*)results, true ) )
+  {
+    fprintf( stderr, "cannot create the prediction service\n" );
+  }
+  else
+  {
+    printf( "%u axes, %u rounds, %u groups, jitter %.4f K, tolerance %.4f K\n",
+            (unsigned)numAxes, (unsigned)rounds, (unsigned)numGroups, (double)jitter, (double)tolerance );
+
+    for ( round = 0U; round < rounds; round++ )
+    {
+      uint64_t start = 0U;
+
+      // states from idle to well past the thresholds
+      for ( i = 0U; i < ( numGroups * NUM_STATES ); i++ )
+      {
+        groups[ i ] = 80.0f * _Random();
+      }
+
+      for ( a = 0U; a < numAxes; a++ )
+      {
+        requests[ a ].instance = (void*)(uintptr_t)a;
+        requests[ a ].ambient = 15.0f + ( 20.0f * _Random() );
+
+        for ( i = 0U; i < NUM_STATES; i++ )
+        {
+          requests[ a ].state[ i ] = ( numGroups > 0U ) ?
+            ( groups[ ( ( a % numGroups ) * NUM_STATES ) + i ] + ( jitter * ( ( 2.0f * _Random() ) - 1.0f ) ) ) :
+            ( 80.0f * _Random() );
+        }
+      }
+
+      // a background task per axis, thresholds moved by its ambient
+      start = _Now();
+
+      for ( a = 0U; a < numAxes; a++ )
+      {
+        for ( i = 0U; i < NUM_OUTPUTS; i++ )
+        {
+          predictor->maxTempThresholds[ i ] = ratings->thresholds[ i ] + ( predictor->ambientTemp - requests[ a ].ambient );
+        }
+
+        memcpy( (char*)predictor->initialState, (char*)requests[ a ].state, sizeof( predictor->initialState ) );
+        (void)ASC_THERMAL_MODEL_InstanceBackgroundTask( &axis );
+        memcpy( (char*)reference[ a ].peaks, (char*)predictor->maxTemps, sizeof( reference[ a ].peaks ) );
+        reference[ a ].overloadAvailable = ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_IsOverloadAvailable( predictor );
+      }
+
+      independent.nanoseconds += _Now() - start;
+
+      // the batch kernel on the caller, nothing shared
+      start = _Now();
+      distinct += ASC_THERMAL_MODEL_PREDICTION_SERVICE_Predict( &_batched, requests, numAxes, results );
+      batched.nanoseconds += _Now() - start;
+      _Compare( &batched, results, reference, numAxes );
+
+      // submitted one by one to the service thread
+      start = _Now();
+
+      for ( a = 0U; a < numAxes; a++ )
+      {
+        (void)ASC_THERMAL_MODEL_PREDICTION_SERVICE_Submit( &_service, requests[ a ].instance,
+                                                           requests[ a ].state, requests[ a ].ambient );
+      }
+
+      ASC_THERMAL_MODEL_PREDICTION_SERVICE_Flush( &_service );
+      threaded.nanoseconds += _Now() - start;
+      _Compare( &threaded, results, reference, numAxes );
+    }
+
+    ASC_THERMAL_MODEL_PREDICTION_SERVICE_GetStats( &_service, &stats );
+    _PrintResult( "independent", &independent, (uint64_t)numAxes * rounds, independent.nanoseconds );
+    _PrintResult( "batched", &batched, (uint64_t)numAxes * rounds, independent.nanoseconds );
+    _PrintResult( "service", &threaded, (uint64_t)numAxes * rounds, independent.nanoseconds );
+    printf( "batched: %llu distinct states, service: %llu requests in %llu batches, %llu shared, %llu rejected\n",
+            (unsigned long long)distinct, (unsigned long long)stats.requests, (unsigned long long)stats.batches,
+            (unsigned long long)stats.shared, (unsigned long long)stats.rejected );
+    exitCode = ( ( batched.unsafeVerdicts + threaded.unsafeVerdicts ) > 0U ) ? 1 : 0;
+
+    ASC_THERMAL_MODEL_PREDICTION_SERVICE_Destroy( &_service );
+    ASC_THERMAL_MODEL_PREDICTION_SERVICE_Destroy( &_batched );
+  }
+
+  free( groups );
+  free( results );
+  free( reference );
+  free( requests );
+
+  return exitCode;
+}
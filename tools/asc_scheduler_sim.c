@@ -0,0 +1,361 @@
+/**
+ * @file
+ * @brief Runs many axes of estimator, overload predictor and torque manager in
+ * real time, once called all at the same moment and once through the task
+ * scheduler, and compares the tick latencies
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_scheduler_sim [-n axes] [-t seconds] [-w workers]
+ *
+ * Every axis runs its torque manager foreground task each 10 ms tick, its
+ * estimator each second and an overload prediction each second. The aligned
+ * run calls them the way an application without the scheduler does, every
+ * estimator and prediction in the same tick. The scheduled run staggers the
+ * estimators over the ticks of the second and hands the predictions to the
+ * workers, earliest deadline first.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "rk4solver.h"
+#include "task_scheduler.h"
+#include "thermal_model.h"
+#include "thermal_model_estimator.h"
+#include "thermal_model_overload_predictor.h"
+#include "thermal_model_state_space.h"
+#include "torque_manager.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define TICK_NANOSECONDS (10000000ULL) // 10 ms
+#define TICKS_PER_SECOND (100U)
+
+/* Relative costs for the phase planning, in RK4 steps */
+#define CONTROL_COST (1U)
+#define ESTIMATOR_COST (10U)
+#define PREDICTION_COST (60U)
+
+/*!
+ * \brief Everything one axis runs
+ */
+typedef struct
+{
+  ASC_THERMAL_MODEL_INSTANCE model;
+  ASC_TORQUE_MANAGER manager;
+  uint32_t seed;
+  bool overloadAvailable;
+} AXIS;
+
+/*!
+ * \brief Torque output of the torque managers, nothing to drive here
+ */
+static void _SetTorque( uint8_t value )
+{
+  (void)value;
+}
+
+/*!
+ * \brief Next value of an axis' random sequence, 0 .. 65535
+ */
+static uint32_t _Random( AXIS * axis )
+{
+  axis->seed = ( axis->seed * 1103515245U ) + 12345U;
+
+  return axis->seed >> 16;
+}
+
+/*!
+ * \brief Sets up the estimator, predictor and torque manager of an axis
+ * \return success
+ */
+static bool _SetupAxis( AXIS * axis, uint32_t index )
+{
+  ASC_TORQUE_MANAGER manager =
+  {
+    255U, 0U, 0U, 0U, 0U, 0U, _SetTorque,
+    { 0U, 30U, 170U, 150U, 110U, 150U, 130U, 230U },
+    { 10, 1, 1, 10, 0, 64U, 0U, 1U },
+    (const ASC_THERMAL_MODEL_SETPOINT_ENTRY*)0,
+    (const ASC_THERMAL_MODEL_SETPOINT_ENTRY*)0
+  };
+
+  memset( (char*)axis, 0, sizeof( *axis ) );
+  axis->seed = 7U + index;
+  axis->manager = manager;
+
+  return ASC_THERMAL_MODEL_SetupInstance( &axis->model );
+}
+
+/*!
+ * \brief Torque manager job, every tick, changes setpoint now and then
+ */
+static void _ControlJob( void * instance )
+{
+  AXIS * axis = (AXIS*)instance;
+
+  if ( ( _Random( axis ) & 0x3FU ) == 0U )
+  {
+    (void)ASC_TORQUE_MANAGER_SetTorqueByIndex( &axis->manager, (uint8_t)( _Random( axis ) % ASC_TORQUE_SETPOINT_COUNT ) );
+  }
+
+  ASC_TORQUE_MANAGER_ForegroundTask( &axis->manager );
+}
+
+/*!
+ * \brief Estimator job, every second, with the losses of a random load
+ */
+static void _EstimatorJob( void * instance )
+{
+  AXIS * axis = (AXIS*)instance;
+  float inputs[ NUM_INPUTS ];
+
+  ASC_THERMAL_MODEL_CalculateSourceInputs( inputs,
+                                           4.0f * (float)_Random( axis ) / 65536.0f,
+                                           40.0f * (float)_Random( axis ) / 65536.0f );
+  ASC_THERMAL_MODEL_ESTIMATOR_SetInputs( &axis->model.estimator, inputs );
+  ASC_THERMAL_MODEL_InstancePeriodicTask( &axis->model );
+}
+
+/*!
+ * \brief Hands the prediction the estimate it starts from, in the tick
+ */
+static void _PredictionRelease( void * instance )
+{
+  AXIS * axis = (AXIS*)instance;
+
+  memcpy( (char*)axis->model.predictor.initialState, (char*)axis->model.estimatorState, sizeof( axis->model.estimatorState ) );
+}
+
+/*!
+ * \brief Overload prediction job, every second
+ */
+static void _PredictionJob( void * instance )
+{
+  AXIS * axis = (AXIS*)instance;
+
+  (void)ASC_THERMAL_MODEL_InstanceBackgroundTask( &axis->model );
+  axis->overloadAvailable = ASC_THERMAL_MODEL_OVERLOAD_PREDICTOR_IsOverloadAvailable( &axis->model.predictor );
+}
+
+/*!
+ * \brief Monotonic time stamp
+ * \return Nanoseconds
+ */
+static uint64_t _Now( void )
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  return ( (uint64_t)now.tv_sec * 1000000000ULL ) + (uint64_t)now.tv_nsec;
+}
+
+/*!
+ * \brief Sleeps until an absolute monotonic time
+ */
+static void _SleepUntil( uint64_t time )
+{
+  struct timespec until;
+
+  until.tv_sec = (time_t)( time / 1000000000ULL );
+  until.tv_nsec = (long)( time % 1000000000ULL );
+
+  while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &until, (struct timespec*)0 ) != 0 )
+  {
+  }
+}
+
+/*!
+ * \brief Prints one line of results
+ */
+static void _PrintResult( const char * name, uint64_t worst, uint64_t mean, uint32_t overruns,
+                          uint32_t minLoad, uint32_t maxLoad, uint32_t misses, uint32_t skipped )
+{
+  printf( "%-9s worst tick %8.3f ms  mean %7.3f ms  overruns %5u  load per tick %6u .. %-6u  misses %u  skipped %u\n",
+          name, (double)worst * 1e-6, (double)mean * 1e-6, (unsigned)overruns,
+          (unsigned)minLoad, (unsigned)maxLoad, (unsigned)misses, (unsigned)skipped );
+}
+
+/*!
+ * \brief Every job of every axis in the tick it falls due, predictions inline
+ * right after the estimators
+ */
+static void _RunAligned( AXIS * axes, uint32_t numAxes, uint32_t ticks )
+{
+  uint64_t next = _Now();
+  uint64_t worst = 0U;
+  uint64_t total = 0U;
+  uint32_t overruns = 0U;
+  uint32_t tick = 0U;
+  uint32_t i = 0U;
+
+  for ( tick = 0U; tick < ticks; tick++ )
+  {
+    uint64_t start = 0U;
+    uint64_t elapsed = 0U;
+
+    _SleepUntil( next );
+    next += TICK_NANOSECONDS;
+    start = _Now();
+
+    for ( i = 0U; i < numAxes; i++ )
+    {
+      _ControlJob( &axes[ i ] );
+    }
+
+    if ( ( tick % TICKS_PER_SECOND ) == 0U )
+    {
+      for ( i = 0U; i < numAxes; i++ )
+      {
+        _EstimatorJob( &axes[ i ] );
+      }
+
+      for ( i = 0U; i < numAxes; i++ )
+      {
+        _PredictionRelease( &axes[ i ] );
+        _PredictionJob( &axes[ i ] );
+      }
+    }
+
+    elapsed = _Now() - start;
+    worst = ( elapsed > worst ) ? elapsed : worst;
+    total += elapsed;
+    overruns += ( elapsed > TICK_NANOSECONDS ) ? 1U : 0U;
+  }
+
+  _PrintResult( "aligned", worst, total / ticks, overruns,
+                numAxes * CONTROL_COST, numAxes * ( CONTROL_COST + ESTIMATOR_COST + PREDICTION_COST ), 0U, 0U );
+}
+
+/*!
+ * \brief The same jobs through the task scheduler
+ * \return success
+ */
+static bool _RunScheduled( AXIS * axes, uint32_t numAxes, uint32_t ticks, uint32_t numWorkers )
+{
+  static ASC_TASK_SCHEDULER scheduler;
+  bool status = ASC_TASK_SCHEDULER_Create( &scheduler, TICKS_PER_SECOND, TICK_NANOSECONDS, numWorkers );
+  uint32_t i = 0U;
+
+  for ( i = 0U; ( i < numAxes ) && status; i++ )
+  {
+    status = ASC_TASK_SCHEDULER_AddForeground( &scheduler, _ControlJob, &axes[ i ], 1U, CONTROL_COST, (uint32_t*)0 ) &&
+             ASC_TASK_SCHEDULER_AddForeground( &scheduler, _EstimatorJob, &axes[ i ], TICKS_PER_SECOND,
+                                               ESTIMATOR_COST, (uint32_t*)0 ) &&
+             ASC_TASK_SCHEDULER_AddBackground( &scheduler, _PredictionJob, _PredictionRelease, &axes[ i ],
+                                               TICKS_PER_SECOND, TICKS_PER_SECOND, PREDICTION_COST, (uint32_t*)0 );
+  }
+
+  if ( status )
+  {
+    ASC_TASK_SCHEDULER_STATS stats;
+    uint64_t next = _Now();
+    uint32_t tick = 0U;
+
+    for ( tick = 0U; tick < ticks; tick++ )
+    {
+      _SleepUntil( next );
+      next += TICK_NANOSECONDS;
+      ASC_TASK_SCHEDULER_Tick( &scheduler );
+
+      // without workers the predictions run in the rest of the tick
+      if ( numWorkers == 0U )
+      {
+        (void)ASC_TASK_SCHEDULER_Background( &scheduler );
+      }
+    }
+
+    while ( !ASC_TASK_SCHEDULER_Idle( &scheduler ) )
+    {
+      _SleepUntil( _Now() + 1000000ULL );
+    }
+
+    ASC_TASK_SCHEDULER_GetStats( &scheduler, &stats );
+    _PrintResult( "scheduled", stats.worstTickNanoseconds, stats.meanTickNanoseconds, stats.tickOverruns,
+                  stats.minFrameLoad, stats.maxFrameLoad, stats.misses, stats.skipped );
+  }
+  else
+  {
+    fprintf( stderr, "cannot schedule %u axes, at most %u tasks\n",
+             (unsigned)numAxes, (unsigned)ASC_TASK_SCHEDULER_MAX_TASKS );
+  }
+
+  ASC_TASK_SCHEDULER_Destroy( &scheduler );
+
+  return status;
+}
+
+int main( int argc, char *argv[] )
+{
+  int exitCode = 1;
+  uint32_t numAxes = 256U;
+  uint32_t duration = 5U;
+  uint32_t numWorkers = 2U;
+  AXIS * axes = (AXIS*)0;
+  uint32_t i = 0U;
+  bool status = true;
+  int arg = 0;
+
+  for ( arg = 1; arg < argc; arg++ )
+  {
+    if ( ( strcmp( argv[ arg ], "-n" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      numAxes = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-t" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      duration = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-w" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      numWorkers = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else
+    {
+      fprintf( stderr, "usage: %s [-n axes] [-t seconds] [-w workers]\n", argv[ 0 ] );
+      return 1;
+    }
+  }
+
+  axes = (AXIS*)calloc( ( numAxes > 0U ) ? numAxes : 1U, sizeof( AXIS ) );
+
+  for ( i = 0U; axes && ( i < numAxes ) && status; i++ )
+  {
+    status = _SetupAxis( &axes[ i ], i );
+  }
+
+  if ( axes && status && ( numAxes > 0U ) && ( duration > 0U ) )
+  {
+    printf( "%u axes, %u s, 10 ms ticks, %u workers, load in RK4 steps\n",
+            (unsigned)numAxes, (unsigned)duration, (unsigned)numWorkers );
+    _RunAligned( axes, numAxes, duration * TICKS_PER_SECOND );
+
+    for ( i = 0U; i < numAxes; i++ )
+    {
+      status = status && _SetupAxis( &axes[ i ], i );
+    }
+
+    exitCode = ( status && _RunScheduled( axes, numAxes, duration * TICKS_PER_SECOND, numWorkers ) ) ? 0 : 1;
+  }
+
+  free( axes );
+
+  return exitCode;
+}
@@ -0,0 +1,83 @@
+/** 
+ * @file
+ * @brief Decodes binary telemetry files written by the telemetry consumer
+ * thread into CSV
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "telemetry.h"
+#include "thermal_model_state_space.h"
+#include <stdint.h>
+#include <stdio.h>
+
+int main( int argc, char *argv[] )
+{
+  int exitCode = 1;
+  FILE * file = ( argc > 1 ) ? fopen( argv[ 1 ], "rb" ) : (FILE*)0;
+  
+  if ( !file )
+  {
+    fprintf( stderr, "usage: %s <telemetry.bin>\n", argv[ 0 ] );
+  }
+  else
+  {
+    ASC_TELEMETRY_FILE_HEADER header;
+    
+    if ( ASC_TELEMETRY_ReadHeader( file, &header ) )
+    {
+      ASC_TELEMETRY_RECORD record;
+      uint32_t itr = 0U;
+      
+      printf( "timestamp_ms,axis,sequence,verdict" );
+      for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_OUTPUTS; itr++ )
+      {
+        printf( ",y%u", itr );
+      }
+      for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_INPUTS; itr++ )
+      {
+        printf( ",u%u", itr );
+      }
+      printf( "\n" );
+      
+      while ( fread( (void*)&record, sizeof( record ), 1U, file ) == 1U )
+      {
+        printf( "%llu,%u,%u,%u",
+                (unsigned long long)record.timestamp,
+                (unsigned int)record.axis,
+                (unsigned int)record.sequence,
+                (unsigned int)record.verdict );
+        for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_OUTPUTS; itr++ )
+        {
+          printf( ",%.4f", record.outputs[ itr ] );
+        }
+        for ( itr = 0U; itr < ASC_THERMAL_MODEL_NUM_INPUTS; itr++ )
+        {
+          printf( ",%.4f", record.inputs[ itr ] );
+        }
+        printf( "\n" );
+      }
+      
+      exitCode = 0;
+    }
+    else
+    {
+      fprintf( stderr, "%s: not a telemetry file for this model layout\n", argv[ 1 ] );
+    }
+    
+    fclose( file );
+  }
+  
+  return exitCode;
+}
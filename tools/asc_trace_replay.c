@@ -0,0 +1,285 @@
+/**
+ * @file
+ * @brief Replays one long drive trace through the thermal model on all cores
+ * and checks it against the sequential estimator
+ * @author Jon C. Anderson <andersonjc@msoe.edu>
+ * @copyright (C) Jon C. Anderson 2019
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * usage: asc_trace_replay [-j workers] [-q] <trace.txt | -s seconds>
+ * The trace has one "current speed" pair (A, rad/s) per 1 s thermal period,
+ * commas are accepted as separators. -s replays a synthetic duty cycle
+ * instead. The outputs of every period are written to stdout as CSV unless
+ * -q is given. The timings go to stderr: the replay on one worker against
+ * the replay on all of them, and separately against a plain sequential loop
+ * of the same period operator, so the first ratio is the parallel speedup and
+ * the second what the scan costs over the loop it replaces. The largest
+ * difference to the sequential estimator, 10 RK4 steps per period, follows.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "thermal_model.h"
+#include "thermal_model_replay.h"
+#include "thermal_model_state_space.h"
+#include "thermal_model_step_operator.h"
+#include "work_pool.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_STATES ASC_THERMAL_MODEL_NUM_STATES
+#define NUM_INPUTS ASC_THERMAL_MODEL_NUM_INPUTS
+#define NUM_OUTPUTS ASC_THERMAL_MODEL_NUM_OUTPUTS
+
+/*!
+ * \brief Seconds since an arbitrary point
+ */
+static double _Now( void )
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/*!
+ * \brief Appends the heat source inputs of one period to a growing array
+ * \return success
+ */
+static bool _Append( float ** inputs, uint32_t * count, uint32_t * capacity, float current, float speed )
+{
+  bool status = true;
+
+  if ( *count == *capacity )
+  {
+    float * grown = (float*)0;
+
+    *capacity = ( *capacity > 0U ) ? ( *capacity * 2U ) : 4096U;
+    grown = (float*)realloc( (void*)*inputs, (size_t)*capacity * NUM_INPUTS * sizeof( float ) );
+    status = ( grown != (float*)0 );
+    *inputs = status ? grown : *inputs;
+  }
+
+  if ( status )
+  {
+    ASC_THERMAL_MODEL_CalculateSourceInputs( &( *inputs )[ *count * NUM_INPUTS ], current, speed );
+    ( *count )++;
+  }
+
+  return status;
+}
+
+int main( int argc, char *argv[] )
+{
+  int exitCode = 1;
+  uint32_t numWorkers = 0U;
+  bool quiet = false;
+  const char * path = (const char*)0;
+  uint32_t synthetic = 0U;
+  float * inputs = (float*)0;
+  uint32_t numSteps = 0U;
+  uint32_t capacity = 0U;
+  bool status = true;
+  int arg = 0;
+
+  for ( arg = 1; arg < argc; arg++ )
+  {
+    if ( ( strcmp( argv[ arg ], "-j" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      numWorkers = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( ( strcmp( argv[ arg ], "-s" ) == 0 ) && ( ( arg + 1 ) < argc ) )
+    {
+      synthetic = (uint32_t)strtoul( argv[ ++arg ], (char**)0, 10 );
+    }
+    else if ( strcmp( argv[ arg ], "-q" ) == 0 )
+    {
+      quiet = true;
+    }
+    else
+    {
+      path = argv[ arg ];
+    }
+  }
+
+  if ( synthetic > 0U )
+  {
+    uint32_t t = 0U;
+
+    // 20 s on at 4.6 A, 10 s at 1 A, every fifth minute idle
+    for ( t = 0U; ( t < synthetic ) && status; t++ )
+    {
+      bool idle = ( ( t / 60U ) % 5U ) == 4U;
+      bool on = ( t % 30U ) < 20U;
+
+      status = _Append( &inputs, &numSteps, &capacity,
+                        idle ? 0.0f : ( on ? 4.6f : 1.0f ),
+                        idle ? 0.0f : ( on ? 36.7f : 10.0f ) );
+    }
+  }
+  else if ( path )
+  {
+    FILE * file = fopen( path, "r" );
+    char line[ 256 ];
+
+    status = ( file != (FILE*)0 );
+
+    while ( status && fgets( line, (int)sizeof( line ), file ) )
+    {
+      char * comma = (char*)0;
+      float current = 0.0f;
+      float speed = 0.0f;
+
+      while ( ( comma = strchr( line, ',' ) ) != (char*)0 )
+      {
+        *comma = ' ';
+      }
+
+      if ( sscanf( line, "%f %f", &current, &speed ) == 2 )
+      {
+        status = _Append( &inputs, &numSteps, &capacity, current, speed );
+      }
+    }
+
+    if ( file )
+    {
+      fclose( file );
+    }
+  }
+
+  if ( !status || ( numSteps == 0U ) )
+  {
+    fprintf( stderr, "usage: %s [-j workers] [-q] <trace.txt | -s seconds>\n", argv[ 0 ] );
+  }
+  else
+  {
+    float * states = (float*)malloc( (size_t)numSteps * NUM_STATES * sizeof( float ) );
+    float * outputs = (float*)malloc( (size_t)numSteps * NUM_OUTPUTS * sizeof( float ) );
+    float * reference = (float*)malloc( (size_t)numSteps * NUM_OUTPUTS * sizeof( float ) );
+    float * loopOutputs = (float*)malloc( (size_t)numSteps * NUM_OUTPUTS * sizeof( float ) );
+    const float initialState[ NUM_STATES ] = { 0.0f, 0.0f, 0.0f };
+    ASC_THERMAL_MODEL_STEP_OPERATOR op;
+    ASC_WORK_POOL pool;
+    ASC_WORK_POOL single;
+
+    // the estimator's thermal period, 10 RK4 steps of 0.1 s
+    if ( states && outputs && reference && loopOutputs &&
+         ASC_THERMAL_MODEL_STEP_OPERATOR_FromSolver( &op, ASC_THERMAL_MODEL_config, 0.1f, 10U ) &&
+         ASC_WORK_POOL_Create( &pool, numWorkers ) && ASC_WORK_POOL_Create( &single, 1U ) &&
+         ASC_THERMAL_MODEL_Setup() )
+    {
+      float state[ NUM_STATES ] = { 0.0f, 0.0f, 0.0f };
+      float next[ NUM_STATES ];
+      double start = _Now();
+      double estimator = 0.0;
+      double loop = 0.0;
+      double oneWorker = 0.0;
+      double parallel = 0.0;
+      float maxError = 0.0f;
+      float maxLoopError = 0.0f;
+      uint32_t step = 0U;
+      uint32_t i = 0U;
+
+      for ( step = 0U; step < numSteps; step++ )
+      {
+        ASC_THERMAL_MODEL_SetInputs( &inputs[ step * NUM_INPUTS ] );
+        ASC_THERMAL_MODEL_PeriodicTask();
+        ASC_THERMAL_MODEL_GetCurrentTemp( &reference[ step * NUM_OUTPUTS ] );
+      }
+
+      estimator = _Now() - start;
+
+      // the same operator stepped one period after the other
+      start = _Now();
+
+      for ( step = 0U; ( step < numSteps ) && status; step++ )
+      {
+        ASC_THERMAL_MODEL_STEP_OPERATOR_Apply( &op, state, &inputs[ step * NUM_INPUTS ], next );
+        memcpy( (char*)state, (char*)next, sizeof( state ) );
+        status = ( RK4SOLVER_Output( ASC_THERMAL_MODEL_config, state, &inputs[ step * NUM_INPUTS ],
+                                     &loopOutputs[ step * NUM_OUTPUTS ] ) == 1U );
+      }
+
+      loop = _Now() - start;
+
+      start = _Now();
+      status = status && ASC_THERMAL_MODEL_REPLAY_Run( &single, ASC_THERMAL_MODEL_config, &op, initialState,
+                                                       inputs, numSteps, states, outputs );
+      oneWorker = _Now() - start;
+
+      start = _Now();
+      status = status && ASC_THERMAL_MODEL_REPLAY_Run( &pool, ASC_THERMAL_MODEL_config, &op, initialState,
+                                                       inputs, numSteps, states, outputs );
+      parallel = _Now() - start;
+
+      for ( i = 0U; i < numSteps * NUM_OUTPUTS; i++ )
+      {
+        float error = fabsf( outputs[ i ] - reference[ i ] );
+        float loopError = fabsf( outputs[ i ] - loopOutputs[ i ] );
+
+        maxError = ( error > maxError ) ? error : maxError;
+        maxLoopError = ( loopError > maxLoopError ) ? loopError : maxLoopError;
+      }
+
+      if ( status && !quiet )
+      {
+        printf( "t" );
+        for ( i = 0U; i < NUM_OUTPUTS; i++ )
+        {
+          printf( ",y%u", i );
+        }
+        printf( "\n" );
+
+        for ( step = 0U; step < numSteps; step++ )
+        {
+          printf( "%u", step + 1U );
+          for ( i = 0U; i < NUM_OUTPUTS; i++ )
+          {
+            printf( ",%.4f", outputs[ ( step * NUM_OUTPUTS ) + i ] );
+          }
+          printf( "\n" );
+        }
+      }
+
+      if ( status )
+      {
+        fprintf( stderr, "%u periods: replay on %u workers %.3f s, x%.2f over 1 worker %.3f s\n",
+                 numSteps, pool.numWorkers, parallel,
+                 ( parallel > 0.0 ) ? oneWorker / parallel : 0.0, oneWorker );
+        fprintf( stderr, "  x%.2f over the sequential operator loop %.3f s, max difference %.3e K\n",
+                 ( parallel > 0.0 ) ? loop / parallel : 0.0, loop, maxLoopError );
+        fprintf( stderr, "  sequential estimator %.3f s, max difference %.3e K\n", estimator, maxError );
+        exitCode = 0;
+      }
+
+      ASC_THERMAL_MODEL_Cleanup();
+      ASC_WORK_POOL_Destroy( &single );
+      ASC_WORK_POOL_Destroy( &pool );
+    }
+
+    free( (void*)states );
+    free( (void*)outputs );
+    free( (void*)reference );
+    free( (void*)loopOutputs );
+  }
+
+  free( (void*)inputs );
+
+  return exitCode;
+}